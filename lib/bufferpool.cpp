@@ -0,0 +1,414 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "bufferpool.hpp"
+#include "device.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+
+namespace OCLT
+{
+
+namespace
+{
+
+std::atomic<unsigned long long> iNextPoolId(0);
+
+// ids of pools between Init() and Clear(), thread caches of other ids
+// are dropped from the lists of the threads
+std::mutex iLivePoolsMutex;
+std::set<unsigned long long> iLivePools;
+
+// take a free buffer of capacity from bins
+bool iPop(std::map< size_t, std::vector<cl_mem> >& bins, size_t capacity,
+	cl_mem& mem)
+{
+	std::map< size_t, std::vector<cl_mem> >::iterator bin = bins.find(capacity);
+
+	if(bin == bins.end() || bin->second.empty())
+	{
+		return false;
+	}
+
+	mem = bin->second.back();
+	bin->second.pop_back();
+
+	return true;
+}
+
+// release buffers of bins, largest first, while held is above bytes.
+// returns the capacity released.
+size_t iRelease(std::map< size_t, std::vector<cl_mem> >& bins,
+	std::atomic<size_t>& held, size_t bytes, std::atomic<size_t>& destroys)
+{
+	size_t released = 0;
+
+	for(std::map< size_t, std::vector<cl_mem> >::reverse_iterator bin = bins.rbegin();
+		bin != bins.rend() && held > bytes; ++bin)
+	{
+		while(!bin->second.empty() && held > bytes)
+		{
+			clReleaseMemObject(bin->second.back());
+			bin->second.pop_back();
+			held -= bin->first;
+			released += bin->first;
+			++destroys;
+		}
+	}
+
+	return released;
+}
+
+size_t iClamp(cl_ulong value)
+{
+	return static_cast<size_t>(std::min<cl_ulong>(
+		value, std::numeric_limits<size_t>::max()));
+}
+
+}
+
+double BufferPoolStats::HitRate() const
+{
+	return requests ? static_cast<double>(threadHits + sharedHits) / requests : 0;
+}
+
+double BufferPoolStats::Fragmentation() const
+{
+	return bytesInUse ?
+		static_cast<double>(bytesInUse - bytesRequested) / bytesInUse : 0;
+}
+
+BufferPool::ThreadCache::ThreadCache()
+	: bytes(0), requests(0), threadHits(0), sharedHits(0), creates(0)
+{
+}
+
+BufferPool::BufferPool()
+	: id_(0), context_(NULL), alignment_(1), maxAlloc_(0), globalMem_(0),
+	maxHeld_(0), sharedBytes_(0), destroys_(0), bytesHeld_(0), bytesInUse_(0),
+	bytesRequested_(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+	Clear();
+}
+
+void BufferPool::Clear()
+{
+	Trim(0);
+
+	{
+		std::lock_guard<std::mutex> lock(iLivePoolsMutex);
+		iLivePools.erase(id_);
+	}
+
+	std::lock_guard<std::mutex> lock(cachesMutex_);
+
+	caches_.clear();
+	shared_.clear();
+	sharedBytes_ = 0;
+	destroys_ = 0;
+	bytesHeld_ = 0;
+	bytesInUse_ = 0;
+	bytesRequested_ = 0;
+
+	if(context_)
+	{
+		clReleaseContext(context_);
+		context_ = NULL;
+	}
+}
+
+cl_int BufferPool::Init(cl_context context, cl_device_id device,
+	const BufferPoolOptions& options)
+{
+	Clear();
+
+	// CL_DEVICE_MEM_BASE_ADDR_ALIGN is in bits
+	alignment_ = std::max<size_t>(1,
+		GetDeviceInfoValue<cl_uint>(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN) / 8);
+	maxAlloc_ = iClamp(
+		GetDeviceInfoValue<cl_ulong>(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE));
+	globalMem_ = iClamp(
+		GetDeviceInfoValue<cl_ulong>(device, CL_DEVICE_GLOBAL_MEM_SIZE));
+
+	if(!maxAlloc_ || !globalMem_)
+	{
+		return CL_INVALID_DEVICE;
+	}
+
+	if(cl_int err = clRetainContext(context))
+	{
+		return err;
+	}
+
+	id_ = ++iNextPoolId;
+	context_ = context;
+
+	{
+		std::lock_guard<std::mutex> lock(iLivePoolsMutex);
+		iLivePools.insert(id_);
+	}
+	options_ = options;
+	maxHeld_ = static_cast<size_t>(globalMem_ * std::min(options.heldFraction, 1.0));
+
+	return CL_SUCCESS;
+}
+
+size_t BufferPool::ClassSize(size_t size) const
+{
+	if(!size || size > maxAlloc_)
+	{
+		return 0;
+	}
+
+	size_t step = alignment_;
+
+	// a quarter of the power of two below size
+	if(size > 4 * alignment_)
+	{
+		size_t power = 1;
+
+		while(power <= (size - 1) / 2)
+		{
+			power *= 2;
+		}
+
+		step = std::max(alignment_, power / 4);
+	}
+
+	return std::min((size + step - 1) / step * step, maxAlloc_);
+}
+
+BufferPool::ThreadCache& BufferPool::GetThreadCache()
+{
+	static thread_local std::vector< std::pair<unsigned long long, ThreadCache*> > caches;
+
+	for(size_t i = 0; i < caches.size(); ++i)
+	{
+		if(caches[i].first == id_)
+		{
+			return *caches[i].second;
+		}
+	}
+
+	// a miss is the first use by this thread, a good time to forget the
+	// caches of pools which were cleared or destroyed since
+	{
+		std::lock_guard<std::mutex> lock(iLivePoolsMutex);
+
+		for(size_t i = 0; i < caches.size(); )
+		{
+			if(iLivePools.count(caches[i].first))
+			{
+				++i;
+				continue;
+			}
+
+			caches[i] = caches.back();
+			caches.pop_back();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(cachesMutex_);
+
+	caches_.push_back(std::unique_ptr<ThreadCache>(new ThreadCache));
+	caches.push_back(std::make_pair(id_, caches_.back().get()));
+
+	return *caches_.back();
+}
+
+cl_int BufferPool::Acquire(size_t size, PooledBuffer& buffer)
+{
+	if(!context_)
+	{
+		return CL_INVALID_CONTEXT;
+	}
+
+	size_t capacity = ClassSize(size);
+
+	if(!capacity)
+	{
+		return CL_INVALID_BUFFER_SIZE;
+	}
+
+	ThreadCache& cache = GetThreadCache();
+	cl_mem mem = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+
+		++cache.requests;
+
+		if(iPop(cache.bins, capacity, mem))
+		{
+			cache.bytes -= capacity;
+			++cache.threadHits;
+		}
+		else
+		{
+			std::lock_guard<std::mutex> shared_lock(sharedMutex_);
+
+			if(iPop(shared_, capacity, mem))
+			{
+				sharedBytes_ -= capacity;
+				++cache.sharedHits;
+			}
+		}
+	}
+
+	if(mem)
+	{
+		bytesHeld_ -= capacity;
+	}
+	else
+	{
+		// free buffers make room for the new one on the device
+		size_t in_use = bytesInUse_ + capacity;
+
+		if(in_use + bytesHeld_ > globalMem_)
+		{
+			Trim(globalMem_ > in_use ? globalMem_ - in_use : 0);
+		}
+
+		cl_int err;
+		mem = clCreateBuffer(context_, options_.flags, capacity, NULL, &err);
+
+		if(err == CL_MEM_OBJECT_ALLOCATION_FAILURE || err == CL_OUT_OF_RESOURCES ||
+			err == CL_OUT_OF_HOST_MEMORY)
+		{
+			Trim(0);
+			mem = clCreateBuffer(context_, options_.flags, capacity, NULL, &err);
+		}
+
+		if(err)
+		{
+			return err;
+		}
+
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		++cache.creates;
+	}
+
+	bytesInUse_ += capacity;
+	bytesRequested_ += size;
+
+	buffer.mem = mem;
+	buffer.size = size;
+	buffer.capacity = capacity;
+
+	return CL_SUCCESS;
+}
+
+void BufferPool::Release(PooledBuffer& buffer)
+{
+	if(!buffer.mem)
+	{
+		return;
+	}
+
+	size_t capacity = buffer.capacity;
+	ThreadCache& cache = GetThreadCache();
+	bool kept = false;
+
+	bytesInUse_ -= capacity;
+	bytesRequested_ -= buffer.size;
+	bytesHeld_ += capacity;
+
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		std::vector<cl_mem>& bin = cache.bins[capacity];
+
+		if(bytesHeld_ <= maxHeld_ &&
+			cache.bytes + capacity <= options_.threadCacheBytes &&
+			bin.size() < options_.threadCacheBuffers)
+		{
+			bin.push_back(buffer.mem);
+			cache.bytes += capacity;
+			kept = true;
+		}
+	}
+
+	if(!kept)
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex_);
+
+		shared_[capacity].push_back(buffer.mem);
+		sharedBytes_ += capacity;
+
+		if(bytesHeld_ > maxHeld_)
+		{
+			TrimShared(maxHeld_);
+		}
+	}
+
+	buffer = PooledBuffer();
+}
+
+void BufferPool::TrimShared(size_t bytes)
+{
+	sharedBytes_ -= iRelease(shared_, bytesHeld_, bytes, destroys_);
+}
+
+void BufferPool::Trim(size_t bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex_);
+		TrimShared(bytes);
+	}
+
+	std::lock_guard<std::mutex> lock(cachesMutex_);
+
+	for(size_t i = 0; i < caches_.size() && bytesHeld_ > bytes; ++i)
+	{
+		ThreadCache& cache = *caches_[i];
+		std::lock_guard<std::mutex> cache_lock(cache.mutex);
+
+		cache.bytes -= iRelease(cache.bins, bytesHeld_, bytes, destroys_);
+	}
+}
+
+void BufferPool::GetStats(BufferPoolStats& stats) const
+{
+	stats = BufferPoolStats();
+
+	{
+		std::lock_guard<std::mutex> lock(cachesMutex_);
+
+		for(size_t i = 0; i < caches_.size(); ++i)
+		{
+			const ThreadCache& cache = *caches_[i];
+			std::lock_guard<std::mutex> cache_lock(cache.mutex);
+
+			stats.requests += cache.requests;
+			stats.threadHits += cache.threadHits;
+			stats.sharedHits += cache.sharedHits;
+			stats.creates += cache.creates;
+		}
+	}
+
+	stats.destroys = destroys_;
+	stats.bytesInUse = bytesInUse_;
+	stats.bytesRequested = bytesRequested_;
+	stats.bytesHeld = bytesHeld_;
+}
+
+}
@@ -0,0 +1,167 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_BUFFERPOOL_HPP_
+#define OCLC_BUFFERPOOL_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace OCLT
+{
+
+struct BufferPoolOptions
+{
+	BufferPoolOptions()
+		: flags(CL_MEM_READ_WRITE), heldFraction(0.25), threadCacheBytes(16 << 20),
+		threadCacheBuffers(4)
+	{
+	}
+
+	// of every buffer of the pool
+	cl_mem_flags flags;
+	// free buffers the pool keeps, of CL_DEVICE_GLOBAL_MEM_SIZE
+	double heldFraction;
+	// free buffers a thread keeps for itself, in bytes and per size class
+	size_t threadCacheBytes;
+	size_t threadCacheBuffers;
+};
+
+// a buffer of the pool, capacity is the size of its class
+struct PooledBuffer
+{
+	PooledBuffer() : mem(NULL), size(0), capacity(0) {}
+
+	cl_mem mem;
+	size_t size;
+	size_t capacity;
+};
+
+struct BufferPoolStats
+{
+	size_t requests;
+	size_t threadHits;     // served from the cache of the thread
+	size_t sharedHits;     // served from the bins of the pool
+	size_t creates;        // clCreateBuffer
+	size_t destroys;       // clReleaseMemObject by trimming
+	size_t bytesInUse;     // capacity of buffers handed out
+	size_t bytesRequested; // size asked for of those
+	size_t bytesHeld;      // capacity of free buffers kept
+
+	// of requests served without clCreateBuffer
+	double HitRate() const;
+	// capacity in use beyond the sizes asked for, of the capacity in use
+	double Fragmentation() const;
+};
+
+// recycles buffers of one context instead of creating and releasing them
+// per use. sizes are rounded up to classes, multiples of
+// CL_DEVICE_MEM_BASE_ADDR_ALIGN below 4 of them and 4 classes per power of
+// two above, so a buffer wastes at most a quarter. a released buffer goes
+// to the cache of the releasing thread, and when that is full to the
+// bins of the pool, and Acquire() looks in the same order before calling
+// clCreateBuffer. free buffers beyond heldFraction of
+// CL_DEVICE_GLOBAL_MEM_SIZE are released, largest first, and so are free
+// buffers when a new one would not fit the device or clCreateBuffer runs
+// out of memory. sizes beyond CL_DEVICE_MAX_MEM_ALLOC_SIZE fail with
+// CL_INVALID_BUFFER_SIZE. every member but Init() may be called from
+// several threads at once. buffers must be released to the pool before
+// it is destroyed or initialized again.
+class BufferPool
+{
+public:
+	BufferPool();
+	~BufferPool();
+
+	// buffers of context, limits of device
+	cl_int Init(cl_context context, cl_device_id device,
+		const BufferPoolOptions& options = BufferPoolOptions());
+
+	// a buffer of at least size bytes, contents undefined
+	cl_int Acquire(size_t size, PooledBuffer& buffer);
+	// give back a buffer of Acquire(), buffer is cleared
+	void Release(PooledBuffer& buffer);
+
+	// release free buffers, largest first, until at most bytes are held
+	void Trim(size_t bytes);
+
+	// capacity of the class of size, 0 beyond the largest allocation
+	size_t ClassSize(size_t size) const;
+
+	void GetStats(BufferPoolStats& stats) const;
+
+private:
+	BufferPool(const BufferPool&);
+	BufferPool& operator=(const BufferPool&);
+
+	typedef std::map< size_t, std::vector<cl_mem> > Bins;
+
+	// free buffers and counters of one thread, its mutex is only
+	// contended by Trim() and GetStats()
+	struct ThreadCache
+	{
+		ThreadCache();
+
+		mutable std::mutex mutex;
+		Bins bins;
+		size_t bytes;
+		size_t requests;
+		size_t threadHits;
+		size_t sharedHits;
+		size_t creates;
+	};
+
+	ThreadCache& GetThreadCache();
+	void Clear();
+	// release shared buffers, largest first, until held is at most bytes,
+	// called with sharedMutex_ held
+	void TrimShared(size_t bytes);
+
+	unsigned long long id_;  // new for every Init(), keys thread caches
+	cl_context context_;
+	BufferPoolOptions options_;
+	size_t alignment_;
+	size_t maxAlloc_;
+	size_t globalMem_;
+	size_t maxHeld_;
+
+	mutable std::mutex cachesMutex_;
+	std::vector< std::unique_ptr<ThreadCache> > caches_;
+
+	mutable std::mutex sharedMutex_;
+	Bins shared_;
+	size_t sharedBytes_;
+
+	std::atomic<size_t> destroys_;
+	std::atomic<size_t> bytesHeld_;
+	std::atomic<size_t> bytesInUse_;
+	std::atomic<size_t> bytesRequested_;
+};
+
+}
+
+#endif
@@ -0,0 +1,575 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "build.hpp"
+#include "clx.hpp"
+#include "device.hpp"
+#include "file.hpp"
+#include "trace.hpp"
+
+#include <sstream>
+#include <thread>
+
+namespace OCLT
+{
+
+static cl_int BuildEachDevice(
+	cl_program program, const std::vector<cl_device_id>& device_ids,
+	const std::string& build_options);
+
+cl_int GetPlatformIDs(std::vector<cl_platform_id>& platform_ids)
+{
+	TraceSpan span("clGetPlatformIDs");
+
+	cl_uint num_platforms = 0;
+
+	platform_ids.clear();
+
+	if(cl_int err = clGetPlatformIDs(0, NULL, &num_platforms))
+	{
+		return err;
+	}
+
+	if(!num_platforms)
+	{
+		return CL_SUCCESS;
+	}
+
+	platform_ids.resize(num_platforms);
+
+	return clGetPlatformIDs(num_platforms, &platform_ids[0], NULL);
+}
+
+cl_int GetDeviceIDs(
+	cl_platform_id platform_id, std::vector<cl_device_id>& device_ids)
+{
+	TraceSpan span("clGetDeviceIDs");
+
+	cl_uint num_devices = 0;
+
+	device_ids.clear();
+
+	if(cl_int err = clGetDeviceIDs(
+		platform_id, CL_DEVICE_TYPE_ALL, 0, NULL, &num_devices))
+	{
+		return err == CL_DEVICE_NOT_FOUND ? CL_SUCCESS : err;
+	}
+
+	if(!num_devices)
+	{
+		return CL_SUCCESS;
+	}
+
+	device_ids.resize(num_devices);
+
+	return clGetDeviceIDs(
+		platform_id, CL_DEVICE_TYPE_ALL, num_devices, &device_ids[0], NULL);
+}
+
+cl_int CreatePlatformContext(
+	cl_platform_id platform_id, PlatformContext& context)
+{
+	context.platform_id = platform_id;
+	context.context = NULL;
+
+	if(cl_int err = GetDeviceIDs(platform_id, context.device_ids))
+	{
+		return err;
+	}
+
+	if(context.device_ids.empty())
+	{
+		return CL_DEVICE_NOT_FOUND;
+	}
+
+	TraceSpan span("clCreateContext");
+
+	cl_int errcode_ret;
+	context.context = clCreateContext(
+		NULL, context.device_ids.size(), &context.device_ids[0],
+		NULL, NULL, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		context.context = NULL;
+	}
+
+	return errcode_ret;
+}
+
+void ReleasePlatformContext(PlatformContext& context)
+{
+	if(context.context)
+	{
+		clReleaseContext(context.context);
+		context.context = NULL;
+	}
+}
+
+void BuildProgram(
+	const PlatformContext& context,
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	PlatformBuild& result)
+{
+	using namespace std;
+
+	result.platform_id = context.platform_id;
+	result.error = CL_SUCCESS;
+	result.log.clear();
+	result.binaries.clear();
+
+	vector<const char*> srcPtrs(sources.size());
+	vector<size_t> srcSizes(sources.size());
+
+	for(size_t i = 0; i < sources.size(); ++i)
+	{
+		// a zero length means null terminated, so empty text must be ""
+		srcPtrs[i] = sources[i].size ? sources[i].data : "";
+		srcSizes[i] = sources[i].size;
+	}
+
+	cl_int errcode_ret;
+	cl_program program;
+
+	{
+		TraceSpan span("clCreateProgramWithSource");
+		program = clCreateProgramWithSource(
+			context.context, sources.size(), &srcPtrs[0], &srcSizes[0],
+			&errcode_ret);
+	}
+
+	if( (result.error = errcode_ret) )
+	{
+		return;
+	}
+
+	// serializes the devices, documented with --trace and --time-report
+	if(TraceEnabled())
+	{
+		result.error = BuildEachDevice(program, context.device_ids, build_options);
+	}
+	else
+	{
+		result.error = clBuildProgram(
+			program, 0, NULL, build_options.c_str(), NULL, NULL);
+	}
+
+	if(result.error)
+	{
+		GetBuildLog(program, context.device_ids, result.log);
+	}
+	else
+	{
+		result.error = GetProgramBinaries(program, result.binaries);
+	}
+
+	clReleaseProgram(program);
+}
+
+void BuildProgram(
+	cl_platform_id platform_id,
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	PlatformBuild& result)
+{
+	PlatformContext context;
+
+	result.platform_id = platform_id;
+	result.log.clear();
+	result.binaries.clear();
+
+	if( (result.error = CreatePlatformContext(platform_id, context)) )
+	{
+		return;
+	}
+
+	BuildProgram(context, sources, build_options, result);
+
+	ReleasePlatformContext(context);
+}
+
+void CompileProgram(
+	const PlatformContext& context,
+	const SourceText& source,
+	const std::string& compile_options,
+	PlatformBuild& result)
+{
+	result.platform_id = context.platform_id;
+	result.log.clear();
+	result.binaries.clear();
+
+	const char* srcPtr = source.size ? source.data : "";
+
+	cl_int errcode_ret;
+	cl_program program;
+
+	{
+		TraceSpan span("clCreateProgramWithSource");
+		program = clCreateProgramWithSource(
+			context.context, 1, &srcPtr, &source.size, &errcode_ret);
+	}
+
+	if( (result.error = errcode_ret) )
+	{
+		return;
+	}
+
+	{
+		TraceSpan span("clCompileProgram");
+#ifdef CL_VERSION_1_2
+		result.error = clCompileProgram(
+			program, 0, NULL, compile_options.c_str(), 0, NULL, NULL, NULL, NULL);
+#else
+		result.error = CL_INVALID_OPERATION;
+#endif
+	}
+
+	if(result.error)
+	{
+		GetBuildLog(program, context.device_ids, result.log);
+	}
+	else
+	{
+		result.error = GetProgramBinaries(program, result.binaries);
+	}
+
+	clReleaseProgram(program);
+}
+
+void LinkProgram(
+	const PlatformContext& context,
+	const std::vector<const PlatformBuild*>& units,
+	const std::string& link_options,
+	PlatformBuild& result)
+{
+	using namespace std;
+
+	result.platform_id = context.platform_id;
+	result.error = CL_SUCCESS;
+	result.log.clear();
+	result.binaries.clear();
+
+	vector<cl_program> programs;
+
+	for(size_t i = 0; i < units.size() && !result.error; ++i)
+	{
+		vector<size_t> sizes;
+		vector<const unsigned char*> binaries;
+
+		for(size_t j = 0; j < context.device_ids.size(); ++j)
+		{
+			const vector<DeviceBinary>& unitBinaries = units[i]->binaries;
+			size_t k = 0;
+
+			while(k < unitBinaries.size() &&
+				unitBinaries[k].device_id != context.device_ids[j])
+			{
+				++k;
+			}
+
+			if(k == unitBinaries.size() || unitBinaries[k].binary.empty())
+			{
+				result.error = CL_INVALID_BINARY;
+				break;
+			}
+
+			sizes.push_back(unitBinaries[k].binary.size());
+			binaries.push_back(&unitBinaries[k].binary[0]);
+		}
+
+		if(result.error)
+		{
+			break;
+		}
+
+		cl_int errcode_ret;
+		cl_program program = clCreateProgramWithBinary(
+			context.context, context.device_ids.size(), &context.device_ids[0],
+			&sizes[0], &binaries[0], NULL, &errcode_ret);
+
+		if( (result.error = errcode_ret) )
+		{
+			break;
+		}
+
+		programs.push_back(program);
+	}
+
+	if(!result.error && !programs.empty())
+	{
+		TraceSpan span("clLinkProgram");
+
+		cl_int errcode_ret;
+#ifdef CL_VERSION_1_2
+		cl_program program = clLinkProgram(
+			context.context, 0, NULL, link_options.c_str(),
+			programs.size(), &programs[0], NULL, NULL, &errcode_ret);
+#else
+		cl_program program = NULL;
+		errcode_ret = CL_INVALID_OPERATION;
+#endif
+
+		result.error = errcode_ret;
+
+		if(program)
+		{
+			if(result.error)
+			{
+				GetBuildLog(program, context.device_ids, result.log);
+			}
+			else
+			{
+				result.error = GetProgramBinaries(program, result.binaries);
+			}
+
+			clReleaseProgram(program);
+		}
+	}
+
+	for(vector<cl_program>::iterator itr = programs.begin();
+		itr != programs.end(); ++itr)
+	{
+		clReleaseProgram(*itr);
+	}
+}
+
+void BuildProgramAllPlatforms(
+	const std::vector<cl_platform_id>& platform_ids,
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	std::vector<PlatformBuild>& results)
+{
+	using namespace std;
+
+	results.resize(platform_ids.size());
+
+	vector<thread> threads;
+	threads.reserve(platform_ids.size());
+
+	for(size_t i = 0; i < platform_ids.size(); ++i)
+	{
+		threads.push_back( thread([&, i]()
+		{
+			ostringstream name;
+			name << "platform " << i;
+			SetTraceThreadName(name.str());
+
+			BuildProgram(platform_ids[i], sources, build_options, results[i]);
+		}) );
+	}
+
+	for(vector<thread>::iterator itr = threads.begin();
+		itr != threads.end(); ++itr)
+	{
+		itr->join();
+	}
+}
+
+bool SaveBinaries(
+	const std::string& outfile, const std::vector<PlatformBuild>& results,
+	bool raw, bool per_device, bool compress)
+{
+	using namespace std;
+
+	TraceSpan span("save binaries", outfile);
+
+	if(raw)
+	{
+		for(size_t i = 0; i < results.size(); ++i)
+		{
+			if(results[i].error) continue;
+
+			for(size_t j = 0; j < results[i].binaries.size(); ++j)
+			{
+				const vector<unsigned char>& binary = results[i].binaries[j].binary;
+
+				if(!WriteFileAtomic(
+					per_device ? DeviceOutfile(outfile, i, j) : outfile,
+					binary.empty() ? NULL : &binary[0], binary.size()))
+				{
+					return false;
+				}
+
+				if(!per_device) return true;
+			}
+		}
+
+		return true;
+	}
+
+	ClxWriter writer;
+	writer.SetCompression(compress);
+
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		if(results[i].error) continue;
+
+		for(size_t j = 0; j < results[i].binaries.size(); ++j)
+		{
+			const DeviceBinary& binary = results[i].binaries[j];
+
+			writer.Add(GetDeviceFingerprint(binary.device_id),
+				binary.binary.empty() ? NULL : &binary.binary[0],
+				binary.binary.size());
+		}
+	}
+
+	return !writer.EntryCount() || writer.Write(outfile);
+}
+
+std::string DeviceOutfile(
+	const std::string& outfile, size_t platform_index, size_t device_index)
+{
+	using namespace std;
+
+	string::size_type slash = outfile.find_last_of('/');
+	string::size_type dot = outfile.find_last_of('.');
+
+	if(dot == string::npos || (slash != string::npos && dot < slash))
+	{
+		dot = outfile.size();
+	}
+
+	ostringstream oss;
+	oss << outfile.substr(0, dot) << "." << platform_index << "." <<
+		device_index << outfile.substr(dot);
+
+	return oss.str();
+}
+
+cl_int GetBuildLog(
+	cl_program program, const std::vector<cl_device_id>& device_ids,
+	std::string& log)
+{
+	using namespace std;
+
+	log.clear();
+
+	for(vector<cl_device_id>::const_iterator itr = device_ids.begin();
+		itr != device_ids.end(); ++itr)
+	{
+		size_t log_size = 0;
+
+		if(cl_int err = clGetProgramBuildInfo(
+			program, *itr, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size))
+		{
+			return err;
+		}
+
+		if(log_size <= 1)
+		{
+			continue;
+		}
+
+		vector<char> build_log(log_size);
+
+		if(cl_int err = clGetProgramBuildInfo(
+			program, *itr, CL_PROGRAM_BUILD_LOG, log_size, &build_log[0], NULL))
+		{
+			return err;
+		}
+
+		log.append(&build_log[0]);
+		log.append("\n");
+	}
+
+	return CL_SUCCESS;
+}
+
+cl_int GetProgramBinaries(
+	cl_program program, std::vector<DeviceBinary>& binaries)
+{
+	using namespace std;
+
+	TraceSpan span("get binaries");
+
+	cl_uint num_program_devices = 0;
+
+	if(cl_int err = clGetProgramInfo(
+		program, CL_PROGRAM_NUM_DEVICES, sizeof(num_program_devices),
+		&num_program_devices, NULL))
+	{
+		return err;
+	}
+
+	if(!num_program_devices)
+	{
+		return CL_INVALID_PROGRAM_EXECUTABLE;
+	}
+
+	vector<cl_device_id> program_devices(num_program_devices);
+
+	if(cl_int err = clGetProgramInfo(
+		program, CL_PROGRAM_DEVICES,
+		sizeof(cl_device_id) * num_program_devices, &program_devices[0], NULL))
+	{
+		return err;
+	}
+
+	vector<size_t> programSizes(num_program_devices);
+
+	if(cl_int err = clGetProgramInfo(
+		program, CL_PROGRAM_BINARY_SIZES,
+		sizeof(size_t) * num_program_devices, &programSizes[0], NULL))
+	{
+		return err;
+	}
+
+	binaries.resize(num_program_devices);
+	vector<unsigned char*> binaryPtrs(num_program_devices);
+
+	for(size_t i = 0; i < num_program_devices; ++i)
+	{
+		binaries[i].device_id = program_devices[i];
+		binaries[i].binary.resize(programSizes[i]);
+		binaryPtrs[i] = programSizes[i] ? &binaries[i].binary[0] : NULL;
+	}
+
+	return clGetProgramInfo(program, CL_PROGRAM_BINARIES,
+		sizeof(unsigned char*) * num_program_devices, &binaryPtrs[0], NULL);
+}
+
+// build one device at a time, so that the trace shows each device.
+// every device is built even after a failure to collect all logs.
+static cl_int BuildEachDevice(
+	cl_program program, const std::vector<cl_device_id>& device_ids,
+	const std::string& build_options)
+{
+	using namespace std;
+
+	cl_int error = CL_SUCCESS;
+
+	for(vector<cl_device_id>::const_iterator itr = device_ids.begin();
+		itr != device_ids.end(); ++itr)
+	{
+		TraceSpan span("clBuildProgram", GetDeviceInfoString(*itr, CL_DEVICE_NAME));
+
+		cl_int err = clBuildProgram(
+			program, 1, &*itr, build_options.c_str(), NULL, NULL);
+
+		if(err && !error)
+		{
+			error = err;
+		}
+	}
+
+	return error;
+}
+
+}
@@ -0,0 +1,140 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_BUILD_HPP_
+#define OCLC_BUILD_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// program source text passed to clCreateProgramWithSource as is,
+// the memory is owned by the caller (see SourceFiles)
+struct SourceText
+{
+	const char* data;
+	size_t size;
+};
+
+// program binary built for one device
+struct DeviceBinary
+{
+	cl_device_id device_id;
+	std::vector<unsigned char> binary;
+};
+
+// result of building sources for every device of one platform
+struct PlatformBuild
+{
+	cl_platform_id platform_id;
+	cl_int error;
+	std::string log;
+	std::vector<DeviceBinary> binaries;
+};
+
+// context holding every device of a platform, shared by builds
+struct PlatformContext
+{
+	PlatformContext() : platform_id(NULL), context(NULL) {}
+
+	cl_platform_id platform_id;
+	std::vector<cl_device_id> device_ids;
+	cl_context context;
+};
+
+cl_int GetPlatformIDs(std::vector<cl_platform_id>& platform_ids);
+cl_int GetDeviceIDs(
+	cl_platform_id platform_id, std::vector<cl_device_id>& device_ids);
+
+// returns CL_DEVICE_NOT_FOUND for a platform without devices
+cl_int CreatePlatformContext(
+	cl_platform_id platform_id, PlatformContext& context);
+void ReleasePlatformContext(PlatformContext& context);
+
+// build sources for all devices of context.
+// functions below never exit, errors are returned in result.error.
+// builds on one context may run concurrently.
+void BuildProgram(
+	const PlatformContext& context,
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	PlatformBuild& result);
+
+// create a context for platform_id, build and release the context
+void BuildProgram(
+	cl_platform_id platform_id,
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	PlatformBuild& result);
+
+// compile one source into an object for every device of context with
+// clCompileProgram. result.binaries hold the objects. CL_INVALID_OPERATION
+// when built with headers older than OpenCL 1.2, as LinkProgram.
+void CompileProgram(
+	const PlatformContext& context,
+	const SourceText& source,
+	const std::string& compile_options,
+	PlatformBuild& result);
+
+// link objects or libraries with clLinkProgram into an executable, or into
+// a library with -create-library in link_options. every unit must hold a
+// binary for each device of context.
+void LinkProgram(
+	const PlatformContext& context,
+	const std::vector<const PlatformBuild*>& units,
+	const std::string& link_options,
+	PlatformBuild& result);
+
+// build sources for each platform concurrently, one thread per platform.
+void BuildProgramAllPlatforms(
+	const std::vector<cl_platform_id>& platform_ids,
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	std::vector<PlatformBuild>& results);
+
+// write the binaries of successful results to outfile as a clx container,
+// compressed with compress. with raw, bare binaries are written instead,
+// to outfile or with per_device to DeviceOutfile() for each device.
+// returns false and sets errno on failure.
+bool SaveBinaries(
+	const std::string& outfile, const std::vector<PlatformBuild>& results,
+	bool raw, bool per_device, bool compress);
+
+// build logs of every device of program which has one, concatenated
+cl_int GetBuildLog(
+	cl_program program, const std::vector<cl_device_id>& device_ids,
+	std::string& log);
+
+// the binary of every device of a built program
+cl_int GetProgramBinaries(
+	cl_program program, std::vector<DeviceBinary>& binaries);
+
+// outfile with ".<platform>.<device>" inserted before the extension
+std::string DeviceOutfile(
+	const std::string& outfile, size_t platform_index, size_t device_index);
+
+}
+
+#endif
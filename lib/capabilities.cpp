@@ -0,0 +1,536 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "capabilities.hpp"
+#include "device.hpp"
+#include "file.hpp"
+#include "sha256.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+const char* const iMagic = "oclt-capabilities 1";
+
+// calls visit(key, member) for every member of caps, shared by the
+// writer and the reader so that both agree on keys
+template<typename Caps, typename Visitor>
+void iVisit(Caps& caps, Visitor& visit)
+{
+	visit("platform", caps.platform);
+	visit("platform_version", caps.platformVersion);
+	visit("name", caps.name);
+	visit("vendor", caps.vendor);
+	visit("version", caps.version);
+	visit("driver_version", caps.driverVersion);
+	visit("opencl_c_version", caps.openclCVersion);
+	visit("profile", caps.profile);
+	visit("extensions", caps.extensions);
+	visit("type", caps.type);
+	visit("vendor_id", caps.vendorId);
+	visit("compute_units", caps.computeUnits);
+	visit("max_clock_frequency", caps.maxClockFrequency);
+	visit("address_bits", caps.addressBits);
+	visit("max_work_item_sizes", caps.maxWorkItemSizes);
+	visit("max_work_group_size", caps.maxWorkGroupSize);
+	visit("preferred_vector_widths", caps.preferredVectorWidths);
+	visit("native_vector_widths", caps.nativeVectorWidths);
+	visit("global_mem_size", caps.globalMemSize);
+	visit("global_mem_cache_size", caps.globalMemCacheSize);
+	visit("global_mem_cacheline_size", caps.globalMemCachelineSize);
+	visit("local_mem_size", caps.localMemSize);
+	visit("max_mem_alloc_size", caps.maxMemAllocSize);
+	visit("max_constant_buffer_size", caps.maxConstantBufferSize);
+	visit("max_constant_args", caps.maxConstantArgs);
+	visit("max_parameter_size", caps.maxParameterSize);
+	visit("mem_base_addr_align", caps.memBaseAddrAlign);
+	visit("min_data_type_align_size", caps.minDataTypeAlignSize);
+	visit("image_support", caps.imageSupport);
+	visit("host_unified_memory", caps.unifiedMemory);
+	visit("error_correction_support", caps.errorCorrection);
+	visit("available", caps.available);
+	visit("compiler_available", caps.compilerAvailable);
+	visit("single_fp_config", caps.singleFpConfig);
+	visit("queue_properties", caps.queueProperties);
+	visit("execution_capabilities", caps.executionCapabilities);
+	visit("profiling_timer_resolution", caps.profilingTimerResolution);
+}
+
+struct iWriter
+{
+	std::ostringstream out;
+
+	void operator()(const char* key, const std::string& value)
+	{
+		out << key << " " << value << "\n";
+	}
+
+	template<typename T>
+	void operator()(const char* key, const std::vector<T>& values)
+	{
+		out << key;
+
+		for(size_t i = 0; i < values.size(); ++i)
+		{
+			out << " " << values[i];
+		}
+
+		out << "\n";
+	}
+
+	template<typename T>
+	void operator()(const char* key, const T& value)
+	{
+		out << key << " " << value << "\n";
+	}
+};
+
+struct iReader
+{
+	const std::map<std::string, std::string>& values;
+	bool ok;
+
+	void operator()(const char* key, std::string& value)
+	{
+		std::map<std::string, std::string>::const_iterator itr = values.find(key);
+
+		if(itr != values.end())
+		{
+			value = itr->second;
+		}
+	}
+
+	template<typename T>
+	void operator()(const char* key, std::vector<T>& values)
+	{
+		std::string str;
+		(*this)(key, str);
+
+		const char* begin = str.c_str();
+		char* end;
+
+		values.clear();
+
+		while(*begin)
+		{
+			values.push_back(static_cast<T>(strtoull(begin, &end, 10)));
+			ok = ok && end != begin && (*end == ' ' || !*end);
+			begin = *end && end != begin ? end + 1 : "";
+		}
+	}
+
+	template<typename T>
+	void operator()(const char* key, T& value)
+	{
+		std::string str;
+		(*this)(key, str);
+
+		if(!str.empty())
+		{
+			char* end;
+			value = static_cast<T>(strtoull(str.c_str(), &end, 10));
+			ok = ok && !*end;
+		}
+	}
+};
+
+std::string iPlatformString(cl_platform_id platform_id, cl_platform_info info)
+{
+	size_t size = 0;
+
+	if(clGetPlatformInfo(platform_id, info, 0, NULL, &size) || !size)
+	{
+		return std::string();
+	}
+
+	std::vector<char> str(size + 1, '\0');
+
+	if(clGetPlatformInfo(platform_id, info, size, &str[0], NULL))
+	{
+		return std::string();
+	}
+
+	return std::string(&str[0]);
+}
+
+std::vector<cl_uint> iVectorWidths(cl_device_id device_id, bool native)
+{
+	static const cl_device_info preferred[] = {
+		CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR,
+		CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT,
+		CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT,
+		CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG,
+		CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT,
+		CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE,
+		CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF };
+
+	static const cl_device_info natives[] = {
+		CL_DEVICE_NATIVE_VECTOR_WIDTH_CHAR,
+		CL_DEVICE_NATIVE_VECTOR_WIDTH_SHORT,
+		CL_DEVICE_NATIVE_VECTOR_WIDTH_INT,
+		CL_DEVICE_NATIVE_VECTOR_WIDTH_LONG,
+		CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT,
+		CL_DEVICE_NATIVE_VECTOR_WIDTH_DOUBLE,
+		CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF };
+
+	std::vector<cl_uint> widths;
+
+	for(size_t i = 0; i < sizeof(natives) / sizeof(natives[0]); ++i)
+	{
+		widths.push_back(GetDeviceInfoValue<cl_uint>(
+			device_id, native ? natives[i] : preferred[i]));
+	}
+
+	return widths;
+}
+
+void iQueryDevice(cl_platform_id platform_id, cl_device_id device_id,
+	DeviceCapabilities& caps)
+{
+	caps.platform = iPlatformString(platform_id, CL_PLATFORM_NAME);
+	caps.platformVersion = iPlatformString(platform_id, CL_PLATFORM_VERSION);
+	caps.name = GetDeviceInfoString(device_id, CL_DEVICE_NAME);
+	caps.vendor = GetDeviceInfoString(device_id, CL_DEVICE_VENDOR);
+	caps.version = GetDeviceInfoString(device_id, CL_DEVICE_VERSION);
+	caps.driverVersion = GetDeviceInfoString(device_id, CL_DRIVER_VERSION);
+	caps.openclCVersion = GetDeviceInfoString(device_id, CL_DEVICE_OPENCL_C_VERSION);
+	caps.profile = GetDeviceInfoString(device_id, CL_DEVICE_PROFILE);
+	caps.extensions = GetDeviceInfoString(device_id, CL_DEVICE_EXTENSIONS);
+	caps.type = GetDeviceInfoValue<cl_device_type>(device_id, CL_DEVICE_TYPE);
+	caps.vendorId = GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_VENDOR_ID);
+	caps.computeUnits =
+		GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_MAX_COMPUTE_UNITS);
+	caps.maxClockFrequency =
+		GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_MAX_CLOCK_FREQUENCY);
+	caps.addressBits = GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_ADDRESS_BITS);
+
+	caps.maxWorkItemSizes.resize(GetDeviceInfoValue<cl_uint>(
+		device_id, CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS));
+
+	if(!caps.maxWorkItemSizes.empty() &&
+		clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_ITEM_SIZES,
+			sizeof(size_t) * caps.maxWorkItemSizes.size(),
+			&caps.maxWorkItemSizes[0], NULL))
+	{
+		caps.maxWorkItemSizes.clear();
+	}
+
+	caps.maxWorkGroupSize =
+		GetDeviceInfoValue<size_t>(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE);
+	caps.preferredVectorWidths = iVectorWidths(device_id, false);
+	caps.nativeVectorWidths = iVectorWidths(device_id, true);
+	caps.globalMemSize =
+		GetDeviceInfoValue<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_SIZE);
+	caps.globalMemCacheSize =
+		GetDeviceInfoValue<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_CACHE_SIZE);
+	caps.globalMemCachelineSize =
+		GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE);
+	caps.localMemSize =
+		GetDeviceInfoValue<cl_ulong>(device_id, CL_DEVICE_LOCAL_MEM_SIZE);
+	caps.maxMemAllocSize =
+		GetDeviceInfoValue<cl_ulong>(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE);
+	caps.maxConstantBufferSize =
+		GetDeviceInfoValue<cl_ulong>(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE);
+	caps.maxConstantArgs =
+		GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_MAX_CONSTANT_ARGS);
+	caps.maxParameterSize =
+		GetDeviceInfoValue<size_t>(device_id, CL_DEVICE_MAX_PARAMETER_SIZE);
+	caps.memBaseAddrAlign =
+		GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_MEM_BASE_ADDR_ALIGN);
+	caps.minDataTypeAlignSize =
+		GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_MIN_DATA_TYPE_ALIGN_SIZE);
+	caps.imageSupport =
+		GetDeviceInfoValue<cl_bool>(device_id, CL_DEVICE_IMAGE_SUPPORT) != CL_FALSE;
+	caps.unifiedMemory =
+		GetDeviceInfoValue<cl_bool>(device_id, CL_DEVICE_HOST_UNIFIED_MEMORY) != CL_FALSE;
+	caps.errorCorrection = GetDeviceInfoValue<cl_bool>(
+		device_id, CL_DEVICE_ERROR_CORRECTION_SUPPORT) != CL_FALSE;
+	caps.available =
+		GetDeviceInfoValue<cl_bool>(device_id, CL_DEVICE_AVAILABLE) != CL_FALSE;
+	caps.compilerAvailable =
+		GetDeviceInfoValue<cl_bool>(device_id, CL_DEVICE_COMPILER_AVAILABLE) != CL_FALSE;
+	caps.singleFpConfig = GetDeviceInfoValue<cl_device_fp_config>(
+		device_id, CL_DEVICE_SINGLE_FP_CONFIG);
+	caps.queueProperties = GetDeviceInfoValue<cl_command_queue_properties>(
+		device_id, CL_DEVICE_QUEUE_PROPERTIES);
+	caps.executionCapabilities = GetDeviceInfoValue<cl_device_exec_capabilities>(
+		device_id, CL_DEVICE_EXECUTION_CAPABILITIES);
+	caps.profilingTimerResolution =
+		GetDeviceInfoValue<size_t>(device_id, CL_DEVICE_PROFILING_TIMER_RESOLUTION);
+}
+
+void iStampFile(Sha256& hash, const std::string& path)
+{
+	struct stat st;
+
+	std::ostringstream str;
+	str << path << "\n";
+
+	if(!stat(path.c_str(), &st))
+	{
+		str << st.st_size << " " << st.st_mtim.tv_sec << "." <<
+			st.st_mtim.tv_nsec << "\n";
+	}
+
+	hash.Update(str.str());
+}
+
+}
+
+DeviceCapabilities::DeviceCapabilities()
+	: type(0), vendorId(0), computeUnits(0), maxClockFrequency(0),
+	addressBits(0), maxWorkGroupSize(0), globalMemSize(0),
+	globalMemCacheSize(0), globalMemCachelineSize(0), localMemSize(0),
+	maxMemAllocSize(0), maxConstantBufferSize(0), maxConstantArgs(0),
+	maxParameterSize(0), memBaseAddrAlign(0), minDataTypeAlignSize(0),
+	imageSupport(false), unifiedMemory(false), errorCorrection(false),
+	available(false), compilerAvailable(false), singleFpConfig(0),
+	queueProperties(0), executionCapabilities(0), profilingTimerResolution(0)
+{
+}
+
+std::string GetIcdStamp()
+{
+	using namespace std;
+
+	Sha256 hash;
+
+	const char* vendors = getenv("OCL_ICD_VENDORS");
+	string dirname = vendors ? vendors : "/etc/OpenCL/vendors";
+	vector<string> files;
+
+	if(DIR* dir = opendir(dirname.c_str()))
+	{
+		while(struct dirent* entry = readdir(dir))
+		{
+			if(entry->d_name[0] != '.')
+			{
+				files.push_back(dirname + "/" + entry->d_name);
+			}
+		}
+
+		closedir(dir);
+	}
+	else
+	{
+		files.push_back(dirname);
+	}
+
+	sort(files.begin(), files.end());
+
+	for(size_t i = 0; i < files.size(); ++i)
+	{
+		iStampFile(hash, files[i]);
+
+		vector<char> data;
+
+		if(!ReadFile(files[i], data))
+		{
+			continue;
+		}
+
+		string library(data.begin(), data.end());
+		library.erase(library.find_last_not_of(" \t\r\n") + 1);
+
+		hash.Update(library);
+
+		if(!library.empty() && library[0] == '/')
+		{
+			iStampFile(hash, library);
+		}
+	}
+
+	if(const char* filenames = getenv("OCL_ICD_FILENAMES"))
+	{
+		hash.Update(string("OCL_ICD_FILENAMES=") + filenames);
+	}
+
+	return hash.HexDigest();
+}
+
+std::string GetDefaultSnapshotPath()
+{
+	if(const char* env = getenv("OCLT_SNAPSHOT"))
+	{
+		return env;
+	}
+
+	if(const char* env = getenv("XDG_CACHE_HOME"))
+	{
+		return std::string(env) + "/oclt/capabilities";
+	}
+
+	const char* home = getenv("HOME");
+
+	return std::string(home ? home : ".") + "/.cache/oclt/capabilities";
+}
+
+cl_int QueryCapabilities(CapabilitySnapshot& snapshot)
+{
+	using namespace std;
+
+	snapshot.icdStamp = GetIcdStamp();
+	snapshot.devices.clear();
+
+	cl_uint num_platforms = 0;
+	cl_int err = clGetPlatformIDs(0, NULL, &num_platforms);
+
+	if(err || !num_platforms)
+	{
+		return err;
+	}
+
+	vector<cl_platform_id> platforms(num_platforms);
+
+	if((err = clGetPlatformIDs(num_platforms, &platforms[0], NULL)))
+	{
+		return err;
+	}
+
+	for(cl_uint i = 0; i < num_platforms; ++i)
+	{
+		cl_uint num_devices = 0;
+
+		if(clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, 0, NULL, &num_devices) ||
+			!num_devices)
+		{
+			continue;
+		}
+
+		vector<cl_device_id> devices(num_devices);
+
+		if((err = clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL,
+			num_devices, &devices[0], NULL)))
+		{
+			return err;
+		}
+
+		for(cl_uint j = 0; j < num_devices; ++j)
+		{
+			snapshot.devices.push_back(DeviceCapabilities());
+			iQueryDevice(platforms[i], devices[j], snapshot.devices.back());
+		}
+	}
+
+	return CL_SUCCESS;
+}
+
+bool SaveSnapshot(const std::string& path, const CapabilitySnapshot& snapshot)
+{
+	iWriter writer;
+
+	writer.out << iMagic << "\n";
+	writer.out << "icd " << snapshot.icdStamp << "\n";
+
+	for(size_t i = 0; i < snapshot.devices.size(); ++i)
+	{
+		writer.out << "device\n";
+		iVisit(snapshot.devices[i], writer);
+	}
+
+	std::string data = writer.out.str();
+
+	return WriteFileAtomic(path, data.data(), data.size());
+}
+
+bool LoadSnapshot(const std::string& path, CapabilitySnapshot& snapshot)
+{
+	using namespace std;
+
+	vector<char> data;
+
+	if(!ReadFile(path, data))
+	{
+		return false;
+	}
+
+	// one map of "key value" lines per device, the file header first
+	vector<map<string, string> > sections(1);
+	string::size_type pos = 0;
+	string text(data.begin(), data.end());
+
+	if(text.compare(0, strlen(iMagic), iMagic) || text.size() <= strlen(iMagic) ||
+		text[strlen(iMagic)] != '\n')
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	pos = strlen(iMagic) + 1;
+
+	while(pos < text.size())
+	{
+		string::size_type end = text.find('\n', pos);
+
+		if(end == string::npos)
+		{
+			end = text.size();
+		}
+
+		string line = text.substr(pos, end - pos);
+		string::size_type space = line.find(' ');
+
+		if(line == "device")
+		{
+			sections.push_back(map<string, string>());
+		}
+		else if(!line.empty())
+		{
+			sections.back()[line.substr(0, space)] =
+				space == string::npos ? string() : line.substr(space + 1);
+		}
+
+		pos = end + 1;
+	}
+
+	snapshot.icdStamp = sections[0]["icd"];
+	snapshot.devices.assign(sections.size() - 1, DeviceCapabilities());
+
+	for(size_t i = 1; i < sections.size(); ++i)
+	{
+		iReader reader = { sections[i], true };
+		iVisit(snapshot.devices[i - 1], reader);
+
+		if(!reader.ok)
+		{
+			errno = EINVAL;
+			return false;
+		}
+	}
+
+	if(snapshot.icdStamp != GetIcdStamp())
+	{
+		errno = ESTALE;
+		return false;
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,107 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_CAPABILITIES_HPP_
+#define OCLC_CAPABILITIES_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// limits and features of one device, as reported by clGetDeviceInfo
+struct DeviceCapabilities
+{
+	std::string platform;         // CL_PLATFORM_NAME
+	std::string platformVersion;  // CL_PLATFORM_VERSION
+	std::string name;
+	std::string vendor;
+	std::string version;
+	std::string driverVersion;
+	std::string openclCVersion;
+	std::string profile;
+	std::string extensions;
+	cl_device_type type;
+	cl_uint vendorId;
+	cl_uint computeUnits;
+	cl_uint maxClockFrequency;
+	cl_uint addressBits;
+	std::vector<size_t> maxWorkItemSizes;
+	size_t maxWorkGroupSize;
+	// char, short, int, long, float, double, half
+	std::vector<cl_uint> preferredVectorWidths;
+	std::vector<cl_uint> nativeVectorWidths;
+	cl_ulong globalMemSize;
+	cl_ulong globalMemCacheSize;
+	cl_uint globalMemCachelineSize;
+	cl_ulong localMemSize;
+	cl_ulong maxMemAllocSize;
+	cl_ulong maxConstantBufferSize;
+	cl_uint maxConstantArgs;
+	size_t maxParameterSize;
+	cl_uint memBaseAddrAlign;  // bits
+	cl_uint minDataTypeAlignSize;
+	bool imageSupport;
+	bool unifiedMemory;
+	bool errorCorrection;
+	bool available;
+	bool compilerAvailable;
+	cl_device_fp_config singleFpConfig;
+	cl_command_queue_properties queueProperties;
+	cl_device_exec_capabilities executionCapabilities;
+	size_t profilingTimerResolution;
+
+	DeviceCapabilities();
+};
+
+// the devices of every platform and a stamp of the installed drivers
+struct CapabilitySnapshot
+{
+	std::string icdStamp;
+	std::vector<DeviceCapabilities> devices;
+};
+
+// hash of the ICD registry: the files in $OCL_ICD_VENDORS or
+// /etc/OpenCL/vendors, their contents, size and modification time and
+// those of the libraries they name by absolute path, and
+// $OCL_ICD_FILENAMES. installing or updating a driver changes it.
+std::string GetIcdStamp();
+
+// $OCLT_SNAPSHOT, else oclt/capabilities in $XDG_CACHE_HOME or ~/.cache
+std::string GetDefaultSnapshotPath();
+
+// query every device of every platform
+cl_int QueryCapabilities(CapabilitySnapshot& snapshot);
+
+// write snapshot to path as "key value" lines, atomically
+bool SaveSnapshot(const std::string& path, const CapabilitySnapshot& snapshot);
+
+// read a snapshot written by SaveSnapshot() without calling OpenCL.
+// returns false and sets errno when it can not be read, EINVAL when it is
+// malformed and ESTALE when GetIcdStamp() no longer matches.
+bool LoadSnapshot(const std::string& path, CapabilitySnapshot& snapshot);
+
+}
+
+#endif
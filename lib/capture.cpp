@@ -0,0 +1,681 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "capture.hpp"
+#include "build.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace OCLT
+{
+
+namespace
+{
+
+const char* const iMagic = "oclt-capture 1";
+
+// buffers are read and written in pieces of this size
+const size_t iPieceSize = 16 << 20;
+
+uint64_t iAlign(uint64_t offset)
+{
+	return (offset + CaptureAlignment - 1) / CaptureAlignment * CaptureAlignment;
+}
+
+void iAppendString(std::string& header, const char* key, const std::string& str)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s %zu\n", key, str.size());
+	header += buf;
+	header += str;
+	header += '\n';
+}
+
+std::string iClError(const char* function, cl_int err)
+{
+	return std::string(function) + ": " + GetErrorMessage(err);
+}
+
+bool iGetKernelName(cl_kernel kernel, std::string& name, std::string& error)
+{
+	size_t size = 0;
+	cl_int err = clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, NULL, &size);
+	std::vector<char> buf(size + 1, '\0');
+
+	if(!err && size)
+	{
+		err = clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, size, &buf[0], NULL);
+	}
+
+	if(err)
+	{
+		error = iClError("clGetKernelInfo", err);
+		return false;
+	}
+
+	name = &buf[0];
+	return true;
+}
+
+// source of program, or the binary for device_id when it has no source
+bool iGetProgram(cl_program program, cl_device_id device_id,
+	KernelCapture& launch, std::vector<unsigned char>& data, std::string& error)
+{
+	using namespace std;
+
+	size_t size = 0;
+	cl_int err = clGetProgramInfo(program, CL_PROGRAM_SOURCE, 0, NULL, &size);
+
+	if(!err && size > 1)
+	{
+		data.resize(size);
+		err = clGetProgramInfo(program, CL_PROGRAM_SOURCE, size, &data[0], NULL);
+
+		// without the terminating zero
+		data.resize(size - 1);
+		launch.binary = false;
+	}
+	else if(!err)
+	{
+		vector<DeviceBinary> binaries;
+		err = GetProgramBinaries(program, binaries);
+
+		for(size_t i = 0; !err && i < binaries.size(); ++i)
+		{
+			if(binaries[i].device_id == device_id)
+			{
+				data.swap(binaries[i].binary);
+			}
+		}
+
+		if(!err && data.empty())
+		{
+			err = CL_INVALID_PROGRAM_EXECUTABLE;
+		}
+
+		launch.binary = true;
+	}
+
+	if(!err)
+	{
+		err = clGetProgramBuildInfo(
+			program, device_id, CL_PROGRAM_BUILD_OPTIONS, 0, NULL, &size);
+	}
+
+	if(!err && size)
+	{
+		vector<char> options(size + 1, '\0');
+		err = clGetProgramBuildInfo(program, device_id,
+			CL_PROGRAM_BUILD_OPTIONS, size, &options[0], NULL);
+		launch.options = &options[0];
+	}
+
+	if(err)
+	{
+		error = iClError("program", err);
+		return false;
+	}
+
+	return true;
+}
+
+// copy size bytes of mem to writer through host memory of at most
+// iPieceSize bytes
+bool iWriteBuffer(AtomicFileWriter& writer, cl_command_queue queue,
+	cl_mem mem, size_t size, std::string& error)
+{
+	std::vector<unsigned char> piece(std::min(size, iPieceSize));
+
+	for(size_t offset = 0; offset < size; offset += piece.size())
+	{
+		size_t bytes = std::min(piece.size(), size - offset);
+
+		if(cl_int err = clEnqueueReadBuffer(
+			queue, mem, CL_TRUE, offset, bytes, &piece[0], 0, NULL, NULL))
+		{
+			error = iClError("clEnqueueReadBuffer", err);
+			return false;
+		}
+
+		if(!writer.Write(&piece[0], bytes))
+		{
+			error = strerror(errno);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// cursor over the header
+class iHeader
+{
+public:
+	iHeader(const unsigned char* data, size_t size)
+		: pos_(reinterpret_cast<const char*>(data)), end_(pos_ + size) {}
+
+	bool Line(std::string& line)
+	{
+		const char* eol = static_cast<const char*>(memchr(pos_, '\n', end_ - pos_));
+
+		if(!eol)
+		{
+			return false;
+		}
+
+		line.assign(pos_, eol);
+		pos_ = eol + 1;
+		return true;
+	}
+
+	// size bytes and the newline after them
+	bool Bytes(size_t size, std::string& str)
+	{
+		if(static_cast<size_t>(end_ - pos_) <= size || pos_[size] != '\n')
+		{
+			return false;
+		}
+
+		str.assign(pos_, size);
+		pos_ += size + 1;
+		return true;
+	}
+
+	size_t Offset(const unsigned char* data) const
+	{
+		return pos_ - reinterpret_cast<const char*>(data);
+	}
+
+private:
+	const char* pos_;
+	const char* end_;
+};
+
+bool iParseArg(std::istringstream& fields, KernelCapture& launch)
+{
+	size_t index;
+	std::string kind;
+
+	if(!(fields >> index >> kind) || index > 0xffff)
+	{
+		return false;
+	}
+
+	if(index >= launch.args.size())
+	{
+		launch.args.resize(index + 1);
+	}
+
+	CaptureArg& arg = launch.args[index];
+
+	if(kind == "value")
+	{
+		std::string hex;
+		fields >> hex;
+
+		if(hex.empty() || hex.size() % 2)
+		{
+			return false;
+		}
+
+		for(size_t i = 0; i < hex.size(); i += 2)
+		{
+			char* end;
+			std::string byte = hex.substr(i, 2);
+			arg.value.push_back(static_cast<unsigned char>(strtoul(byte.c_str(), &end, 16)));
+
+			if(*end)
+			{
+				return false;
+			}
+		}
+
+		arg.kind = CaptureArg::VALUE;
+		arg.size = arg.value.size();
+		return true;
+	}
+
+	if(kind == "buffer")
+	{
+		arg.kind = CaptureArg::BUFFER;
+		arg.size = sizeof(cl_mem);
+		return fields >> arg.buffer && arg.buffer < launch.buffers.size();
+	}
+
+	if(kind == "sub")
+	{
+		arg.kind = CaptureArg::BUFFER;
+		arg.size = sizeof(cl_mem);
+		return fields >> arg.buffer >> arg.origin >> arg.region &&
+			arg.buffer < launch.buffers.size() && arg.region &&
+			arg.origin <= launch.buffers[arg.buffer].size &&
+			arg.region <= launch.buffers[arg.buffer].size - arg.origin;
+	}
+
+	if(kind == "null")
+	{
+		arg.kind = CaptureArg::EMPTY;
+		return static_cast<bool>(fields >> arg.size);
+	}
+
+	return false;
+}
+
+}
+
+bool CaptureLaunch(const std::string& path, cl_command_queue queue,
+	cl_kernel kernel, cl_uint work_dim, const size_t* global_work_offset,
+	const size_t* global_work_size, const size_t* local_work_size,
+	cl_uint num_events, const cl_event* events,
+	const std::vector<CaptureArg>& args, std::string& error)
+{
+	using namespace std;
+
+	if(work_dim < 1 || work_dim > 3 || !global_work_size)
+	{
+		error = "bad work size";
+		return false;
+	}
+
+	// the launch sees what every command before it wrote
+	cl_int err = num_events ? clWaitForEvents(num_events, events) : CL_SUCCESS;
+
+	if(!err)
+	{
+		err = clFinish(queue);
+	}
+
+	if(err)
+	{
+		error = iClError("clFinish", err);
+		return false;
+	}
+
+	KernelCapture launch;
+	cl_device_id device_id = NULL;
+	cl_program program = NULL;
+
+	err = clGetCommandQueueInfo(
+		queue, CL_QUEUE_DEVICE, sizeof(device_id), &device_id, NULL);
+
+	if(!err)
+	{
+		err = clGetKernelInfo(
+			kernel, CL_KERNEL_PROGRAM, sizeof(program), &program, NULL);
+	}
+
+	if(err)
+	{
+		error = iClError("clGetKernelInfo", err);
+		return false;
+	}
+
+	cl_uint num_args = 0;
+	err = clGetKernelInfo(kernel, CL_KERNEL_NUM_ARGS, sizeof(num_args), &num_args, NULL);
+
+	if(err || args.size() < num_args)
+	{
+		error = err ? iClError("clGetKernelInfo", err) : "arguments not set";
+		return false;
+	}
+
+	vector<unsigned char> programData;
+
+	if(!iGetKernelName(kernel, launch.kernel, error) ||
+		!iGetProgram(program, device_id, launch, programData, error))
+	{
+		return false;
+	}
+
+	launch.device = GetDeviceFingerprint(device_id);
+	launch.program.size = programData.size();
+
+	// distinct buffers and their place after the program
+	vector<cl_mem> mems;
+	uint64_t offset = iAlign(launch.program.size);
+	string argLines;
+	char buf[128];
+
+	for(size_t i = 0; i < args.size(); ++i)
+	{
+		const CaptureArg& arg = args[i];
+
+		if(arg.kind == CaptureArg::VALUE)
+		{
+			snprintf(buf, sizeof(buf), "arg %zu value ", i);
+			argLines += buf;
+
+			for(size_t j = 0; j < arg.value.size(); ++j)
+			{
+				snprintf(buf, sizeof(buf), "%02x", arg.value[j]);
+				argLines += buf;
+			}
+
+			argLines += '\n';
+			continue;
+		}
+
+		if(arg.kind == CaptureArg::EMPTY)
+		{
+			snprintf(buf, sizeof(buf), "arg %zu null %zu\n", i, arg.size);
+			argLines += buf;
+			continue;
+		}
+
+		// a sub-buffer is written as a region of its parent, which is never
+		// a sub-buffer itself
+		cl_mem mem = arg.mem;
+		size_t origin = 0;
+		size_t region = 0;
+
+#ifdef CL_VERSION_1_1
+		cl_mem parent = NULL;
+
+		err = clGetMemObjectInfo(arg.mem,
+			CL_MEM_ASSOCIATED_MEMOBJECT, sizeof(parent), &parent, NULL);
+
+		if(!err && parent)
+		{
+			mem = parent;
+			err = clGetMemObjectInfo(
+				arg.mem, CL_MEM_OFFSET, sizeof(origin), &origin, NULL);
+		}
+
+		if(!err && parent)
+		{
+			err = clGetMemObjectInfo(
+				arg.mem, CL_MEM_SIZE, sizeof(region), &region, NULL);
+		}
+
+		if(err)
+		{
+			snprintf(buf, sizeof(buf), "argument %zu", i);
+			error = iClError(buf, err);
+			return false;
+		}
+#endif
+
+		size_t index = find(mems.begin(), mems.end(), mem) - mems.begin();
+
+		if(index == mems.size())
+		{
+			cl_mem_object_type type = 0;
+			CaptureBlob blob;
+			size_t size = 0;
+
+			err = clGetMemObjectInfo(
+				mem, CL_MEM_TYPE, sizeof(type), &type, NULL);
+
+			if(!err && type != CL_MEM_OBJECT_BUFFER)
+			{
+				err = CL_INVALID_MEM_OBJECT;
+			}
+
+			if(!err)
+			{
+				err = clGetMemObjectInfo(
+					mem, CL_MEM_SIZE, sizeof(size), &size, NULL);
+			}
+
+			if(err)
+			{
+				snprintf(buf, sizeof(buf), "argument %zu", i);
+				error = iClError(buf, err);
+				return false;
+			}
+
+			blob.offset = offset;
+			blob.size = size;
+			offset = iAlign(offset + size);
+
+			mems.push_back(mem);
+			launch.buffers.push_back(blob);
+		}
+
+		if(region)
+		{
+			snprintf(buf, sizeof(buf), "arg %zu sub %zu %zu %zu\n", i, index, origin, region);
+		}
+		else
+		{
+			snprintf(buf, sizeof(buf), "arg %zu buffer %zu\n", i, index);
+		}
+
+		argLines += buf;
+	}
+
+	string header = iMagic;
+	header += '\n';
+	iAppendString(header, "kernel", launch.kernel);
+	iAppendString(header, "device", launch.device);
+	iAppendString(header, "options", launch.options);
+
+	snprintf(buf, sizeof(buf), "program %s 0 %llu\n",
+		launch.binary ? "binary" : "source",
+		static_cast<unsigned long long>(launch.program.size));
+	header += buf;
+
+	snprintf(buf, sizeof(buf), "range %u", work_dim);
+	header += buf;
+
+	const size_t* ranges[] = {global_work_offset, global_work_size, local_work_size};
+
+	for(size_t r = 0; r < 3; ++r)
+	{
+		for(cl_uint d = 0; d < 3; ++d)
+		{
+			snprintf(buf, sizeof(buf), " %zu", ranges[r] && d < work_dim ? ranges[r][d] : 0);
+			header += buf;
+		}
+	}
+
+	header += '\n';
+
+	for(size_t i = 0; i < launch.buffers.size(); ++i)
+	{
+		snprintf(buf, sizeof(buf), "buffer %llu %llu\n",
+			static_cast<unsigned long long>(launch.buffers[i].offset),
+			static_cast<unsigned long long>(launch.buffers[i].size));
+		header += buf;
+	}
+
+	header += argLines;
+	header += "end\n";
+
+	AtomicFileWriter writer;
+
+	bool ok = writer.Open(path) &&
+		writer.Write(header.data(), header.size()) &&
+		writer.Pad(CaptureAlignment) &&
+		(programData.empty() || writer.Write(&programData[0], programData.size())) &&
+		writer.Pad(CaptureAlignment);
+
+	if(!ok)
+	{
+		error = path + ": " + strerror(errno);
+		return false;
+	}
+
+	for(size_t i = 0; i < mems.size(); ++i)
+	{
+		if(!iWriteBuffer(writer, queue, mems[i], launch.buffers[i].size, error) ||
+			!writer.Pad(CaptureAlignment))
+		{
+			if(error.empty())
+			{
+				error = strerror(errno);
+			}
+
+			error = path + ": " + error;
+			return false;
+		}
+	}
+
+	if(!writer.Commit())
+	{
+		error = path + ": " + strerror(errno);
+		return false;
+	}
+
+	return true;
+}
+
+CaptureFile::CaptureFile()
+	: dataOffset_(0)
+{
+}
+
+bool CaptureFile::Open(const std::string& path)
+{
+	using namespace std;
+
+	Close();
+
+	if(!file_.Open(path))
+	{
+		error_ = path + ": " + strerror(errno);
+		return false;
+	}
+
+	iHeader header(file_.Data(), file_.Size());
+	string line;
+
+	if(!header.Line(line) || line != iMagic)
+	{
+		error_ = "not a capture file";
+		Close();
+		return false;
+	}
+
+	bool ended = false;
+
+	while(!ended && header.Line(line))
+	{
+		istringstream fields(line);
+		string key;
+		fields >> key;
+
+		bool ok = true;
+
+		if(key == "kernel" || key == "device" || key == "options")
+		{
+			string& str = key == "kernel" ? launch_.kernel :
+				key == "device" ? launch_.device : launch_.options;
+			size_t size;
+
+			ok = (fields >> size) && header.Bytes(size, str);
+		}
+		else if(key == "program")
+		{
+			string kind;
+			ok = (fields >> kind >> launch_.program.offset >> launch_.program.size) &&
+				(kind == "source" || kind == "binary");
+			launch_.binary = kind == "binary";
+		}
+		else if(key == "range")
+		{
+			ok = static_cast<bool>(fields >> launch_.dims) &&
+				launch_.dims >= 1 && launch_.dims <= 3;
+
+			size_t* ranges[] = {launch_.offset, launch_.global, launch_.local};
+
+			for(size_t i = 0; ok && i < 9; ++i)
+			{
+				ok = static_cast<bool>(fields >> ranges[i / 3][i % 3]);
+			}
+		}
+		else if(key == "buffer")
+		{
+			CaptureBlob blob;
+			ok = (fields >> blob.offset >> blob.size) && blob.size;
+			launch_.buffers.push_back(blob);
+		}
+		else if(key == "arg")
+		{
+			ok = iParseArg(fields, launch_);
+		}
+		else if(key == "end")
+		{
+			ended = true;
+		}
+
+		if(!ok)
+		{
+			error_ = "broken capture header at \"" + line + "\"";
+			Close();
+			return false;
+		}
+	}
+
+	dataOffset_ = iAlign(header.Offset(file_.Data()));
+
+	bool ok = ended && launch_.dims && !launch_.kernel.empty() &&
+		dataOffset_ <= file_.Size();
+	uint64_t dataSize = ok ? file_.Size() - dataOffset_ : 0;
+
+	ok = ok && launch_.program.offset <= dataSize &&
+		launch_.program.size <= dataSize - launch_.program.offset;
+
+	for(size_t i = 0; ok && i < launch_.buffers.size(); ++i)
+	{
+		const CaptureBlob& blob = launch_.buffers[i];
+		ok = blob.offset <= dataSize && blob.size <= dataSize - blob.offset;
+	}
+
+	if(!ok)
+	{
+		error_ = "truncated capture file";
+		Close();
+		return false;
+	}
+
+	for(size_t i = 0; i < launch_.args.size(); ++i)
+	{
+		// arguments not in the file have no size
+		if(launch_.args[i].kind == CaptureArg::EMPTY && !launch_.args[i].size)
+		{
+			ostringstream str;
+			str << "argument " << i << " missing";
+			error_ = str.str();
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CaptureFile::Close()
+{
+	file_.Close();
+	launch_ = KernelCapture();
+	dataOffset_ = 0;
+}
+
+const unsigned char* CaptureFile::Data(const CaptureBlob& blob) const
+{
+	return file_.Data() + dataOffset_ + blob.offset;
+}
+
+}
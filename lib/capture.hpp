@@ -0,0 +1,155 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_CAPTURE_HPP_
+#define OCLC_CAPTURE_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include "file.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// .oclcap file, one clEnqueueNDRangeKernel with everything needed to run
+// it again. a text header
+//
+//   oclt-capture 1
+//   kernel <length>\n<name>
+//   device <length>\n<fingerprint>
+//   options <length>\n<build options>
+//   program source|binary <offset> <size>
+//   range <dims> <offset x y z> <global x y z> <local x y z>
+//   buffer <offset> <size>          (one line per distinct buffer)
+//   arg <index> value <hex bytes>
+//   arg <index> buffer <buffer index>
+//   arg <index> sub <buffer index> <origin> <size>
+//   arg <index> null <size>         (local memory or a NULL buffer)
+//   end
+//
+// is followed by the program and the buffer contents. offsets count from
+// the first page after the header and are page aligned, so a mapped file
+// can be handed to clCreateBuffer as it is and buffers larger than memory
+// are paged in as they are read. a sub-buffer is stored as a region of
+// its parent, so arguments sharing memory still do when replayed.
+
+static const size_t CaptureAlignment = 4096;
+
+struct CaptureBlob
+{
+	CaptureBlob() : offset(0), size(0) {}
+
+	uint64_t offset;
+	uint64_t size;
+};
+
+// an argument as it was given to clSetKernelArg
+struct CaptureArg
+{
+	enum Kind
+	{
+		VALUE,
+		BUFFER,
+		EMPTY,  // NULL value, local memory of size bytes or a NULL buffer
+	};
+
+	CaptureArg() : kind(EMPTY), size(0), mem(NULL), buffer(0), origin(0), region(0) {}
+
+	Kind kind;
+	size_t size;
+	std::vector<unsigned char> value;
+
+	// the buffer when capturing, its index in KernelCapture::buffers
+	// when read
+	cl_mem mem;
+	size_t buffer;
+
+	// the bytes of buffer a sub-buffer covers when read, region 0 for
+	// the whole buffer
+	size_t origin;
+	size_t region;
+};
+
+struct KernelCapture
+{
+	KernelCapture() : binary(false), dims(0), offset(), global(), local() {}
+
+	std::string kernel;
+	// see GetDeviceFingerprint()
+	std::string device;
+	std::string options;
+
+	// source text, or the binary for device when the program was not
+	// created from source
+	bool binary;
+	CaptureBlob program;
+
+	// local all zero when the launch left it to the driver
+	cl_uint dims;
+	size_t offset[3];
+	size_t global[3];
+	size_t local[3];
+
+	std::vector<CaptureBlob> buffers;
+	std::vector<CaptureArg> args;
+};
+
+// write the launch of kernel on queue to path, args in argument order.
+// waits for events and queue first, then reads the program and every
+// buffer, the latter in pieces so that it need not fit in memory. the
+// file is written atomically. returns false and sets error on failure.
+bool CaptureLaunch(const std::string& path, cl_command_queue queue,
+	cl_kernel kernel, cl_uint work_dim, const size_t* global_work_offset,
+	const size_t* global_work_size, const size_t* local_work_size,
+	cl_uint num_events, const cl_event* events,
+	const std::vector<CaptureArg>& args, std::string& error);
+
+class CaptureFile
+{
+public:
+	CaptureFile();
+
+	// maps path and parses the header
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return file_.IsOpen(); }
+	const std::string& Error() const { return error_; }
+
+	const KernelCapture& Launch() const { return launch_; }
+
+	// bytes of blob, pointing into the mapping
+	const unsigned char* Data(const CaptureBlob& blob) const;
+
+private:
+	MappedFile file_;
+	std::string error_;
+	KernelCapture launch_;
+	size_t dataOffset_;
+};
+
+}
+
+#endif
@@ -0,0 +1,394 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "clx.hpp"
+#include "lz.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+
+namespace OCLT
+{
+
+static const char iMagic[8] = { 'O', 'C', 'L', 'T', 'C', 'L', 'X', '\0' };
+
+static void iPut32(unsigned char* p, uint32_t v)
+{
+	for(int i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+static void iPut64(unsigned char* p, uint64_t v)
+{
+	for(int i = 0; i < 8; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+static uint32_t iGet32(const unsigned char* p)
+{
+	uint32_t v = 0;
+	for(int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+	return v;
+}
+
+static uint64_t iGet64(const unsigned char* p)
+{
+	uint64_t v = 0;
+	for(int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+	return v;
+}
+
+ClxWriter::ClxWriter()
+	: alignment_(ClxDefaultAlignment), compress_(false)
+{
+}
+
+void ClxWriter::Add(const std::string& fingerprint,
+	const unsigned char* binary, size_t size)
+{
+	Source source;
+	source.fingerprint = fingerprint;
+	source.flags = 0;
+	source.data = binary;
+	source.size = size;
+	source.rawSize = size;
+
+	Sha256 sha;
+	sha.Update(binary, size);
+	sha.Final(source.digest);
+
+	// identical binaries share the blob, compress them once
+	for(std::vector<Source>::const_iterator itr = entries_.begin();
+		itr != entries_.end(); ++itr)
+	{
+		if(!memcmp(itr->digest, source.digest, Sha256::DigestSize))
+		{
+			source.flags = itr->flags;
+			source.data = itr->data;
+			source.size = itr->size;
+			entries_.push_back(source);
+			return;
+		}
+	}
+
+	if(compress_ && size)
+	{
+		std::vector<unsigned char> compressed;
+		LzCompress(binary, size, compressed);
+
+		if(compressed.size() < size)
+		{
+			compressed_.push_back(std::vector<unsigned char>());
+			compressed_.back().swap(compressed);
+
+			source.flags = ClxFlagLz;
+			source.data = &compressed_.back()[0];
+			source.size = compressed_.back().size();
+		}
+	}
+
+	entries_.push_back(source);
+}
+
+bool ClxWriter::Write(const std::string& path) const
+{
+	std::vector<unsigned char> head;
+	std::vector<size_t> blobEntries;
+	std::vector<uint64_t> blobOffsets;
+
+	Layout(head, blobEntries, blobOffsets);
+
+	AtomicFileWriter writer;
+
+	if(!writer.Open(path) || !writer.Write(&head[0], head.size()))
+	{
+		return false;
+	}
+
+	for(size_t i = 0; i < blobEntries.size(); ++i)
+	{
+		const Source& source = entries_[blobEntries[i]];
+
+		if(!writer.Pad(alignment_) || !writer.Write(source.data, source.size))
+		{
+			return false;
+		}
+	}
+
+	return writer.Commit();
+}
+
+void ClxWriter::Serialize(std::vector<unsigned char>& data) const
+{
+	std::vector<size_t> blobEntries;
+	std::vector<uint64_t> blobOffsets;
+
+	Layout(data, blobEntries, blobOffsets);
+
+	for(size_t i = 0; i < blobEntries.size(); ++i)
+	{
+		const Source& source = entries_[blobEntries[i]];
+
+		data.resize(blobOffsets[i], 0);
+		data.insert(data.end(), source.data, source.data + source.size);
+	}
+}
+
+void ClxWriter::Layout(std::vector<unsigned char>& head,
+	std::vector<size_t>& blobEntries, std::vector<uint64_t>& blobOffsets) const
+{
+	using namespace std;
+
+	const size_t count = entries_.size();
+
+	// assign one blob per distinct digest and lay out the file
+	map<string, size_t> blobIndices;
+	vector<size_t> entryBlobs(count);
+
+	string strings;
+	vector<uint64_t> stringOffsets(count);
+
+	blobEntries.clear();
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		string digest(reinterpret_cast<const char*>(entries_[i].digest),
+			Sha256::DigestSize);
+		map<string, size_t>::iterator itr = blobIndices.find(digest);
+
+		if(itr == blobIndices.end())
+		{
+			itr = blobIndices.insert(make_pair(digest, blobEntries.size())).first;
+			blobEntries.push_back(i);
+		}
+
+		entryBlobs[i] = itr->second;
+
+		stringOffsets[i] = strings.size();
+		strings += entries_[i].fingerprint;
+	}
+
+	const uint64_t indexOffset = ClxHeaderSize;
+	const uint64_t stringsOffset = indexOffset + count * ClxEntrySize;
+
+	blobOffsets.resize(blobEntries.size());
+	uint64_t offset = stringsOffset + strings.size();
+
+	for(size_t i = 0; i < blobEntries.size(); ++i)
+	{
+		offset = (offset + alignment_ - 1) / alignment_ * alignment_;
+		blobOffsets[i] = offset;
+		offset += entries_[blobEntries[i]].size;
+	}
+
+	uint32_t version = 1;
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		if(entries_[i].flags)
+		{
+			version = ClxVersion;
+		}
+	}
+
+	head.assign(stringsOffset, 0);
+
+	memcpy(&head[0], iMagic, sizeof(iMagic));
+	iPut32(&head[8], version);
+	iPut32(&head[12], ClxHeaderSize);
+	iPut32(&head[16], count);
+	iPut32(&head[20], blobEntries.size());
+	iPut64(&head[24], indexOffset);
+	iPut64(&head[32], stringsOffset);
+	iPut64(&head[40], strings.size());
+	iPut32(&head[48], alignment_);
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		unsigned char* p = &head[indexOffset + i * ClxEntrySize];
+
+		iPut64(p + 0, stringOffsets[i]);
+		iPut32(p + 8, entries_[i].fingerprint.size());
+		iPut32(p + 12, entries_[i].flags);
+		iPut64(p + 16, blobOffsets[entryBlobs[i]]);
+		iPut64(p + 24, entries_[i].size);
+		iPut64(p + 32, entries_[i].rawSize);
+		memcpy(p + 40, entries_[i].digest, Sha256::DigestSize);
+	}
+
+	head.insert(head.end(), strings.begin(), strings.end());
+}
+
+ClxFile::ClxFile()
+	: version_(0)
+{
+}
+
+bool ClxFile::Open(const std::string& path)
+{
+	Close();
+
+	if(!file_.Open(path))
+	{
+		error_ = strerror(errno);
+		return false;
+	}
+
+	const unsigned char* data = file_.Data();
+	const uint64_t size = file_.Size();
+
+	if(!IsClx(data, size) || size < ClxHeaderSize)
+	{
+		error_ = "not a clx file";
+		Close();
+		return false;
+	}
+
+	version_ = iGet32(data + 8);
+	uint32_t headerSize = iGet32(data + 12);
+	uint32_t count = iGet32(data + 16);
+	uint64_t indexOffset = iGet64(data + 24);
+	uint64_t stringsOffset = iGet64(data + 32);
+	uint64_t stringsSize = iGet64(data + 40);
+
+	if(version_ < 1 || version_ > ClxVersion)
+	{
+		error_ = "unsupported clx version";
+		Close();
+		return false;
+	}
+
+	if(headerSize < ClxHeaderSize || indexOffset < headerSize ||
+		indexOffset > size || count > (size - indexOffset) / ClxEntrySize ||
+		stringsOffset > size || stringsSize > size - stringsOffset)
+	{
+		error_ = "broken clx header";
+		Close();
+		return false;
+	}
+
+	entries_.resize(count);
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		const unsigned char* p = data + indexOffset + i * ClxEntrySize;
+		ClxEntry& entry = entries_[i];
+
+		uint64_t fingerprintOffset = iGet64(p + 0);
+		uint32_t fingerprintSize = iGet32(p + 8);
+		entry.flags = iGet32(p + 12);
+		entry.offset = iGet64(p + 16);
+		entry.size = iGet64(p + 24);
+		entry.rawSize = iGet64(p + 32);
+		memcpy(entry.digest, p + 40, Sha256::DigestSize);
+
+		if(fingerprintOffset > stringsSize ||
+			fingerprintSize > stringsSize - fingerprintOffset ||
+			entry.offset > size || entry.size > size - entry.offset ||
+			(entry.flags & ~ClxFlagLz) ||
+			(!entry.flags && entry.size != entry.rawSize))
+		{
+			error_ = "broken clx index";
+			Close();
+			return false;
+		}
+
+		entry.fingerprint.assign(
+			reinterpret_cast<const char*>(data + stringsOffset + fingerprintOffset),
+			fingerprintSize);
+	}
+
+	error_.clear();
+
+	return true;
+}
+
+void ClxFile::Close()
+{
+	file_.Close();
+	entries_.clear();
+	version_ = 0;
+}
+
+int ClxFile::Find(const std::string& fingerprint) const
+{
+	for(size_t i = 0; i < entries_.size(); ++i)
+	{
+		if(entries_[i].fingerprint == fingerprint)
+		{
+			return static_cast<int>(i);
+		}
+	}
+
+	return -1;
+}
+
+const unsigned char* ClxFile::Data(size_t index) const
+{
+	return file_.Data() + entries_[index].offset;
+}
+
+bool ClxFile::Extract(size_t index, unsigned char* out) const
+{
+	const ClxEntry& entry = entries_[index];
+
+	if(!(entry.flags & ClxFlagLz))
+	{
+		memcpy(out, Data(index), entry.size);
+		return true;
+	}
+
+	// pages of the mapping are read in as the decoder walks over them
+	return LzDecompress(Data(index), entry.size, out, entry.rawSize);
+}
+
+bool ClxFile::Extract(size_t index, std::vector<unsigned char>& binary) const
+{
+	binary.resize(entries_[index].rawSize);
+	return binary.empty() || Extract(index, &binary[0]);
+}
+
+bool ClxFile::Verify(size_t index) const
+{
+	const ClxEntry& entry = entries_[index];
+	const unsigned char* data = Data(index);
+	std::vector<unsigned char> binary;
+
+	if(entry.flags & ClxFlagLz)
+	{
+		if(!Extract(index, binary))
+		{
+			return false;
+		}
+
+		data = binary.empty() ? NULL : &binary[0];
+	}
+
+	unsigned char digest[Sha256::DigestSize];
+
+	Sha256 sha;
+	sha.Update(data, entry.rawSize);
+	sha.Final(digest);
+
+	return !memcmp(digest, entry.digest, Sha256::DigestSize);
+}
+
+bool ClxFile::IsClx(const unsigned char* data, size_t size)
+{
+	return size >= sizeof(iMagic) && !memcmp(data, iMagic, sizeof(iMagic));
+}
+
+}
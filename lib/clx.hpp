@@ -0,0 +1,150 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_CLX_HPP_
+#define OCLC_CLX_HPP_
+
+#include "file.hpp"
+#include "sha256.hpp"
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// .clx container, all integers little endian.
+//
+//   header  (ClxHeaderSize bytes)
+//     magic "OCLTCLX\0", version, header size, entry count, blob count,
+//     index offset, strings offset, strings size, blob alignment
+//   index   (entry count * ClxEntrySize bytes)
+//     fingerprint offset/size in strings, flags, blob offset, stored size,
+//     raw size, SHA-256 of raw blob
+//   strings (device fingerprints)
+//   blobs   (each starts at a multiple of blob alignment)
+//
+// entries whose binaries are identical share one blob, so several devices
+// may point to the same offset. blobs are page aligned, a mapped file can
+// hand a pointer into the mapping to clCreateProgramWithBinary as it is.
+// blobs with ClxFlagLz are compressed (see lz.hpp) and must be extracted
+// first. files without such blobs are written as version 1.
+
+static const uint32_t ClxVersion = 2;
+static const uint32_t ClxFlagLz = 1;
+static const size_t ClxHeaderSize = 64;
+static const size_t ClxEntrySize = 80;
+static const size_t ClxDefaultAlignment = 4096;
+
+struct ClxEntry
+{
+	std::string fingerprint;
+	uint32_t flags;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t rawSize;
+	unsigned char digest[Sha256::DigestSize];
+};
+
+class ClxWriter
+{
+public:
+	ClxWriter();
+
+	// binary is referenced, not copied. it must stay alive until Write().
+	void Add(const std::string& fingerprint,
+		const unsigned char* binary, size_t size);
+
+	size_t EntryCount() const { return entries_.size(); }
+
+	// compress binaries added from now on, where that makes them smaller
+	void SetCompression(bool compress) { compress_ = compress; }
+
+	// write atomically, returns false and sets errno on failure
+	bool Write(const std::string& path) const;
+
+	// the same bytes Write() would write
+	void Serialize(std::vector<unsigned char>& data) const;
+
+private:
+	struct Source
+	{
+		std::string fingerprint;
+		uint32_t flags;
+		// stored bytes, in compressed_ with ClxFlagLz
+		const unsigned char* data;
+		size_t size;
+		size_t rawSize;
+		unsigned char digest[Sha256::DigestSize];
+	};
+
+	// header, index and strings, and which entry holds each distinct blob
+	void Layout(std::vector<unsigned char>& head,
+		std::vector<size_t>& blobEntries, std::vector<uint64_t>& blobOffsets) const;
+
+	std::vector<Source> entries_;
+	std::list< std::vector<unsigned char> > compressed_;
+	size_t alignment_;
+	bool compress_;
+};
+
+class ClxFile
+{
+public:
+	ClxFile();
+
+	// maps path and validates header and index
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return file_.IsOpen(); }
+	const std::string& Error() const { return error_; }
+
+	uint32_t Version() const { return version_; }
+	size_t EntryCount() const { return entries_.size(); }
+	const ClxEntry& Entry(size_t index) const { return entries_[index]; }
+
+	// index of first entry with fingerprint, -1 when not found
+	int Find(const std::string& fingerprint) const;
+
+	// stored bytes of entry, pointing into the mapping
+	const unsigned char* Data(size_t index) const;
+
+	// the binary of entry, Entry(index).rawSize bytes, written to out
+	// (decompressed when stored with ClxFlagLz). returns false on broken
+	// data.
+	bool Extract(size_t index, unsigned char* out) const;
+	bool Extract(size_t index, std::vector<unsigned char>& binary) const;
+
+	// compare SHA-256 of the binary with the index
+	bool Verify(size_t index) const;
+
+	// true when data starts with the container magic
+	static bool IsClx(const unsigned char* data, size_t size);
+
+private:
+	MappedFile file_;
+	std::string error_;
+	uint32_t version_;
+	std::vector<ClxEntry> entries_;
+};
+
+}
+
+#endif
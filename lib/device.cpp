@@ -0,0 +1,79 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "device.hpp"
+
+#include <vector>
+
+namespace OCLT
+{
+
+std::string GetDeviceInfoString(cl_device_id device_id, cl_device_info info)
+{
+	size_t size = 0;
+
+	if(clGetDeviceInfo(device_id, info, 0, NULL, &size) || !size)
+	{
+		return std::string();
+	}
+
+	std::vector<char> str(size + 1, '\0');
+
+	if(clGetDeviceInfo(device_id, info, size, &str[0], NULL))
+	{
+		return std::string();
+	}
+
+	return std::string(&str[0]);
+}
+
+std::string GetDeviceFingerprint(cl_device_id device_id)
+{
+	return GetDeviceInfoString(device_id, CL_DEVICE_NAME) + "\n" +
+		GetDeviceInfoString(device_id, CL_DRIVER_VERSION) + "\n" +
+		GetDeviceInfoString(device_id, CL_DEVICE_VERSION);
+}
+
+cl_uint GetPreferredVectorWidth(cl_device_id device_id, const std::string& type)
+{
+	static const struct
+	{
+		const char* type;
+		cl_device_info info;
+	} widths[] =
+	{
+		{ "char", CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR },
+		{ "short", CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT },
+		{ "int", CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT },
+		{ "long", CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG },
+		{ "float", CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT },
+		{ "double", CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE },
+		{ "half", CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF },
+	};
+
+	for(size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); ++i)
+	{
+		if(type == widths[i].type)
+		{
+			return GetDeviceInfoValue<cl_uint>(device_id, widths[i].info);
+		}
+	}
+
+	return 0;
+}
+
+}
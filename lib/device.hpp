@@ -0,0 +1,60 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_DEVICE_HPP_
+#define OCLC_DEVICE_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <string>
+
+namespace OCLT
+{
+
+// string valued clGetDeviceInfo, returns empty string on error
+std::string GetDeviceInfoString(cl_device_id device_id, cl_device_info info);
+
+// fixed size clGetDeviceInfo, returns value_on_error on error
+template<typename T>
+T GetDeviceInfoValue(
+	cl_device_id device_id, cl_device_info info, T value_on_error = T())
+{
+	T value;
+
+	if(clGetDeviceInfo(device_id, info, sizeof(value), &value, NULL))
+	{
+		return value_on_error;
+	}
+
+	return value;
+}
+
+// CL_DEVICE_PREFERRED_VECTOR_WIDTH_<type> for an OpenCL C scalar type
+// name (char, short, int, long, float, double, half), 0 when unknown
+cl_uint GetPreferredVectorWidth(cl_device_id device_id, const std::string& type);
+
+// identifies a device and the driver which compiles for it:
+// CL_DEVICE_NAME, CL_DRIVER_VERSION and CL_DEVICE_VERSION joined by '\n'
+std::string GetDeviceFingerprint(cl_device_id device_id);
+
+}
+
+#endif
@@ -0,0 +1,634 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "dispatch.hpp"
+#include "device.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace OCLT
+{
+
+namespace
+{
+
+typedef std::chrono::steady_clock iClock;
+
+// work-groups [begin, end) along the split dimension
+struct Share
+{
+	size_t begin;
+	size_t end;
+};
+
+// everything the queue threads of one Run() share
+struct RunState
+{
+	cl_kernel kernel;
+	std::vector<size_t> global;
+	std::vector<size_t> local;
+	size_t split;
+	size_t granule;        // work-items of a group along split
+	size_t groupItems;     // work-items of a group across every dimension
+	DispatchOptions options;
+
+	std::mutex mutex;
+	std::vector<Share> shares;
+	cl_int error;
+};
+
+bool iIsNameChar(char c)
+{
+	return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// offset of the next occurrence of name as a whole identifier
+size_t iFindName(const std::string& text, const char* name, size_t from)
+{
+	size_t len = strlen(name);
+
+	for(size_t pos = text.find(name, from); pos != std::string::npos;
+		pos = text.find(name, pos + 1))
+	{
+		if((!pos || !iIsNameChar(text[pos - 1])) &&
+			(pos + len == text.size() || !iIsNameChar(text[pos + len])))
+		{
+			return pos;
+		}
+	}
+
+	return std::string::npos;
+}
+
+// the body of kernel in the source of its program calls a work-item
+// function whose value differs between a chunk and one launch over the
+// whole range. false when the program has no source or the definition
+// is not found.
+bool iQueriesRange(cl_kernel kernel)
+{
+	using namespace std;
+
+	static const char* const functions[] = {"get_group_id", "get_num_groups",
+		"get_global_size", "get_global_offset"};
+
+	cl_program program = NULL;
+	size_t name_size = 0, source_size = 0;
+
+	if(clGetKernelInfo(kernel, CL_KERNEL_PROGRAM, sizeof(program), &program, NULL) ||
+		clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, NULL, &name_size) ||
+		clGetProgramInfo(program, CL_PROGRAM_SOURCE, 0, NULL, &source_size) ||
+		name_size < 2 || source_size < 2)
+	{
+		return false;
+	}
+
+	vector<char> name(name_size, '\0');
+	string source(source_size, '\0');
+
+	if(clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, name_size, &name[0], NULL) ||
+		clGetProgramInfo(program, CL_PROGRAM_SOURCE, source_size, &source[0], NULL))
+	{
+		return false;
+	}
+
+	// the definition is the occurrence followed by a parameter list and a
+	// body
+	for(size_t pos = iFindName(source, &name[0], 0); pos != string::npos;
+		pos = iFindName(source, &name[0], pos + 1))
+	{
+		size_t open = source.find_first_not_of(" \t\r\n", pos + strlen(&name[0]));
+
+		if(open == string::npos || source[open] != '(')
+		{
+			continue;
+		}
+
+		size_t close = source.find(')', open);
+		size_t begin = close == string::npos ? close :
+			source.find_first_not_of(" \t\r\n", close + 1);
+
+		if(begin == string::npos || source[begin] != '{')
+		{
+			continue;
+		}
+
+		size_t end = begin;
+
+		for(int depth = 0; end < source.size(); ++end)
+		{
+			depth += source[end] == '{' ? 1 : source[end] == '}' ? -1 : 0;
+
+			if(!depth)
+			{
+				break;
+			}
+		}
+
+		for(size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); ++f)
+		{
+			size_t use = iFindName(source, functions[f], begin);
+
+			if(use != string::npos && use < end)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	return false;
+}
+
+struct Pending
+{
+	cl_event event;
+	size_t items;
+	iClock::time_point enqueued;
+};
+
+// take up to groups work-groups for queue index, from its own share or
+// stolen from the largest other one. false when the range is done or
+// another queue failed.
+bool iTake(RunState& state, size_t index, size_t groups, Share& chunk,
+	DispatchQueueStats& stats)
+{
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if(state.error)
+	{
+		return false;
+	}
+
+	Share& own = state.shares[index];
+
+	if(own.begin == own.end)
+	{
+		size_t victim = index;
+		size_t most = 0;
+
+		for(size_t i = 0; i < state.shares.size(); ++i)
+		{
+			size_t left = state.shares[i].end - state.shares[i].begin;
+
+			if(left > most)
+			{
+				victim = i;
+				most = left;
+			}
+		}
+
+		if(!most)
+		{
+			return false;
+		}
+
+		// the back half, the victim keeps working from the front
+		own.end = state.shares[victim].end;
+		own.begin = own.end - (most + 1) / 2;
+		state.shares[victim].end = own.begin;
+		++stats.steals;
+	}
+
+	chunk.begin = own.begin;
+	chunk.end = own.begin + std::min(groups, own.end - own.begin);
+	own.begin = chunk.end;
+
+	return true;
+}
+
+void iFail(RunState& state, cl_int err)
+{
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if(!state.error)
+	{
+		state.error = err;
+	}
+}
+
+cl_int iEnqueue(RunState& state, cl_command_queue queue, const Share& chunk,
+	Pending& pending)
+{
+	size_t offset[3] = {0, 0, 0};
+	size_t size[3];
+	size_t dims = state.global.size();
+
+	for(size_t d = 0; d < dims; ++d)
+	{
+		size[d] = state.global[d];
+	}
+
+	offset[state.split] = chunk.begin * state.granule;
+	size[state.split] = std::min(chunk.end * state.granule,
+		state.global[state.split]) - offset[state.split];
+
+	pending.items = 1;
+
+	for(size_t d = 0; d < dims; ++d)
+	{
+		pending.items *= size[d];
+	}
+
+	pending.enqueued = iClock::now();
+
+	cl_int err = clEnqueueNDRangeKernel(queue, state.kernel, dims, offset, size,
+		state.local.empty() ? NULL : &state.local[0], 0, NULL, &pending.event);
+
+	return err ? err : clFlush(queue);
+}
+
+// wait for a chunk, its device time in seconds. host time since it was
+// enqueued or the previous chunk ended stands in without profiling.
+cl_int iComplete(Pending& pending, iClock::time_point& last_done, double& seconds)
+{
+	cl_int err = clWaitForEvents(1, &pending.event);
+	cl_int status = CL_COMPLETE;
+
+	if(!err)
+	{
+		err = clGetEventInfo(pending.event, CL_EVENT_COMMAND_EXECUTION_STATUS,
+			sizeof(status), &status, NULL);
+	}
+
+	if(!err && status < 0)
+	{
+		err = status;
+	}
+
+	iClock::time_point now = iClock::now();
+	cl_ulong start = 0;
+	cl_ulong end = 0;
+
+	if(!err && !clGetEventProfilingInfo(pending.event, CL_PROFILING_COMMAND_START,
+		sizeof(start), &start, NULL) && !clGetEventProfilingInfo(pending.event,
+		CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL) && end > start)
+	{
+		seconds = (end - start) * 1e-9;
+	}
+	else
+	{
+		seconds = std::chrono::duration<double>(
+			now - std::max(pending.enqueued, last_done)).count();
+	}
+
+	last_done = now;
+	clReleaseEvent(pending.event);
+
+	return err;
+}
+
+// the loop of the thread of queue index, first is the chunk in groups
+// taken until the queue is measured
+void iWork(RunState& state, size_t index, size_t first, cl_command_queue queue,
+	double& items_per_second, DispatchQueueStats& stats)
+{
+	std::deque<Pending> pending;
+	iClock::time_point last_done = iClock::now();
+	bool more = true;
+
+	for(;;)
+	{
+		while(more && pending.size() < std::max<size_t>(1, state.options.inFlight))
+		{
+			size_t groups = items_per_second > 0 ? static_cast<size_t>(
+				items_per_second * state.options.chunkSeconds / state.groupItems) : first;
+			Share chunk;
+
+			if(!(more = iTake(state, index, std::max<size_t>(1, groups), chunk, stats)))
+			{
+				break;
+			}
+
+			Pending launch = Pending();
+
+			if(cl_int err = iEnqueue(state, queue, chunk, launch))
+			{
+				if(launch.event)
+				{
+					pending.push_back(launch);
+				}
+
+				iFail(state, err);
+				more = false;
+				break;
+			}
+
+			pending.push_back(launch);
+		}
+
+		if(pending.empty())
+		{
+			break;
+		}
+
+		double seconds = 0;
+
+		if(cl_int err = iComplete(pending.front(), last_done, seconds))
+		{
+			iFail(state, err);
+			more = false;
+		}
+		else if(seconds > 0)
+		{
+			double measured = pending.front().items / seconds;
+
+			items_per_second = items_per_second > 0 ?
+				0.5 * items_per_second + 0.5 * measured : measured;
+		}
+
+		++stats.chunks;
+		stats.workItems += pending.front().items;
+		stats.busySeconds += seconds;
+		pending.pop_front();
+	}
+
+	stats.itemsPerSecond = items_per_second;
+}
+
+}
+
+Dispatcher::Dispatcher()
+	: context_(NULL)
+{
+}
+
+Dispatcher::~Dispatcher()
+{
+	Release();
+}
+
+void Dispatcher::Release()
+{
+	for(size_t i = 0; i < devices_.size(); ++i)
+	{
+		clReleaseCommandQueue(devices_[i].queue);
+	}
+
+	devices_.clear();
+	stats_.clear();
+	context_ = NULL;
+}
+
+cl_int Dispatcher::Init(const std::vector<cl_command_queue>& queues,
+	const DispatchOptions& options)
+{
+	Release();
+	options_ = options;
+
+	if(queues.empty())
+	{
+		return CL_INVALID_COMMAND_QUEUE;
+	}
+
+	for(size_t i = 0; i < queues.size(); ++i)
+	{
+		cl_context context = NULL;
+		cl_device_id device_id = NULL;
+
+		if(cl_int err = clGetCommandQueueInfo(queues[i], CL_QUEUE_CONTEXT,
+			sizeof(context), &context, NULL))
+		{
+			Release();
+			return err;
+		}
+
+		if(cl_int err = clGetCommandQueueInfo(queues[i], CL_QUEUE_DEVICE,
+			sizeof(device_id), &device_id, NULL))
+		{
+			Release();
+			return err;
+		}
+
+		if(context_ && context != context_)
+		{
+			Release();
+			return CL_INVALID_CONTEXT;
+		}
+
+		context_ = context;
+
+		Device device;
+		device.queue = queues[i];
+		device.maxWorkGroupSize =
+			GetDeviceInfoValue<size_t>(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE);
+		device.itemsPerSecond = 0;
+
+		cl_uint dims = GetDeviceInfoValue<cl_uint>(
+			device_id, CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS);
+		device.maxWorkItemSizes.resize(std::max<cl_uint>(dims, 1), 1);
+
+		if(cl_int err = clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_ITEM_SIZES,
+			device.maxWorkItemSizes.size() * sizeof(size_t),
+			&device.maxWorkItemSizes[0], NULL))
+		{
+			Release();
+			return err;
+		}
+
+		clRetainCommandQueue(queues[i]);
+		devices_.push_back(device);
+	}
+
+	return CL_SUCCESS;
+}
+
+cl_int Dispatcher::Run(cl_kernel kernel, const std::vector<size_t>& global,
+	const std::vector<size_t>& local)
+{
+	using namespace std;
+
+	if(devices_.empty())
+	{
+		return CL_INVALID_COMMAND_QUEUE;
+	}
+
+	size_t dims = global.size();
+
+	if(dims < 1 || dims > 3 || (!local.empty() && local.size() != dims))
+	{
+		return CL_INVALID_WORK_DIMENSION;
+	}
+
+	cl_context context = NULL;
+
+	if(cl_int err = clGetKernelInfo(kernel, CL_KERNEL_CONTEXT,
+		sizeof(context), &context, NULL))
+	{
+		return err;
+	}
+
+	if(context != context_)
+	{
+		return CL_INVALID_CONTEXT;
+	}
+
+	if(iQueriesRange(kernel))
+	{
+		return CL_INVALID_KERNEL;
+	}
+
+	// work-groups must fit every device, chunks are made of them
+	vector<size_t> granules(dims, 64);
+	size_t group_items = 1;
+
+	for(size_t d = 0; d < dims; ++d)
+	{
+		if(!global[d] || (!local.empty() && (!local[d] || global[d] % local[d])))
+		{
+			return !global[d] ? CL_INVALID_GLOBAL_WORK_SIZE : CL_INVALID_WORK_GROUP_SIZE;
+		}
+
+		for(size_t i = 0; i < devices_.size(); ++i)
+		{
+			const Device& device = devices_[i];
+			size_t max_items = d < device.maxWorkItemSizes.size() ?
+				device.maxWorkItemSizes[d] : 1;
+
+			if(!local.empty() && local[d] > max_items)
+			{
+				return CL_INVALID_WORK_ITEM_SIZE;
+			}
+
+			granules[d] = min(granules[d], max<size_t>(max_items, 1));
+		}
+
+		if(!local.empty())
+		{
+			granules[d] = local[d];
+			group_items *= local[d];
+		}
+	}
+
+	for(size_t i = 0; !local.empty() && i < devices_.size(); ++i)
+	{
+		if(group_items > devices_[i].maxWorkGroupSize)
+		{
+			return CL_INVALID_WORK_GROUP_SIZE;
+		}
+	}
+
+	RunState state;
+	state.kernel = kernel;
+	state.global = global;
+	state.local = local;
+	state.options = options_;
+	state.error = CL_SUCCESS;
+
+	// the outermost dimension unless others have far more groups
+	vector<size_t> groups(dims);
+
+	for(size_t d = 0; d < dims; ++d)
+	{
+		groups[d] = (global[d] + granules[d] - 1) / granules[d];
+	}
+
+	state.split = dims - 1;
+
+	if(groups[state.split] < 4 * devices_.size())
+	{
+		state.split = max_element(groups.begin(), groups.end()) - groups.begin();
+	}
+
+	state.granule = granules[state.split];
+	state.groupItems = state.granule;
+
+	for(size_t d = 0; d < dims; ++d)
+	{
+		state.groupItems *= d == state.split ? 1 : global[d];
+	}
+
+	// shares in proportion to measured throughput, equal before
+	bool measured = true;
+	double total_rate = 0;
+
+	for(size_t i = 0; i < devices_.size(); ++i)
+	{
+		measured = measured && devices_[i].itemsPerSecond > 0;
+		total_rate += devices_[i].itemsPerSecond;
+	}
+
+	size_t total = groups[state.split];
+	double sum = 0;
+
+	state.shares.resize(devices_.size());
+
+	for(size_t i = 0; i < devices_.size(); ++i)
+	{
+		state.shares[i].begin = i ? state.shares[i - 1].end : 0;
+		sum += measured ? devices_[i].itemsPerSecond / total_rate :
+			1.0 / devices_.size();
+		state.shares[i].end = i + 1 == devices_.size() ? total :
+			max(state.shares[i].begin, min(total, static_cast<size_t>(sum * total + 0.5)));
+	}
+
+	stats_.assign(devices_.size(), DispatchQueueStats());
+
+	// until measured, a sixteenth of the initial share. taken here since
+	// shares change under state.mutex once the threads run
+	vector<size_t> first(devices_.size());
+
+	for(size_t i = 0; i < devices_.size(); ++i)
+	{
+		first[i] = max<size_t>(1, (state.shares[i].end - state.shares[i].begin) / 16);
+	}
+
+	vector<thread> threads;
+	threads.reserve(devices_.size() - 1);
+
+	for(size_t i = 1; i < devices_.size(); ++i)
+	{
+		threads.push_back( thread([&, i]()
+		{
+			iWork(state, i, first[i], devices_[i].queue,
+				devices_[i].itemsPerSecond, stats_[i]);
+		}) );
+	}
+
+	iWork(state, 0, first[0], devices_[0].queue,
+		devices_[0].itemsPerSecond, stats_[0]);
+
+	for(vector<thread>::iterator itr = threads.begin();
+		itr != threads.end(); ++itr)
+	{
+		itr->join();
+	}
+
+	return state.error;
+}
+
+const std::vector<DispatchQueueStats>& Dispatcher::Stats() const
+{
+	return stats_;
+}
+
+void Dispatcher::ResetThroughput()
+{
+	for(size_t i = 0; i < devices_.size(); ++i)
+	{
+		devices_[i].itemsPerSecond = 0;
+	}
+}
+
+}
@@ -0,0 +1,123 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_DISPATCH_HPP_
+#define OCLC_DISPATCH_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <cstddef>
+#include <vector>
+
+namespace OCLT
+{
+
+struct DispatchOptions
+{
+	DispatchOptions()
+		: chunkSeconds(0.002), inFlight(2)
+	{
+	}
+
+	// a chunk is sized to run about this long on its device
+	double chunkSeconds;
+	// chunks enqueued on a queue before waiting for the oldest
+	size_t inFlight;
+};
+
+// what one queue did in the last Run()
+struct DispatchQueueStats
+{
+	size_t chunks;
+	size_t steals;        // ranges taken from other queues
+	size_t workItems;
+	double busySeconds;   // device time of its chunks
+	double itemsPerSecond;  // throughput estimate after the run
+};
+
+// spreads the NDRange of one kernel over queues on several devices of a
+// context, e.g. sub-devices of a CPU or a CPU and an accelerator. the
+// range is cut along one dimension into contiguous shares, one per
+// queue, in proportion to the throughput each queue showed before. a
+// thread per queue takes chunks from the front of its share, and once
+// the share is done steals the back half of the largest remaining share
+// of another queue. chunks are launched with a global work offset, so
+// get_global_id() is the same as in one launch over the whole range,
+// and sized from the measured throughput to run for chunkSeconds. only
+// get_global_id() and get_local_id() are preserved: get_group_id(),
+// get_num_groups() and get_global_size() see the chunk, and
+// get_global_offset() its offset.
+// devices should share memory (sub-devices of one device, host unified
+// memory): with discrete devices the driver migrates whole buffers.
+class Dispatcher
+{
+public:
+	Dispatcher();
+	~Dispatcher();
+
+	// queues of one context, profiling enabled for exact throughput (else
+	// host time is measured). they are retained until the next Init().
+	cl_int Init(const std::vector<cl_command_queue>& queues,
+		const DispatchOptions& options = DispatchOptions());
+
+	// run kernel, arguments set, over global work sizes (1 to 3
+	// dimensions) in work-groups of local (driver chosen when empty) and
+	// wait for it. work-group sizes beyond CL_DEVICE_MAX_WORK_ITEM_SIZES
+	// or CL_DEVICE_MAX_WORK_GROUP_SIZE of a device fail with
+	// CL_INVALID_WORK_ITEM_SIZE or CL_INVALID_WORK_GROUP_SIZE before
+	// anything is enqueued. chunks are whole work-groups (without local,
+	// multiples of the smallest max work-item size of the dimension, at
+	// most 64) except the last. kernels whose source calls get_group_id(),
+	// get_num_groups(), get_global_size() or get_global_offset() in their
+	// body fail with CL_INVALID_KERNEL, calls in functions they call are
+	// not found. the first error stops every queue.
+	cl_int Run(cl_kernel kernel, const std::vector<size_t>& global,
+		const std::vector<size_t>& local = std::vector<size_t>());
+
+	// of the last Run(), one per queue
+	const std::vector<DispatchQueueStats>& Stats() const;
+
+	// forget measured throughput, the next Run() starts with equal shares
+	void ResetThroughput();
+
+private:
+	Dispatcher(const Dispatcher&);
+	Dispatcher& operator=(const Dispatcher&);
+
+	struct Device
+	{
+		cl_command_queue queue;
+		size_t maxWorkGroupSize;
+		std::vector<size_t> maxWorkItemSizes;
+		double itemsPerSecond;  // 0 until measured
+	};
+
+	void Release();
+
+	cl_context context_;
+	std::vector<Device> devices_;
+	DispatchOptions options_;
+	std::vector<DispatchQueueStats> stats_;
+};
+
+}
+
+#endif
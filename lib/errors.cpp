@@ -49,6 +49,13 @@ static const std::map<int, std::string>::value_type iErrorMessages[] =
 	iMAP_ELEM(CL_MAP_FAILURE),
 	iMAP_ELEM(CL_MISALIGNED_SUB_BUFFER_OFFSET),
 	iMAP_ELEM(CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST),
+#ifdef CL_VERSION_1_2
+	iMAP_ELEM(CL_COMPILE_PROGRAM_FAILURE),
+	iMAP_ELEM(CL_LINKER_NOT_AVAILABLE),
+	iMAP_ELEM(CL_LINK_PROGRAM_FAILURE),
+	iMAP_ELEM(CL_DEVICE_PARTITION_FAILED),
+	iMAP_ELEM(CL_KERNEL_ARG_INFO_NOT_AVAILABLE),
+#endif
 
 	iMAP_ELEM(CL_INVALID_VALUE),
 	iMAP_ELEM(CL_INVALID_DEVICE_TYPE),
@@ -85,6 +92,12 @@ static const std::map<int, std::string>::value_type iErrorMessages[] =
 	iMAP_ELEM(CL_INVALID_MIP_LEVEL),
 	iMAP_ELEM(CL_INVALID_GLOBAL_WORK_SIZE),
 	iMAP_ELEM(CL_INVALID_PROPERTY),
+#ifdef CL_VERSION_1_2
+	iMAP_ELEM(CL_INVALID_IMAGE_DESCRIPTOR),
+	iMAP_ELEM(CL_INVALID_COMPILER_OPTIONS),
+	iMAP_ELEM(CL_INVALID_LINKER_OPTIONS),
+	iMAP_ELEM(CL_INVALID_DEVICE_PARTITION_COUNT),
+#endif
 };
 
 static const size_t iErrorMessageMapSize =
@@ -92,5 +105,10 @@ static const size_t iErrorMessageMapSize =
 const std::map<int, std::string> ErrorMessageMap(
 	iErrorMessages, iErrorMessages + iErrorMessageMapSize);
 
+std::string GetErrorMessage(int error)
+{
+	std::map<int, std::string>::const_iterator itr = ErrorMessageMap.find(error);
+	return itr != ErrorMessageMap.end() ? itr->second : std::string("unkown error");
 }
 
+}
@@ -26,6 +26,9 @@ namespace OCLT
 
 extern const std::map<int, std::string> ErrorMessageMap;
 
+// ErrorMessageMap text of error, "unkown error" when it has none
+std::string GetErrorMessage(int error);
+
 }
 
 #endif
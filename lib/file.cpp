@@ -0,0 +1,349 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "file.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+std::atomic<unsigned> iTmpCounter(0);
+
+}
+
+MappedFile::MappedFile()
+	: fd_(-1), data_(NULL), size_(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	fd_ = open(path.c_str(), O_RDONLY);
+
+	if(fd_ < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+
+	if(fstat(fd_, &st))
+	{
+		int errorNum = errno;
+		Close();
+		errno = errorNum;
+		return false;
+	}
+
+	if(!S_ISREG(st.st_mode))
+	{
+		Close();
+		errno = ENODEV;
+		return false;
+	}
+
+	size_ = st.st_size;
+
+	if(!size_)
+	{
+		return true;
+	}
+
+	void* addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+
+	if(addr == MAP_FAILED)
+	{
+		int errorNum = errno;
+		Close();
+		errno = errorNum;
+		return false;
+	}
+
+	data_ = static_cast<const unsigned char*>(addr);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(data_)
+	{
+		munmap(const_cast<unsigned char*>(data_), size_);
+	}
+
+	if(fd_ >= 0)
+	{
+		close(fd_);
+	}
+
+	fd_ = -1;
+	data_ = NULL;
+	size_ = 0;
+}
+
+AtomicFileWriter::AtomicFileWriter()
+	: fd_(-1), failed_(false), offset_(0)
+{
+}
+
+AtomicFileWriter::~AtomicFileWriter()
+{
+	Abort();
+}
+
+bool AtomicFileWriter::Open(const std::string& path)
+{
+	Abort();
+
+	path_ = path;
+
+	// like mkstemp, but created 0666 so that the kernel applies the umask
+	// as for fopen. umask() would change it for every thread meanwhile.
+	for(int attempt = 0; attempt < 100; ++attempt)
+	{
+		unsigned long long seed = static_cast<unsigned long long>(
+			std::chrono::steady_clock::now().time_since_epoch().count()) ^
+			(static_cast<unsigned long long>(getpid()) << 32) ^ ++iTmpCounter;
+		char suffix[16];
+		snprintf(suffix, sizeof(suffix), ".tmp.%06llx", seed & 0xffffff);
+
+		std::string tmp = path + suffix;
+		fd_ = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+
+		if(fd_ >= 0)
+		{
+			tmpPath_ = tmp;
+			failed_ = false;
+			offset_ = 0;
+			return true;
+		}
+
+		if(errno != EEXIST)
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool AtomicFileWriter::Write(const void* data, size_t size)
+{
+	if(fd_ < 0 || failed_)
+	{
+		return false;
+	}
+
+	const char* bytes = static_cast<const char*>(data);
+
+	while(size)
+	{
+		ssize_t written = write(fd_, bytes, size);
+
+		if(written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(written <= 0)
+		{
+			failed_ = true;
+			return false;
+		}
+
+		bytes += written;
+		size -= written;
+		offset_ += written;
+	}
+
+	return true;
+}
+
+bool AtomicFileWriter::Pad(size_t alignment)
+{
+	static const char zeros[256] = { 0 };
+
+	while(offset_ % alignment)
+	{
+		size_t size = alignment - offset_ % alignment;
+
+		if(!Write(zeros, size < sizeof(zeros) ? size : sizeof(zeros)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool AtomicFileWriter::Commit()
+{
+	if(fd_ < 0)
+	{
+		return false;
+	}
+
+	bool succeeded = !failed_;
+
+	if(close(fd_))
+	{
+		succeeded = false;
+	}
+
+	fd_ = -1;
+
+	if(succeeded && !rename(tmpPath_.c_str(), path_.c_str()))
+	{
+		tmpPath_.clear();
+		return true;
+	}
+
+	int errorNum = errno;
+	unlink(tmpPath_.c_str());
+	tmpPath_.clear();
+	errno = errorNum;
+
+	return false;
+}
+
+void AtomicFileWriter::Abort()
+{
+	if(fd_ >= 0)
+	{
+		close(fd_);
+		fd_ = -1;
+	}
+
+	if(!tmpPath_.empty())
+	{
+		unlink(tmpPath_.c_str());
+		tmpPath_.clear();
+	}
+}
+
+bool ReadFile(const std::string& path, std::vector<char>& data)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if(fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+
+	if(fstat(fd, &st))
+	{
+		int errorNum = errno;
+		close(fd);
+		errno = errorNum;
+		return false;
+	}
+
+	// the size of pipes and character devices is not known in advance
+	bool regular = S_ISREG(st.st_mode);
+	data.resize(regular ? st.st_size : 65536);
+
+	size_t done = 0;
+
+	while(done < data.size())
+	{
+		ssize_t readBytes = read(fd, &data[done], data.size() - done);
+
+		if(readBytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(readBytes < 0)
+		{
+			int errorNum = errno;
+			close(fd);
+			errno = errorNum;
+			return false;
+		}
+
+		if(!readBytes)
+		{
+			// end of stream, or file shrunk while reading
+			break;
+		}
+
+		done += readBytes;
+
+		if(!regular && done == data.size())
+		{
+			data.resize(data.size() * 2);
+		}
+	}
+
+	data.resize(done);
+	close(fd);
+
+	return true;
+}
+
+bool MakeDirectories(const std::string& path)
+{
+	std::string::size_type pos = 0;
+
+	do
+	{
+		pos = path.find('/', pos + 1);
+		std::string sub = path.substr(0, pos);
+
+		if(mkdir(sub.c_str(), 0777) && errno != EEXIST)
+		{
+			return false;
+		}
+	}
+	while(pos != std::string::npos);
+
+	struct stat st;
+
+	return !stat(path.c_str(), &st) && S_ISDIR(st.st_mode);
+}
+
+bool WriteFileAtomic(const std::string& path, const void* data, size_t size)
+{
+	AtomicFileWriter writer;
+
+	return writer.Open(path) && writer.Write(data, size) && writer.Commit();
+}
+
+}
@@ -0,0 +1,95 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_FILE_HPP_
+#define OCLC_FILE_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// returns false and sets errno on failure, ENODEV for files other
+	// than regular files
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return fd_ >= 0; }
+	const unsigned char* Data() const { return data_; }
+	size_t Size() const { return size_; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	int fd_;
+	const unsigned char* data_;
+	size_t size_;
+};
+
+// writes to a temporary file next to path and renames it over path on
+// Commit(), so readers never see a partially written file.
+// destroying an uncommitted writer removes the temporary file.
+class AtomicFileWriter
+{
+public:
+	AtomicFileWriter();
+	~AtomicFileWriter();
+
+	bool Open(const std::string& path);
+	bool Write(const void* data, size_t size);
+
+	// write zero bytes up to the next multiple of alignment
+	bool Pad(size_t alignment);
+
+	unsigned long long Offset() const { return offset_; }
+
+	bool Commit();
+	void Abort();
+
+private:
+	AtomicFileWriter(const AtomicFileWriter&);
+	AtomicFileWriter& operator=(const AtomicFileWriter&);
+
+	std::string path_;
+	std::string tmpPath_;
+	int fd_;
+	bool failed_;
+	unsigned long long offset_;
+};
+
+// read a whole file with one read into a buffer sized by fstat, pipes
+// are read until end of stream. returns false and sets errno on failure
+bool ReadFile(const std::string& path, std::vector<char>& data);
+
+bool MakeDirectories(const std::string& path);
+
+// write data to path through AtomicFileWriter
+bool WriteFileAtomic(const std::string& path, const void* data, size_t size);
+
+}
+
+#endif
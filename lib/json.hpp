@@ -15,6 +15,17 @@
  *    See the License for the specific language governing permissions and
  *    limitations under the License.
  */
-#ifndef OCLC_OCLC_HPP_
-#define OCLC_OCLC_HPP_
+#ifndef OCLC_JSON_HPP_
+#define OCLC_JSON_HPP_
+
+#include <string>
+
+namespace OCLT
+{
+
+// append str to out as a quoted JSON string
+void AppendJsonString(std::string& out, const std::string& str);
+
+}
+
 #endif
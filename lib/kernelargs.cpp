@@ -0,0 +1,552 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "kernelargs.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+struct ScalarType
+{
+	const char* name;
+	size_t size;
+	bool floating;
+	bool isSigned;
+};
+
+const ScalarType iScalarTypes[] =
+{
+	{ "char", 1, false, true },
+	{ "uchar", 1, false, false },
+	{ "short", 2, false, true },
+	{ "ushort", 2, false, false },
+	{ "int", 4, false, true },
+	{ "uint", 4, false, false },
+	{ "long", 8, false, true },
+	{ "ulong", 8, false, false },
+	{ "float", 4, true, true },
+	{ "double", 8, true, true },
+};
+
+const ScalarType* iFindType(const std::string& name)
+{
+	for(size_t i = 0; i < sizeof(iScalarTypes) / sizeof(iScalarTypes[0]); ++i)
+	{
+		if(name == iScalarTypes[i].name)
+		{
+			return &iScalarTypes[i];
+		}
+	}
+
+	return NULL;
+}
+
+std::vector<std::string> iSplit(const std::string& str, char separator)
+{
+	std::vector<std::string> fields;
+	std::string::size_type begin = 0;
+
+	for(;;)
+	{
+		std::string::size_type end = str.find(separator, begin);
+		fields.push_back(str.substr(begin, end - begin));
+
+		if(end == std::string::npos)
+		{
+			return fields;
+		}
+
+		begin = end + 1;
+	}
+}
+
+bool iParseCount(const std::string& str, size_t& count)
+{
+	char* end;
+	unsigned long long value = strtoull(str.c_str(), &end, 10);
+
+	if(end == str.c_str())
+	{
+		return false;
+	}
+
+	if(*end == 'K' || *end == 'k')
+	{
+		value <<= 10;
+		++end;
+	}
+	else if(*end == 'M' || *end == 'm')
+	{
+		value <<= 20;
+		++end;
+	}
+
+	count = value;
+
+	return !*end && count;
+}
+
+// value as bytes of the scalar type
+bool iEncode(const ScalarType& type, const std::string& str,
+	std::vector<unsigned char>& bytes)
+{
+	char* end;
+	bytes.resize(type.size);
+
+	if(type.floating)
+	{
+		double value = strtod(str.c_str(), &end);
+
+		if(type.size == 4)
+		{
+			float f = static_cast<float>(value);
+			memcpy(&bytes[0], &f, sizeof(f));
+		}
+		else
+		{
+			memcpy(&bytes[0], &value, sizeof(value));
+		}
+	}
+	else
+	{
+		uint64_t value = type.isSigned ?
+			static_cast<uint64_t>(strtoll(str.c_str(), &end, 0)) :
+			strtoull(str.c_str(), &end, 0);
+
+		// little endian hosts only, as OpenCL devices in practice
+		memcpy(&bytes[0], &value, type.size);
+	}
+
+	return end != str.c_str() && !*end;
+}
+
+// element i of contents as double
+double iElement(const ArgSpec& arg, const std::vector<unsigned char>& contents,
+	size_t i)
+{
+	const unsigned char* p = &contents[i * arg.elementSize];
+
+	if(arg.floating)
+	{
+		if(arg.elementSize == 4)
+		{
+			float f;
+			memcpy(&f, p, sizeof(f));
+			return f;
+		}
+
+		double d;
+		memcpy(&d, p, sizeof(d));
+		return d;
+	}
+
+	uint64_t value = 0;
+	memcpy(&value, p, arg.elementSize);
+
+	const ScalarType* type = iFindType(arg.type);
+
+	if(type && type->isSigned && arg.elementSize < 8 &&
+		(value >> (arg.elementSize * 8 - 1)) & 1)
+	{
+		value |= ~uint64_t(0) << (arg.elementSize * 8);
+	}
+
+	return type && type->isSigned ?
+		static_cast<double>(static_cast<int64_t>(value)) :
+		static_cast<double>(value);
+}
+
+void iFillRandom(const ArgSpec& arg, size_t seed,
+	std::vector<unsigned char>& contents)
+{
+	uint64_t state = (seed + 1) * 0x9E3779B97F4A7C15ULL;
+
+	for(size_t i = 0; i < arg.count; ++i)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		unsigned char* p = &contents[i * arg.elementSize];
+
+		if(arg.floating && arg.elementSize == 4)
+		{
+			float f = static_cast<float>(state >> 40) / 16777216.0f;
+			memcpy(p, &f, sizeof(f));
+		}
+		else if(arg.floating)
+		{
+			double d = static_cast<double>(state >> 11) / 9007199254740992.0;
+			memcpy(p, &d, sizeof(d));
+		}
+		else
+		{
+			// small values do not overflow narrow types in kernels
+			uint64_t value = state % 100;
+			memcpy(p, &value, arg.elementSize);
+		}
+	}
+}
+
+}
+
+bool ParseArgSpecs(
+	const std::string& spec, std::vector<ArgSpec>& args, std::string& error)
+{
+	args.clear();
+
+	if(spec.empty())
+	{
+		return true;
+	}
+
+	std::vector<std::string> items = iSplit(spec, ',');
+
+	for(std::vector<std::string>::const_iterator itr = items.begin();
+		itr != items.end(); ++itr)
+	{
+		std::vector<std::string> fields = iSplit(*itr, ':');
+		ArgSpec arg;
+		const ScalarType* type = NULL;
+
+		if(fields[0] == "buffer" || fields[0] == "local")
+		{
+			arg.kind = fields[0] == "buffer" ? ArgSpec::BUFFER : ArgSpec::LOCAL;
+
+			size_t maxFields = arg.kind == ArgSpec::BUFFER ? 4 : 3;
+
+			if(fields.size() < 3 || fields.size() > maxFields ||
+				!(type = iFindType(fields[1])) || !iParseCount(fields[2], arg.count) ||
+				(fields.size() == 4 && !iEncode(*type, fields[3], arg.value)))
+			{
+				error = "bad argument: " + *itr;
+				return false;
+			}
+		}
+		else
+		{
+			arg.kind = ArgSpec::SCALAR;
+			arg.count = 1;
+
+			if(fields.size() != 2 || !(type = iFindType(fields[0])) ||
+				!iEncode(*type, fields[1], arg.value))
+			{
+				error = "bad argument: " + *itr;
+				return false;
+			}
+		}
+
+		arg.type = type->name;
+		arg.elementSize = type->size;
+		arg.floating = type->floating;
+
+		args.push_back(arg);
+	}
+
+	return true;
+}
+
+bool ParseWorkSizes(const std::string& spec, std::vector<size_t>& sizes)
+{
+	sizes.clear();
+
+	std::vector<std::string> fields = iSplit(spec, ',');
+
+	if(fields.size() > 3)
+	{
+		return false;
+	}
+
+	for(size_t i = 0; i < fields.size(); ++i)
+	{
+		size_t size;
+
+		if(!iParseCount(fields[i], size))
+		{
+			return false;
+		}
+
+		sizes.push_back(size);
+	}
+
+	return true;
+}
+
+cl_int TimeKernel(cl_command_queue queue, cl_kernel kernel,
+	const std::vector<size_t>& global, const std::vector<size_t>& local,
+	size_t runs, std::vector<double>& times, const size_t* offset)
+{
+	for(size_t i = 0; i < runs; ++i)
+	{
+		cl_event event;
+
+		if(cl_int err = clEnqueueNDRangeKernel(queue, kernel, global.size(), offset,
+			&global[0], local.empty() ? NULL : &local[0], 0, NULL, &event))
+		{
+			return err;
+		}
+
+		cl_ulong start = 0;
+		cl_ulong end = 0;
+		cl_int err = clWaitForEvents(1, &event);
+
+		if(!err)
+		{
+			err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+				sizeof(start), &start, NULL);
+		}
+
+		if(!err)
+		{
+			err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+				sizeof(end), &end, NULL);
+		}
+
+		clReleaseEvent(event);
+
+		if(err)
+		{
+			return err;
+		}
+
+		times.push_back((end - start) * 1e-6);
+	}
+
+	return CL_SUCCESS;
+}
+
+KernelArgs::KernelArgs()
+{
+}
+
+KernelArgs::~KernelArgs()
+{
+	Release();
+}
+
+cl_int KernelArgs::Create(cl_context context, const std::vector<ArgSpec>& args)
+{
+	Release();
+
+	args_ = args;
+	buffers_.resize(args.size(), NULL);
+	initial_.resize(args.size());
+
+	for(size_t i = 0; i < args.size(); ++i)
+	{
+		const ArgSpec& arg = args[i];
+
+		if(arg.kind != ArgSpec::BUFFER)
+		{
+			continue;
+		}
+
+		std::vector<unsigned char>& contents = initial_[i];
+		contents.resize(arg.count * arg.elementSize);
+
+		if(arg.value.empty())
+		{
+			iFillRandom(arg, i, contents);
+		}
+		else
+		{
+			for(size_t j = 0; j < arg.count; ++j)
+			{
+				memcpy(&contents[j * arg.elementSize], &arg.value[0], arg.elementSize);
+			}
+		}
+
+		cl_int errcode_ret;
+		buffers_[i] = clCreateBuffer(context, CL_MEM_READ_WRITE,
+			contents.size(), NULL, &errcode_ret);
+
+		if(errcode_ret)
+		{
+			buffers_[i] = NULL;
+			Release();
+			return errcode_ret;
+		}
+	}
+
+	return CL_SUCCESS;
+}
+
+void KernelArgs::Release()
+{
+	for(std::vector<cl_mem>::iterator itr = buffers_.begin();
+		itr != buffers_.end(); ++itr)
+	{
+		if(*itr)
+		{
+			clReleaseMemObject(*itr);
+		}
+	}
+
+	args_.clear();
+	buffers_.clear();
+	initial_.clear();
+}
+
+cl_int KernelArgs::Reset(cl_command_queue queue)
+{
+	for(size_t i = 0; i < buffers_.size(); ++i)
+	{
+		if(!buffers_[i])
+		{
+			continue;
+		}
+
+		if(cl_int err = clEnqueueWriteBuffer(queue, buffers_[i], CL_FALSE, 0,
+			initial_[i].size(), &initial_[i][0], 0, NULL, NULL))
+		{
+			return err;
+		}
+	}
+
+	return clFinish(queue);
+}
+
+cl_int KernelArgs::Set(cl_kernel kernel) const
+{
+	for(size_t i = 0; i < args_.size(); ++i)
+	{
+		const ArgSpec& arg = args_[i];
+		cl_int err;
+
+		switch(arg.kind)
+		{
+		case ArgSpec::BUFFER:
+			err = clSetKernelArg(kernel, i, sizeof(cl_mem), &buffers_[i]);
+			break;
+		case ArgSpec::LOCAL:
+			err = clSetKernelArg(kernel, i, arg.count * arg.elementSize, NULL);
+			break;
+		default:
+			err = clSetKernelArg(kernel, i, arg.value.size(), &arg.value[0]);
+			break;
+		}
+
+		if(err)
+		{
+			return err;
+		}
+	}
+
+	return CL_SUCCESS;
+}
+
+cl_int KernelArgs::Read(cl_command_queue queue,
+	std::vector< std::vector<unsigned char> >& contents) const
+{
+	contents.clear();
+	contents.resize(buffers_.size());
+
+	for(size_t i = 0; i < buffers_.size(); ++i)
+	{
+		if(!buffers_[i])
+		{
+			continue;
+		}
+
+		contents[i].resize(initial_[i].size());
+
+		if(cl_int err = clEnqueueReadBuffer(queue, buffers_[i], CL_TRUE, 0,
+			contents[i].size(), &contents[i][0], 0, NULL, NULL))
+		{
+			return err;
+		}
+	}
+
+	return CL_SUCCESS;
+}
+
+bool KernelArgs::Compare(
+	const std::vector< std::vector<unsigned char> >& reference,
+	const std::vector< std::vector<unsigned char> >& contents,
+	double tolerance, double& max_error) const
+{
+	bool same = true;
+	max_error = 0;
+
+	for(size_t i = 0; i < args_.size(); ++i)
+	{
+		const ArgSpec& arg = args_[i];
+
+		if(arg.kind != ArgSpec::BUFFER)
+		{
+			continue;
+		}
+
+		if(i >= reference.size() || i >= contents.size() ||
+			reference[i].size() != contents[i].size())
+		{
+			return false;
+		}
+
+		for(size_t j = 0; j < arg.count; ++j)
+		{
+			double expected = iElement(arg, reference[i], j);
+			double actual = iElement(arg, contents[i], j);
+
+			if(std::isnan(expected) && std::isnan(actual))
+			{
+				continue;
+			}
+
+			double error = std::fabs(actual - expected);
+
+			if(arg.floating)
+			{
+				error /= std::max(1.0, std::fabs(expected));
+			}
+
+			if(!(error <= (arg.floating ? tolerance : 0.0)))
+			{
+				same = false;
+			}
+
+			if(!(error <= max_error))
+			{
+				max_error = error;
+			}
+		}
+	}
+
+	return same;
+}
+
+size_t KernelArgs::BufferBytes() const
+{
+	size_t bytes = 0;
+
+	for(size_t i = 0; i < initial_.size(); ++i)
+	{
+		bytes += initial_[i].size();
+	}
+
+	return bytes;
+}
+
+}
@@ -0,0 +1,122 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_KERNELARGS_HPP_
+#define OCLC_KERNELARGS_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// one kernel argument given on the command line
+struct ArgSpec
+{
+	enum Kind
+	{
+		SCALAR,
+		BUFFER,
+		LOCAL,
+	};
+
+	Kind kind;
+
+	// OpenCL C scalar type of the value or the elements
+	std::string type;
+	size_t elementSize;
+	bool floating;
+
+	// elements of buffers and local memory
+	size_t count;
+
+	// bytes of a scalar, or of the element buffers are filled with.
+	// buffers without it get pseudo random contents.
+	std::vector<unsigned char> value;
+};
+
+// parse comma separated arguments in kernel argument order:
+//   buffer:<type>:<count>[:<fill>]  global buffer, count may end in K or M
+//   local:<type>:<count>            local memory
+//   <type>:<value>                  scalar
+// types are char, uchar, short, ushort, int, uint, long, ulong, float,
+// double. returns false and sets error on failure.
+bool ParseArgSpecs(
+	const std::string& spec, std::vector<ArgSpec>& args, std::string& error);
+
+// parse "x[,y[,z]]" work sizes, returns false on failure
+bool ParseWorkSizes(const std::string& spec, std::vector<size_t>& sizes);
+
+// enqueue kernel over global work sizes (in groups of local unless it is
+// empty, starting at offset unless it is NULL) runs times, one after
+// another, and add the execution time of each, from profiling events, to
+// times in milliseconds. queue must have been created with
+// CL_QUEUE_PROFILING_ENABLE.
+cl_int TimeKernel(cl_command_queue queue, cl_kernel kernel,
+	const std::vector<size_t>& global, const std::vector<size_t>& local,
+	size_t runs, std::vector<double>& times, const size_t* offset = NULL);
+
+// buffers and values of ArgSpecs set on kernels. every buffer starts
+// with the same contents, so runs of different kernels can be compared.
+class KernelArgs
+{
+public:
+	KernelArgs();
+	~KernelArgs();
+
+	// allocate buffers in context and make their initial contents
+	cl_int Create(cl_context context, const std::vector<ArgSpec>& args);
+	void Release();
+
+	// write the initial contents to every buffer and wait
+	cl_int Reset(cl_command_queue queue);
+
+	cl_int Set(cl_kernel kernel) const;
+
+	// contents of every buffer, in argument order
+	cl_int Read(cl_command_queue queue,
+		std::vector< std::vector<unsigned char> >& contents) const;
+
+	// compare contents read from two runs, floating point elements within
+	// tolerance relative to the reference (absolute below 1). max_error is
+	// the largest difference found.
+	bool Compare(
+		const std::vector< std::vector<unsigned char> >& reference,
+		const std::vector< std::vector<unsigned char> >& contents,
+		double tolerance, double& max_error) const;
+
+	// bytes of every global buffer together
+	size_t BufferBytes() const;
+
+private:
+	KernelArgs(const KernelArgs&);
+	KernelArgs& operator=(const KernelArgs&);
+
+	std::vector<ArgSpec> args_;
+	std::vector<cl_mem> buffers_;
+	std::vector< std::vector<unsigned char> > initial_;
+};
+
+}
+
+#endif
@@ -0,0 +1,279 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "loader.hpp"
+#include "build.hpp"
+#include "clx.hpp"
+#include "device.hpp"
+#include "file.hpp"
+
+#include <vector>
+
+namespace OCLT
+{
+
+namespace
+{
+
+// binary of device_id from a clx container or a bare binary file. data
+// points into file or into buffer.
+bool iFindBinary(const std::string& path, cl_device_id device_id,
+	ClxFile& clx, MappedFile& file, std::vector<unsigned char>& buffer,
+	const unsigned char*& data, size_t& size)
+{
+	if(clx.Open(path))
+	{
+		int index = clx.Find(GetDeviceFingerprint(device_id));
+
+		if(index < 0)
+		{
+			return false;
+		}
+
+		if(!(clx.Entry(index).flags & ClxFlagLz))
+		{
+			// the mapping goes to the driver without a copy
+			data = clx.Data(index);
+			size = clx.Entry(index).size;
+			return true;
+		}
+
+		if(!clx.Extract(index, buffer))
+		{
+			return false;
+		}
+	}
+	else if(!file.Open(path) || ClxFile::IsClx(file.Data(), file.Size()))
+	{
+		return false;
+	}
+	else
+	{
+		data = file.Data();
+		size = file.Size();
+		return true;
+	}
+
+	data = buffer.empty() ? NULL : &buffer[0];
+	size = buffer.size();
+
+	return true;
+}
+
+cl_int iBuildFromBinary(cl_context context, cl_device_id device_id,
+	const unsigned char* data, size_t size, const std::string& build_options,
+	cl_program& program)
+{
+	cl_int binary_status = CL_SUCCESS;
+	cl_int errcode_ret;
+
+	program = clCreateProgramWithBinary(
+		context, 1, &device_id, &size, &data, &binary_status, &errcode_ret);
+
+	if(!errcode_ret && binary_status)
+	{
+		errcode_ret = binary_status;
+	}
+
+	if(!errcode_ret)
+	{
+		errcode_ret = clBuildProgram(
+			program, 1, &device_id, build_options.c_str(), NULL, NULL);
+	}
+
+	if(errcode_ret && program)
+	{
+		clReleaseProgram(program);
+	}
+
+	if(errcode_ret)
+	{
+		program = NULL;
+	}
+
+	return errcode_ret;
+}
+
+cl_int iBuildFromSource(cl_context context, cl_device_id device_id,
+	const ProgramLoadOptions& opts, ProgramLoadResult& result)
+{
+	std::vector<char> source;
+
+	if(!ReadFile(opts.sourcePath, source))
+	{
+		return CL_INVALID_VALUE;
+	}
+
+	const char* text = source.empty() ? "" : &source[0];
+	size_t length = source.size();
+	cl_int errcode_ret;
+
+	result.program = clCreateProgramWithSource(
+		context, 1, &text, &length, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		result.program = NULL;
+		return errcode_ret;
+	}
+
+	errcode_ret = clBuildProgram(result.program, 1, &device_id,
+		opts.buildOptions.c_str(), NULL, NULL);
+
+	if(errcode_ret)
+	{
+		size_t log_size = 0;
+
+		if(!clGetProgramBuildInfo(result.program, device_id,
+			CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size) && log_size > 1)
+		{
+			std::vector<char> log(log_size);
+
+			if(!clGetProgramBuildInfo(result.program, device_id,
+				CL_PROGRAM_BUILD_LOG, log_size, &log[0], NULL))
+			{
+				result.log.assign(&log[0]);
+			}
+		}
+
+		clReleaseProgram(result.program);
+		result.program = NULL;
+	}
+
+	return errcode_ret;
+}
+
+// replace or add the entry of device_id in the container at path,
+// keeping the entries of other devices. a bare binary at path is
+// replaced by a bare binary.
+bool iWriteBack(const std::string& path, cl_device_id device_id,
+	cl_program program)
+{
+	using namespace std;
+
+	// the program holds a binary for every device of its context
+	vector<DeviceBinary> binaries;
+
+	if(GetProgramBinaries(program, binaries))
+	{
+		return false;
+	}
+
+	size_t index = 0;
+
+	while(index < binaries.size() && binaries[index].device_id != device_id)
+	{
+		++index;
+	}
+
+	if(index == binaries.size() || binaries[index].binary.empty())
+	{
+		return false;
+	}
+
+	const vector<unsigned char>& binary = binaries[index].binary;
+
+	const string fingerprint = GetDeviceFingerprint(device_id);
+	ClxFile clx;
+	ClxWriter writer;
+	vector< vector<unsigned char> > others;
+	bool compress = false;
+
+	if(clx.Open(path))
+	{
+		others.resize(clx.EntryCount());
+
+		for(size_t i = 0; i < clx.EntryCount(); ++i)
+		{
+			compress = compress || (clx.Entry(i).flags & ClxFlagLz);
+
+			if(clx.Entry(i).fingerprint != fingerprint && !clx.Extract(i, others[i]))
+			{
+				return false;
+			}
+		}
+	}
+	else
+	{
+		MappedFile file;
+		bool raw = file.Open(path) && !ClxFile::IsClx(file.Data(), file.Size());
+		file.Close();
+
+		if(raw)
+		{
+			return WriteFileAtomic(path, &binary[0], binary.size());
+		}
+	}
+
+	writer.SetCompression(compress);
+
+	for(size_t i = 0; i < others.size(); ++i)
+	{
+		if(clx.Entry(i).fingerprint != fingerprint)
+		{
+			writer.Add(clx.Entry(i).fingerprint,
+				others[i].empty() ? NULL : &others[i][0], others[i].size());
+		}
+	}
+
+	writer.Add(fingerprint, &binary[0], binary.size());
+
+	return writer.Write(path);
+}
+
+}
+
+cl_int LoadProgram(cl_context context, cl_device_id device_id,
+	const ProgramLoadOptions& opts, ProgramLoadResult& result)
+{
+	result = ProgramLoadResult();
+
+	if(!opts.binaryPath.empty())
+	{
+		ClxFile clx;
+		MappedFile file;
+		std::vector<unsigned char> buffer;
+		const unsigned char* data = NULL;
+		size_t size = 0;
+
+		if(iFindBinary(opts.binaryPath, device_id, clx, file, buffer, data, size))
+		{
+			result.binaryStatus = iBuildFromBinary(context, device_id,
+				data, size, opts.buildOptions, result.program);
+
+			if(!result.binaryStatus)
+			{
+				result.fromBinary = true;
+				return CL_SUCCESS;
+			}
+		}
+	}
+
+	if(cl_int err = iBuildFromSource(context, device_id, opts, result))
+	{
+		return err;
+	}
+
+	if(opts.writeBack && !opts.binaryPath.empty())
+	{
+		result.wroteBack = iWriteBack(opts.binaryPath, device_id, result.program);
+	}
+
+	return CL_SUCCESS;
+}
+
+}
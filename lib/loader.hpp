@@ -0,0 +1,79 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_LOADER_HPP_
+#define OCLC_LOADER_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <string>
+
+namespace OCLT
+{
+
+// where LoadProgram() takes the program from
+struct ProgramLoadOptions
+{
+	ProgramLoadOptions() : writeBack(false) {}
+
+	// clx container written by oclc, or a bare binary of oclc --raw.
+	// empty to build from source.
+	std::string binaryPath;
+	// OpenCL C source built when there is no usable binary
+	std::string sourcePath;
+	// passed to clBuildProgram for binaries and sources alike
+	std::string buildOptions;
+	// store the binary of a source build into binaryPath (as a clx entry
+	// for the device, or in place of a bare binary), so that the next
+	// start finds it. the file is replaced atomically without a lock:
+	// when processes write back at once, the last one wins and the
+	// entries the others added are built again at a later start.
+	bool writeBack;
+};
+
+struct ProgramLoadResult
+{
+	ProgramLoadResult() : program(NULL), fromBinary(false),
+		binaryStatus(CL_SUCCESS), wroteBack(false) {}
+
+	// built for the device, owned by the caller
+	cl_program program;
+	bool fromBinary;
+	// why a binary was not used, CL_SUCCESS when none was found:
+	// the error of clCreateProgramWithBinary, its binary_status or the
+	// error of clBuildProgram
+	cl_int binaryStatus;
+	bool wroteBack;
+	// build log of a failed source build
+	std::string log;
+};
+
+// build a program for device_id of context from the device's binary in
+// opts.binaryPath, falling back to a build of opts.sourcePath when there
+// is none or the driver rejects it (a driver update, a different device).
+// returns the error of the source build, CL_SUCCESS on success. a failed
+// write back is not an error, see result.wroteBack.
+cl_int LoadProgram(cl_context context, cl_device_id device_id,
+	const ProgramLoadOptions& opts, ProgramLoadResult& result);
+
+}
+
+#endif
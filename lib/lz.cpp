@@ -0,0 +1,324 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "lz.hpp"
+
+#include <stdint.h>
+#include <cstring>
+
+namespace OCLT
+{
+
+namespace
+{
+
+const uint32_t iStoredFlag = 0x80000000u;
+const size_t iHeaderSize = 8;
+const size_t iMinMatch = 4;
+const size_t iMaxOffset = 65535;
+const int iHashBits = 14;
+const size_t iNoPosition = ~size_t(0);
+
+uint32_t iRead32(const unsigned char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint32_t iGet32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+void iPut32(unsigned char* p, uint32_t v)
+{
+	for(int i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+size_t iHash(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - iHashBits);
+}
+
+void iPutLength(std::vector<unsigned char>& out, size_t length)
+{
+	for(; length >= 255; length -= 255)
+	{
+		out.push_back(255);
+	}
+
+	out.push_back(static_cast<unsigned char>(length));
+}
+
+// literals followed by a match of match_length at offset, or by nothing
+// when match_length is 0
+void iPutSequence(std::vector<unsigned char>& out,
+	const unsigned char* literals, size_t literal_length,
+	size_t offset, size_t match_length)
+{
+	size_t matchCode = match_length ? match_length - iMinMatch : 0;
+
+	out.push_back(static_cast<unsigned char>(
+		((literal_length < 15 ? literal_length : 15) << 4) |
+		(matchCode < 15 ? matchCode : 15)));
+
+	if(literal_length >= 15)
+	{
+		iPutLength(out, literal_length - 15);
+	}
+
+	out.insert(out.end(), literals, literals + literal_length);
+
+	if(!match_length)
+	{
+		return;
+	}
+
+	out.push_back(static_cast<unsigned char>(offset));
+	out.push_back(static_cast<unsigned char>(offset >> 8));
+
+	if(matchCode >= 15)
+	{
+		iPutLength(out, matchCode - 15);
+	}
+}
+
+bool iGetLength(const unsigned char*& in, const unsigned char* end,
+	size_t& length)
+{
+	for(;;)
+	{
+		if(in == end)
+		{
+			return false;
+		}
+
+		unsigned char byte = *in++;
+		length += byte;
+
+		if(byte != 255)
+		{
+			return true;
+		}
+	}
+}
+
+// decode one block of stored size bytes at data to out + pos, earlier
+// output is the window of its matches
+bool iDecodeBlock(const unsigned char* data, size_t size, bool stored,
+	size_t raw_size, unsigned char* out, size_t out_size, size_t& pos)
+{
+	if(raw_size > LzBlockSize || raw_size > out_size - pos || size > LzBlockSize)
+	{
+		return false;
+	}
+
+	if(stored)
+	{
+		if(size != raw_size)
+		{
+			return false;
+		}
+
+		memcpy(out + pos, data, size);
+		pos += size;
+
+		return true;
+	}
+
+	const unsigned char* in = data;
+	const unsigned char* inEnd = data + size;
+	unsigned char* op = out + pos;
+	unsigned char* const opEnd = op + raw_size;
+
+	while(in < inEnd)
+	{
+		unsigned char token = *in++;
+		size_t literals = token >> 4;
+
+		if(literals == 15 && !iGetLength(in, inEnd, literals))
+		{
+			return false;
+		}
+
+		if(literals > size_t(inEnd - in) || literals > size_t(opEnd - op))
+		{
+			return false;
+		}
+
+		memcpy(op, in, literals);
+		in += literals;
+		op += literals;
+
+		if(in == inEnd)
+		{
+			break;
+		}
+
+		if(inEnd - in < 2)
+		{
+			return false;
+		}
+
+		size_t offset = in[0] | (in[1] << 8);
+		size_t length = token & 15;
+		in += 2;
+
+		if(length == 15 && !iGetLength(in, inEnd, length))
+		{
+			return false;
+		}
+
+		length += iMinMatch;
+
+		if(!offset || offset > size_t(op - out) || length > size_t(opEnd - op))
+		{
+			return false;
+		}
+
+		const unsigned char* match = op - offset;
+
+		if(offset >= length)
+		{
+			memcpy(op, match, length);
+			op += length;
+		}
+		else
+		{
+			// overlapping match repeats the last offset bytes
+			for(size_t i = 0; i < length; ++i)
+			{
+				*op++ = *match++;
+			}
+		}
+	}
+
+	if(op != opEnd)
+	{
+		return false;
+	}
+
+	pos += raw_size;
+
+	return true;
+}
+
+}
+
+void LzCompress(const unsigned char* data, size_t size,
+	std::vector<unsigned char>& out)
+{
+	std::vector<size_t> table(size_t(1) << iHashBits, iNoPosition);
+
+	for(size_t start = 0; start < size; start += LzBlockSize)
+	{
+		const size_t end = start + LzBlockSize < size ? start + LzBlockSize : size;
+		const size_t header = out.size();
+
+		out.resize(header + iHeaderSize);
+
+		size_t anchor = start;
+		size_t i = start;
+
+		while(i + iMinMatch <= end)
+		{
+			uint32_t value = iRead32(data + i);
+			size_t& slot = table[iHash(value)];
+			size_t candidate = slot;
+			slot = i;
+
+			if(candidate == iNoPosition || i - candidate > iMaxOffset ||
+				iRead32(data + candidate) != value)
+			{
+				// step faster through data which does not compress
+				i += 1 + ((i - anchor) >> 6);
+				continue;
+			}
+
+			size_t length = iMinMatch;
+
+			while(i + length < end && data[candidate + length] == data[i + length])
+			{
+				++length;
+			}
+
+			while(i > anchor && candidate > 0 && data[i - 1] == data[candidate - 1])
+			{
+				--i;
+				--candidate;
+				++length;
+			}
+
+			iPutSequence(out, data + anchor, i - anchor, i - candidate, length);
+
+			i += length;
+			anchor = i;
+
+			if(i - 2 >= start && i + iMinMatch <= end)
+			{
+				table[iHash(iRead32(data + i - 2))] = i - 2;
+			}
+		}
+
+		iPutSequence(out, data + anchor, end - anchor, 0, 0);
+
+		size_t stored = out.size() - header - iHeaderSize;
+		uint32_t flags = 0;
+
+		if(stored >= end - start)
+		{
+			out.resize(header + iHeaderSize);
+			out.insert(out.end(), data + start, data + end);
+			stored = end - start;
+			flags = iStoredFlag;
+		}
+
+		iPut32(&out[header], static_cast<uint32_t>(stored) | flags);
+		iPut32(&out[header + 4], static_cast<uint32_t>(end - start));
+	}
+}
+
+bool LzDecompress(const unsigned char* data, size_t size,
+	unsigned char* out, size_t out_size)
+{
+	size_t pos = 0;
+
+	while(size)
+	{
+		if(size < iHeaderSize)
+		{
+			return false;
+		}
+
+		uint32_t stored = iGet32(data);
+		size_t length = stored & ~iStoredFlag;
+
+		if(size - iHeaderSize < length || !iDecodeBlock(data + iHeaderSize, length,
+			(stored & iStoredFlag) != 0, iGet32(data + 4), out, out_size, pos))
+		{
+			return false;
+		}
+
+		data += iHeaderSize + length;
+		size -= iHeaderSize + length;
+	}
+
+	return pos == out_size;
+}
+
+}
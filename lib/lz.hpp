@@ -0,0 +1,53 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_LZ_HPP_
+#define OCLC_LZ_HPP_
+
+#include <cstddef>
+#include <vector>
+
+namespace OCLT
+{
+
+// byte oriented LZ77 codec for device binaries, in the spirit of LZ4:
+// fast to decode, no entropy coding.
+//
+// a stream is a sequence of blocks of at most LzBlockSize raw bytes
+//   stored size (u32, bit 31 set when the block is stored as is)
+//   raw size (u32)
+//   stored size bytes of sequences, or of raw bytes
+// a sequence is
+//   token: literal length (high 4 bits), match length - 4 (low 4 bits),
+//     15 is continued by bytes up to and including one below 255
+//   literals
+//   match offset (u16) and match, omitted by the last sequence of a block
+// matches may reach back into earlier blocks by up to 65535 bytes.
+
+static const size_t LzBlockSize = 1 << 16;
+
+// append the compressed stream of data to out
+void LzCompress(const unsigned char* data, size_t size,
+	std::vector<unsigned char>& out);
+
+// decompress a whole stream into out, returns false on broken data
+bool LzDecompress(const unsigned char* data, size_t size,
+	unsigned char* out, size_t out_size);
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "session.hpp"
+
+#include <thread>
+
+namespace OCLT
+{
+
+BuildSession::BuildSession()
+	: enumerated_(false), queried_(false)
+{
+}
+
+BuildSession::~BuildSession()
+{
+	for(std::map<cl_platform_id, ContextSlot*>::iterator itr =
+		contexts_.begin(); itr != contexts_.end(); ++itr)
+	{
+		if(itr->second->context)
+		{
+			ReleasePlatformContext(*itr->second->context);
+			delete itr->second->context;
+		}
+
+		delete itr->second;
+	}
+}
+
+// called with mutex_ held
+cl_int BuildSession::EnumeratePlatforms()
+{
+	if(enumerated_)
+	{
+		return CL_SUCCESS;
+	}
+
+	if(cl_int err = OCLT::GetPlatformIDs(platform_ids_))
+	{
+		return err;
+	}
+
+	enumerated_ = true;
+
+	return CL_SUCCESS;
+}
+
+cl_int BuildSession::GetPlatformIDs(std::vector<cl_platform_id>& platform_ids)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if(cl_int err = EnumeratePlatforms())
+	{
+		return err;
+	}
+
+	platform_ids = platform_ids_;
+
+	return CL_SUCCESS;
+}
+
+cl_int BuildSession::GetContext(
+	cl_platform_id platform_id, const PlatformContext*& context)
+{
+	ContextSlot* slot = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		ContextSlot*& entry = contexts_[platform_id];
+
+		if(!entry)
+		{
+			entry = new ContextSlot;
+		}
+
+		slot = entry;
+	}
+
+	// other platforms only wait for the map lookup above
+	std::lock_guard<std::mutex> lock(slot->mutex);
+
+	if(!slot->context)
+	{
+		PlatformContext* created = new PlatformContext;
+
+		if(cl_int err = CreatePlatformContext(platform_id, *created))
+		{
+			delete created;
+			return err;
+		}
+
+		slot->context = created;
+	}
+
+	context = slot->context;
+
+	return CL_SUCCESS;
+}
+
+void BuildSession::Build(
+	cl_platform_id platform_id,
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	PlatformBuild& result)
+{
+	const PlatformContext* context = NULL;
+
+	result.platform_id = platform_id;
+	result.log.clear();
+	result.binaries.clear();
+
+	if( (result.error = GetContext(platform_id, context)) )
+	{
+		return;
+	}
+
+	BuildProgram(*context, sources, build_options, result);
+}
+
+cl_int BuildSession::BuildAll(
+	const std::vector<SourceText>& sources,
+	const std::string& build_options,
+	std::vector<PlatformBuild>& results)
+{
+	using namespace std;
+
+	vector<cl_platform_id> platform_ids;
+
+	if(cl_int err = GetPlatformIDs(platform_ids))
+	{
+		return err;
+	}
+
+	results.resize(platform_ids.size());
+
+	vector<thread> threads;
+	threads.reserve(platform_ids.size());
+
+	for(size_t i = 0; i < platform_ids.size(); ++i)
+	{
+		threads.push_back( thread([&, i]()
+		{
+			Build(platform_ids[i], sources, build_options, results[i]);
+		}) );
+	}
+
+	for(vector<thread>::iterator itr = threads.begin();
+		itr != threads.end(); ++itr)
+	{
+		itr->join();
+	}
+
+	return CL_SUCCESS;
+}
+
+cl_int BuildSession::GetCapabilities(CapabilitySnapshot& snapshot)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if(!queried_)
+	{
+		if(cl_int err = QueryCapabilities(capabilities_))
+		{
+			return err;
+		}
+
+		queried_ = true;
+	}
+
+	snapshot = capabilities_;
+
+	return CL_SUCCESS;
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_SESSION_HPP_
+#define OCLC_SESSION_HPP_
+
+#include "build.hpp"
+#include "capabilities.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// entry point for long-lived processes which build and query many times.
+// platforms, their contexts and device capabilities are looked up on
+// first use and kept until the session is destroyed, so only the first
+// call pays for ICD loading and context creation. nothing exits the
+// process, errors are returned as cl_int (GetErrorMessage() has their
+// text) and build errors in PlatformBuild::error with the build log.
+// every member may be called from several threads at once.
+class BuildSession
+{
+public:
+	BuildSession();
+	~BuildSession();
+
+	// every platform, enumerated by the first call
+	cl_int GetPlatformIDs(std::vector<cl_platform_id>& platform_ids);
+
+	// context holding every device of platform_id, created by the first
+	// call for the platform (again by the next call when that failed)
+	// without blocking calls for other platforms. it lives as long as the
+	// session.
+	cl_int GetContext(cl_platform_id platform_id, const PlatformContext*& context);
+
+	// build sources for every device of platform_id on its shared context
+	void Build(
+		cl_platform_id platform_id,
+		const std::vector<SourceText>& sources,
+		const std::string& build_options,
+		PlatformBuild& result);
+
+	// build sources for every platform, one thread per platform
+	cl_int BuildAll(
+		const std::vector<SourceText>& sources,
+		const std::string& build_options,
+		std::vector<PlatformBuild>& results);
+
+	// capabilities of every device, queried by the first call
+	cl_int GetCapabilities(CapabilitySnapshot& snapshot);
+
+private:
+	BuildSession(const BuildSession&);
+	BuildSession& operator=(const BuildSession&);
+
+	// the context of one platform and the lock held while it is created,
+	// so that platforms are set up concurrently
+	struct ContextSlot
+	{
+		ContextSlot() : context(NULL) {}
+
+		std::mutex mutex;
+		PlatformContext* context;  // NULL until created
+	};
+
+	cl_int EnumeratePlatforms();
+
+	std::mutex mutex_;
+	bool enumerated_;
+	std::vector<cl_platform_id> platform_ids_;
+	std::map<cl_platform_id, ContextSlot*> contexts_;
+	bool queried_;
+	CapabilitySnapshot capabilities_;
+};
+
+}
+
+#endif
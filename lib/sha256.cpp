@@ -0,0 +1,181 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "sha256.hpp"
+
+#include <cstring>
+
+namespace OCLT
+{
+
+static const uint32_t iRoundConstants[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t iRotr(uint32_t x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+Sha256::Sha256()
+	: length_(0), buffered_(0)
+{
+	state_[0] = 0x6a09e667;
+	state_[1] = 0xbb67ae85;
+	state_[2] = 0x3c6ef372;
+	state_[3] = 0xa54ff53a;
+	state_[4] = 0x510e527f;
+	state_[5] = 0x9b05688c;
+	state_[6] = 0x1f83d9ab;
+	state_[7] = 0x5be0cd19;
+}
+
+void Sha256::Update(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	length_ += size;
+
+	if(buffered_)
+	{
+		size_t fill = 64 - buffered_ < size ? 64 - buffered_ : size;
+		memcpy(buffer_ + buffered_, bytes, fill);
+		buffered_ += fill;
+		bytes += fill;
+		size -= fill;
+
+		if(buffered_ < 64)
+		{
+			return;
+		}
+
+		Transform(buffer_);
+		buffered_ = 0;
+	}
+
+	for(; size >= 64; bytes += 64, size -= 64)
+	{
+		Transform(bytes);
+	}
+
+	memcpy(buffer_, bytes, size);
+	buffered_ = size;
+}
+
+void Sha256::Update(const std::string& str)
+{
+	Update(str.data(), str.size());
+}
+
+void Sha256::Final(unsigned char* digest)
+{
+	uint64_t bits = length_ * 8;
+	unsigned char pad[72] = { 0x80 };
+	size_t padSize = (buffered_ < 56 ? 56 : 120) - buffered_;
+
+	for(int i = 0; i < 8; ++i)
+	{
+		pad[padSize + i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+	}
+
+	Update(pad, padSize + 8);
+
+	for(int i = 0; i < 8; ++i)
+	{
+		digest[i * 4 + 0] = static_cast<unsigned char>(state_[i] >> 24);
+		digest[i * 4 + 1] = static_cast<unsigned char>(state_[i] >> 16);
+		digest[i * 4 + 2] = static_cast<unsigned char>(state_[i] >> 8);
+		digest[i * 4 + 3] = static_cast<unsigned char>(state_[i]);
+	}
+}
+
+std::string Sha256::HexDigest()
+{
+	unsigned char digest[DigestSize];
+	Final(digest);
+	return ToHex(digest, DigestSize);
+}
+
+void Sha256::Transform(const unsigned char* block)
+{
+	uint32_t w[64];
+
+	for(int i = 0; i < 16; ++i)
+	{
+		w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+			(uint32_t(block[i * 4 + 2]) << 8) | uint32_t(block[i * 4 + 3]);
+	}
+
+	for(int i = 16; i < 64; ++i)
+	{
+		uint32_t s0 = iRotr(w[i - 15], 7) ^ iRotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = iRotr(w[i - 2], 17) ^ iRotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+	uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+
+	for(int i = 0; i < 64; ++i)
+	{
+		uint32_t s1 = iRotr(e, 6) ^ iRotr(e, 11) ^ iRotr(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t t1 = h + s1 + ch + iRoundConstants[i] + w[i];
+		uint32_t s0 = iRotr(a, 2) ^ iRotr(a, 13) ^ iRotr(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t t2 = s0 + maj;
+
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+	state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+}
+
+std::string ToHex(const unsigned char* data, size_t size)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	std::string result(size * 2, '0');
+
+	for(size_t i = 0; i < size; ++i)
+	{
+		result[i * 2] = digits[data[i] >> 4];
+		result[i * 2 + 1] = digits[data[i] & 0xf];
+	}
+
+	return result;
+}
+
+}
@@ -0,0 +1,57 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_SHA256_HPP_
+#define OCLC_SHA256_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+namespace OCLT
+{
+
+class Sha256
+{
+public:
+	static const size_t DigestSize = 32;
+
+	Sha256();
+
+	void Update(const void* data, size_t size);
+	void Update(const std::string& str);
+
+	// finish hashing and write DigestSize bytes to digest
+	void Final(unsigned char* digest);
+
+	// finish hashing and return digest as lower case hex string
+	std::string HexDigest();
+
+private:
+	void Transform(const unsigned char* block);
+
+	uint32_t state_[8];
+	uint64_t length_;
+	unsigned char buffer_[64];
+	size_t buffered_;
+};
+
+std::string ToHex(const unsigned char* data, size_t size);
+
+}
+
+#endif
@@ -0,0 +1,454 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "stream.hpp"
+#include "device.hpp"
+
+#include <chrono>
+
+namespace OCLT
+{
+
+namespace
+{
+
+const size_t iMaxChunkBytes = 64 << 20;
+const size_t iMinChunkBytes = 1 << 20;
+const size_t iDefaultDepth = 3;
+
+size_t iClamp(cl_ulong value)
+{
+	return static_cast<size_t>(std::min<cl_ulong>(
+		value, std::numeric_limits<size_t>::max()));
+}
+
+// device time of a finished command, 0 without profiling
+double iSeconds(cl_event event)
+{
+	cl_ulong start = 0;
+	cl_ulong end = 0;
+
+	if(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+		sizeof(start), &start, NULL) || clGetEventProfilingInfo(event,
+		CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL) || end < start)
+	{
+		return 0;
+	}
+
+	return (end - start) * 1e-9;
+}
+
+}
+
+double StreamStats::OverlapEfficiency(double serial_seconds) const
+{
+	double sum = uploadSeconds + kernelSeconds + downloadSeconds;
+	double longest = std::max(uploadSeconds, std::max(kernelSeconds, downloadSeconds));
+	double serial = serial_seconds > 0 ? serial_seconds : sum;
+
+	if(serial <= longest)
+	{
+		return 0;
+	}
+
+	return std::max(0.0, std::min(1.0, (serial - seconds) / (serial - longest)));
+}
+
+StreamPipeline::Slot::Slot()
+	: input(NULL), output(NULL), hostInput(NULL), hostOutput(NULL),
+	hostInputData(NULL), hostOutputData(NULL), bytesIn(0), bytesOut(0),
+	busy(false)
+{
+	events[0] = events[1] = events[2] = NULL;
+}
+
+StreamPipeline::StreamPipeline()
+	: context_(NULL), maxAlloc_(0), globalMem_(0), chunkBytes_(0),
+	stats_()
+{
+	queues_[0] = queues_[1] = queues_[2] = NULL;
+}
+
+StreamPipeline::~StreamPipeline()
+{
+	Release();
+}
+
+void StreamPipeline::ReleaseSlots()
+{
+	for(size_t i = 0; i < slots_.size(); ++i)
+	{
+		Slot& slot = slots_[i];
+
+		if(slot.hostInputData)
+		{
+			clEnqueueUnmapMemObject(queues_[0], slot.hostInput,
+				slot.hostInputData, 0, NULL, NULL);
+		}
+
+		if(slot.hostOutputData)
+		{
+			clEnqueueUnmapMemObject(queues_[0], slot.hostOutput,
+				slot.hostOutputData, 0, NULL, NULL);
+		}
+	}
+
+	if(queues_[0])
+	{
+		clFinish(queues_[0]);
+	}
+
+	for(size_t i = 0; i < slots_.size(); ++i)
+	{
+		cl_mem mems[] = {slots_[i].input, slots_[i].output,
+			slots_[i].hostInput, slots_[i].hostOutput};
+
+		for(size_t m = 0; m < sizeof(mems) / sizeof(mems[0]); ++m)
+		{
+			if(mems[m]) clReleaseMemObject(mems[m]);
+		}
+	}
+
+	slots_.clear();
+	chunkBytes_ = 0;
+}
+
+void StreamPipeline::Release()
+{
+	ReleaseSlots();
+
+	// serial pipelines use one queue for every stage
+	for(size_t i = 0; i < 3; ++i)
+	{
+		if(queues_[i] && (!i || queues_[i] != queues_[0]))
+		{
+			clReleaseCommandQueue(queues_[i]);
+		}
+
+		queues_[i] = NULL;
+	}
+
+	if(context_)
+	{
+		clReleaseContext(context_);
+		context_ = NULL;
+	}
+}
+
+cl_int StreamPipeline::Init(cl_context context, cl_device_id device,
+	const StreamOptions& options)
+{
+	Release();
+
+	options_ = options;
+	options_.inputElementSize = std::max<size_t>(options.inputElementSize, 1);
+	maxAlloc_ = iClamp(GetDeviceInfoValue<cl_ulong>(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE));
+	globalMem_ = iClamp(GetDeviceInfoValue<cl_ulong>(device, CL_DEVICE_GLOBAL_MEM_SIZE));
+
+	if(!maxAlloc_ || !globalMem_)
+	{
+		return CL_INVALID_DEVICE;
+	}
+
+	if(cl_int err = clRetainContext(context))
+	{
+		return err;
+	}
+
+	context_ = context;
+
+	for(size_t i = 0; i < (options.serial ? 1 : 3); ++i)
+	{
+		cl_int err;
+		queues_[i] = clCreateCommandQueue(
+			context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+
+		if(err)
+		{
+			queues_[i] = NULL;
+			Release();
+			return err;
+		}
+	}
+
+	if(options.serial)
+	{
+		queues_[1] = queues_[2] = queues_[0];
+	}
+
+	return CL_SUCCESS;
+}
+
+cl_int StreamPipeline::Allocate(size_t chunk_bytes, size_t depth)
+{
+	if(chunk_bytes == chunkBytes_ && depth == slots_.size())
+	{
+		return CL_SUCCESS;
+	}
+
+	ReleaseSlots();
+	slots_.resize(depth);
+
+	size_t output_bytes = chunk_bytes / options_.inputElementSize *
+		std::max<size_t>(options_.outputElementSize, 1);
+	cl_int err = CL_SUCCESS;
+
+	for(size_t i = 0; !err && i < depth; ++i)
+	{
+		Slot& slot = slots_[i];
+
+		slot.input = clCreateBuffer(context_, CL_MEM_READ_ONLY, chunk_bytes, NULL, &err);
+
+		if(!err) slot.output = clCreateBuffer(
+			context_, CL_MEM_WRITE_ONLY, output_bytes, NULL, &err);
+		if(!err) slot.hostInput = clCreateBuffer(context_,
+			CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, chunk_bytes, NULL, &err);
+		if(!err) slot.hostOutput = clCreateBuffer(context_,
+			CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, output_bytes, NULL, &err);
+		if(!err) slot.hostInputData = clEnqueueMapBuffer(queues_[0], slot.hostInput,
+			CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, chunk_bytes, 0, NULL, NULL, &err);
+		if(!err) slot.hostOutputData = clEnqueueMapBuffer(queues_[0], slot.hostOutput,
+			CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, output_bytes, 0, NULL, NULL, &err);
+	}
+
+	if(err)
+	{
+		ReleaseSlots();
+		return err;
+	}
+
+	chunkBytes_ = chunk_bytes;
+
+	return CL_SUCCESS;
+}
+
+cl_int StreamPipeline::Finish(Slot& slot, const StreamSink& sink)
+{
+	cl_int err = CL_SUCCESS;
+	double* seconds[] = {&stats_.uploadSeconds, &stats_.kernelSeconds,
+		&stats_.downloadSeconds};
+
+	for(size_t i = 0; i < 3; ++i)
+	{
+		if(!slot.events[i])
+		{
+			// never enqueued, the chunk failed
+			err = err ? err : CL_INVALID_EVENT;
+			continue;
+		}
+
+		cl_int status = CL_COMPLETE;
+		cl_int waited = clWaitForEvents(1, &slot.events[i]);
+
+		if(!waited)
+		{
+			waited = clGetEventInfo(slot.events[i], CL_EVENT_COMMAND_EXECUTION_STATUS,
+				sizeof(status), &status, NULL);
+		}
+
+		err = err ? err : waited ? waited : status < 0 ? status : CL_SUCCESS;
+		*seconds[i] += iSeconds(slot.events[i]);
+
+		clReleaseEvent(slot.events[i]);
+		slot.events[i] = NULL;
+	}
+
+	slot.busy = false;
+
+	if(err)
+	{
+		return err;
+	}
+
+	++stats_.chunks;
+	stats_.bytesIn += slot.bytesIn;
+	stats_.bytesOut += slot.bytesOut;
+
+	if(sink)
+	{
+		sink(slot.hostOutputData, slot.bytesOut);
+	}
+
+	return CL_SUCCESS;
+}
+
+cl_int StreamPipeline::Run(cl_kernel kernel, StreamSource& source,
+	const StreamSink& sink)
+{
+	using namespace std;
+
+	if(!context_)
+	{
+		return CL_INVALID_CONTEXT;
+	}
+
+	size_t element = options_.inputElementSize;
+	size_t output_element = max<size_t>(options_.outputElementSize, 1);
+	size_t depth = options_.serial ? 1 : options_.depth ? options_.depth : iDefaultDepth;
+	size_t chunk = options_.chunkBytes;
+
+	if(!chunk)
+	{
+		// every slot holds a chunk of input and its output, in at most
+		// half the device memory
+		double output_ratio = static_cast<double>(output_element) / element;
+
+		chunk = min(iMaxChunkBytes, min(maxAlloc_,
+			static_cast<size_t>(maxAlloc_ / output_ratio)));
+		chunk = min(chunk, static_cast<size_t>(
+			globalMem_ / 2 / depth / (1 + output_ratio)));
+
+		// a short input still fills the pipeline
+		if(source.Remaining() != numeric_limits<size_t>::max())
+		{
+			chunk = min(chunk, max(iMinChunkBytes, source.Remaining() / (4 * depth)));
+		}
+	}
+
+	// whole elements which the uint count can address
+	chunk = min(chunk, static_cast<size_t>(numeric_limits<cl_uint>::max()) * element);
+	chunk = max(element, chunk / element * element);
+
+	if(cl_int err = Allocate(chunk, depth))
+	{
+		return err;
+	}
+
+	stats_ = StreamStats();
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	cl_int err = CL_SUCCESS;
+	size_t i = 0;
+
+	// the start of an element a short read split, the head of the next
+	// chunk
+	vector<unsigned char> carry;
+	bool ended = false;
+
+	for(; !err && !ended; ++i)
+	{
+		Slot& slot = slots_[i % depth];
+
+		if(slot.busy)
+		{
+			err = Finish(slot, sink);
+		}
+
+		size_t taken = 0;
+		const unsigned char* data = NULL;
+
+		if(!err && carry.empty())
+		{
+			data = static_cast<const unsigned char*>(source.Take(chunk, taken));
+			ended = data && !taken;
+
+			// in place only from a whole element on, else copied with the
+			// bytes after it
+			if(data && taken && taken < element)
+			{
+				carry.assign(data, data + taken);
+				data = NULL;
+			}
+		}
+
+		if(!err && !data && !ended)
+		{
+			unsigned char* buffer = static_cast<unsigned char*>(slot.hostInputData);
+			size_t got = 0;
+
+			if(!carry.empty())
+			{
+				memcpy(buffer, &carry[0], carry.size());
+			}
+
+			taken = carry.size();
+
+			// read on until a whole element or the end
+			do
+			{
+				got = source.Read(buffer + taken, chunk - taken);
+				taken += got;
+			}
+			while(got && taken < element);
+
+			data = buffer;
+			ended = !got;
+		}
+
+		cl_uint count = static_cast<cl_uint>(taken / element);
+
+		if(data)
+		{
+			carry.assign(data + count * element, data + taken);
+		}
+
+		if(err || !count)
+		{
+			break;
+		}
+
+		slot.bytesIn = count * element;
+		slot.bytesOut = count * output_element;
+		slot.busy = true;
+
+		size_t local = options_.local;
+		size_t global = local ? (count + local - 1) / local * local : count;
+
+		err = clEnqueueWriteBuffer(queues_[0], slot.input, CL_FALSE, 0,
+			slot.bytesIn, data, 0, NULL, &slot.events[0]);
+
+		if(!err) err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &slot.input);
+		if(!err) err = clSetKernelArg(kernel, 1, sizeof(cl_mem), &slot.output);
+		if(!err) err = clSetKernelArg(kernel, 2, sizeof(count), &count);
+
+		if(!err) err = clEnqueueNDRangeKernel(queues_[1], kernel, 1, NULL,
+			&global, local ? &local : NULL, 1, &slot.events[0], &slot.events[1]);
+
+		if(!err) err = clEnqueueReadBuffer(queues_[2], slot.output, CL_FALSE, 0,
+			slot.bytesOut, slot.hostOutputData, 1, &slot.events[1], &slot.events[2]);
+
+		for(size_t q = 0; !err && q < 3; ++q)
+		{
+			err = clFlush(queues_[q]);
+		}
+
+		// the baseline waits for each chunk before reading the next
+		if(!err && options_.serial)
+		{
+			err = Finish(slot, sink);
+		}
+	}
+
+	// the chunks in flight, oldest first, handed out unless one failed
+	for(size_t k = 0; k < depth; ++k)
+	{
+		Slot& slot = slots_[(i + k) % depth];
+
+		if(slot.busy)
+		{
+			cl_int finished = Finish(slot, err ? StreamSink() : sink);
+			err = err ? err : finished;
+		}
+	}
+
+	stats_.bytesDropped = carry.size();
+	stats_.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	return err;
+}
+
+}
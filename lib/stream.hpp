@@ -0,0 +1,267 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_STREAM_HPP_
+#define OCLC_STREAM_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace OCLT
+{
+
+// input of a StreamPipeline, read front to back
+class StreamSource
+{
+public:
+	virtual ~StreamSource() {}
+
+	// copy up to size bytes to data, the count copied, 0 at the end
+	virtual size_t Read(void* data, size_t size) = 0;
+
+	// the next up to size bytes in place, valid until the source is
+	// destroyed, or NULL when the source has to copy
+	virtual const void* Take(size_t size, size_t& taken)
+	{
+		(void)size;
+		taken = 0;
+		return NULL;
+	}
+
+	// bytes left, SIZE_MAX when unknown
+	virtual size_t Remaining() const
+	{
+		return std::numeric_limits<size_t>::max();
+	}
+};
+
+// bytes in memory, such as the Data() of a MappedFile. chunks are
+// uploaded straight from it.
+class MemorySource : public StreamSource
+{
+public:
+	MemorySource(const void* data, size_t size)
+		: data_(static_cast<const unsigned char*>(data)), size_(size), offset_(0)
+	{
+	}
+
+	virtual size_t Read(void* data, size_t size)
+	{
+		size_t taken = 0;
+		const void* from = Take(size, taken);
+
+		memcpy(data, from, taken);
+		return taken;
+	}
+
+	virtual const void* Take(size_t size, size_t& taken)
+	{
+		taken = std::min(size, size_ - offset_);
+		offset_ += taken;
+		return data_ + offset_ - taken;
+	}
+
+	virtual size_t Remaining() const
+	{
+		return size_ - offset_;
+	}
+
+private:
+	const unsigned char* data_;
+	size_t size_;
+	size_t offset_;
+};
+
+// elements of [begin, end) of any input iterator over trivially copyable
+// values, copied into the chunks
+template<typename Iterator>
+class IteratorSource : public StreamSource
+{
+public:
+	typedef typename std::iterator_traits<Iterator>::value_type Value;
+
+	IteratorSource(Iterator begin, Iterator end)
+		: current_(begin), end_(end)
+	{
+	}
+
+	virtual size_t Read(void* data, size_t size)
+	{
+		Value* out = static_cast<Value*>(data);
+		size_t count = 0;
+
+		for(; count < size / sizeof(Value) && current_ != end_; ++current_)
+		{
+			out[count++] = *current_;
+		}
+
+		return count * sizeof(Value);
+	}
+
+	virtual size_t Remaining() const
+	{
+		return Remaining(typename std::iterator_traits<Iterator>::iterator_category());
+	}
+
+private:
+	// known for random access iterators only
+	size_t Remaining(std::random_access_iterator_tag) const
+	{
+		return static_cast<size_t>(end_ - current_) * sizeof(Value);
+	}
+
+	size_t Remaining(std::input_iterator_tag) const
+	{
+		return std::numeric_limits<size_t>::max();
+	}
+
+	Iterator current_;
+	Iterator end_;
+};
+
+// receives the output of each chunk in input order, data is valid during
+// the call only
+typedef std::function<void(const void* data, size_t size)> StreamSink;
+
+struct StreamOptions
+{
+	StreamOptions()
+		: chunkBytes(0), depth(0), inputElementSize(1), outputElementSize(1),
+		local(0), serial(false)
+	{
+	}
+
+	// input bytes of a chunk and chunks in flight, 0 to choose them from
+	// the device limits
+	size_t chunkBytes;
+	size_t depth;
+	// the kernel writes one output element per input element
+	size_t inputElementSize;
+	size_t outputElementSize;
+	// work-group size, 0 for the driver's choice. the global size is
+	// rounded up to it, so the kernel has to check the count.
+	size_t local;
+	// upload, run and download one chunk after another on one queue, the
+	// baseline the overlap is measured against
+	bool serial;
+};
+
+// device time of each stage summed over the chunks of a Run(), from
+// profiling events, and its wall time
+struct StreamStats
+{
+	size_t chunks;
+	size_t bytesIn;
+	size_t bytesOut;
+	// input bytes short of a whole element at the end, left out
+	size_t bytesDropped;
+	double seconds;
+	double uploadSeconds;
+	double kernelSeconds;
+	double downloadSeconds;
+
+	// of the time overlapping could save over serial_seconds (a serial
+	// baseline, or the sum of the stages when 0) down to the longest
+	// stage, the part saved
+	double OverlapEfficiency(double serial_seconds = 0) const;
+};
+
+// streams input larger than device memory through a kernel in chunks.
+// each of depth slots has an input and an output buffer and pinned host
+// memory for the output. uploads, kernels and downloads go to three
+// in-order queues, ordered by events, so the upload of chunk N+1, the
+// kernel on chunk N and the download of chunk N-1 run at once. the host
+// reads the next input and hands finished outputs to the sink while the
+// device works, in order. the kernel takes (__global const in*,
+// __global out*, uint count) as its first arguments, later ones are set
+// by the caller. without options, chunks are sized from
+// CL_DEVICE_GLOBAL_MEM_SIZE and CL_DEVICE_MAX_MEM_ALLOC_SIZE (at most
+// 64MB, smaller for short inputs so that the pipeline fills) and depth
+// is 3, one chunk per stage.
+class StreamPipeline
+{
+public:
+	StreamPipeline();
+	~StreamPipeline();
+
+	cl_int Init(cl_context context, cl_device_id device,
+		const StreamOptions& options = StreamOptions());
+
+	// run kernel over every chunk of source, sink may be empty. the bytes
+	// of an element a short read splits start the next chunk, those short
+	// of a whole element at the end are left out, see
+	// StreamStats::bytesDropped
+	cl_int Run(cl_kernel kernel, StreamSource& source, const StreamSink& sink);
+
+	// chosen by the last Run()
+	size_t ChunkBytes() const { return chunkBytes_; }
+	size_t Depth() const { return slots_.size(); }
+
+	const StreamStats& Stats() const { return stats_; }
+
+private:
+	StreamPipeline(const StreamPipeline&);
+	StreamPipeline& operator=(const StreamPipeline&);
+
+	struct Slot
+	{
+		Slot();
+
+		cl_mem input;
+		cl_mem output;
+		// CL_MEM_ALLOC_HOST_PTR, mapped while allocated: the input of
+		// sources which copy, and the output
+		cl_mem hostInput;
+		cl_mem hostOutput;
+		void* hostInputData;
+		void* hostOutputData;
+		cl_event events[3];    // upload, kernel, download
+		size_t bytesIn;
+		size_t bytesOut;
+		bool busy;
+	};
+
+	cl_int Allocate(size_t chunk_bytes, size_t depth);
+	// wait for the chunk in slot, add its stage times and hand it out
+	cl_int Finish(Slot& slot, const StreamSink& sink);
+	void ReleaseSlots();
+	void Release();
+
+	cl_context context_;
+	StreamOptions options_;
+	size_t maxAlloc_;
+	size_t globalMem_;
+	cl_command_queue queues_[3];
+	std::vector<Slot> slots_;
+	size_t chunkBytes_;
+	StreamStats stats_;
+};
+
+}
+
+#endif
@@ -0,0 +1,283 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "trace.hpp"
+#include "file.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+struct TraceEvent
+{
+	const char* name;
+	std::string detail;
+	long long start;
+	long long duration;
+	int thread;
+};
+
+struct PhaseTotal
+{
+	PhaseTotal() : count(0), total(0), longest(0) {}
+
+	std::string name;
+	size_t count;
+	long long total;
+	long long longest;
+};
+
+// never destroyed, spans may end in threads still running at exit
+struct TraceLog
+{
+	std::mutex mutex;
+	std::chrono::steady_clock::time_point origin;
+	std::vector<TraceEvent> events;
+	std::map<int, std::string> threadNames;
+};
+
+std::atomic<bool> gTraceEnabled(false);
+std::atomic<int> gNextThread(0);
+TraceLog* gTraceLog = NULL;
+
+int iThreadIndex()
+{
+	static thread_local int index = -1;
+
+	if(index < 0)
+	{
+		index = gNextThread++;
+	}
+
+	return index;
+}
+
+long long iNow()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - gTraceLog->origin).count();
+}
+
+bool iLongerTotal(const PhaseTotal& lhs, const PhaseTotal& rhs)
+{
+	return lhs.total > rhs.total;
+}
+
+}
+
+void EnableTrace()
+{
+	if(gTraceEnabled)
+	{
+		return;
+	}
+
+	gTraceLog = new TraceLog;
+	gTraceLog->origin = std::chrono::steady_clock::now();
+
+	// the enabling thread is usually main
+	SetTraceThreadName("main");
+
+	gTraceEnabled = true;
+}
+
+bool TraceEnabled()
+{
+	return gTraceEnabled;
+}
+
+void SetTraceThreadName(const std::string& name)
+{
+	if(!gTraceLog)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(gTraceLog->mutex);
+	gTraceLog->threadNames[iThreadIndex()] = name;
+}
+
+TraceSpan::TraceSpan(const char* name)
+	: name_(name), start_(gTraceEnabled ? iNow() : -1)
+{
+}
+
+TraceSpan::TraceSpan(const char* name, const std::string& detail)
+	: name_(name), start_(gTraceEnabled ? iNow() : -1)
+{
+	if(start_ >= 0)
+	{
+		detail_ = detail;
+	}
+}
+
+TraceSpan::~TraceSpan()
+{
+	if(start_ < 0)
+	{
+		return;
+	}
+
+	TraceEvent event;
+	event.name = name_;
+	event.detail.swap(detail_);
+	event.start = start_;
+	event.duration = iNow() - start_;
+	event.thread = iThreadIndex();
+
+	std::lock_guard<std::mutex> lock(gTraceLog->mutex);
+	gTraceLog->events.push_back(event);
+}
+
+void PrintTimeReport(std::ostream& out)
+{
+	using namespace std;
+
+	if(!gTraceLog)
+	{
+		return;
+	}
+
+	vector<PhaseTotal> totals;
+	long long wall;
+	size_t threads;
+
+	{
+		lock_guard<mutex> lock(gTraceLog->mutex);
+
+		map<string, size_t> indices;
+
+		for(vector<TraceEvent>::const_iterator itr = gTraceLog->events.begin();
+			itr != gTraceLog->events.end(); ++itr)
+		{
+			map<string, size_t>::iterator index = indices.find(itr->name);
+
+			if(index == indices.end())
+			{
+				index = indices.insert(make_pair(string(itr->name), totals.size())).first;
+				totals.push_back(PhaseTotal());
+				totals.back().name = itr->name;
+			}
+
+			PhaseTotal& total = totals[index->second];
+			++total.count;
+			total.total += itr->duration;
+			total.longest = max(total.longest, itr->duration);
+		}
+
+		wall = iNow();
+		threads = gNextThread;
+	}
+
+	stable_sort(totals.begin(), totals.end(), iLongerTotal);
+
+	char line[128];
+
+	snprintf(line, sizeof(line), "---- time report, %.3f ms wall on %u threads",
+		wall / 1000.0, static_cast<unsigned>(threads));
+	out << line << endl;
+
+	snprintf(line, sizeof(line), "%-28s %6s %12s %12s",
+		"phase", "count", "total ms", "longest ms");
+	out << line << endl;
+
+	for(vector<PhaseTotal>::const_iterator itr = totals.begin();
+		itr != totals.end(); ++itr)
+	{
+		snprintf(line, sizeof(line), "%-28s %6u %12.3f %12.3f",
+			itr->name.c_str(), static_cast<unsigned>(itr->count),
+			itr->total / 1000.0, itr->longest / 1000.0);
+		out << line << endl;
+	}
+
+	if(threads > 1)
+	{
+		out << "phases of concurrent threads overlap, totals may exceed wall" <<
+			endl;
+	}
+}
+
+bool WriteChromeTrace(const std::string& path)
+{
+	using namespace std;
+
+	string json = "{\"traceEvents\":[\n";
+
+	if(gTraceLog)
+	{
+		lock_guard<mutex> lock(gTraceLog->mutex);
+
+		char buf[160];
+		int pid = getpid();
+		bool first = true;
+
+		for(map<int, string>::const_iterator itr = gTraceLog->threadNames.begin();
+			itr != gTraceLog->threadNames.end(); ++itr)
+		{
+			snprintf(buf, sizeof(buf),
+				"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+				"\"args\":{\"name\":", first ? "" : ",\n", pid, itr->first);
+			json += buf;
+			AppendJsonString(json, itr->second);
+			json += "}}";
+			first = false;
+		}
+
+		for(vector<TraceEvent>::const_iterator itr = gTraceLog->events.begin();
+			itr != gTraceLog->events.end(); ++itr)
+		{
+			json += first ? "" : ",\n";
+			json += "{\"name\":";
+			AppendJsonString(json, itr->name);
+
+			snprintf(buf, sizeof(buf),
+				",\"cat\":\"oclc\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+				"\"pid\":%d,\"tid\":%d",
+				itr->start, itr->duration, pid, itr->thread);
+			json += buf;
+
+			if(!itr->detail.empty())
+			{
+				json += ",\"args\":{\"detail\":";
+				AppendJsonString(json, itr->detail);
+				json += "}";
+			}
+
+			json += "}";
+			first = false;
+		}
+	}
+
+	json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return WriteFileAtomic(path, json.data(), json.size());
+}
+
+}
@@ -0,0 +1,62 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_TRACE_HPP_
+#define OCLC_TRACE_HPP_
+
+#include <ostream>
+#include <string>
+
+namespace OCLT
+{
+
+// phases of oclc timed for --time-report and --trace. nothing is recorded
+// until EnableTrace(), then spans of every thread are kept in memory.
+void EnableTrace();
+bool TraceEnabled();
+
+// name of the calling thread's track, others are shown by number
+void SetTraceThreadName(const std::string& name);
+
+// time the enclosing scope as phase name. name must be a literal,
+// detail (a path, a device name) is shown in the trace only.
+class TraceSpan
+{
+public:
+	explicit TraceSpan(const char* name);
+	TraceSpan(const char* name, const std::string& detail);
+	~TraceSpan();
+
+private:
+	TraceSpan(const TraceSpan&);
+	TraceSpan& operator=(const TraceSpan&);
+
+	const char* name_;
+	std::string detail_;
+	long long start_;
+};
+
+// count, total and longest time of every phase, longest total first
+void PrintTimeReport(std::ostream& out);
+
+// chrome://tracing and Perfetto JSON with one track per thread.
+// returns false and sets errno on failure.
+bool WriteChromeTrace(const std::string& path);
+
+}
+
+#endif
@@ -0,0 +1,914 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "bench.hpp"
+#include "build.hpp"
+#include "capture.hpp"
+#include "device.hpp"
+#include "dispatch.hpp"
+#include "errors.hpp"
+#include "file.hpp"
+#include "kernelargs.hpp"
+#include "loader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace OCLT
+{
+
+namespace
+{
+
+bool iDeviceType(const std::string& name, cl_device_type& type)
+{
+	if(name == "cpu") type = CL_DEVICE_TYPE_CPU;
+	else if(name == "gpu") type = CL_DEVICE_TYPE_GPU;
+	else if(name == "accelerator") type = CL_DEVICE_TYPE_ACCELERATOR;
+	else return false;
+
+	return true;
+}
+
+bool iEndsWith(const std::string& str, const std::string& suffix)
+{
+	return str.size() >= suffix.size() &&
+		!str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+}
+
+void iPrintStats(const Options& opts, std::vector<double> times, double bytes)
+{
+	std::sort(times.begin(), times.end());
+
+	double median = times[times.size() / 2];
+
+	printf("  min    %12.6f ms\n", times.front());
+	printf("  median %12.6f ms\n", median);
+
+	// the rank is ceil(0.99 n), below 100 runs that is the maximum
+	if(times.size() >= 100)
+	{
+		printf("  p99    %12.6f ms\n", times[(times.size() * 99 + 99) / 100 - 1]);
+	}
+
+	printf("  max    %12.6f ms\n", times.back());
+
+	// of the median run
+	if(bytes > 0 && median > 0)
+	{
+		printf("  bandwidth %9.3f GB/s (%.0f bytes)\n", bytes / median / 1e6, bytes);
+	}
+
+	if(opts.flops > 0 && median > 0)
+	{
+		printf("  compute   %9.3f GFLOP/s (%.0f flops)\n",
+			opts.flops / median / 1e6, opts.flops);
+	}
+}
+
+// warmup and timed runs of kernel with its arguments set, reset() before
+// every timed run with opts.reset
+cl_int iTimeRuns(const Options& opts, cl_command_queue queue, cl_kernel kernel,
+	const std::vector<size_t>& global, const std::vector<size_t>& local,
+	const size_t* offset, const std::function<cl_int()>& reset,
+	std::vector<double>& times)
+{
+	std::vector<double> warmup;
+	cl_int err = TimeKernel(queue, kernel, global, local, opts.warmup, warmup, offset);
+
+	for(size_t i = 0; !err && i < opts.iterations; )
+	{
+		size_t runs = opts.reset ? 1 : opts.iterations;
+
+		if(opts.reset)
+		{
+			err = reset();
+		}
+
+		if(!err)
+		{
+			err = TimeKernel(queue, kernel, global, local, runs, times, offset);
+		}
+
+		i += runs;
+	}
+
+	return err;
+}
+
+// time kernel with freshly made arguments
+int iMeasure(const Options& opts, cl_context context, cl_command_queue queue,
+	cl_kernel kernel, const std::vector<ArgSpec>& argSpecs,
+	const std::vector<size_t>& global, const std::vector<size_t>& local,
+	std::vector<double>& times, double& bytes)
+{
+	KernelArgs args;
+	cl_int err = args.Create(context, argSpecs);
+
+	if(!err) err = args.Reset(queue);
+	if(!err) err = args.Set(kernel);
+
+	if(!err)
+	{
+		err = iTimeRuns(opts, queue, kernel, global, local, NULL,
+			[&]() { return args.Reset(queue); }, times);
+	}
+
+	if(err)
+	{
+		std::cerr << "error : " << GetErrorMessage(err) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bytes = opts.autoBytes ? static_cast<double>(args.BufferBytes()) : opts.bytes;
+
+	return EXIT_SUCCESS;
+}
+
+// load the program and run its kernel
+int iBenchmark(const Options& opts, cl_context context, cl_command_queue queue,
+	cl_device_id device_id, const std::vector<ArgSpec>& argSpecs,
+	const std::vector<size_t>& global, const std::vector<size_t>& local)
+{
+	using namespace std;
+
+	ProgramLoadOptions load;
+	ProgramLoadResult loaded;
+
+	if(iEndsWith(opts.infile, ".cl"))
+	{
+		load.sourcePath = opts.infile;
+	}
+	else
+	{
+		load.binaryPath = opts.infile;
+		load.sourcePath = opts.sourceFile;
+	}
+
+	load.buildOptions = opts.buildOptions;
+
+	if(cl_int err = LoadProgram(context, device_id, load, loaded))
+	{
+		if(!loaded.log.empty())
+		{
+			cout << loaded.log << endl;
+		}
+
+		cerr << "error : " << (load.sourcePath.empty() ?
+			string("no usable binary for the device in ") + opts.infile :
+			GetErrorMessage(err)) << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!load.binaryPath.empty() && !loaded.fromBinary)
+	{
+		cerr << "warning : binary not used (" <<
+			(loaded.binaryStatus ? GetErrorMessage(loaded.binaryStatus) :
+				string("not found")) << "), built " << load.sourcePath << endl;
+	}
+
+	cl_int errcode_ret;
+	cl_kernel kernel = clCreateKernel(
+		loaded.program, opts.kernel.c_str(), &errcode_ret);
+
+	if(errcode_ret)
+	{
+		cerr << "error : " << GetErrorMessage(errcode_ret) << ": " <<
+			opts.kernel << endl;
+		clReleaseProgram(loaded.program);
+		return EXIT_FAILURE;
+	}
+
+	vector<double> times;
+	double bytes = 0;
+	int status = iMeasure(
+		opts, context, queue, kernel, argSpecs, global, local, times, bytes);
+
+	if(!status)
+	{
+		cout << opts.kernel << " on " <<
+			GetDeviceInfoString(device_id, CL_DEVICE_NAME) << " (" <<
+			(loaded.fromBinary ? "binary" : "source") << "), " <<
+			opts.warmup << " warmup, " << opts.iterations << " iterations" << endl;
+
+		iPrintStats(opts, times, bytes);
+	}
+
+	clReleaseKernel(kernel);
+	clReleaseProgram(loaded.program);
+
+	return status;
+}
+
+// the captured program, its binary or source built for device_id
+cl_int iLoadCapturedProgram(const Options& opts, cl_context context,
+	cl_device_id device_id, const CaptureFile& file, cl_program& program,
+	std::string& log)
+{
+	using namespace std;
+
+	const KernelCapture& launch = file.Launch();
+	const unsigned char* data = file.Data(launch.program);
+	size_t size = launch.program.size;
+	cl_int err = CL_SUCCESS;
+	vector<char> source;
+
+	if(launch.binary)
+	{
+		cl_int status = CL_SUCCESS;
+		program = clCreateProgramWithBinary(
+			context, 1, &device_id, &size, &data, &status, &err);
+
+		if(!err && status)
+		{
+			clReleaseProgram(program);
+			err = status;
+		}
+
+		if(err && !opts.sourceFile.empty())
+		{
+			if(!ReadFile(opts.sourceFile, source))
+			{
+				log = opts.sourceFile + ": " + strerror(errno);
+				return CL_INVALID_VALUE;
+			}
+
+			if(source.empty())
+			{
+				log = opts.sourceFile + ": empty";
+				return CL_INVALID_VALUE;
+			}
+
+			cerr << "warning : captured binary not used (" <<
+				GetErrorMessage(err) << "), built " << opts.sourceFile << endl;
+		}
+		else if(err)
+		{
+			return err;
+		}
+	}
+
+	if(!launch.binary || !source.empty())
+	{
+		const char* text = source.empty() ?
+			reinterpret_cast<const char*>(data) : &source[0];
+		size_t length = source.empty() ? size : source.size();
+
+		program = clCreateProgramWithSource(context, 1, &text, &length, &err);
+
+		if(err)
+		{
+			return err;
+		}
+	}
+
+	const string& options = opts.buildOptions.empty() ?
+		launch.options : opts.buildOptions;
+
+	err = clBuildProgram(program, 1, &device_id, options.c_str(), NULL, NULL);
+
+	if(err)
+	{
+		GetBuildLog(program, vector<cl_device_id>(1, device_id), log);
+		clReleaseProgram(program);
+	}
+
+	return err;
+}
+
+// run the launch of a file written by ocltrace with the captured buffers
+int iReplay(const Options& opts, cl_context context, cl_command_queue queue,
+	cl_device_id device_id)
+{
+	using namespace std;
+
+	CaptureFile file;
+
+	if(!file.Open(opts.infile))
+	{
+		cerr << "error : " << file.Error() << endl;
+		return EXIT_FAILURE;
+	}
+
+	const KernelCapture& launch = file.Launch();
+	cl_program program = NULL;
+	string log;
+
+	if(cl_int err = iLoadCapturedProgram(opts, context, device_id, file, program, log))
+	{
+		if(!log.empty())
+		{
+			cout << log << endl;
+		}
+
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return EXIT_FAILURE;
+	}
+
+	cl_int err;
+	cl_kernel kernel = clCreateKernel(program, launch.kernel.c_str(), &err);
+	vector<cl_mem> buffers;
+	vector<cl_mem> subBuffers;
+	double bytes = 0;
+
+	// created from the mapping, pages are read as the driver copies them
+	for(size_t i = 0; !err && i < launch.buffers.size(); ++i)
+	{
+		const CaptureBlob& blob = launch.buffers[i];
+
+		buffers.push_back(clCreateBuffer(context,
+			CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, blob.size,
+			const_cast<unsigned char*>(file.Data(blob)), &err));
+		bytes += blob.size;
+	}
+
+	for(size_t i = 0; !err && i < launch.args.size(); ++i)
+	{
+		const CaptureArg& arg = launch.args[i];
+
+		if(arg.kind == CaptureArg::VALUE)
+		{
+			err = clSetKernelArg(kernel, i, arg.size, &arg.value[0]);
+		}
+		else if(arg.kind == CaptureArg::BUFFER && arg.region)
+		{
+			// a region of a captured buffer, aliasing it as it did before
+#ifdef CL_VERSION_1_1
+			cl_buffer_region region = {arg.origin, arg.region};
+			cl_mem mem = clCreateSubBuffer(buffers[arg.buffer], 0,
+				CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
+
+			if(!err)
+			{
+				subBuffers.push_back(mem);
+				err = clSetKernelArg(kernel, i, sizeof(cl_mem), &mem);
+			}
+#else
+			err = CL_INVALID_MEM_OBJECT;
+#endif
+		}
+		else if(arg.kind == CaptureArg::BUFFER)
+		{
+			err = clSetKernelArg(kernel, i, sizeof(cl_mem), &buffers[arg.buffer]);
+		}
+		else
+		{
+			err = clSetKernelArg(kernel, i, arg.size, NULL);
+		}
+	}
+
+	vector<size_t> global(launch.global, launch.global + launch.dims);
+	vector<size_t> local;
+
+	if(!opts.localSize.empty())
+	{
+		if(!ParseWorkSizes(opts.localSize, local) || local.size() != launch.dims)
+		{
+			cerr << "bad work size" << endl;
+			err = CL_INVALID_WORK_GROUP_SIZE;
+		}
+	}
+	else if(launch.local[0])
+	{
+		local.assign(launch.local, launch.local + launch.dims);
+	}
+
+	vector<double> times;
+
+	if(!err)
+	{
+		err = iTimeRuns(opts, queue, kernel, global, local, launch.offset, [&]()
+		{
+			cl_int err = CL_SUCCESS;
+
+			for(size_t i = 0; !err && i < buffers.size(); ++i)
+			{
+				const CaptureBlob& blob = launch.buffers[i];
+				err = clEnqueueWriteBuffer(queue, buffers[i], CL_TRUE, 0,
+					blob.size, file.Data(blob), 0, NULL, NULL);
+			}
+
+			return err;
+		}, times);
+	}
+
+	if(err)
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+	}
+	else
+	{
+		string captured = launch.device.substr(0, launch.device.find('\n'));
+
+		cout << launch.kernel << " on " <<
+			GetDeviceInfoString(device_id, CL_DEVICE_NAME) << " (captured on " <<
+			captured << "), " << opts.warmup << " warmup, " <<
+			opts.iterations << " iterations" << endl;
+
+		iPrintStats(opts, times, opts.autoBytes ? bytes : opts.bytes);
+	}
+
+	for(size_t i = 0; i < subBuffers.size(); ++i)
+	{
+		clReleaseMemObject(subBuffers[i]);
+	}
+
+	for(size_t i = 0; i < buffers.size(); ++i)
+	{
+		if(buffers[i])
+		{
+			clReleaseMemObject(buffers[i]);
+		}
+	}
+
+	if(kernel)
+	{
+		clReleaseKernel(kernel);
+	}
+
+	clReleaseProgram(program);
+
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// up to count sub-devices of device_id with equal compute units, or
+// every device of its platform when it cannot be partitioned (always
+// without OpenCL 1.2)
+cl_int iScalingDevices(cl_device_id device_id, size_t count,
+	std::vector<cl_device_id>& devices, bool& partitioned)
+{
+	using namespace std;
+
+	partitioned = false;
+
+#ifdef CL_VERSION_1_2
+	cl_uint units = GetDeviceInfoValue<cl_uint>(device_id, CL_DEVICE_MAX_COMPUTE_UNITS);
+	cl_uint most = min(units, GetDeviceInfoValue<cl_uint>(
+		device_id, CL_DEVICE_PARTITION_MAX_SUB_DEVICES));
+	cl_uint num = static_cast<cl_uint>(min<size_t>(count, most));
+
+	partitioned = num > 1;
+
+	if(partitioned)
+	{
+		cl_device_partition_property properties[] = {
+			CL_DEVICE_PARTITION_EQUALLY,
+			static_cast<cl_device_partition_property>(units / num), 0};
+		cl_uint created = 0;
+
+		partitioned = !clCreateSubDevices(device_id, properties, 0, NULL, &created) &&
+			created >= num;
+
+		if(partitioned)
+		{
+			devices.resize(created);
+
+			if(cl_int err = clCreateSubDevices(
+				device_id, properties, created, &devices[0], NULL))
+			{
+				devices.clear();
+				return err;
+			}
+
+			for(size_t i = num; i < devices.size(); ++i)
+			{
+				clReleaseDevice(devices[i]);
+			}
+
+			devices.resize(num);
+			return CL_SUCCESS;
+		}
+	}
+#endif
+
+	cl_platform_id platform_id = NULL;
+
+	if(cl_int err = clGetDeviceInfo(device_id, CL_DEVICE_PLATFORM,
+		sizeof(platform_id), &platform_id, NULL))
+	{
+		return err;
+	}
+
+	if(cl_int err = GetDeviceIDs(platform_id, devices))
+	{
+		return err;
+	}
+
+	// the selected device first
+	vector<cl_device_id>::iterator selected =
+		find(devices.begin(), devices.end(), device_id);
+
+	if(selected != devices.end())
+	{
+		iter_swap(devices.begin(), selected);
+	}
+
+	if(count < devices.size())
+	{
+		devices.resize(count);
+	}
+
+	return CL_SUCCESS;
+}
+
+// time kernel dispatched over the first 1, 2, 4, ... and all devices
+int iMeasureScaling(const Options& opts, cl_context context,
+	const std::vector<cl_device_id>& devices, cl_kernel kernel,
+	KernelArgs& args, const std::vector<size_t>& global,
+	const std::vector<size_t>& local)
+{
+	using namespace std;
+
+	vector<cl_command_queue> queues;
+	cl_int err = CL_SUCCESS;
+
+	for(size_t i = 0; !err && i < devices.size(); ++i)
+	{
+		queues.push_back(clCreateCommandQueue(
+			context, devices[i], CL_QUEUE_PROFILING_ENABLE, &err));
+	}
+
+	if(!err) err = args.Reset(queues[0]);
+	if(!err) err = args.Set(kernel);
+
+	vector<size_t> counts;
+
+	for(size_t n = 1; n < devices.size(); n *= 2)
+	{
+		counts.push_back(n);
+	}
+
+	counts.push_back(devices.size());
+
+	printf("%7s %12s %8s %10s %7s %7s\n",
+		"devices", "median ms", "speedup", "efficiency", "chunks", "steals");
+
+	double single = 0;
+
+	for(size_t c = 0; !err && c < counts.size(); ++c)
+	{
+		Dispatcher dispatcher;
+		vector<double> times;
+
+		err = dispatcher.Init(vector<cl_command_queue>(
+			queues.begin(), queues.begin() + counts[c]));
+
+		// warmup runs also measure the throughput shares start from
+		for(size_t i = 0; !err && i < opts.warmup + opts.iterations; ++i)
+		{
+			if(opts.reset)
+			{
+				err = args.Reset(queues[0]);
+			}
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+			if(!err)
+			{
+				err = dispatcher.Run(kernel, global, local);
+			}
+
+			if(i >= opts.warmup)
+			{
+				times.push_back(chrono::duration<double, milli>(
+					chrono::steady_clock::now() - start).count());
+			}
+		}
+
+		if(err)
+		{
+			break;
+		}
+
+		sort(times.begin(), times.end());
+
+		double median = times[times.size() / 2];
+		size_t chunks = 0;
+		size_t steals = 0;
+
+		single = c ? single : median;
+
+		for(size_t i = 0; i < dispatcher.Stats().size(); ++i)
+		{
+			chunks += dispatcher.Stats()[i].chunks;
+			steals += dispatcher.Stats()[i].steals;
+		}
+
+		printf("%7zu %12.6f %7.2fx %9.1f%% %7zu %7zu\n", counts[c], median,
+			single / median, single / median / counts[c] * 100, chunks, steals);
+
+		if(opts.verbose)
+		{
+			for(size_t i = 0; i < dispatcher.Stats().size(); ++i)
+			{
+				const DispatchQueueStats& stats = dispatcher.Stats()[i];
+
+				printf("  %zu: %zu work-items in %zu chunks, %.6f ms busy\n", i,
+					stats.workItems, stats.chunks, stats.busySeconds * 1e3);
+			}
+		}
+	}
+
+	for(size_t i = 0; i < queues.size(); ++i)
+	{
+		if(queues[i])
+		{
+			clReleaseCommandQueue(queues[i]);
+		}
+	}
+
+	if(err)
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+	}
+
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// build the source for sub-devices of device_id (or the devices of its
+// platform) and compare dispatching the kernel over more and more of them
+int iScaling(const Options& opts, cl_device_id device_id,
+	const std::vector<ArgSpec>& argSpecs, const std::vector<size_t>& global,
+	const std::vector<size_t>& local)
+{
+	using namespace std;
+
+	const string& path = iEndsWith(opts.infile, ".cl") ? opts.infile : opts.sourceFile;
+	vector<char> source;
+
+	if(path.empty())
+	{
+		cerr << "--scaling builds the source, give a .cl input or -s" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!ReadFile(path, source) || source.empty())
+	{
+		cerr << path << ": " << (source.empty() && !errno ? "empty" : strerror(errno)) << endl;
+		return EXIT_FAILURE;
+	}
+
+	vector<cl_device_id> devices;
+	bool partitioned = false;
+
+	if(cl_int err = iScalingDevices(device_id, opts.scaling, devices, partitioned))
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return EXIT_FAILURE;
+	}
+
+	cl_int err;
+	cl_context context = clCreateContext(
+		NULL, devices.size(), &devices[0], NULL, NULL, &err);
+	cl_program program = NULL;
+	cl_kernel kernel = NULL;
+	KernelArgs args;
+
+	if(!err)
+	{
+		const char* text = &source[0];
+		size_t length = source.size();
+
+		program = clCreateProgramWithSource(context, 1, &text, &length, &err);
+	}
+
+	if(!err)
+	{
+		err = clBuildProgram(program, devices.size(), &devices[0],
+			opts.buildOptions.c_str(), NULL, NULL);
+
+		string log;
+
+		if(err && !GetBuildLog(program, devices, log) && !log.empty())
+		{
+			cout << log << endl;
+		}
+	}
+
+	if(!err)
+	{
+		kernel = clCreateKernel(program, opts.kernel.c_str(), &err);
+	}
+
+	if(!err)
+	{
+		err = args.Create(context, argSpecs);
+	}
+
+	int status = EXIT_FAILURE;
+
+	if(err)
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+	}
+	else
+	{
+		cout << opts.kernel << " over " << devices.size() <<
+			(partitioned ? " sub-devices of " : " devices of the platform of ") <<
+			GetDeviceInfoString(device_id, CL_DEVICE_NAME) << ", " <<
+			opts.warmup << " warmup, " << opts.iterations << " iterations" << endl;
+
+		status = iMeasureScaling(opts, context, devices, kernel, args, global, local);
+	}
+
+	args.Release();
+
+	if(kernel)
+	{
+		clReleaseKernel(kernel);
+	}
+
+	if(program)
+	{
+		clReleaseProgram(program);
+	}
+
+	if(context)
+	{
+		clReleaseContext(context);
+	}
+
+#ifdef CL_VERSION_1_2
+	for(size_t i = 0; partitioned && i < devices.size(); ++i)
+	{
+		clReleaseDevice(devices[i]);
+	}
+#endif
+
+	return status;
+}
+
+}
+
+cl_int SelectDevice(const Options& opts, cl_device_id& device_id)
+{
+	using namespace std;
+
+	cl_uint num_platforms = 0;
+
+	if(cl_int err = clGetPlatformIDs(0, NULL, &num_platforms))
+	{
+		return err;
+	}
+
+	vector<cl_platform_id> platform_ids(num_platforms);
+
+	if(num_platforms)
+	{
+		if(cl_int err = clGetPlatformIDs(num_platforms, &platform_ids[0], NULL))
+		{
+			return err;
+		}
+	}
+
+	cl_device_type type = CL_DEVICE_TYPE_ALL;
+
+	if(!opts.deviceType.empty() && !iDeviceType(opts.deviceType, type))
+	{
+		return CL_INVALID_DEVICE_TYPE;
+	}
+
+	for(size_t i = 0; i < platform_ids.size(); ++i)
+	{
+		if(opts.deviceType.empty() && i != opts.platformIndex)
+		{
+			continue;
+		}
+
+		cl_uint num_devices = 0;
+
+		if(clGetDeviceIDs(platform_ids[i], type, 0, NULL, &num_devices) ||
+			!num_devices)
+		{
+			continue;
+		}
+
+		vector<cl_device_id> device_ids(num_devices);
+
+		if(cl_int err = clGetDeviceIDs(
+			platform_ids[i], type, num_devices, &device_ids[0], NULL))
+		{
+			return err;
+		}
+
+		size_t index = opts.deviceType.empty() ? opts.deviceIndex : 0;
+
+		if(index < device_ids.size())
+		{
+			device_id = device_ids[index];
+			return CL_SUCCESS;
+		}
+	}
+
+	return CL_DEVICE_NOT_FOUND;
+}
+
+int RunBenchmark(const Options& opts)
+{
+	using namespace std;
+
+	vector<ArgSpec> argSpecs;
+	vector<size_t> global;
+	vector<size_t> local;
+	string error;
+
+	// a capture brings kernel, arguments and work sizes along
+	bool replay = iEndsWith(opts.infile, ".oclcap");
+
+	if(replay && opts.scaling)
+	{
+		cerr << "--scaling does not replay captures" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!replay && (opts.kernel.empty() || opts.globalSize.empty()))
+	{
+		cerr << "oclb needs --kernel and --global" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!replay && !ParseArgSpecs(opts.args, argSpecs, error))
+	{
+		cerr << error << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!replay && (!ParseWorkSizes(opts.globalSize, global) ||
+		(!opts.localSize.empty() && (!ParseWorkSizes(opts.localSize, local) ||
+			local.size() != global.size()))))
+	{
+		cerr << "bad work size" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(opts.iterations < 1)
+	{
+		cerr << "no iterations" << endl;
+		return EXIT_FAILURE;
+	}
+
+	cl_device_id device_id = NULL;
+
+	if(cl_int err = SelectDevice(opts, device_id))
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(opts.scaling)
+	{
+		return iScaling(opts, device_id, argSpecs, global, local);
+	}
+
+	cl_int errcode_ret;
+	cl_context context = clCreateContext(
+		NULL, 1, &device_id, NULL, NULL, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		cerr << "error : " << GetErrorMessage(errcode_ret) << endl;
+		return EXIT_FAILURE;
+	}
+
+	cl_command_queue queue = clCreateCommandQueue(
+		context, device_id, CL_QUEUE_PROFILING_ENABLE, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		cerr << "error : " << GetErrorMessage(errcode_ret) << endl;
+		clReleaseContext(context);
+		return EXIT_FAILURE;
+	}
+
+	int status = replay ? iReplay(opts, context, queue, device_id) :
+		iBenchmark(opts, context, queue, device_id, argSpecs, global, local);
+
+	clReleaseCommandQueue(queue);
+	clReleaseContext(context);
+
+	return status;
+}
+
+}
@@ -0,0 +1,43 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLB_BENCH_HPP_
+#define OCLB_BENCH_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include "options.hpp"
+
+namespace OCLT
+{
+
+// load opts.infile, run opts.kernel opts.warmup times and then time
+// opts.iterations runs with profiling events. prints min, median and p99
+// kernel time, and bandwidth and GFLOP/s of the median run when bytes
+// and flops are known. returns process exit status.
+int RunBenchmark(const Options& opts);
+
+// device of opts.deviceType, or of opts.platformIndex and opts.deviceIndex
+cl_int SelectDevice(const Options& opts, cl_device_id& device_id);
+
+}
+
+#endif
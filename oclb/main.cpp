@@ -0,0 +1,282 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include "bench.hpp"
+#include "poolbench.hpp"
+#include "streambench.hpp"
+#include "options.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <getopt.h>
+
+static const int gVersionMajor = 1;
+static const int gVersionMinor = 0;
+static const size_t gStreamBytes = 256 << 20;
+
+static void GetOpts(int argc, char* argv[], OCLT::Options& opts);
+
+int
+main(int argc, char* argv[])
+{
+	using namespace std;
+	using namespace OCLT;
+
+	Options opts;
+
+	GetOpts(argc, argv, opts);
+
+	if(opts.help)
+	{
+		cout << "usage: " << argv[0] << " [options] kernel.clx|kernel.cl" << endl <<
+			"       " << argv[0] << " [options] capture.oclcap" << endl <<
+			"               replay a launch captured by ocltrace" << endl <<
+			"  -k --kernel=name" << endl <<
+			"               kernel to run" << endl <<
+			"  --args=spec  kernel arguments in order, comma separated:" << endl <<
+			"               buffer:<type>:<count>[:<fill>] (random contents" << endl <<
+			"               without fill, count may end in K or M)," << endl <<
+			"               local:<type>:<count>, <type>:<value>" << endl <<
+			"  -g --global=x[,y,z]" << endl <<
+			"               global work size" << endl <<
+			"  -l --local=x[,y,z]" << endl <<
+			"               work-group size (default: chosen by the driver)" << endl <<
+			"  -O --options=string" << endl <<
+			"               options passed to clBuildProgram" << endl <<
+			"  -s --source=file" << endl <<
+			"               build file when the driver rejects the binary" << endl <<
+			"  -p --platform=n -d --device=n" << endl <<
+			"               run on device n of platform n (default 0 0)" << endl <<
+			"  -t --type=cpu|gpu|accelerator" << endl <<
+			"               run on the first device of the type" << endl <<
+			"  -w --warmup=n runs before timing (default 3)" << endl <<
+			"  -n --iterations=n" << endl <<
+			"               timed runs (default 20, p99 is printed from 100)" << endl <<
+			"  --reset      restore buffer contents before every run" << endl <<
+			"  --bytes=n|auto" << endl <<
+			"               bytes one run moves, auto for every buffer once" << endl <<
+			"  --flops=n    floating point operations of one run" << endl <<
+			"  --bench-pool[=threads]" << endl <<
+			"               acquire and release buffers from the pool of" << endl <<
+			"               liboclt and with clCreateBuffer on 1, 2, 4, ..." << endl <<
+			"               threads (default one per hardware thread)" << endl <<
+			"  --bench-stream[=size]" << endl <<
+			"               stream the input file, or size bytes (default" << endl <<
+			"               256M), through a kernel in chunks one after" << endl <<
+			"               another and with copies and kernels overlapped" << endl <<
+			"  --scaling[=n]" << endl <<
+			"               dispatch the kernel over 1, 2, 4, ... n sub-devices" << endl <<
+			"               of the device (default as many as it allows, the" << endl <<
+			"               devices of its platform when it has none) and" << endl <<
+			"               print the speedup, builds the source" << endl <<
+			"  -v --verbose print detail" << endl <<
+			"  -h --help    print help" << endl <<
+			"  -V --version print version information" << endl;
+		exit(EXIT_SUCCESS);
+	}
+
+	if(opts.version)
+	{
+		cout << "oclb version " << gVersionMajor << "." << gVersionMinor << endl;
+		exit(EXIT_SUCCESS);
+	}
+
+	if(opts.poolThreads)
+	{
+		return RunPoolBenchmark(opts);
+	}
+
+	if(opts.streamBytes)
+	{
+		return RunStreamBenchmark(opts);
+	}
+
+	if(opts.infile.empty())
+	{
+		cerr << "no input file" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	return RunBenchmark(opts);
+}
+
+static void GetOpts(int argc, char* argv[], OCLT::Options& opts)
+{
+	enum
+	{
+		OPT_ARGS = 256,
+		OPT_RESET,
+		OPT_BYTES,
+		OPT_FLOPS,
+		OPT_SCALING,
+		OPT_BENCH_POOL,
+		OPT_BENCH_STREAM,
+	};
+
+	opts = OCLT::Options();
+
+	for(;;)
+	{
+		static struct option long_options[] = {
+			{"help", 0, 0, 'h'},
+			{"verbose", 0, 0, 'v'},
+			{"version", 0, 0, 'V'},
+			{"kernel", 1, 0, 'k'},
+			{"args", 1, 0, OPT_ARGS},
+			{"global", 1, 0, 'g'},
+			{"local", 1, 0, 'l'},
+			{"options", 1, 0, 'O'},
+			{"source", 1, 0, 's'},
+			{"platform", 1, 0, 'p'},
+			{"device", 1, 0, 'd'},
+			{"type", 1, 0, 't'},
+			{"warmup", 1, 0, 'w'},
+			{"iterations", 1, 0, 'n'},
+			{"reset", 0, 0, OPT_RESET},
+			{"bytes", 1, 0, OPT_BYTES},
+			{"flops", 1, 0, OPT_FLOPS},
+			{"scaling", 2, 0, OPT_SCALING},
+			{"bench-pool", 2, 0, OPT_BENCH_POOL},
+			{"bench-stream", 2, 0, OPT_BENCH_STREAM},
+			{0,0,0,0}
+		};
+
+		int option_index = 0;
+		int c = getopt_long(argc, argv, "hvVk:g:l:O:s:p:d:t:w:n:",
+			long_options, &option_index);
+
+		if(c == -1) break;
+
+		switch(c)
+		{
+		case 'h':
+			opts.help = true;
+			break;
+		case 'v':
+			opts.verbose = true;
+			break;
+		case 'V':
+			opts.version = true;
+			break;
+		case 'k':
+			opts.kernel = optarg;
+			break;
+		case OPT_ARGS:
+			opts.args = optarg;
+			break;
+		case 'g':
+			opts.globalSize = optarg;
+			break;
+		case 'l':
+			opts.localSize = optarg;
+			break;
+		case 'O':
+			if(!opts.buildOptions.empty()) opts.buildOptions += " ";
+			opts.buildOptions += optarg;
+			break;
+		case 's':
+			opts.sourceFile = optarg;
+			break;
+		case 'p':
+			opts.platformIndex = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			opts.deviceIndex = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			opts.deviceType = optarg;
+			break;
+		case 'w':
+			opts.warmup = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			opts.iterations = strtoul(optarg, NULL, 10);
+			break;
+		case OPT_RESET:
+			opts.reset = true;
+			break;
+		case OPT_BYTES:
+			opts.autoBytes = std::string(optarg) == "auto";
+			opts.bytes = strtod(optarg, NULL);
+			break;
+		case OPT_FLOPS:
+			opts.flops = strtod(optarg, NULL);
+			break;
+		case OPT_SCALING:
+			opts.scaling = optarg ? strtoul(optarg, NULL, 10) : SIZE_MAX;
+			break;
+		case OPT_BENCH_POOL:
+			opts.poolThreads = optarg ? strtoul(optarg, NULL, 10) : SIZE_MAX;
+			break;
+		case OPT_BENCH_STREAM:
+			opts.streamBytes = gStreamBytes;
+
+			if(optarg)
+			{
+				char* end;
+				unsigned long long bytes = strtoull(optarg, &end, 10);
+				int shift = 0;
+
+				if(*end == 'K' || *end == 'k')
+				{
+					shift = 10;
+				}
+				else if(*end == 'M' || *end == 'm')
+				{
+					shift = 20;
+				}
+				else if(*end == 'G' || *end == 'g')
+				{
+					shift = 30;
+				}
+
+				if(shift)
+				{
+					++end;
+				}
+
+				// at least one float, and no trailing text
+				if(!isdigit(static_cast<unsigned char>(*optarg)) || *end ||
+					bytes > (SIZE_MAX >> shift) || (bytes << shift) < sizeof(float))
+				{
+					std::cerr << "invalid size: --bench-stream=" << optarg << std::endl;
+					exit(EXIT_FAILURE);
+				}
+
+				opts.streamBytes = static_cast<size_t>(bytes << shift);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	if(optind < argc)
+	{
+		opts.infile = argv[optind];
+	}
+}
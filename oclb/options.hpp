@@ -0,0 +1,86 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLB_OPTIONS_HPP_
+#define OCLB_OPTIONS_HPP_
+
+#include <string>
+
+namespace OCLT
+{
+
+// command line options of oclb
+struct Options
+{
+	Options()
+		: verbose(false), version(false), help(false), platformIndex(0),
+		deviceIndex(0), warmup(3), iterations(20), reset(false), bytes(0),
+		autoBytes(false), flops(0), scaling(0), poolThreads(0), streamBytes(0)
+	{
+	}
+
+	bool verbose;
+	bool version;
+	bool help;
+
+	// clx container or bare binary written by oclc, OpenCL C source or
+	// a launch captured by ocltrace (.oclcap)
+	std::string infile;
+	// built when the driver rejects the binary of infile
+	std::string sourceFile;
+	std::string buildOptions;
+
+	// kernel to run, its arguments (see ParseArgSpecs()) and work sizes
+	std::string kernel;
+	std::string args;
+	std::string globalSize;
+	std::string localSize;
+
+	// device deviceIndex of platform platformIndex, or with deviceType
+	// ("cpu", "gpu", "accelerator") the first device of that type
+	size_t platformIndex;
+	size_t deviceIndex;
+	std::string deviceType;
+
+	size_t warmup;
+	size_t iterations;
+	// write the initial contents to the buffers before every iteration
+	bool reset;
+
+	// bytes moved and floating point operations of one run, 0 when
+	// unknown. autoBytes takes the size of every buffer.
+	double bytes;
+	bool autoBytes;
+	double flops;
+
+	// dispatch the kernel over 1, 2, 4, ... of this many sub-devices of
+	// the device (or devices of its platform), SIZE_MAX for as many as
+	// it can be split into, 0 for a single queue
+	size_t scaling;
+
+	// compare a BufferPool with clCreateBuffer on up to this many threads,
+	// SIZE_MAX for the hardware threads, 0 to run a kernel instead
+	size_t poolThreads;
+
+	// stream infile, or without one this many bytes, through a
+	// StreamPipeline serially and overlapped, 0 to run a kernel instead
+	size_t streamBytes;
+};
+
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "poolbench.hpp"
+#include "bench.hpp"
+#include "bufferpool.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace OCLT
+{
+
+namespace
+{
+
+// of each thread, buffers of log-uniform random sizes
+const size_t iOperations = 20000;
+const size_t iLive = 8;
+const size_t iMinSize = 4 << 10;
+const size_t iMaxSize = 4 << 20;
+
+size_t iRandomSize(std::mt19937& random)
+{
+	std::uniform_real_distribution<double> exponent(
+		std::log2(static_cast<double>(iMinSize)), std::log2(static_cast<double>(iMaxSize)));
+
+	return static_cast<size_t>(std::exp2(exponent(random)));
+}
+
+// run body(index, done) on threads threads at once, operations per
+// second. done() is called once the operations are over and returns when
+// every thread got there and the buffers still held may go.
+double iRun(size_t threads,
+	const std::function<cl_int(size_t, const std::function<void()>&)>& body,
+	const std::function<void()>& all_done, cl_int& err)
+{
+	using namespace std;
+
+	atomic<size_t> finished(0);
+	atomic<bool> release(false);
+	vector<cl_int> errors(threads, CL_SUCCESS);
+	vector<thread> workers;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	chrono::steady_clock::time_point end = start;
+
+	function<void()> done = [&]()
+	{
+		++finished;
+
+		while(!release)
+		{
+			this_thread::yield();
+		}
+	};
+
+	for(size_t i = 0; i < threads; ++i)
+	{
+		workers.push_back( thread([&, i]()
+		{
+			errors[i] = body(i, done);
+		}) );
+	}
+
+	while(finished < threads)
+	{
+		this_thread::yield();
+	}
+
+	end = chrono::steady_clock::now();
+	all_done();
+	release = true;
+
+	for(vector<thread>::iterator itr = workers.begin(); itr != workers.end(); ++itr)
+	{
+		itr->join();
+	}
+
+	err = CL_SUCCESS;
+
+	for(size_t i = 0; i < threads && !err; ++i)
+	{
+		err = errors[i];
+	}
+
+	return threads * iOperations / chrono::duration<double>(end - start).count();
+}
+
+cl_int iRaw(cl_context context, size_t index, const std::function<void()>& done)
+{
+	std::mt19937 random(index + 1);
+	std::vector<cl_mem> live(iLive, NULL);
+	cl_int err = CL_SUCCESS;
+
+	for(size_t i = 0; i < iOperations && !err; ++i)
+	{
+		cl_mem& slot = live[i % iLive];
+
+		if(slot)
+		{
+			clReleaseMemObject(slot);
+		}
+
+		slot = clCreateBuffer(context, CL_MEM_READ_WRITE, iRandomSize(random), NULL, &err);
+	}
+
+	done();
+
+	for(size_t i = 0; i < live.size(); ++i)
+	{
+		if(live[i])
+		{
+			clReleaseMemObject(live[i]);
+		}
+	}
+
+	return err;
+}
+
+cl_int iPooled(BufferPool& pool, size_t index, const std::function<void()>& done)
+{
+	std::mt19937 random(index + 1);
+	std::vector<PooledBuffer> live(iLive);
+	cl_int err = CL_SUCCESS;
+
+	for(size_t i = 0; i < iOperations && !err; ++i)
+	{
+		PooledBuffer& slot = live[i % iLive];
+
+		pool.Release(slot);
+		err = pool.Acquire(iRandomSize(random), slot);
+	}
+
+	done();
+
+	for(size_t i = 0; i < live.size(); ++i)
+	{
+		pool.Release(live[i]);
+	}
+
+	return err;
+}
+
+}
+
+int RunPoolBenchmark(const Options& opts)
+{
+	using namespace std;
+
+	cl_device_id device_id = NULL;
+	cl_int err = SelectDevice(opts, device_id);
+	cl_context context = NULL;
+
+	if(!err)
+	{
+		context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &err);
+	}
+
+	if(err)
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t most = opts.poolThreads != SIZE_MAX ? opts.poolThreads :
+		max<size_t>(1, thread::hardware_concurrency());
+	vector<size_t> counts;
+
+	for(size_t n = 1; n < most; n *= 2)
+	{
+		counts.push_back(n);
+	}
+
+	counts.push_back(most);
+
+	cout << "buffer pool on " << GetDeviceInfoString(device_id, CL_DEVICE_NAME) <<
+		", " << (iMinSize >> 10) << "K to " << (iMaxSize >> 20) << "M buffers, " <<
+		iLive << " held and " << iOperations << " acquired per thread" << endl;
+
+	printf("%7s %12s %12s %8s %8s %9s %13s\n", "threads", "raw ops/s",
+		"pool ops/s", "speedup", "hit rate", "held MB", "fragmentation");
+
+	for(size_t c = 0; !err && c < counts.size(); ++c)
+	{
+		double raw = iRun(counts[c], [&](size_t index, const function<void()>& done)
+		{
+			return iRaw(context, index, done);
+		}, [](){}, err);
+
+		if(err)
+		{
+			break;
+		}
+
+		BufferPool pool;
+		BufferPoolStats stats;
+
+		if((err = pool.Init(context, device_id)))
+		{
+			break;
+		}
+
+		double pooled = iRun(counts[c], [&](size_t index, const function<void()>& done)
+		{
+			return iPooled(pool, index, done);
+		}, [&]()
+		{
+			pool.GetStats(stats);
+		}, err);
+
+		if(err)
+		{
+			break;
+		}
+
+		printf("%7zu %12.0f %12.0f %7.2fx %7.1f%% %9.1f %12.1f%%\n", counts[c],
+			raw, pooled, pooled / raw, stats.HitRate() * 100,
+			stats.bytesHeld / 1048576.0, stats.Fragmentation() * 100);
+
+		if(opts.verbose)
+		{
+			printf("  %zu requests, %zu thread cache hits, %zu shared hits, "
+				"%zu created, %zu released\n", stats.requests, stats.threadHits,
+				stats.sharedHits, stats.creates, stats.destroys);
+		}
+	}
+
+	clReleaseContext(context);
+
+	if(err)
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+}
@@ -15,6 +15,20 @@
  *    See the License for the specific language governing permissions and
  *    limitations under the License.
  */
+#ifndef OCLB_POOLBENCH_HPP_
+#define OCLB_POOLBENCH_HPP_
 
-#include "oclc.hpp"
+#include "options.hpp"
 
+namespace OCLT
+{
+
+// acquire and release buffers of random sizes on 1, 2, 4, ...
+// opts.poolThreads threads, from a BufferPool and with clCreateBuffer and
+// clReleaseMemObject, and print operations per second and the statistics
+// of the pool. returns process exit status.
+int RunPoolBenchmark(const Options& opts);
+
+}
+
+#endif
@@ -0,0 +1,215 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "streambench.hpp"
+#include "bench.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+#include "file.hpp"
+#include "stream.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace OCLT
+{
+
+namespace
+{
+
+const char* const iStreamSource =
+	"__kernel void stream(__global const float* in, __global float* out,\n"
+	"	uint count, uint rounds)\n"
+	"{\n"
+	"	size_t i = get_global_id(0);\n"
+	"	if(i >= count) return;\n"
+	"	float x = in[i];\n"
+	"	for(uint r = 0; r < rounds; ++r)\n"
+	"		x = mad(x, 0.999f, 0.001f);\n"
+	"	out[i] = x;\n"
+	"}\n";
+
+// mads per element, enough that the kernel is not free next to the copies
+const cl_uint iRounds = 32;
+
+// run input through kernel, stats and a checksum of the output
+cl_int iStream(cl_context context, cl_device_id device_id, cl_kernel kernel,
+	const MappedFile& file, const std::vector<float>& generated,
+	const StreamOptions& options, StreamPipeline& pipeline, double& checksum)
+{
+	if(cl_int err = pipeline.Init(context, device_id, options))
+	{
+		return err;
+	}
+
+	StreamSink sink = [&](const void* data, size_t size)
+	{
+		const float* values = static_cast<const float*>(data);
+
+		for(size_t i = 0; i < size / sizeof(float); i += 1024)
+		{
+			checksum += values[i];
+		}
+	};
+
+	// untimed first, for buffers and the kernel to be ready
+	for(size_t run = 0; run < 2; ++run)
+	{
+		checksum = 0;
+
+		MemorySource mapped(file.Data(), file.Size());
+		IteratorSource<std::vector<float>::const_iterator> iterated(
+			generated.begin(), generated.end());
+		StreamSource& source = file.IsOpen() ?
+			static_cast<StreamSource&>(mapped) : iterated;
+
+		if(cl_int err = pipeline.Run(kernel, source, sink))
+		{
+			return err;
+		}
+	}
+
+	return CL_SUCCESS;
+}
+
+void iPrint(const char* mode, const StreamPipeline& pipeline)
+{
+	const StreamStats& stats = pipeline.Stats();
+
+	printf("%-9s %7zu %8.1f %5zu %10.3f %10.3f %10.3f %11.3f %7.3f\n", mode,
+		stats.chunks, pipeline.ChunkBytes() / 1048576.0, pipeline.Depth(),
+		stats.seconds * 1e3, stats.uploadSeconds * 1e3, stats.kernelSeconds * 1e3,
+		stats.downloadSeconds * 1e3,
+		stats.seconds > 0 ? stats.bytesIn / stats.seconds / 1e9 : 0);
+}
+
+}
+
+int RunStreamBenchmark(const Options& opts)
+{
+	using namespace std;
+
+	MappedFile file;
+	vector<float> generated;
+
+	if(!opts.infile.empty())
+	{
+		if(!file.Open(opts.infile))
+		{
+			cerr << opts.infile << ": " << strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		generated.resize(opts.streamBytes / sizeof(float));
+
+		for(size_t i = 0; i < generated.size(); ++i)
+		{
+			generated[i] = static_cast<float>(i & 1023);
+		}
+	}
+
+	cl_device_id device_id = NULL;
+	cl_int err = SelectDevice(opts, device_id);
+	cl_context context = NULL;
+	cl_program program = NULL;
+	cl_kernel kernel = NULL;
+	const char* source = iStreamSource;
+
+	if(!err) context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &err);
+	if(!err) program = clCreateProgramWithSource(context, 1, &source, NULL, &err);
+	if(!err) err = clBuildProgram(program, 1, &device_id, "", NULL, NULL);
+	if(!err) kernel = clCreateKernel(program, "stream", &err);
+	if(!err) err = clSetKernelArg(kernel, 3, sizeof(iRounds), &iRounds);
+
+	StreamPipeline serial;
+	StreamPipeline overlapped;
+	double serial_checksum = 0;
+	double overlapped_checksum = 0;
+
+	if(!err)
+	{
+		cout << "streaming " << (file.IsOpen() ? file.Size() :
+			generated.size() * sizeof(float)) << " bytes of " <<
+			(file.IsOpen() ? opts.infile : string("generated floats")) <<
+			" through " << iRounds << " mads per float on " <<
+			GetDeviceInfoString(device_id, CL_DEVICE_NAME) << endl;
+
+		StreamOptions options;
+		options.inputElementSize = sizeof(cl_float);
+		options.outputElementSize = sizeof(cl_float);
+
+		err = iStream(context, device_id, kernel, file, generated, options,
+			overlapped, overlapped_checksum);
+
+		// chunks of the same size, one after another
+		options.chunkBytes = overlapped.ChunkBytes();
+		options.serial = true;
+
+		if(!err)
+		{
+			err = iStream(context, device_id, kernel, file, generated, options,
+				serial, serial_checksum);
+		}
+	}
+
+	if(!err)
+	{
+		printf("%-9s %7s %8s %5s %10s %10s %10s %11s %7s\n", "mode", "chunks",
+			"chunk MB", "depth", "wall ms", "upload ms", "kernel ms",
+			"download ms", "GB/s");
+
+		iPrint("serial", serial);
+		iPrint("overlap", overlapped);
+
+		const StreamStats& stats = overlapped.Stats();
+
+		printf("speedup %.2fx, overlap efficiency %.1f%% (of the time the "
+			"longest stage allows to save)\n",
+			stats.seconds > 0 ? serial.Stats().seconds / stats.seconds : 0,
+			stats.OverlapEfficiency(serial.Stats().seconds) * 100);
+
+		if(stats.bytesDropped)
+		{
+			cout << "last " << stats.bytesDropped <<
+				" bytes left out, short of a whole float" << endl;
+		}
+
+		if(serial_checksum != overlapped_checksum)
+		{
+			cerr << "error : outputs differ" << endl;
+			err = CL_INVALID_VALUE;
+		}
+	}
+	else
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+	}
+
+	if(kernel) clReleaseKernel(kernel);
+	if(program) clReleaseProgram(program);
+	if(context) clReleaseContext(context);
+
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+}
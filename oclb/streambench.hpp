@@ -0,0 +1,34 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLB_STREAMBENCH_HPP_
+#define OCLB_STREAMBENCH_HPP_
+
+#include "options.hpp"
+
+namespace OCLT
+{
+
+// stream opts.infile (mapped), or opts.streamBytes of generated floats,
+// through a built-in kernel with a StreamPipeline, once one chunk after
+// another and once overlapped, and print the time of each stage, the
+// speedup and the overlap efficiency. returns process exit status.
+int RunStreamBenchmark(const Options& opts);
+
+}
+
+#endif
@@ -0,0 +1,531 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "batch.hpp"
+#include "build.hpp"
+#include "errors.hpp"
+#include "file.hpp"
+#include "includes.hpp"
+#include "jobserver.hpp"
+#include "sources.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace OCLT
+{
+
+namespace
+{
+
+struct BatchJob
+{
+	BatchJob() : seconds(0), succeeded(false), cached(false) {}
+
+	std::string infile;
+	std::string outfile;
+	double seconds;
+	bool succeeded;
+	bool cached;
+};
+
+// logs and errors of a job, each starting on a line of its own
+void iAppendLines(std::string& message, const std::string& lines)
+{
+	if(!message.empty() && message[message.size() - 1] != '\n')
+	{
+		message += '\n';
+	}
+
+	message += lines;
+}
+
+bool iSlowerThan(const BatchJob* lhs, const BatchJob* rhs)
+{
+	return lhs->seconds > rhs->seconds;
+}
+
+// platform context created on first cache miss
+struct LazyContext
+{
+	PlatformContext context;
+	cl_int deviceError;
+	std::once_flag once;
+	cl_int contextError;
+};
+
+class Batch
+{
+public:
+	Batch(const Options& opts, CompileCache& cache)
+		: opts_(opts), cache_(cache), next_(0)
+	{
+	}
+
+	~Batch()
+	{
+		for(size_t i = 0; i < contexts_.size(); ++i)
+		{
+			ReleasePlatformContext(contexts_[i]->context);
+			delete contexts_[i];
+		}
+	}
+
+	bool Prepare();
+	void Run();
+	int PrintSummary(double wall) const;
+
+private:
+	bool ReadManifest(const std::string& path);
+	void Work();
+	void RunJob(BatchJob& job);
+	void Report(const BatchJob& job, const std::string& message);
+
+	const Options& opts_;
+	CompileCache& cache_;
+	JobServer jobServer_;
+
+	std::vector<BatchJob> jobs_;
+	std::vector<LazyContext*> contexts_;
+	std::atomic<size_t> next_;
+	std::mutex outputMutex_;
+};
+
+bool Batch::Prepare()
+{
+	using namespace std;
+
+	if(!opts_.manifest.empty() && !ReadManifest(opts_.manifest))
+	{
+		return false;
+	}
+
+	for(vector<string>::const_iterator itr = opts_.infiles.begin();
+		itr != opts_.infiles.end(); ++itr)
+	{
+		BatchJob job;
+		job.infile = *itr;
+		jobs_.push_back(job);
+	}
+
+	// a/k.cl and b/k.cl both become k.clx in the output directory
+	map<string, string> writers;
+
+	for(vector<BatchJob>::iterator itr = jobs_.begin(); itr != jobs_.end(); ++itr)
+	{
+		if(itr->outfile.empty()) itr->outfile = BatchOutfile(opts_, itr->infile);
+
+		pair<map<string, string>::iterator, bool> inserted =
+			writers.insert(make_pair(itr->outfile, itr->infile));
+
+		if(!inserted.second)
+		{
+			cerr << inserted.first->second << " and " << itr->infile <<
+				" are both built into " << itr->outfile << endl;
+			return false;
+		}
+	}
+
+	if(jobs_.empty())
+	{
+		cerr << "no input file" << endl;
+		return false;
+	}
+
+	if(!opts_.outfile.empty() && !MakeDirectories(opts_.outfile))
+	{
+		cerr << strerror(errno) << ": " << opts_.outfile << endl;
+		return false;
+	}
+
+	vector<cl_platform_id> platform_ids;
+
+	if(cl_int err = GetPlatformIDs(platform_ids))
+	{
+		map<int, string>::const_iterator itr = ErrorMessageMap.find(err);
+		cerr << "error : " <<
+			(itr != ErrorMessageMap.end() ? itr->second : string("unkown error")) <<
+			endl;
+		return false;
+	}
+
+	if(platform_ids.empty())
+	{
+		cerr << "no platform on system" << endl;
+		return false;
+	}
+
+	if(!opts_.all)
+	{
+		platform_ids.resize(1);
+	}
+
+	for(size_t i = 0; i < platform_ids.size(); ++i)
+	{
+		LazyContext* context = new LazyContext;
+		context->context.platform_id = platform_ids[i];
+		context->deviceError =
+			GetDeviceIDs(platform_ids[i], context->context.device_ids);
+		context->contextError = CL_SUCCESS;
+		contexts_.push_back(context);
+	}
+
+	if(jobServer_.Open())
+	{
+		if(opts_.verbose) cout << "batch: using make jobserver" << endl;
+	}
+	else if(opts_.verbose)
+	{
+		cout << "batch: " << jobServer_.Error() << endl;
+	}
+
+	return true;
+}
+
+bool Batch::ReadManifest(const std::string& path)
+{
+	using namespace std;
+
+	ifstream ifs(path.c_str());
+
+	if(!ifs)
+	{
+		cerr << strerror(errno) << ": " << path << endl;
+		return false;
+	}
+
+	string line;
+
+	while(getline(ifs, line))
+	{
+		istringstream iss(line);
+		BatchJob job;
+
+		if(!(iss >> job.infile) || job.infile[0] == '#')
+		{
+			continue;
+		}
+
+		iss >> job.outfile;
+		jobs_.push_back(job);
+	}
+
+	return true;
+}
+
+void Batch::Run()
+{
+	using namespace std;
+
+	size_t workers = opts_.jobs ? opts_.jobs : thread::hardware_concurrency();
+
+	workers = max<size_t>(1, min(workers, jobs_.size()));
+
+	vector<thread> threads;
+
+	for(size_t i = 0; i < workers; ++i)
+	{
+		threads.push_back(thread([this, i]()
+		{
+			ostringstream name;
+			name << "worker " << i;
+			SetTraceThreadName(name.str());
+
+			Work();
+		}));
+	}
+
+	for(vector<thread>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+	{
+		itr->join();
+	}
+}
+
+void Batch::Work()
+{
+	for(;;)
+	{
+		size_t index = next_++;
+
+		if(index >= jobs_.size())
+		{
+			return;
+		}
+
+		bool acquired;
+
+		{
+			TraceSpan span("jobserver wait");
+			acquired = jobServer_.Acquire();
+		}
+
+		if(!acquired)
+		{
+			Report(jobs_[index], "can not get a job from the jobserver");
+			continue;
+		}
+
+		RunJob(jobs_[index]);
+
+		jobServer_.Release();
+	}
+}
+
+void Batch::RunJob(BatchJob& job)
+{
+	using namespace std;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	TraceSpan span("batch job", job.infile);
+
+	SourceFiles files;
+	bool loaded;
+
+	{
+		TraceSpan loadSpan("load source", job.infile);
+		loaded = files.Add(job.infile);
+	}
+
+	if(!loaded)
+	{
+		Report(job, string(strerror(errno)) + ": " + job.infile);
+		return;
+	}
+
+	const vector<SourceText>& sources = files.Texts();
+
+	IncludeScan scan;
+
+	if(!ScanIncludes(vector<string>(1, job.infile), sources,
+		opts_.includeDirs, scan))
+	{
+		Report(job, string(strerror(errno)) + ": " + scan.files.back());
+		return;
+	}
+
+	string buildOptions = CompileOptions(opts_.buildOptions, scan);
+
+	vector<PlatformBuild> results(contexts_.size());
+	string message;
+	bool failed = false;
+
+	job.cached = true;
+
+	for(size_t i = 0; i < contexts_.size(); ++i)
+	{
+		LazyContext& context = *contexts_[i];
+
+		if(cache_.IsOpen() && !context.deviceError &&
+			cache_.LoadPlatform(CacheDigest(scan), opts_.buildOptions,
+				context.context.platform_id, context.context.device_ids, results[i]))
+		{
+			continue;
+		}
+
+		job.cached = false;
+
+		call_once(context.once, [&context]()
+		{
+			const std::vector<cl_device_id>& device_ids = context.context.device_ids;
+
+			if(context.deviceError || device_ids.empty())
+			{
+				context.contextError = context.deviceError ?
+					context.deviceError : CL_DEVICE_NOT_FOUND;
+				return;
+			}
+
+			TraceSpan span("clCreateContext");
+
+			context.context.context = clCreateContext(
+				NULL, device_ids.size(), &device_ids[0], NULL, NULL,
+				&context.contextError);
+
+			if(context.contextError)
+			{
+				context.context.context = NULL;
+			}
+		});
+
+		if(context.contextError)
+		{
+			results[i].error = context.contextError;
+		}
+		else
+		{
+			BuildProgram(context.context, sources, buildOptions, results[i]);
+			cache_.StorePlatform(CacheDigest(scan), opts_.buildOptions, results[i]);
+		}
+
+		if(!results[i].log.empty())
+		{
+			iAppendLines(message, results[i].log);
+		}
+
+		if(results[i].error)
+		{
+			map<int, string>::const_iterator itr =
+				ErrorMessageMap.find(results[i].error);
+			iAppendLines(message, "error : " +
+				(itr != ErrorMessageMap.end() ? itr->second : string("unkown error")));
+			failed = true;
+		}
+	}
+
+	if(!failed && !SaveBinaries(job.outfile, results,
+		opts_.raw, opts_.all, opts_.compress))
+	{
+		iAppendLines(message, string(strerror(errno)) + ": " + job.outfile);
+		failed = true;
+	}
+
+	string depfile = DefaultDepfile(job.outfile);
+
+	if(!failed && opts_.depfile && !WriteDepfile(depfile, job.outfile, scan.files))
+	{
+		iAppendLines(message, string(strerror(errno)) + ": " + depfile);
+		failed = true;
+	}
+
+	job.seconds = chrono::duration<double>(
+		chrono::steady_clock::now() - start).count();
+	job.succeeded = !failed;
+
+	Report(job, message);
+}
+
+void Batch::Report(const BatchJob& job, const std::string& message)
+{
+	using namespace std;
+
+	lock_guard<mutex> lock(outputMutex_);
+
+	if(!message.empty())
+	{
+		cout << job.infile << ":" << endl << message << endl;
+	}
+
+	if(opts_.verbose)
+	{
+		char seconds[32];
+		snprintf(seconds, sizeof(seconds), "%8.3f", job.seconds);
+		cout << seconds << " s  " << job.infile << " -> " << job.outfile <<
+			(job.cached ? " (cached)" : "") << endl;
+	}
+}
+
+int Batch::PrintSummary(double wall) const
+{
+	using namespace std;
+
+	vector<const BatchJob*> sorted;
+	size_t failed = 0;
+	size_t cached = 0;
+	double total = 0;
+
+	for(vector<BatchJob>::const_iterator itr = jobs_.begin();
+		itr != jobs_.end(); ++itr)
+	{
+		sorted.push_back(&*itr);
+		total += itr->seconds;
+
+		if(!itr->succeeded) ++failed;
+		else if(itr->cached) ++cached;
+	}
+
+	sort(sorted.begin(), sorted.end(), iSlowerThan);
+
+	char buf[256];
+
+	cout << "---- batch" << endl;
+
+	for(vector<const BatchJob*>::const_iterator itr = sorted.begin();
+		itr != sorted.end(); ++itr)
+	{
+		snprintf(buf, sizeof(buf), "%8.3f s  %s%s%s", (*itr)->seconds,
+			(*itr)->infile.c_str(),
+			(*itr)->cached ? " (cached)" : "",
+			(*itr)->succeeded ? "" : " (failed)");
+		cout << buf << endl;
+	}
+
+	snprintf(buf, sizeof(buf),
+		"%zu files, %zu built, %zu cached, %zu failed, "
+		"%.3f s wall, %.3f s total build time",
+		jobs_.size(), jobs_.size() - failed - cached, cached, failed, wall, total);
+	cout << buf << endl;
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+}
+
+std::string BatchOutfile(const Options& opts, const std::string& infile)
+{
+	using namespace std;
+
+	string::size_type slash = infile.find_last_of('/');
+	string::size_type dot = infile.find_last_of('.');
+
+	if(dot == string::npos || (slash != string::npos && dot < slash))
+	{
+		dot = infile.size();
+	}
+
+	string outfile = infile.substr(0, dot) + ".clx";
+
+	if(opts.outfile.empty())
+	{
+		return outfile;
+	}
+
+	return opts.outfile + "/" +
+		(slash == string::npos ? outfile : outfile.substr(slash + 1));
+}
+
+int RunBatch(const Options& opts, CompileCache& cache)
+{
+	using namespace std;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	Batch batch(opts, cache);
+
+	if(!batch.Prepare())
+	{
+		return EXIT_FAILURE;
+	}
+
+	batch.Run();
+
+	return batch.PrintSummary(chrono::duration<double>(
+		chrono::steady_clock::now() - start).count());
+}
+
+}
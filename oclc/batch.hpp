@@ -0,0 +1,42 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_BATCH_HPP_
+#define OCLC_BATCH_HPP_
+
+#include "cache.hpp"
+#include "options.hpp"
+
+#include <string>
+
+namespace OCLT
+{
+
+// compile every input file (or manifest line "input [output]") into its
+// own output on a bounded pool of opts.jobs threads sharing one context
+// per platform. honors the make jobserver and prints per-file build times.
+// returns process exit status.
+int RunBatch(const Options& opts, CompileCache& cache);
+
+// output of infile in batch mode, infile with .clx as its extension, in
+// the directory opts.outfile when given. inputs of the same name in
+// different directories collide there, callers reject that.
+std::string BatchOutfile(const Options& opts, const std::string& infile);
+
+}
+
+#endif
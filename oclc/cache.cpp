@@ -0,0 +1,459 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "cache.hpp"
+#include "device.hpp"
+#include "file.hpp"
+#include "sha256.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace OCLT
+{
+
+static const char* const iEntrySuffix = ".bin";
+static const char* const iLockName = "lock";
+static const char* const iStatsName = "stats";
+// WriteFileAtomic() temporaries older than this were left by a writer
+// which died, no write takes that long
+static const time_t iStaleTmpSeconds = 3600;
+
+CacheStats::CacheStats()
+	: hits(0), misses(0), evictions(0), entries(0), bytes(0)
+{
+}
+
+CompileCache::CompileCache(
+	const std::string& directory, unsigned long long max_bytes)
+	: directory_(directory), maxBytes_(max_bytes), open_(false)
+{
+	if(directory_.empty())
+	{
+		return;
+	}
+
+	open_ = MakeDirectories(directory_);
+}
+
+CompileCache::~CompileCache()
+{
+	FlushStats();
+}
+
+bool CompileCache::IsOpen() const
+{
+	return open_;
+}
+
+std::string CompileCache::MakeKey(
+	const std::string& source_digest, const std::string& build_options,
+	const std::string& device_fingerprint)
+{
+	if(source_digest.empty())
+	{
+		return std::string();
+	}
+
+	Sha256 sha;
+
+	sha.Update("oclc-cache-1", 13);
+	sha.Update(source_digest.c_str(), source_digest.size() + 1);
+	sha.Update(build_options.c_str(), build_options.size() + 1);
+	sha.Update(device_fingerprint.c_str(), device_fingerprint.size() + 1);
+
+	return sha.HexDigest();
+}
+
+bool CompileCache::Load(
+	const std::string& key, std::vector<unsigned char>& binary)
+{
+	if(!open_ || key.empty())
+	{
+		return false;
+	}
+
+	TraceSpan span("cache load");
+
+	std::string path = EntryPath(key);
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if(fd < 0)
+	{
+		CountMiss();
+		return false;
+	}
+
+	struct stat st;
+
+	if(fstat(fd, &st) || st.st_size <= 0)
+	{
+		close(fd);
+		CountMiss();
+		return false;
+	}
+
+	binary.resize(st.st_size);
+
+	size_t done = 0;
+
+	while(done < binary.size())
+	{
+		ssize_t readBytes = read(fd, &binary[done], binary.size() - done);
+
+		if(readBytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(readBytes <= 0)
+		{
+			break;
+		}
+
+		done += readBytes;
+	}
+
+	close(fd);
+
+	if(done != binary.size())
+	{
+		binary.clear();
+		CountMiss();
+		return false;
+	}
+
+	// refresh mtime, it is the LRU order
+	utimensat(AT_FDCWD, path.c_str(), NULL, 0);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	++session_.hits;
+	return true;
+}
+
+bool CompileCache::Store(
+	const std::string& key, const std::vector<unsigned char>& binary)
+{
+	if(!open_ || key.empty() || binary.empty() || binary.size() > maxBytes_)
+	{
+		return false;
+	}
+
+	TraceSpan span("cache store");
+
+	if(!WriteFileAtomic(EntryPath(key), &binary[0], binary.size()))
+	{
+		return false;
+	}
+
+	Evict();
+
+	return true;
+}
+
+bool CompileCache::LoadPlatform(
+	const std::string& source_digest, const std::string& build_options,
+	cl_platform_id platform_id, const std::vector<cl_device_id>& device_ids,
+	PlatformBuild& result)
+{
+	if(!open_ || device_ids.empty())
+	{
+		return false;
+	}
+
+	result.platform_id = platform_id;
+	result.error = CL_SUCCESS;
+	result.log.clear();
+	result.binaries.resize(device_ids.size());
+
+	for(size_t i = 0; i < device_ids.size(); ++i)
+	{
+		std::string key = MakeKey(source_digest, build_options,
+			GetDeviceFingerprint(device_ids[i]));
+
+		result.binaries[i].device_id = device_ids[i];
+
+		if(!Load(key, result.binaries[i].binary))
+		{
+			result.binaries.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CompileCache::StorePlatform(
+	const std::string& source_digest, const std::string& build_options,
+	const PlatformBuild& result)
+{
+	if(!open_ || result.error)
+	{
+		return;
+	}
+
+	for(std::vector<DeviceBinary>::const_iterator itr = result.binaries.begin();
+		itr != result.binaries.end(); ++itr)
+	{
+		Store(MakeKey(source_digest, build_options,
+			GetDeviceFingerprint(itr->device_id)), itr->binary);
+	}
+}
+
+CacheStats CompileCache::SessionStats()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return session_;
+}
+
+bool CompileCache::TotalStats(CacheStats& stats)
+{
+	if(!open_)
+	{
+		return false;
+	}
+
+	FlushStats();
+
+	int fd = Lock();
+
+	ReadStats(stats);
+
+	std::vector<Entry> entries;
+	ScanEntries(entries);
+
+	stats.entries = entries.size();
+	stats.bytes = 0;
+
+	for(std::vector<Entry>::const_iterator itr = entries.begin();
+		itr != entries.end(); ++itr)
+	{
+		stats.bytes += itr->size;
+	}
+
+	Unlock(fd);
+
+	return true;
+}
+
+void CompileCache::FlushStats()
+{
+	if(!open_)
+	{
+		return;
+	}
+
+	// each counter increment is claimed by exactly one flush
+	CacheStats delta;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		delta.hits = session_.hits - flushed_.hits;
+		delta.misses = session_.misses - flushed_.misses;
+		delta.evictions = session_.evictions - flushed_.evictions;
+
+		if(!delta.hits && !delta.misses && !delta.evictions)
+		{
+			return;
+		}
+
+		flushed_ = session_;
+	}
+
+	int fd = Lock();
+
+	CacheStats stats;
+	ReadStats(stats);
+
+	stats.hits += delta.hits;
+	stats.misses += delta.misses;
+	stats.evictions += delta.evictions;
+
+	WriteStats(stats);
+
+	Unlock(fd);
+}
+
+void CompileCache::CountMiss()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	++session_.misses;
+}
+
+std::string CompileCache::EntryPath(const std::string& key) const
+{
+	return directory_ + "/" + key + iEntrySuffix;
+}
+
+int CompileCache::Lock() const
+{
+	std::string path = directory_ + "/" + iLockName;
+	int fd = open(path.c_str(), O_RDWR | O_CREAT, 0666);
+
+	if(fd >= 0)
+	{
+		while(flock(fd, LOCK_EX) && errno == EINTR);
+	}
+
+	return fd;
+}
+
+void CompileCache::Unlock(int fd) const
+{
+	if(fd >= 0)
+	{
+		flock(fd, LOCK_UN);
+		close(fd);
+	}
+}
+
+void CompileCache::ScanEntries(
+	std::vector<Entry>& entries, std::vector<std::string>* stale) const
+{
+	entries.clear();
+
+	DIR* dir = opendir(directory_.c_str());
+
+	if(!dir)
+	{
+		return;
+	}
+
+	const size_t suffixSize = strlen(iEntrySuffix);
+	const time_t now = time(NULL);
+
+	while(struct dirent* ent = readdir(dir))
+	{
+		std::string name(ent->d_name);
+
+		if(name.find(".tmp.") != std::string::npos)
+		{
+			std::string path = directory_ + "/" + name;
+			struct stat st;
+
+			if(stale && !stat(path.c_str(), &st) && S_ISREG(st.st_mode) &&
+				st.st_mtime + iStaleTmpSeconds < now)
+			{
+				stale->push_back(path);
+			}
+
+			continue;
+		}
+
+		if(name.size() <= suffixSize ||
+			name.compare(name.size() - suffixSize, suffixSize, iEntrySuffix))
+		{
+			continue;
+		}
+
+		Entry entry;
+		entry.path = directory_ + "/" + name;
+
+		struct stat st;
+
+		if(stat(entry.path.c_str(), &st) || !S_ISREG(st.st_mode))
+		{
+			continue;
+		}
+
+		entry.size = st.st_size;
+		entry.mtime = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL +
+			st.st_mtim.tv_nsec;
+		entries.push_back(entry);
+	}
+
+	closedir(dir);
+}
+
+void CompileCache::Evict()
+{
+	int fd = Lock();
+
+	std::vector<Entry> entries;
+	std::vector<std::string> stale;
+	ScanEntries(entries, &stale);
+
+	for(size_t i = 0; i < stale.size(); ++i)
+	{
+		unlink(stale[i].c_str());
+	}
+
+	unsigned long long total = 0;
+
+	for(std::vector<Entry>::const_iterator itr = entries.begin();
+		itr != entries.end(); ++itr)
+	{
+		total += itr->size;
+	}
+
+	if(total > maxBytes_)
+	{
+		std::sort(entries.begin(), entries.end());
+
+		for(std::vector<Entry>::const_iterator itr = entries.begin();
+			itr != entries.end() && total > maxBytes_; ++itr)
+		{
+			if(!unlink(itr->path.c_str()))
+			{
+				total -= itr->size;
+
+				std::lock_guard<std::mutex> lock(mutex_);
+				++session_.evictions;
+			}
+		}
+	}
+
+	Unlock(fd);
+}
+
+void CompileCache::ReadStats(CacheStats& stats) const
+{
+	std::ifstream ifs((directory_ + "/" + iStatsName).c_str());
+	std::string name;
+	unsigned long long value;
+
+	while(ifs >> name >> value)
+	{
+		if(name == "hits") stats.hits = value;
+		else if(name == "misses") stats.misses = value;
+		else if(name == "evictions") stats.evictions = value;
+	}
+}
+
+void CompileCache::WriteStats(const CacheStats& stats) const
+{
+	char buf[256];
+	int size = snprintf(buf, sizeof(buf),
+		"hits %llu\nmisses %llu\nevictions %llu\n",
+		stats.hits, stats.misses, stats.evictions);
+
+	WriteFileAtomic(directory_ + "/" + iStatsName, buf, size);
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_CACHE_HPP_
+#define OCLC_CACHE_HPP_
+
+#include "build.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+struct CacheStats
+{
+	CacheStats();
+
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long evictions;
+	unsigned long long entries;
+	unsigned long long bytes;
+};
+
+// on-disk program binary cache shared by concurrent oclc processes.
+// entries are written to a temporary file and renamed into place, eviction
+// and statistics updates are serialized with flock() on directory/lock.
+// least recently used entries, ordered by mtime which is refreshed on every
+// hit, are evicted when the directory grows beyond max_bytes, and
+// temporary files an hour old, left by processes killed while writing,
+// are removed at the same time.
+// one instance may be used from several threads.
+class CompileCache
+{
+public:
+	// an empty directory disables the cache
+	CompileCache(const std::string& directory, unsigned long long max_bytes);
+	~CompileCache();
+
+	bool IsOpen() const;
+
+	// source_digest is CacheDigest() of the scan, build_options are those
+	// given by the user, without the -I options of the scan. an empty
+	// source_digest gives an empty key, which is never loaded or stored.
+	static std::string MakeKey(
+		const std::string& source_digest, const std::string& build_options,
+		const std::string& device_fingerprint);
+
+	bool Load(const std::string& key, std::vector<unsigned char>& binary);
+	bool Store(const std::string& key, const std::vector<unsigned char>& binary);
+
+	// load binaries for every device in device_ids, fails unless all hit
+	bool LoadPlatform(
+		const std::string& source_digest, const std::string& build_options,
+		cl_platform_id platform_id, const std::vector<cl_device_id>& device_ids,
+		PlatformBuild& result);
+	void StorePlatform(
+		const std::string& source_digest, const std::string& build_options,
+		const PlatformBuild& result);
+
+	// counters of this process only, entries and bytes are not filled
+	CacheStats SessionStats();
+
+	// counters accumulated by every process sharing the directory
+	bool TotalStats(CacheStats& stats);
+
+	// add session counters to the shared statistics file
+	void FlushStats();
+
+private:
+	CompileCache(const CompileCache&);
+	CompileCache& operator=(const CompileCache&);
+
+	struct Entry
+	{
+		std::string path;
+		unsigned long long size;
+		long long mtime;
+
+		bool operator<(const Entry& rhs) const { return mtime < rhs.mtime; }
+	};
+
+	std::string EntryPath(const std::string& key) const;
+	int Lock() const;
+	void Unlock(int fd) const;
+	// and with stale the temporaries of writers which died
+	void ScanEntries(std::vector<Entry>& entries,
+		std::vector<std::string>* stale = NULL) const;
+	void Evict();
+	void CountMiss();
+	void ReadStats(CacheStats& stats) const;
+	void WriteStats(const CacheStats& stats) const;
+
+	std::string directory_;
+	unsigned long long maxBytes_;
+	bool open_;
+	std::mutex mutex_;
+	CacheStats session_;
+	CacheStats flushed_;
+};
+
+}
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "clxtool.hpp"
+#include "clx.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace OCLT
+{
+
+static std::string iOneLine(std::string str)
+{
+	for(std::string::iterator itr = str.begin(); itr != str.end(); ++itr)
+	{
+		if(*itr == '\n') *itr = ' ';
+	}
+
+	return str;
+}
+
+int ListContainers(const std::vector<std::string>& infiles, bool verbose)
+{
+	using namespace std;
+
+	int status = EXIT_SUCCESS;
+
+	for(vector<string>::const_iterator itr = infiles.begin();
+		itr != infiles.end(); ++itr)
+	{
+		ClxFile file;
+
+		if(!file.Open(*itr))
+		{
+			cerr << file.Error() << ": " << *itr << endl;
+			status = EXIT_FAILURE;
+			continue;
+		}
+
+		cout << *itr << ": clx version " << file.Version() << ", " <<
+			file.EntryCount() << " entries" << endl;
+
+		for(size_t i = 0; i < file.EntryCount(); ++i)
+		{
+			const ClxEntry& entry = file.Entry(i);
+
+			cout << "  " << i << ": " << iOneLine(entry.fingerprint) <<
+				" (" << entry.rawSize << " bytes";
+
+			if(entry.flags & ClxFlagLz)
+			{
+				cout << ", " << entry.size << " compressed";
+			}
+
+			if(verbose)
+			{
+				cout << " at " << entry.offset << ", sha256 " <<
+					ToHex(entry.digest, Sha256::DigestSize);
+			}
+
+			cout << ")" << endl;
+		}
+	}
+
+	return status;
+}
+
+int ExtractContainer(
+	const std::string& infile, size_t index, const std::string& outfile)
+{
+	using namespace std;
+
+	ClxFile file;
+
+	if(!file.Open(infile))
+	{
+		cerr << file.Error() << ": " << infile << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(index >= file.EntryCount())
+	{
+		cerr << "no entry " << index << ": " << infile << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!file.Verify(index))
+	{
+		cerr << "entry " << index << " is broken: " << infile << endl;
+		return EXIT_FAILURE;
+	}
+
+	string path = outfile.empty() ? string("out.bin") : outfile;
+	vector<unsigned char> binary;
+
+	if(!file.Extract(index, binary))
+	{
+		cerr << "entry " << index << " is broken: " << infile << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!WriteFileAtomic(path, binary.empty() ? NULL : &binary[0], binary.size()))
+	{
+		int errorNum = errno;
+		cerr << strerror(errorNum) << ": " << path << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int VerifyContainers(const std::vector<std::string>& infiles)
+{
+	using namespace std;
+
+	int status = EXIT_SUCCESS;
+
+	for(vector<string>::const_iterator itr = infiles.begin();
+		itr != infiles.end(); ++itr)
+	{
+		ClxFile file;
+
+		if(!file.Open(*itr))
+		{
+			cerr << file.Error() << ": " << *itr << endl;
+			status = EXIT_FAILURE;
+			continue;
+		}
+
+		size_t broken = 0;
+
+		for(size_t i = 0; i < file.EntryCount(); ++i)
+		{
+			if(!file.Verify(i))
+			{
+				cout << *itr << ": entry " << i << " is broken" << endl;
+				++broken;
+			}
+		}
+
+		cout << *itr << ": " << (broken ? "NG" : "OK") << endl;
+
+		if(broken)
+		{
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return status;
+}
+
+}
@@ -0,0 +1,36 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_CLXTOOL_HPP_
+#define OCLC_CLXTOOL_HPP_
+
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// inspection of .clx containers, return process exit status
+
+int ListContainers(const std::vector<std::string>& infiles, bool verbose);
+int ExtractContainer(
+	const std::string& infile, size_t index, const std::string& outfile);
+int VerifyContainers(const std::vector<std::string>& infiles);
+
+}
+
+#endif
@@ -0,0 +1,922 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "daemon.hpp"
+#include "build.hpp"
+#include "clx.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+#include "file.hpp"
+#include "includes.hpp"
+#include "session.hpp"
+#include "sources.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+// every message is a type byte, a 64 bit little endian payload size and
+// the payload. a client sends one MSG_REQUEST, the daemon answers with
+// any number of MSG_LOG, at most one MSG_BINARY and a final MSG_END.
+// headers are not sent, the client scans includes and sends the digest
+// of the closure along with -I options of absolute directories.
+enum MessageType
+{
+	MSG_REQUEST = 'R',
+	MSG_LOG = 'L',
+	MSG_BINARY = 'B',
+	MSG_END = 'E',
+};
+
+enum RequestFlags
+{
+	REQUEST_ALL = 1,
+	REQUEST_RAW = 2,
+	REQUEST_COMPRESS = 4,
+};
+
+const uint32_t iProtocolVersion = 2;
+
+// a larger size is taken as a broken or hostile peer, the connection is
+// closed rather than the daemon running out of memory.
+const uint64_t iMaxMessageBytes = 512ULL << 20;
+
+volatile sig_atomic_t gStop = 0;
+
+// write end of the pipe Serve() polls along with the listening socket
+int gWakeFd = -1;
+
+void iOnSignal(int)
+{
+	int saved = errno;
+
+	gStop = 1;
+
+	if(gWakeFd >= 0)
+	{
+		char byte = 0;
+		ssize_t written = write(gWakeFd, &byte, 1);
+		(void)written;
+	}
+
+	errno = saved;
+}
+
+bool iSendAll(int fd, const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+
+	while(size)
+	{
+		ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+
+		if(sent < 0 && errno == EINTR) continue;
+		if(sent <= 0) return false;
+
+		bytes += sent;
+		size -= sent;
+	}
+
+	return true;
+}
+
+bool iReceiveAll(int fd, void* data, size_t size)
+{
+	char* bytes = static_cast<char*>(data);
+
+	while(size)
+	{
+		ssize_t received = recv(fd, bytes, size, 0);
+
+		if(received < 0 && errno == EINTR) continue;
+		if(received <= 0) return false;
+
+		bytes += received;
+		size -= received;
+	}
+
+	return true;
+}
+
+bool iSendMessage(int fd, char type, const void* data, size_t size)
+{
+	unsigned char header[9];
+	header[0] = type;
+
+	for(int i = 0; i < 8; ++i)
+	{
+		header[1 + i] = static_cast<unsigned char>(uint64_t(size) >> (8 * i));
+	}
+
+	return iSendAll(fd, header, sizeof(header)) && iSendAll(fd, data, size);
+}
+
+bool iReceiveMessage(int fd, char& type, std::vector<unsigned char>& payload)
+{
+	unsigned char header[9];
+
+	if(!iReceiveAll(fd, header, sizeof(header)))
+	{
+		return false;
+	}
+
+	uint64_t size = 0;
+
+	for(int i = 7; i >= 0; --i)
+	{
+		size = (size << 8) | header[1 + i];
+	}
+
+	if(size > iMaxMessageBytes)
+	{
+		errno = EMSGSIZE;
+		return false;
+	}
+
+	type = header[0];
+	payload.resize(size);
+
+	return !size || iReceiveAll(fd, &payload[0], size);
+}
+
+class Encoder
+{
+public:
+	void U32(uint32_t v)
+	{
+		for(int i = 0; i < 4; ++i) data_.push_back(static_cast<unsigned char>(v >> (8 * i)));
+	}
+
+	void Bytes(const void* data, size_t size)
+	{
+		U32(size);
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		data_.insert(data_.end(), bytes, bytes + size);
+	}
+
+	void Str(const std::string& str) { Bytes(str.data(), str.size()); }
+
+	const std::vector<unsigned char>& Data() const { return data_; }
+
+private:
+	std::vector<unsigned char> data_;
+};
+
+class Decoder
+{
+public:
+	explicit Decoder(const std::vector<unsigned char>& data)
+		: p_(data.empty() ? NULL : &data[0]), left_(data.size()), ok_(true)
+	{
+	}
+
+	uint32_t U32()
+	{
+		if(left_ < 4)
+		{
+			ok_ = false;
+			return 0;
+		}
+
+		uint32_t v = p_[0] | (p_[1] << 8) | (p_[2] << 16) | (uint32_t(p_[3]) << 24);
+		p_ += 4;
+		left_ -= 4;
+		return v;
+	}
+
+	// data points into the decoded buffer
+	void Bytes(const char*& data, size_t& size)
+	{
+		uint32_t length = U32();
+
+		if(!ok_ || length > left_)
+		{
+			ok_ = false;
+			data = NULL;
+			size = 0;
+			return;
+		}
+
+		data = reinterpret_cast<const char*>(p_);
+		size = length;
+		p_ += length;
+		left_ -= length;
+	}
+
+	std::string Str()
+	{
+		const char* data;
+		size_t size;
+		Bytes(data, size);
+		return std::string(data ? data : "", size);
+	}
+
+	bool Ok() const { return ok_; }
+
+private:
+	const unsigned char* p_;
+	size_t left_;
+	bool ok_;
+};
+
+bool iMakeAddress(const std::string& path, struct sockaddr_un& addr)
+{
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+
+	if(path.size() >= sizeof(addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return false;
+	}
+
+	strcpy(addr.sun_path, path.c_str());
+	return true;
+}
+
+int iConnect(const std::string& path)
+{
+	struct sockaddr_un addr;
+
+	if(!iMakeAddress(path, addr))
+	{
+		return -1;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(fd < 0)
+	{
+		return -1;
+	}
+
+	if(connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)))
+	{
+		int errorNum = errno;
+		close(fd);
+		errno = errorNum;
+		return -1;
+	}
+
+	return fd;
+}
+
+class Daemon
+{
+public:
+	Daemon(const Options& opts, CompileCache& cache)
+		: opts_(opts), cache_(cache), listenFd_(-1), active_(0),
+		maxActive_(opts.jobs ? opts.jobs : std::thread::hardware_concurrency())
+	{
+		if(!maxActive_) maxActive_ = 1;
+		wakeFds_[0] = wakeFds_[1] = -1;
+	}
+
+	~Daemon()
+	{
+		if(listenFd_ >= 0)
+		{
+			close(listenFd_);
+			unlink(opts_.socketPath.c_str());
+		}
+
+		if(wakeFds_[0] >= 0)
+		{
+			gWakeFd = -1;
+			close(wakeFds_[0]);
+			close(wakeFds_[1]);
+		}
+	}
+
+	bool Start();
+	void Serve();
+
+private:
+	void Handle(int fd);
+
+	const Options& opts_;
+	CompileCache& cache_;
+	int listenFd_;
+	int wakeFds_[2];
+
+	// contexts are created by Start(), or retried by the first request
+	// when that failed
+	BuildSession session_;
+	std::vector<cl_platform_id> platform_ids_;
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	size_t active_;
+	size_t maxActive_;
+};
+
+bool Daemon::Start()
+{
+	using namespace std;
+
+	if(cl_int err = session_.GetPlatformIDs(platform_ids_))
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return false;
+	}
+
+	if(platform_ids_.empty())
+	{
+		cerr << "no platform on system" << endl;
+		return false;
+	}
+
+	for(size_t i = 0; i < platform_ids_.size(); ++i)
+	{
+		const PlatformContext* context = NULL;
+		cl_int err = session_.GetContext(platform_ids_[i], context);
+
+		if(opts_.verbose)
+		{
+			cout << "platform " << i << ": " << (err ? 0 : context->device_ids.size()) <<
+				" devices, " << (err ? GetErrorMessage(err) : string("ready")) << endl;
+		}
+	}
+
+	struct sockaddr_un addr;
+
+	if(!iMakeAddress(opts_.socketPath, addr))
+	{
+		cerr << strerror(errno) << ": " << opts_.socketPath << endl;
+		return false;
+	}
+
+	// remove a socket left by a daemon which is not running any more
+	int probe = iConnect(opts_.socketPath);
+
+	if(probe >= 0)
+	{
+		close(probe);
+		cerr << "daemon is already running: " << opts_.socketPath << endl;
+		return false;
+	}
+
+	if(errno == ECONNREFUSED)
+	{
+		unlink(opts_.socketPath.c_str());
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(fd < 0 ||
+		bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) ||
+		listen(fd, 64))
+	{
+		cerr << strerror(errno) << ": " << opts_.socketPath << endl;
+		if(fd >= 0) close(fd);
+		return false;
+	}
+
+	listenFd_ = fd;
+
+	if(pipe(wakeFds_) ||
+		fcntl(wakeFds_[0], F_SETFL, O_NONBLOCK) ||
+		fcntl(wakeFds_[1], F_SETFL, O_NONBLOCK))
+	{
+		cerr << strerror(errno) << ": pipe" << endl;
+		return false;
+	}
+
+	gWakeFd = wakeFds_[1];
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = iOnSignal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	if(opts_.verbose)
+	{
+		cout << "listening on " << opts_.socketPath << endl;
+	}
+
+	return true;
+}
+
+void Daemon::Serve()
+{
+	using namespace std;
+
+	// a signal writes to the wake pipe, so it is seen even when it arrives
+	// between the check of gStop and the wait for a connection
+	while(!gStop)
+	{
+		{
+			unique_lock<mutex> lock(mutex_);
+			cond_.wait(lock, [this]() { return active_ < maxActive_; });
+		}
+
+		struct pollfd fds[2];
+		fds[0].fd = listenFd_;
+		fds[0].events = POLLIN;
+		fds[1].fd = wakeFds_[0];
+		fds[1].events = POLLIN;
+
+		if(poll(fds, 2, -1) < 0 || !(fds[0].revents & POLLIN))
+		{
+			continue;
+		}
+
+		int fd = accept(listenFd_, NULL, NULL);
+
+		if(fd < 0)
+		{
+			continue;
+		}
+
+		{
+			lock_guard<mutex> lock(mutex_);
+			++active_;
+		}
+
+		thread([this, fd]()
+		{
+			SetTraceThreadName("request");
+			Handle(fd);
+			close(fd);
+
+			lock_guard<mutex> lock(mutex_);
+			--active_;
+			cond_.notify_all();
+		}).detach();
+	}
+
+	unique_lock<mutex> lock(mutex_);
+	cond_.wait(lock, [this]() { return active_ == 0; });
+}
+
+void Daemon::Handle(int fd)
+{
+	using namespace std;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	TraceSpan span("request");
+
+	char type;
+	vector<unsigned char> payload;
+
+	if(!iReceiveMessage(fd, type, payload) || type != MSG_REQUEST)
+	{
+		return;
+	}
+
+	Decoder decoder(payload);
+
+	uint32_t version = decoder.U32();
+	uint32_t flags = decoder.U32();
+	string buildOptions = decoder.Str();
+	IncludeScan scan;
+	scan.options = decoder.Str();
+	scan.digest = decoder.Str();
+	uint32_t count = decoder.U32();
+
+	// sources are used in place in payload
+	SourceFiles files;
+
+	for(uint32_t i = 0; decoder.Ok() && i < count; ++i)
+	{
+		const char* data;
+		size_t size;
+		decoder.Bytes(data, size);
+		files.Add(data, size);
+	}
+
+	const vector<SourceText>& sources = files.Texts();
+
+	Encoder end;
+
+	if(!decoder.Ok() || version != iProtocolVersion)
+	{
+		end.U32(static_cast<uint32_t>(CL_INVALID_VALUE));
+		end.Str("bad request");
+		iSendMessage(fd, MSG_END, &end.Data()[0], end.Data().size());
+		return;
+	}
+
+	size_t platforms = (flags & REQUEST_ALL) ? platform_ids_.size() : 1;
+	vector<PlatformBuild> results(platforms);
+	vector<const PlatformContext*> contexts(platforms);
+
+	string compileOptions = CompileOptions(buildOptions, scan);
+
+	cl_int status = CL_SUCCESS;
+	string message;
+
+	for(size_t i = 0; i < platforms; ++i)
+	{
+		results[i].platform_id = platform_ids_[i];
+		results[i].error = session_.GetContext(platform_ids_[i], contexts[i]);
+
+		if(!results[i].error && !cache_.LoadPlatform(CacheDigest(scan), buildOptions,
+			platform_ids_[i], contexts[i]->device_ids, results[i]))
+		{
+			session_.Build(platform_ids_[i], sources, compileOptions, results[i]);
+			cache_.StorePlatform(CacheDigest(scan), buildOptions, results[i]);
+		}
+
+		if(!results[i].log.empty() && !iSendMessage(
+			fd, MSG_LOG, results[i].log.data(), results[i].log.size()))
+		{
+			return;
+		}
+
+		// like the command line, binaries of the other platforms are still
+		// written with -a and every failing platform is reported
+		if(results[i].error)
+		{
+			if(!status) status = results[i].error;
+			if(!message.empty()) message += "\n";
+
+			if(flags & REQUEST_ALL)
+			{
+				ostringstream oss;
+				oss << "platform " << i << " : " << GetErrorMessage(results[i].error);
+				message += oss.str();
+			}
+			else
+			{
+				message += GetErrorMessage(results[i].error);
+			}
+		}
+	}
+
+	size_t first = 0;
+
+	while(first < results.size() &&
+		(results[first].error || results[first].binaries.empty()))
+	{
+		++first;
+	}
+
+	if(first < results.size())
+	{
+		// like the command line, only the first device without -a
+		if(!(flags & REQUEST_ALL))
+		{
+			vector<DeviceBinary>& binaries = results[0].binaries;
+
+			for(size_t i = 0; i < binaries.size(); ++i)
+			{
+				if(binaries[i].device_id == contexts[0]->device_ids[0])
+				{
+					swap(binaries[0], binaries[i]);
+				}
+			}
+
+			binaries.resize(1);
+		}
+
+		vector<unsigned char> output;
+
+		if(flags & REQUEST_RAW)
+		{
+			output.swap(results[first].binaries[0].binary);
+		}
+		else
+		{
+			ClxWriter writer;
+			writer.SetCompression((flags & REQUEST_COMPRESS) != 0);
+
+			for(size_t i = 0; i < results.size(); ++i)
+			{
+				if(results[i].error) continue;
+
+				for(size_t j = 0; j < results[i].binaries.size(); ++j)
+				{
+					const vector<unsigned char>& binary = results[i].binaries[j].binary;
+
+					writer.Add(GetDeviceFingerprint(results[i].binaries[j].device_id),
+						binary.empty() ? NULL : &binary[0], binary.size());
+				}
+			}
+
+			writer.Serialize(output);
+		}
+
+		if(!iSendMessage(fd, MSG_BINARY,
+			output.empty() ? NULL : &output[0], output.size()))
+		{
+			return;
+		}
+	}
+
+	end.U32(static_cast<uint32_t>(status));
+	end.Str(message);
+	iSendMessage(fd, MSG_END, &end.Data()[0], end.Data().size());
+
+	if(opts_.verbose)
+	{
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%.3f ms", chrono::duration<double, milli>(
+			chrono::steady_clock::now() - start).count());
+		cout << "request: " << sources.size() << " sources, " <<
+			(status ? message : string("ok")) << ", " << buf << endl;
+	}
+}
+
+// one request to the daemon, log is printed unless quiet
+int iRequest(const Options& opts, const std::vector<SourceText>& sources,
+	const IncludeScan& scan, bool quiet)
+{
+	using namespace std;
+
+	int fd = iConnect(opts.socketPath);
+
+	if(fd < 0)
+	{
+		cerr << strerror(errno) << ": " << opts.socketPath << endl;
+		return EXIT_FAILURE;
+	}
+
+	Encoder request;
+	request.U32(iProtocolVersion);
+	request.U32((opts.all ? REQUEST_ALL : 0) | (opts.raw ? REQUEST_RAW : 0) |
+		(opts.compress ? REQUEST_COMPRESS : 0));
+	request.Str(opts.buildOptions);
+	request.Str(scan.options);
+	request.Str(CacheDigest(scan));
+	request.U32(sources.size());
+
+	for(size_t i = 0; i < sources.size(); ++i)
+	{
+		request.Bytes(sources[i].data, sources[i].size);
+	}
+
+	if(!iSendMessage(fd, MSG_REQUEST, &request.Data()[0], request.Data().size()))
+	{
+		cerr << strerror(errno) << ": " << opts.socketPath << endl;
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_FAILURE;
+	char type;
+	vector<unsigned char> payload;
+
+	while(iReceiveMessage(fd, type, payload))
+	{
+		if(type == MSG_LOG)
+		{
+			if(!quiet) cout << string(payload.begin(), payload.end()) << endl;
+		}
+		else if(type == MSG_BINARY)
+		{
+			if(!WriteFileAtomic(opts.outfile,
+				payload.empty() ? NULL : &payload[0], payload.size()))
+			{
+				cerr << strerror(errno) << ": " << opts.outfile << endl;
+				break;
+			}
+		}
+		else if(type == MSG_END)
+		{
+			Decoder decoder(payload);
+			cl_int error = static_cast<cl_int>(decoder.U32());
+			string message = decoder.Str();
+
+			if(error)
+			{
+				istringstream lines(message);
+				string line;
+
+				while(getline(lines, line))
+				{
+					cerr << "error : " << line << endl;
+				}
+			}
+			else
+			{
+				status = EXIT_SUCCESS;
+			}
+
+			break;
+		}
+	}
+
+	close(fd);
+
+	return status;
+}
+
+bool iLoadSources(const Options& opts, SourceFiles& files, IncludeScan& scan)
+{
+	using namespace std;
+
+	for(size_t i = 0; i < opts.infiles.size(); ++i)
+	{
+		if(!files.Add(opts.infiles[i]))
+		{
+			cerr << strerror(errno) << ": " << opts.infiles[i] << endl;
+			return false;
+		}
+	}
+
+	if(!ScanIncludes(opts.infiles, files.Texts(), opts.includeDirs, scan))
+	{
+		cerr << strerror(errno) << ": " << scan.files.back() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+void iPrintLatencies(const char* name, std::vector<double>& ms)
+{
+	using namespace std;
+
+	if(ms.empty()) return;
+
+	sort(ms.begin(), ms.end());
+
+	double sum = 0;
+	for(size_t i = 0; i < ms.size(); ++i) sum += ms[i];
+
+	size_t p99 = min(ms.size() - 1, (ms.size() * 99 + 99) / 100 - 1);
+
+	printf("%-9s min %9.3f ms  median %9.3f ms  p99 %9.3f ms  mean %9.3f ms\n",
+		name, ms.front(), ms[ms.size() / 2], ms[p99], sum / ms.size());
+}
+
+}
+
+std::string DefaultSocketPath()
+{
+	if(const char* env = getenv("OCLC_SOCKET"))
+	{
+		return env;
+	}
+
+	char buf[64];
+	snprintf(buf, sizeof(buf), "/tmp/oclc-%u.sock", static_cast<unsigned>(getuid()));
+
+	return buf;
+}
+
+int RunDaemon(const Options& opts, CompileCache& cache)
+{
+	Daemon daemon(opts, cache);
+
+	if(!daemon.Start())
+	{
+		return EXIT_FAILURE;
+	}
+
+	daemon.Serve();
+
+	return EXIT_SUCCESS;
+}
+
+int RunClient(const Options& opts)
+{
+	using namespace std;
+
+	SourceFiles files;
+	IncludeScan scan;
+
+	if(!iLoadSources(opts, files, scan))
+	{
+		return EXIT_FAILURE;
+	}
+
+	const vector<SourceText>& sources = files.Texts();
+
+	int status = iRequest(opts, sources, scan, false);
+
+	if(opts.depfile && status == EXIT_SUCCESS)
+	{
+		string depfile = opts.depfileOut.empty() ?
+			DefaultDepfile(opts.outfile) : opts.depfileOut;
+
+		if(!WriteDepfile(depfile, opts.outfile, scan.files))
+		{
+			cerr << strerror(errno) << ": " << depfile << endl;
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return status;
+}
+
+int RunClientBench(const Options& opts, int argc, char* argv[])
+{
+	using namespace std;
+
+	SourceFiles files;
+	IncludeScan scan;
+
+	if(!iLoadSources(opts, files, scan))
+	{
+		return EXIT_FAILURE;
+	}
+
+	const vector<SourceText>& sources = files.Texts();
+
+	vector<double> daemonMs;
+
+	for(size_t i = 0; i < opts.benchCount; ++i)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		if(iRequest(opts, sources, scan, true))
+		{
+			return EXIT_FAILURE;
+		}
+
+		daemonMs.push_back(chrono::duration<double, milli>(
+			chrono::steady_clock::now() - start).count());
+	}
+
+	// the same command line without the daemon, including process startup
+	vector<char*> args;
+
+	for(int i = 0; i < argc; ++i)
+	{
+		if(find(opts.remoteArgs.begin(), opts.remoteArgs.end(), argv[i]) ==
+			opts.remoteArgs.end())
+		{
+			args.push_back(argv[i]);
+		}
+	}
+
+	args.push_back(NULL);
+
+	vector<double> oneShotMs;
+
+	for(size_t i = 0; i < opts.benchCount; ++i)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		pid_t pid = fork();
+
+		if(pid == 0)
+		{
+			int null = open("/dev/null", O_WRONLY);
+			dup2(null, STDOUT_FILENO);
+			execv("/proc/self/exe", &args[0]);
+			_exit(127);
+		}
+
+		int wstatus = 0;
+
+		if(pid < 0 || waitpid(pid, &wstatus, 0) < 0 ||
+			!WIFEXITED(wstatus) || WEXITSTATUS(wstatus))
+		{
+			cerr << "one-shot oclc failed" << endl;
+			return EXIT_FAILURE;
+		}
+
+		oneShotMs.push_back(chrono::duration<double, milli>(
+			chrono::steady_clock::now() - start).count());
+	}
+
+	cout << "---- " << opts.benchCount << " requests" << endl;
+	iPrintLatencies("daemon", daemonMs);
+	iPrintLatencies("one-shot", oneShotMs);
+
+	return EXIT_SUCCESS;
+}
+
+}
@@ -0,0 +1,47 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_DAEMON_HPP_
+#define OCLC_DAEMON_HPP_
+
+#include "cache.hpp"
+#include "options.hpp"
+
+#include <string>
+
+namespace OCLT
+{
+
+// $OCLC_SOCKET or /tmp/oclc-<uid>.sock
+std::string DefaultSocketPath();
+
+// keep a context for every platform and serve compile requests on the
+// unix domain socket opts.socketPath until SIGINT or SIGTERM.
+// returns process exit status.
+int RunDaemon(const Options& opts, CompileCache& cache);
+
+// send the sources of opts.infiles to the daemon, print the build log and
+// write the binary to opts.outfile. returns process exit status.
+int RunClient(const Options& opts);
+
+// compare opts.benchCount requests to the daemon with as many runs of
+// the one-shot command line (argv without --remote and --bench)
+int RunClientBench(const Options& opts, int argc, char* argv[]);
+
+}
+
+#endif
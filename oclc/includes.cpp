@@ -0,0 +1,528 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "includes.hpp"
+#include "file.hpp"
+#include "sha256.hpp"
+#include "sources.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <set>
+
+#include <sys/stat.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+class Scanner
+{
+public:
+	Scanner(const std::vector<std::string>& include_dirs, IncludeScan& scan,
+		bool map_headers)
+		: includeDirs_(include_dirs), scan_(scan), headers_(map_headers)
+	{
+		static const char tag[] = "oclc-include-1";
+		sha_.Update(tag, sizeof(tag));
+	}
+
+	bool Visit(const std::string& path, const char* data, size_t size);
+	bool VisitHeader(const std::string& path);
+
+	std::string Digest();
+
+private:
+	bool Resolve(const std::string& name, bool quoted,
+		const std::string& includer, std::string& path) const;
+
+	const std::vector<std::string>& includeDirs_;
+	IncludeScan& scan_;
+	std::set<std::string> visited_;
+	SourceFiles headers_;
+	Sha256 sha_;
+};
+
+std::string iDirName(const std::string& path)
+{
+	std::string::size_type pos = path.rfind('/');
+
+	if(pos == std::string::npos)
+	{
+		return ".";
+	}
+
+	return pos ? path.substr(0, pos) : std::string("/");
+}
+
+std::string iJoinPath(const std::string& dir, const std::string& name)
+{
+	if(name[0] == '/' || dir == ".")
+	{
+		return name;
+	}
+
+	return dir[dir.size() - 1] == '/' ? dir + name : dir + "/" + name;
+}
+
+bool iIsFile(const std::string& path)
+{
+	struct stat st;
+	return !stat(path.c_str(), &st) && !S_ISDIR(st.st_mode);
+}
+
+std::string iAbsolutePath(const std::string& path)
+{
+	char resolved[PATH_MAX];
+	return realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+}
+
+// whether one canonical line is an #include directive. name is the
+// header, quoted is set for "name" and cleared for <name>. name is empty
+// for a computed include (#include MACRO) which the scan can not follow.
+bool iParseInclude(const std::string& line, std::string& name, bool& quoted)
+{
+	std::string::size_type pos = 0;
+
+	if(line.compare(pos, 1, "#"))
+	{
+		return false;
+	}
+
+	pos = line[1] == ' ' ? 2 : 1;
+
+	if(line.compare(pos, 7, "include"))
+	{
+		return false;
+	}
+
+	pos += 7;
+
+	if(pos < line.size() && line[pos] == ' ')
+	{
+		++pos;
+	}
+
+	name.clear();
+	quoted = false;
+
+	if(pos >= line.size() || (line[pos] != '"' && line[pos] != '<'))
+	{
+		// computed includes are left to the compiler
+		return pos >= line.size() || line[pos - 1] == ' ';
+	}
+
+	quoted = line[pos] == '"';
+	std::string::size_type end = line.find(quoted ? '"' : '>', pos + 1);
+
+	if(end == std::string::npos || end == pos + 1)
+	{
+		return true;
+	}
+
+	name = line.substr(pos + 1, end - pos - 1);
+
+	return true;
+}
+
+bool Scanner::Visit(const std::string& path, const char* data, size_t size)
+{
+	std::string text = CanonicalSource(data, size);
+
+	unsigned long long length = text.size();
+	sha_.Update(&length, sizeof(length));
+	sha_.Update(text);
+
+	std::string::size_type begin = 0;
+
+	while(begin < text.size())
+	{
+		std::string::size_type end = text.find('\n', begin);
+
+		if(end == std::string::npos)
+		{
+			end = text.size();
+		}
+
+		std::string name;
+		bool quoted;
+		std::string header;
+
+		std::string line = text.substr(begin, end - begin);
+
+		if(iParseInclude(line, name, quoted))
+		{
+			if(name.empty())
+			{
+				// what a computed include names is not known
+				scan_.unresolved.push_back(line);
+			}
+			else if(!Resolve(name, quoted, path, header))
+			{
+				scan_.unresolved.push_back(name);
+			}
+			else if(!VisitHeader(header))
+			{
+				return false;
+			}
+		}
+
+		begin = end + 1;
+	}
+
+	return true;
+}
+
+std::string Scanner::Digest()
+{
+	for(std::vector<std::string>::const_iterator itr = scan_.unresolved.begin();
+		itr != scan_.unresolved.end(); ++itr)
+	{
+		sha_.Update(itr->c_str(), itr->size() + 1);
+	}
+
+	return sha_.HexDigest();
+}
+
+bool Scanner::VisitHeader(const std::string& path)
+{
+	if(!visited_.insert(path).second)
+	{
+		return true;
+	}
+
+	scan_.files.push_back(path);
+
+	if(!headers_.Add(path))
+	{
+		return false;
+	}
+
+	const SourceText& text = headers_.Texts().back();
+
+	return Visit(path, text.data, text.size);
+}
+
+bool Scanner::Resolve(const std::string& name, bool quoted,
+	const std::string& includer, std::string& path) const
+{
+	if(name[0] == '/')
+	{
+		path = name;
+		return iIsFile(path);
+	}
+
+	if(quoted)
+	{
+		path = iJoinPath(iDirName(includer), name);
+
+		if(iIsFile(path))
+		{
+			return true;
+		}
+	}
+
+	for(std::vector<std::string>::const_iterator itr = includeDirs_.begin();
+		itr != includeDirs_.end(); ++itr)
+	{
+		path = iJoinPath(*itr, name);
+
+		if(iIsFile(path))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void iAppendIncludeOption(std::string& options, const std::string& dir)
+{
+	std::string absolute = iAbsolutePath(dir);
+
+	std::string option = absolute.find(' ') == std::string::npos ?
+		"-I " + absolute : "-I \"" + absolute + "\"";
+
+	if((" " + options + " ").find(" " + option + " ") != std::string::npos)
+	{
+		return;
+	}
+
+	if(!options.empty())
+	{
+		options += " ";
+	}
+
+	options += option;
+}
+
+void iAppendEscaped(std::string& out, const std::string& path)
+{
+	for(std::string::const_iterator itr = path.begin();
+		itr != path.end(); ++itr)
+	{
+		if(*itr == ' ' || *itr == '#')
+		{
+			out += '\\';
+		}
+		else if(*itr == '$')
+		{
+			out += '$';
+		}
+
+		out += *itr;
+	}
+}
+
+}
+
+std::string CanonicalSource(const char* data, size_t size)
+{
+	enum
+	{
+		CODE,
+		STRING,
+		CHAR,
+		LINE_COMMENT,
+		BLOCK_COMMENT,
+	} state = CODE;
+
+	std::string out;
+	out.reserve(size);
+
+	bool space = false;
+	bool newline = false;
+
+	for(size_t i = 0; i < size; ++i)
+	{
+		char c = data[i];
+
+		// line continuations are spliced before anything else
+		if(c == '\\' && i + 1 < size && data[i + 1] == '\n')
+		{
+			++i;
+			continue;
+		}
+
+		if(c == '\\' && i + 2 < size && data[i + 1] == '\r' && data[i + 2] == '\n')
+		{
+			i += 2;
+			continue;
+		}
+
+		switch(state)
+		{
+		case STRING:
+		case CHAR:
+			out += c;
+
+			if(c == '\\' && i + 1 < size)
+			{
+				out += data[++i];
+			}
+			else if(c == (state == STRING ? '"' : '\'') || c == '\n')
+			{
+				state = CODE;
+			}
+
+			continue;
+		case LINE_COMMENT:
+			if(c == '\n')
+			{
+				state = CODE;
+				newline = true;
+			}
+
+			continue;
+		case BLOCK_COMMENT:
+			if(c == '*' && i + 1 < size && data[i + 1] == '/')
+			{
+				++i;
+				state = CODE;
+				space = true;
+			}
+
+			continue;
+		default:
+			break;
+		}
+
+		if(c == '/' && i + 1 < size && data[i + 1] == '/')
+		{
+			++i;
+			state = LINE_COMMENT;
+			continue;
+		}
+
+		if(c == '/' && i + 1 < size && data[i + 1] == '*')
+		{
+			++i;
+			state = BLOCK_COMMENT;
+			continue;
+		}
+
+		if(c == '\n')
+		{
+			newline = true;
+			continue;
+		}
+
+		if(c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+		{
+			space = true;
+			continue;
+		}
+
+		if(newline && !out.empty())
+		{
+			out += '\n';
+		}
+		else if(space && !newline && !out.empty())
+		{
+			out += ' ';
+		}
+
+		space = false;
+		newline = false;
+
+		if(c == '"')
+		{
+			state = STRING;
+		}
+		else if(c == '\'')
+		{
+			state = CHAR;
+		}
+
+		out += c;
+	}
+
+	if(!out.empty())
+	{
+		out += '\n';
+	}
+
+	return out;
+}
+
+bool ScanIncludes(
+	const std::vector<std::string>& paths,
+	const std::vector<SourceText>& sources,
+	const std::vector<std::string>& include_dirs,
+	IncludeScan& scan,
+	bool map_headers)
+{
+	TraceSpan span("scan includes");
+
+	scan.files.clear();
+	scan.digest.clear();
+	scan.unresolved.clear();
+	scan.options.clear();
+
+	// the compiler does not know where a source came from, so includes
+	// next to it are found through its directory, searched last
+	std::vector<std::string> dirs(include_dirs);
+
+	for(size_t i = 0; i < paths.size(); ++i)
+	{
+		std::string dir = iDirName(paths[i]);
+
+		if(find(dirs.begin(), dirs.end(), dir) == dirs.end())
+		{
+			dirs.push_back(dir);
+		}
+	}
+
+	for(std::vector<std::string>::const_iterator itr = dirs.begin();
+		itr != dirs.end(); ++itr)
+	{
+		iAppendIncludeOption(scan.options, *itr);
+	}
+
+	Scanner scanner(dirs, scan, map_headers);
+
+	for(size_t i = 0; i < paths.size() && i < sources.size(); ++i)
+	{
+		scan.files.push_back(paths[i]);
+
+		if(!scanner.Visit(paths[i], sources[i].data, sources[i].size))
+		{
+			return false;
+		}
+	}
+
+	scan.digest = scanner.Digest();
+
+	return true;
+}
+
+std::string CacheDigest(const IncludeScan& scan)
+{
+	return scan.unresolved.empty() ? scan.digest : std::string();
+}
+
+std::string CompileOptions(
+	const std::string& build_options, const IncludeScan& scan)
+{
+	if(build_options.empty() || scan.options.empty())
+	{
+		return build_options + scan.options;
+	}
+
+	return build_options + " " + scan.options;
+}
+
+bool WriteDepfile(const std::string& path, const std::string& target,
+	const std::vector<std::string>& dependencies)
+{
+	TraceSpan span("write depfile", path);
+
+	std::string text;
+	iAppendEscaped(text, target);
+	text += ":";
+
+	for(std::vector<std::string>::const_iterator itr = dependencies.begin();
+		itr != dependencies.end(); ++itr)
+	{
+		text += " \\\n  ";
+		iAppendEscaped(text, *itr);
+	}
+
+	text += "\n";
+
+	return WriteFileAtomic(path, text.data(), text.size());
+}
+
+std::string DefaultDepfile(const std::string& path)
+{
+	std::string::size_type slash = path.rfind('/');
+	std::string::size_type dot = path.rfind('.');
+
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+	{
+		return path + ".d";
+	}
+
+	return path.substr(0, dot) + ".d";
+}
+
+}
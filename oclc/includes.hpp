@@ -0,0 +1,87 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_INCLUDES_HPP_
+#define OCLC_INCLUDES_HPP_
+
+#include "build.hpp"
+
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// #include closure of the sources of one program
+struct IncludeScan
+{
+	// inputs and every header they include, in order of first inclusion
+	std::vector<std::string> files;
+
+	// sha256 over the canonical text of files, see CanonicalSource(), and
+	// the names in unresolved
+	std::string digest;
+
+	// names of #include directives which were not found, and computed
+	// #include lines, in order
+	std::vector<std::string> unresolved;
+
+	// "-I <dir>" for each include directory and input directory, made
+	// absolute, so that clBuildProgram resolves includes as the scan did
+	std::string options;
+};
+
+// source text without comments, line continuations, blank lines and
+// leading or trailing whitespace, other runs of whitespace outside of
+// literals collapsed to one space. cosmetic edits do not change it.
+std::string CanonicalSource(const char* data, size_t size);
+
+// follow #include directives of sources (loaded from paths). "file" is
+// looked up next to the including file and then in include_dirs and the
+// directories of paths, <file> in the latter only. directives are
+// followed regardless of #if, and includes which can not be found are
+// left to the compiler and listed in scan.unresolved. returns false and
+// sets errno if a header can not be read, which is then the last of
+// scan.files. headers are read instead of mapped without map_headers
+// (see SourceFiles).
+bool ScanIncludes(
+	const std::vector<std::string>& paths,
+	const std::vector<SourceText>& sources,
+	const std::vector<std::string>& include_dirs,
+	IncludeScan& scan,
+	bool map_headers = true);
+
+// scan.digest for the compile cache, empty when an include was not
+// resolved: the compiler may find a header the scan did not read, so the
+// build must not be cached
+std::string CacheDigest(const IncludeScan& scan);
+
+// build_options followed by scan.options
+std::string CompileOptions(
+	const std::string& build_options, const IncludeScan& scan);
+
+// write "target: dependencies" in make syntax, which ninja reads as well.
+// returns false and sets errno on failure.
+bool WriteDepfile(const std::string& path, const std::string& target,
+	const std::vector<std::string>& dependencies);
+
+// path with its extension replaced by .d
+std::string DefaultDepfile(const std::string& path);
+
+}
+
+#endif
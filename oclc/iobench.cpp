@@ -0,0 +1,708 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "iobench.hpp"
+#include "build.hpp"
+#include "clx.hpp"
+#include "file.hpp"
+#include "loader.hpp"
+#include "sources.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+enum IoMethod
+{
+	IO_NONE,
+	IO_FREAD,
+	IO_READ,
+	IO_MMAP,
+};
+
+const char* const iMethodNames[] = { "none", "fread", "read", "mmap" };
+
+struct IoResult
+{
+	std::vector<double> ms;
+	long maxRssKb;
+};
+
+bool iGenerateSource(const std::string& path, unsigned long long size)
+{
+	AtomicFileWriter writer;
+
+	if(!writer.Open(path))
+	{
+		return false;
+	}
+
+	std::string chunk;
+	char line[160];
+
+	for(unsigned long long i = 0; writer.Offset() < size; ++i)
+	{
+		snprintf(line, sizeof(line),
+			"float oclc_bench_%llu(float x)\n{\n\treturn x * %llu.5f + 1.0f;\n}\n\n",
+			i, i % 1000);
+		chunk += line;
+
+		if(chunk.size() >= 65536 || writer.Offset() + chunk.size() >= size)
+		{
+			if(!writer.Write(chunk.data(), chunk.size()))
+			{
+				return false;
+			}
+
+			chunk.clear();
+		}
+	}
+
+	const char kernel[] =
+		"__kernel void oclc_bench(__global float* a)\n{\n"
+		"\ta[get_global_id(0)] = oclc_bench_0(a[get_global_id(0)]);\n}\n";
+
+	return writer.Write(kernel, sizeof(kernel) - 1) && writer.Commit();
+}
+
+// the loader and binary writer of oclc before sources were mapped
+void iLoadChunked(const std::string& path, std::vector<char>& source)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if(!file)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	while(!feof(file))
+	{
+		char buf[1024];
+
+		size_t readBytes = fread(buf, 1, 1024, file);
+
+		if(!readBytes)
+		{
+			break;
+		}
+
+		size_t preSize = source.size();
+		source.resize(preSize + readBytes);
+		memcpy(&source[preSize], buf, readBytes);
+	}
+
+	fclose(file);
+}
+
+void iSaveByValue(
+	const std::string& path, const std::vector<unsigned char> binary)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+
+	if(!file)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	fwrite(&binary[0], 1, binary.size(), file);
+	fclose(file);
+}
+
+// body of a child process
+void iRunMethod(IoMethod method, const std::string& source,
+	const std::string& output)
+{
+	using namespace std;
+
+	if(method == IO_NONE)
+	{
+		return;
+	}
+
+	vector<char> buffer;
+	SourceFiles files;
+
+	if(method == IO_FREAD)
+	{
+		iLoadChunked(source, buffer);
+		files.Add(&buffer[0], buffer.size());
+	}
+	else if(method == IO_READ)
+	{
+		if(!ReadFile(source, buffer))
+		{
+			exit(EXIT_FAILURE);
+		}
+
+		files.Add(&buffer[0], buffer.size());
+	}
+	else if(!files.Add(source))
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	// stands in for clCreateProgramWithSource reading the text once
+	const SourceText& text = files.Texts()[0];
+	unsigned char sum = 0;
+
+	for(size_t i = 0; i < text.size; ++i)
+	{
+		sum += text.data[i];
+	}
+
+	// stands in for the binary returned by clGetProgramInfo
+	vector<unsigned char> binary(text.size, sum);
+
+	if(method == IO_FREAD)
+	{
+		vector<unsigned char> selected(binary);
+		iSaveByValue(output, selected);
+	}
+	else if(!WriteFileAtomic(output, &binary[0], binary.size()))
+	{
+		exit(EXIT_FAILURE);
+	}
+}
+
+bool iTimeMethod(IoMethod method, const std::string& source,
+	const std::string& output, IoResult& result)
+{
+	using namespace std;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	pid_t pid = fork();
+
+	if(pid < 0)
+	{
+		return false;
+	}
+
+	if(!pid)
+	{
+		iRunMethod(method, source, output);
+		_exit(EXIT_SUCCESS);
+	}
+
+	int status;
+	struct rusage usage;
+
+	while(wait4(pid, &status, 0, &usage) < 0)
+	{
+		if(errno != EINTR)
+		{
+			return false;
+		}
+	}
+
+	result.ms.push_back(chrono::duration<double, milli>(
+		chrono::steady_clock::now() - start).count());
+	result.maxRssKb = max(result.maxRssKb, usage.ru_maxrss);
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+bool iMakeBenchDir(std::vector<char>& dir)
+{
+	const char* tmpdir = getenv("TMPDIR");
+	std::string dirTemplate =
+		std::string(tmpdir ? tmpdir : "/tmp") + "/oclc-bench.XXXXXX";
+
+	dir.assign(dirTemplate.begin(), dirTemplate.end());
+	dir.push_back('\0');
+
+	if(!mkdtemp(&dir[0]))
+	{
+		std::cerr << strerror(errno) << ": " << dirTemplate << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// evict path from the page cache, as after a reboot or on a network
+// filesystem whose cache went stale
+void iDropCache(const std::string& path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if(fd < 0)
+	{
+		return;
+	}
+
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+// body of a child process, the time to a built program is written to fd
+void iStartProgram(const ProgramLoadOptions& load, int fd)
+{
+	using namespace std;
+
+	cl_platform_id platform_id;
+	cl_device_id device_id;
+	cl_int errcode_ret;
+
+	if(clGetPlatformIDs(1, &platform_id, NULL) ||
+		clGetDeviceIDs(platform_id, CL_DEVICE_TYPE_ALL, 1, &device_id, NULL))
+	{
+		_exit(EXIT_FAILURE);
+	}
+
+	cl_context context = clCreateContext(
+		NULL, 1, &device_id, NULL, NULL, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		_exit(EXIT_FAILURE);
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	ProgramLoadResult result;
+
+	if(LoadProgram(context, device_id, load, result) ||
+		(!load.binaryPath.empty() && !load.writeBack && !result.fromBinary))
+	{
+		_exit(EXIT_FAILURE);
+	}
+
+	double ms = chrono::duration<double, milli>(
+		chrono::steady_clock::now() - start).count();
+
+	if(write(fd, &ms, sizeof(ms)) != sizeof(ms))
+	{
+		_exit(EXIT_FAILURE);
+	}
+
+	clReleaseProgram(result.program);
+	clReleaseContext(context);
+}
+
+// start a child process loading the program, adds the time to the built
+// program to loadMs and that of the whole process to wallMs
+bool iTimeStartup(const ProgramLoadOptions& load,
+	std::vector<double>& loadMs, std::vector<double>& wallMs)
+{
+	using namespace std;
+
+	int fds[2];
+
+	if(pipe(fds))
+	{
+		return false;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	pid_t pid = fork();
+
+	if(pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+
+	if(!pid)
+	{
+		close(fds[0]);
+		iStartProgram(load, fds[1]);
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(fds[1]);
+
+	double ms = 0;
+	bool received = read(fds[0], &ms, sizeof(ms)) == sizeof(ms);
+	close(fds[0]);
+
+	int status;
+
+	while(waitpid(pid, &status, 0) < 0)
+	{
+		if(errno != EINTR)
+		{
+			return false;
+		}
+	}
+
+	wallMs.push_back(chrono::duration<double, milli>(
+		chrono::steady_clock::now() - start).count());
+	loadMs.push_back(ms);
+
+	return received && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+// open a container and extract every binary into the buffer which would
+// be handed to clCreateProgramWithBinary
+bool iLoadContainer(const std::string& path, bool cold, std::vector<double>& ms)
+{
+	using namespace std;
+
+	if(cold)
+	{
+		iDropCache(path);
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	ClxFile file;
+
+	if(!file.Open(path))
+	{
+		return false;
+	}
+
+	vector<unsigned char> binary;
+
+	for(size_t i = 0; i < file.EntryCount(); ++i)
+	{
+		if(!file.Extract(i, binary))
+		{
+			return false;
+		}
+	}
+
+	ms.push_back(chrono::duration<double, milli>(
+		chrono::steady_clock::now() - start).count());
+
+	return true;
+}
+
+}
+
+int RunIoBench(const Options& opts)
+{
+	using namespace std;
+
+	vector<char> dir;
+
+	if(!iMakeBenchDir(dir))
+	{
+		return EXIT_FAILURE;
+	}
+
+	string source = string(&dir[0]) + "/source.cl";
+	string output = string(&dir[0]) + "/out.bin";
+
+	int status = EXIT_SUCCESS;
+
+	if(!iGenerateSource(source, opts.benchIoSize))
+	{
+		cerr << strerror(errno) << ": " << source << endl;
+		status = EXIT_FAILURE;
+	}
+
+	size_t runs = opts.benchCount ? opts.benchCount : 5;
+
+	if(!status)
+	{
+		cout << "---- " << (opts.benchIoSize >> 20) << " MB source, " <<
+			runs << " runs" << endl;
+	}
+
+	// the first pass warms the page cache and is not reported
+	for(int pass = 0; !status && pass < 2; ++pass)
+	{
+		for(int method = IO_NONE; !status && method <= IO_MMAP; ++method)
+		{
+			IoResult result;
+			result.maxRssKb = 0;
+
+			for(size_t i = 0; i < (pass ? runs : 1); ++i)
+			{
+				if(!iTimeMethod(static_cast<IoMethod>(method),
+					source, output, result))
+				{
+					cerr << "benchmark failed: " << iMethodNames[method] << endl;
+					status = EXIT_FAILURE;
+					break;
+				}
+			}
+
+			if(!pass || status)
+			{
+				continue;
+			}
+
+			sort(result.ms.begin(), result.ms.end());
+
+			printf("%-6s wall min %9.3f ms  median %9.3f ms  peak RSS %9.1f MB\n",
+				iMethodNames[method], result.ms.front(),
+				result.ms[result.ms.size() / 2], result.maxRssKb / 1024.0);
+		}
+	}
+
+	unlink(source.c_str());
+	unlink(output.c_str());
+	rmdir(&dir[0]);
+
+	return status;
+}
+
+int RunCompressBench(const Options& opts)
+{
+	using namespace std;
+
+	// every binary of the inputs, one container entry each
+	vector< vector<unsigned char> > binaries;
+	vector<string> fingerprints;
+
+	for(vector<string>::const_iterator itr = opts.infiles.begin();
+		itr != opts.infiles.end(); ++itr)
+	{
+		ClxFile clx;
+
+		if(clx.Open(*itr))
+		{
+			for(size_t i = 0; i < clx.EntryCount(); ++i)
+			{
+				binaries.push_back(vector<unsigned char>());
+				fingerprints.push_back(clx.Entry(i).fingerprint);
+
+				if(!clx.Extract(i, binaries.back()))
+				{
+					cerr << "entry " << i << " is broken: " << *itr << endl;
+					return EXIT_FAILURE;
+				}
+			}
+
+			continue;
+		}
+
+		vector<char> data;
+
+		if(!ReadFile(*itr, data))
+		{
+			cerr << strerror(errno) << ": " << *itr << endl;
+			return EXIT_FAILURE;
+		}
+
+		binaries.push_back(vector<unsigned char>(data.begin(), data.end()));
+		fingerprints.push_back(*itr);
+	}
+
+	if(binaries.empty())
+	{
+		cerr << "no input file" << endl;
+		return EXIT_FAILURE;
+	}
+
+	vector<char> dir;
+
+	if(!iMakeBenchDir(dir))
+	{
+		return EXIT_FAILURE;
+	}
+
+	const string paths[2] =
+	{
+		string(&dir[0]) + "/plain.clx",
+		string(&dir[0]) + "/compressed.clx",
+	};
+
+	const char* const names[2] = { "plain", "lz" };
+
+	unsigned long long rawBytes = 0;
+	unsigned long long fileBytes[2] = { 0, 0 };
+	double compressMs = 0;
+	int status = EXIT_SUCCESS;
+
+	for(int compress = 0; !status && compress < 2; ++compress)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		ClxWriter writer;
+		writer.SetCompression(compress != 0);
+
+		for(size_t i = 0; i < binaries.size(); ++i)
+		{
+			writer.Add(fingerprints[i],
+				binaries[i].empty() ? NULL : &binaries[i][0], binaries[i].size());
+			rawBytes += compress ? 0 : binaries[i].size();
+		}
+
+		if(!writer.Write(paths[compress]))
+		{
+			cerr << strerror(errno) << ": " << paths[compress] << endl;
+			status = EXIT_FAILURE;
+		}
+
+		if(compress)
+		{
+			compressMs = chrono::duration<double, milli>(
+				chrono::steady_clock::now() - start).count();
+		}
+
+		vector<char> written;
+
+		if(!status && ReadFile(paths[compress], written))
+		{
+			fileBytes[compress] = written.size();
+		}
+	}
+
+	size_t runs = opts.benchCount ? opts.benchCount : 5;
+
+	if(!status)
+	{
+		cout << "---- " << binaries.size() << " binaries, " << rawBytes <<
+			" bytes, " << runs << " runs" << endl;
+		printf("lz     %.2fx smaller (%llu -> %llu bytes), compressed in"
+			" %.3f ms (%.1f MB/s)\n",
+			fileBytes[1] ? double(fileBytes[0]) / fileBytes[1] : 0.0,
+			fileBytes[0], fileBytes[1], compressMs,
+			compressMs ? rawBytes / compressMs / 1e3 : 0.0);
+	}
+
+	for(int compress = 0; !status && compress < 2; ++compress)
+	{
+		vector<double> cold;
+		vector<double> warm;
+
+		for(size_t i = 0; !status && i < runs; ++i)
+		{
+			if(!iLoadContainer(paths[compress], true, cold) ||
+				!iLoadContainer(paths[compress], false, warm))
+			{
+				cerr << "benchmark failed: " << names[compress] << endl;
+				status = EXIT_FAILURE;
+			}
+		}
+
+		if(status)
+		{
+			break;
+		}
+
+		sort(cold.begin(), cold.end());
+		sort(warm.begin(), warm.end());
+
+		printf("%-6s load cold median %9.3f ms  warm median %9.3f ms  file %9.1f KB\n",
+			names[compress], cold[cold.size() / 2], warm[warm.size() / 2],
+			fileBytes[compress] / 1024.0);
+	}
+
+	unlink(paths[0].c_str());
+	unlink(paths[1].c_str());
+	rmdir(&dir[0]);
+
+	return status;
+}
+
+int RunStartupBench(const Options& opts)
+{
+	using namespace std;
+
+	if(opts.infiles.empty())
+	{
+		cerr << "no input file" << endl;
+		return EXIT_FAILURE;
+	}
+
+	vector<char> dir;
+
+	if(!iMakeBenchDir(dir))
+	{
+		return EXIT_FAILURE;
+	}
+
+	// the binary is written by the first start, not into the -o file
+	const string binaryPath = string(&dir[0]) + "/startup.clx";
+
+	ProgramLoadOptions load;
+	load.binaryPath = binaryPath;
+	load.sourcePath = opts.infiles[0];
+	load.buildOptions = opts.buildOptions;
+	load.writeBack = true;
+
+	vector<double> loadMs;
+	vector<double> wallMs;
+	int status = EXIT_SUCCESS;
+
+	// makes sure the binary is there, not reported
+	if(!iTimeStartup(load, loadMs, wallMs))
+	{
+		cerr << "can not build " << opts.infiles[0] << endl;
+		status = EXIT_FAILURE;
+	}
+
+	size_t runs = opts.benchCount ? opts.benchCount : 5;
+	const char* const names[2] = { "binary", "source" };
+
+	if(!status)
+	{
+		cout << "---- " << opts.infiles[0] << ", " << runs << " runs" << endl;
+	}
+
+	for(int path = 0; !status && path < 2; ++path)
+	{
+		load.binaryPath = path ? string() : binaryPath;
+		load.writeBack = false;
+		loadMs.clear();
+		wallMs.clear();
+
+		for(size_t i = 0; !status && i < runs; ++i)
+		{
+			if(!iTimeStartup(load, loadMs, wallMs))
+			{
+				cerr << "benchmark failed: " << names[path] <<
+					(path ? "" : " (binary rejected by the driver?)") << endl;
+				status = EXIT_FAILURE;
+			}
+		}
+
+		if(status)
+		{
+			break;
+		}
+
+		sort(loadMs.begin(), loadMs.end());
+		sort(wallMs.begin(), wallMs.end());
+
+		printf("%-6s program min %9.3f ms  median %9.3f ms  process median %9.3f ms\n",
+			names[path], loadMs.front(), loadMs[loadMs.size() / 2],
+			wallMs[wallMs.size() / 2]);
+	}
+
+	unlink(binaryPath.c_str());
+	rmdir(&dir[0]);
+
+	return status;
+}
+
+}
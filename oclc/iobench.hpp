@@ -0,0 +1,49 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_IOBENCH_HPP_
+#define OCLC_IOBENCH_HPP_
+
+#include "options.hpp"
+
+namespace OCLT
+{
+
+// generate a source of opts.benchIoSize bytes, then time loading it,
+// reading it once and writing a binary of the same size, with the former
+// 1KB fread loader and copied binaries, with read() and with mmap.
+// every run is a child process so that its peak RSS can be reported.
+// opts.benchCount runs per method. returns process exit status.
+int RunIoBench(const Options& opts);
+
+// compress the binaries of opts.infiles (clx containers or bare binaries)
+// and compare size and load time of a compressed container with the
+// container SaveBinaries() writes without compression, cold (dropped
+// from the page cache) and warm. opts.benchCount runs of each.
+// returns process exit status.
+int RunCompressBench(const Options& opts);
+
+// compare the startup latency of LoadProgram() from the binary in
+// opts.outfile with building opts.infiles[0] from source, for the first
+// device. the binary is written back first when it is missing. every
+// start is a child process, opts.benchCount of each.
+// returns process exit status.
+int RunStartupBench(const Options& opts);
+
+}
+
+#endif
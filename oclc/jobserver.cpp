@@ -0,0 +1,187 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "jobserver.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace OCLT
+{
+
+JobServer::JobServer()
+	: readFd_(-1), writeFd_(-1), ownFds_(false), implicitFree_(true)
+{
+}
+
+JobServer::~JobServer()
+{
+	// give back tokens of jobs which did not call Release()
+	for(std::vector<char>::const_iterator itr = tokens_.begin();
+		itr != tokens_.end(); ++itr)
+	{
+		while(write(writeFd_, &*itr, 1) < 0 && errno == EINTR);
+	}
+
+	if(ownFds_)
+	{
+		close(readFd_);
+
+		if(writeFd_ != readFd_) close(writeFd_);
+	}
+}
+
+bool JobServer::Open()
+{
+	using namespace std;
+
+	const char* env = getenv("MAKEFLAGS");
+
+	if(!env)
+	{
+		error_ = "no MAKEFLAGS";
+		return false;
+	}
+
+	string flags(env);
+	string value;
+
+	static const char* const keys[] = {
+		"--jobserver-auth=", "--jobserver-fds=",
+	};
+
+	for(size_t i = 0; i < sizeof(keys) / sizeof(keys[0]) && value.empty(); ++i)
+	{
+		string::size_type pos = flags.rfind(keys[i]);
+
+		if(pos == string::npos) continue;
+
+		pos += strlen(keys[i]);
+		value = flags.substr(pos, flags.find(' ', pos) - pos);
+	}
+
+	if(value.empty())
+	{
+		error_ = "no jobserver in MAKEFLAGS";
+		return false;
+	}
+
+	if(value.compare(0, 5, "fifo:") == 0)
+	{
+		readFd_ = writeFd_ = open(value.substr(5).c_str(), O_RDWR);
+
+		if(readFd_ < 0)
+		{
+			error_ = strerror(errno);
+			return false;
+		}
+
+		ownFds_ = true;
+		return true;
+	}
+
+	int readFd = -1;
+	int writeFd = -1;
+
+	if(sscanf(value.c_str(), "%d,%d", &readFd, &writeFd) != 2 ||
+		readFd < 0 || writeFd < 0)
+	{
+		error_ = "unknown jobserver " + value;
+		return false;
+	}
+
+	if(fcntl(readFd, F_GETFD) < 0 || fcntl(writeFd, F_GETFD) < 0)
+	{
+		error_ = "jobserver file descriptors are closed, "
+			"prefix the recipe with '+'";
+		return false;
+	}
+
+	readFd_ = readFd;
+	writeFd_ = writeFd;
+
+	return true;
+}
+
+bool JobServer::Acquire()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if(implicitFree_)
+		{
+			implicitFree_ = false;
+			return true;
+		}
+	}
+
+	if(readFd_ < 0)
+	{
+		return true;
+	}
+
+	for(;;)
+	{
+		char token;
+		ssize_t readBytes = read(readFd_, &token, 1);
+
+		if(readBytes == 1)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			tokens_.push_back(token);
+			return true;
+		}
+
+		if(readBytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			struct pollfd pfd = { readFd_, POLLIN, 0 };
+			poll(&pfd, 1, -1);
+			continue;
+		}
+
+		if(readBytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		return false;
+	}
+}
+
+void JobServer::Release()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if(tokens_.empty())
+	{
+		implicitFree_ = true;
+		return;
+	}
+
+	char token = tokens_.back();
+	tokens_.pop_back();
+
+	while(write(writeFd_, &token, 1) < 0 && errno == EINTR);
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_JOBSERVER_HPP_
+#define OCLC_JOBSERVER_HPP_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// client of the GNU make jobserver found in MAKEFLAGS
+// (--jobserver-auth=R,W, --jobserver-auth=fifo:PATH or --jobserver-fds=R,W).
+// the process owns one implicit token, every further concurrent job has to
+// hold a token read from the jobserver. without a jobserver Acquire()
+// always succeeds and concurrency is bounded by the caller.
+class JobServer
+{
+public:
+	JobServer();
+	~JobServer();
+
+	// returns false when make did not pass a usable jobserver
+	bool Open();
+	bool IsOpen() const { return readFd_ >= 0; }
+	const std::string& Error() const { return error_; }
+
+	// block until this thread may run one job, thread safe
+	bool Acquire();
+	void Release();
+
+private:
+	JobServer(const JobServer&);
+	JobServer& operator=(const JobServer&);
+
+	int readFd_;
+	int writeFd_;
+	bool ownFds_;
+	std::string error_;
+
+	std::mutex mutex_;
+	bool implicitFree_;
+	std::vector<char> tokens_;
+};
+
+}
+
+#endif
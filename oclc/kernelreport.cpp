@@ -0,0 +1,351 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "kernelreport.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace OCLT
+{
+
+namespace
+{
+
+struct KernelInfo
+{
+	std::string name;
+	cl_uint numArgs;
+	size_t workGroupSize;
+	size_t preferredMultiple;
+	cl_ulong localMemSize;
+	cl_ulong privateMemSize;
+
+	// occupancy estimate, see iEstimateOccupancy()
+	size_t groupsPerUnit;
+	size_t residentItems;
+	double occupancy;
+	const char* limitedBy;
+};
+
+struct DeviceReport
+{
+	size_t platform;
+	size_t device;
+	std::string name;
+	size_t binarySize;
+	cl_uint computeUnits;
+	cl_ulong localMemSize;
+	size_t maxWorkGroupSize;
+	cl_int error;
+	std::vector<KernelInfo> kernels;
+};
+
+std::string iKernelName(cl_kernel kernel)
+{
+	size_t size = 0;
+
+	if(clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, NULL, &size) || !size)
+	{
+		return std::string();
+	}
+
+	std::vector<char> name(size);
+
+	if(clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, size, &name[0], NULL))
+	{
+		return std::string();
+	}
+
+	return std::string(&name[0]);
+}
+
+// OpenCL has no query for what a compute unit holds at once, so the
+// device work-group limit stands in for it. work-groups of the kernel's
+// own limit (which drivers lower for kernels using many registers) are
+// packed onto a unit until they fill it or its local memory runs out.
+// every compute unit holds as many, a launch with fewer work-items than
+// the device total leaves units idle.
+void iEstimateOccupancy(const DeviceReport& device, KernelInfo& kernel)
+{
+	size_t capacity = std::max<size_t>(device.maxWorkGroupSize, 1);
+	size_t groupSize = std::max<size_t>(kernel.workGroupSize, 1);
+	size_t byItems = std::max<size_t>(capacity / groupSize, 1);
+	size_t byLocal = kernel.localMemSize ?
+		static_cast<size_t>(device.localMemSize / kernel.localMemSize) : byItems;
+
+	kernel.groupsPerUnit = std::min(byItems, byLocal);
+	kernel.residentItems = kernel.groupsPerUnit * groupSize *
+		std::max<size_t>(device.computeUnits, 1);
+	kernel.occupancy = std::min(1.0,
+		static_cast<double>(kernel.groupsPerUnit * groupSize) / capacity);
+	kernel.limitedBy = byLocal < byItems ? "local memory" :
+		(kernel.occupancy < 1.0 ? "work-group size" : "none");
+}
+
+cl_int iQueryKernels(const DeviceBinary& binary, DeviceReport& report)
+{
+	using namespace std;
+
+	cl_device_id device_id = binary.device_id;
+	cl_int errcode_ret;
+
+	cl_context context = clCreateContext(
+		NULL, 1, &device_id, NULL, NULL, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		return errcode_ret;
+	}
+
+	const unsigned char* data = binary.binary.empty() ? NULL : &binary.binary[0];
+	size_t size = binary.binary.size();
+	cl_int status;
+
+	cl_program program = clCreateProgramWithBinary(
+		context, 1, &device_id, &size, &data, &status, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		program = NULL;
+	}
+	else
+	{
+		errcode_ret = clBuildProgram(program, 1, &device_id, NULL, NULL, NULL);
+	}
+
+	cl_uint count = 0;
+	vector<cl_kernel> kernels;
+
+	if(!errcode_ret)
+	{
+		errcode_ret = clCreateKernelsInProgram(program, 0, NULL, &count);
+	}
+
+	if(!errcode_ret && count)
+	{
+		kernels.resize(count);
+		errcode_ret = clCreateKernelsInProgram(program, count, &kernels[0], NULL);
+
+		if(errcode_ret)
+		{
+			kernels.clear();
+		}
+	}
+
+	for(vector<cl_kernel>::const_iterator itr = kernels.begin();
+		itr != kernels.end(); ++itr)
+	{
+		KernelInfo info;
+		info.name = iKernelName(*itr);
+		info.numArgs = 0;
+		info.workGroupSize = 0;
+		info.preferredMultiple = 0;
+		info.localMemSize = 0;
+		info.privateMemSize = 0;
+
+		clGetKernelInfo(*itr, CL_KERNEL_NUM_ARGS,
+			sizeof(info.numArgs), &info.numArgs, NULL);
+		clGetKernelWorkGroupInfo(*itr, device_id, CL_KERNEL_WORK_GROUP_SIZE,
+			sizeof(info.workGroupSize), &info.workGroupSize, NULL);
+		clGetKernelWorkGroupInfo(*itr, device_id,
+			CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+			sizeof(info.preferredMultiple), &info.preferredMultiple, NULL);
+		clGetKernelWorkGroupInfo(*itr, device_id, CL_KERNEL_LOCAL_MEM_SIZE,
+			sizeof(info.localMemSize), &info.localMemSize, NULL);
+		clGetKernelWorkGroupInfo(*itr, device_id, CL_KERNEL_PRIVATE_MEM_SIZE,
+			sizeof(info.privateMemSize), &info.privateMemSize, NULL);
+
+		iEstimateOccupancy(report, info);
+		report.kernels.push_back(info);
+
+		clReleaseKernel(*itr);
+	}
+
+	if(program)
+	{
+		clReleaseProgram(program);
+	}
+
+	clReleaseContext(context);
+
+	return errcode_ret;
+}
+
+void iPrintText(std::ostream& out, const std::vector<DeviceReport>& reports)
+{
+	using namespace std;
+
+	for(vector<DeviceReport>::const_iterator dev = reports.begin();
+		dev != reports.end(); ++dev)
+	{
+		out << "platform " << dev->platform << " device " << dev->device <<
+			": " << dev->name << " (binary " << dev->binarySize << " bytes, " <<
+			dev->computeUnits << " compute units, " << dev->localMemSize <<
+			" bytes local memory, work-group " << dev->maxWorkGroupSize << ")" <<
+			endl;
+
+		if(dev->error)
+		{
+			out << "  error : " << GetErrorMessage(dev->error) << endl;
+			continue;
+		}
+
+		size_t width = 6;
+
+		for(vector<KernelInfo>::const_iterator itr = dev->kernels.begin();
+			itr != dev->kernels.end(); ++itr)
+		{
+			width = max(width, itr->name.size());
+		}
+
+		out << "  " << left << setw(width) << "kernel" << right <<
+			setw(7) << "wg" << setw(6) << "mult" << setw(9) << "local" <<
+			setw(9) << "private" << setw(8) << "groups" << setw(10) <<
+			"resident" << setw(11) << "occupancy" << "  limited by" << endl;
+
+		for(vector<KernelInfo>::const_iterator itr = dev->kernels.begin();
+			itr != dev->kernels.end(); ++itr)
+		{
+			out << "  " << left << setw(width) << itr->name << right <<
+				setw(7) << itr->workGroupSize << setw(6) <<
+				itr->preferredMultiple << setw(9) << itr->localMemSize <<
+				setw(9) << itr->privateMemSize << setw(8) <<
+				itr->groupsPerUnit << setw(10) << itr->residentItems <<
+				setw(10) << static_cast<int>(itr->occupancy * 100 + 0.5) << "%  " <<
+				itr->limitedBy << endl;
+		}
+	}
+}
+
+void iPrintJson(std::ostream& out, const std::vector<DeviceReport>& reports)
+{
+	using namespace std;
+
+	string json = "{\"devices\":[";
+
+	for(vector<DeviceReport>::const_iterator dev = reports.begin();
+		dev != reports.end(); ++dev)
+	{
+		ostringstream oss;
+		oss << (dev == reports.begin() ? "\n" : ",\n") <<
+			"{\"platform\":" << dev->platform << ",\"device\":" << dev->device <<
+			",\"name\":";
+		json += oss.str();
+		AppendJsonString(json, dev->name);
+
+		oss.str("");
+		oss << ",\"binarySize\":" << dev->binarySize <<
+			",\"computeUnits\":" << dev->computeUnits <<
+			",\"localMemSize\":" << dev->localMemSize <<
+			",\"maxWorkGroupSize\":" << dev->maxWorkGroupSize;
+		json += oss.str();
+
+		if(dev->error)
+		{
+			json += ",\"error\":";
+			AppendJsonString(json, GetErrorMessage(dev->error));
+		}
+
+		json += ",\"kernels\":[";
+
+		for(vector<KernelInfo>::const_iterator itr = dev->kernels.begin();
+			itr != dev->kernels.end(); ++itr)
+		{
+			json += itr == dev->kernels.begin() ? "\n" : ",\n";
+			json += "{\"name\":";
+			AppendJsonString(json, itr->name);
+
+			oss.str("");
+			oss << ",\"numArgs\":" << itr->numArgs <<
+				",\"workGroupSize\":" << itr->workGroupSize <<
+				",\"preferredWorkGroupSizeMultiple\":" << itr->preferredMultiple <<
+				",\"localMemSize\":" << itr->localMemSize <<
+				",\"privateMemSize\":" << itr->privateMemSize <<
+				",\"groupsPerComputeUnit\":" << itr->groupsPerUnit <<
+				",\"residentWorkItems\":" << itr->residentItems <<
+				",\"occupancy\":" << itr->occupancy << ",\"limitedBy\":\"" <<
+				itr->limitedBy << "\"}";
+			json += oss.str();
+		}
+
+		json += "]}";
+	}
+
+	json += "\n]}\n";
+	out << json;
+}
+
+}
+
+bool PrintKernelReport(std::ostream& out,
+	const std::vector<PlatformBuild>& results, bool json)
+{
+	using namespace std;
+
+	vector<DeviceReport> reports;
+	bool succeeded = true;
+
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		if(results[i].error) continue;
+
+		for(size_t j = 0; j < results[i].binaries.size(); ++j)
+		{
+			const DeviceBinary& binary = results[i].binaries[j];
+			cl_device_id device_id = binary.device_id;
+
+			reports.push_back(DeviceReport());
+
+			DeviceReport& report = reports.back();
+			report.platform = i;
+			report.device = j;
+			report.name = GetDeviceInfoString(device_id, CL_DEVICE_NAME);
+			report.binarySize = binary.binary.size();
+			report.computeUnits = GetDeviceInfoValue<cl_uint>(
+				device_id, CL_DEVICE_MAX_COMPUTE_UNITS);
+			report.localMemSize = GetDeviceInfoValue<cl_ulong>(
+				device_id, CL_DEVICE_LOCAL_MEM_SIZE);
+			report.maxWorkGroupSize = GetDeviceInfoValue<size_t>(
+				device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE);
+			report.error = iQueryKernels(binary, report);
+
+			if(report.error)
+			{
+				succeeded = false;
+			}
+		}
+	}
+
+	if(json)
+	{
+		iPrintJson(out, reports);
+	}
+	else
+	{
+		iPrintText(out, reports);
+	}
+
+	return succeeded;
+}
+
+}
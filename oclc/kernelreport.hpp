@@ -0,0 +1,40 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_KERNELREPORT_HPP_
+#define OCLC_KERNELREPORT_HPP_
+
+#include "build.hpp"
+
+#include <ostream>
+#include <vector>
+
+namespace OCLT
+{
+
+// load every binary of the successful results on its device, create its
+// kernels with clCreateKernelsInProgram and print per kernel and device
+// the work-group size and its preferred multiple, local and private
+// memory use, the binary size and an occupancy estimate, as text or as
+// JSON. returns false when a binary could not be loaded, which is
+// reported as an error of its device.
+bool PrintKernelReport(std::ostream& out,
+	const std::vector<PlatformBuild>& results, bool json);
+
+}
+
+#endif
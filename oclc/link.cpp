@@ -0,0 +1,470 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "link.hpp"
+#include "build.hpp"
+#include "clx.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+#include "includes.hpp"
+#include "kernelreport.hpp"
+#include "sha256.hpp"
+#include "sources.hpp"
+#include "trace.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace OCLT
+{
+
+namespace
+{
+
+// an input file, a source compiled to objects or a library
+struct LinkUnit
+{
+	LinkUnit() : library(false) {}
+
+	std::string path;
+	bool library;
+
+	// source units
+	SourceFiles files;
+	IncludeScan scan;
+
+	// library units
+	ClxFile clx;
+
+	// CacheDigest() of a source, or sha256 of a library file
+	std::string digest;
+};
+
+struct PlatformLink
+{
+	PlatformLink() : compiled(0), cached(0), linkCached(false) {}
+
+	PlatformBuild result;
+	size_t compiled;
+	size_t cached;
+	bool linkCached;
+};
+
+class Linker
+{
+public:
+	Linker(const Options& opts, CompileCache& cache)
+		: opts_(opts), cache_(cache)
+	{
+	}
+
+	~Linker();
+
+	bool Load();
+	void Link(cl_platform_id platform_id, PlatformLink& link);
+
+	const std::vector<LinkUnit*>& Units() const { return units_; }
+
+private:
+	bool LoadLibrary(LinkUnit& unit, const PlatformContext& context,
+		PlatformBuild& result) const;
+
+	std::string LinkOptions() const;
+	std::string LinkDigest() const;
+
+	const Options& opts_;
+	CompileCache& cache_;
+	std::vector<LinkUnit*> units_;
+};
+
+// cache keys of objects and linked programs never meet those of builds
+const char iCompileKey[] = "oclc-compile\n";
+const char iLinkKey[] = "oclc-link\n";
+
+Linker::~Linker()
+{
+	for(std::vector<LinkUnit*>::iterator itr = units_.begin();
+		itr != units_.end(); ++itr)
+	{
+		delete *itr;
+	}
+}
+
+bool Linker::Load()
+{
+	using namespace std;
+
+	for(vector<string>::const_iterator itr = opts_.infiles.begin();
+		itr != opts_.infiles.end(); ++itr)
+	{
+		LinkUnit* unit = new LinkUnit;
+		units_.push_back(unit);
+		unit->path = *itr;
+
+		TraceSpan span("load source", *itr);
+
+		if(!unit->files.Add(*itr))
+		{
+			cerr << strerror(errno) << ": " << *itr << endl;
+			return false;
+		}
+
+		const SourceText& text = unit->files.Texts()[0];
+		unit->library = ClxFile::IsClx(
+			reinterpret_cast<const unsigned char*>(text.data), text.size);
+
+		if(unit->library)
+		{
+			if(!unit->clx.Open(*itr))
+			{
+				cerr << unit->clx.Error() << ": " << *itr << endl;
+				return false;
+			}
+
+			Sha256 sha;
+			sha.Update(text.data, text.size);
+			unit->digest = sha.HexDigest();
+			unit->scan.files.push_back(*itr);
+
+			continue;
+		}
+
+		if(!ScanIncludes(vector<string>(1, *itr), unit->files.Texts(),
+			opts_.includeDirs, unit->scan))
+		{
+			cerr << strerror(errno) << ": " << unit->scan.files.back() << endl;
+			return false;
+		}
+
+		unit->digest = CacheDigest(unit->scan);
+	}
+
+	return true;
+}
+
+std::string Linker::LinkOptions() const
+{
+	std::string options = opts_.linkOptions;
+
+	if(opts_.createLibrary)
+	{
+		options += options.empty() ? "-create-library" : " -create-library";
+	}
+
+	return options;
+}
+
+std::string Linker::LinkDigest() const
+{
+	Sha256 sha;
+
+	for(std::vector<LinkUnit*>::const_iterator itr = units_.begin();
+		itr != units_.end(); ++itr)
+	{
+		// a unit which can not be cached, nor can the program
+		if((*itr)->digest.empty())
+		{
+			return std::string();
+		}
+
+		sha.Update((*itr)->digest);
+		sha.Update("\n");
+	}
+
+	// objects depend on compile options, so does the linked program
+	sha.Update(opts_.buildOptions);
+
+	return sha.HexDigest();
+}
+
+bool Linker::LoadLibrary(LinkUnit& unit, const PlatformContext& context,
+	PlatformBuild& result) const
+{
+	result.platform_id = context.platform_id;
+	result.error = CL_SUCCESS;
+	result.binaries.resize(context.device_ids.size());
+
+	for(size_t i = 0; i < context.device_ids.size(); ++i)
+	{
+		int index = unit.clx.Find(GetDeviceFingerprint(context.device_ids[i]));
+
+		if(index < 0)
+		{
+			result.error = CL_INVALID_BINARY;
+			result.log = unit.path + ": no binary for " +
+				GetDeviceInfoString(context.device_ids[i], CL_DEVICE_NAME) + "\n";
+			return false;
+		}
+
+		result.binaries[i].device_id = context.device_ids[i];
+
+		if(!unit.clx.Extract(index, result.binaries[i].binary))
+		{
+			result.error = CL_INVALID_BINARY;
+			result.log = unit.path + ": broken binary for " +
+				GetDeviceInfoString(context.device_ids[i], CL_DEVICE_NAME) + "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Linker::Link(cl_platform_id platform_id, PlatformLink& link)
+{
+	using namespace std;
+
+	PlatformBuild& result = link.result;
+	result.platform_id = platform_id;
+
+	PlatformContext context;
+	context.platform_id = platform_id;
+
+	if( (result.error = GetDeviceIDs(platform_id, context.device_ids)) )
+	{
+		return;
+	}
+
+	if(context.device_ids.empty())
+	{
+		result.error = CL_DEVICE_NOT_FOUND;
+		return;
+	}
+
+	// without -a only the first device is built, as oclc does otherwise
+	if(!opts_.all)
+	{
+		context.device_ids.resize(1);
+	}
+
+	string linkDigest = LinkDigest();
+	string linkOptions = LinkOptions();
+
+	if(cache_.LoadPlatform(linkDigest, iLinkKey + linkOptions,
+		platform_id, context.device_ids, result))
+	{
+		link.linkCached = true;
+		link.cached = units_.size();
+		return;
+	}
+
+	{
+		TraceSpan span("clCreateContext");
+
+		context.context = clCreateContext(NULL, context.device_ids.size(),
+			&context.device_ids[0], NULL, NULL, &result.error);
+	}
+
+	if(result.error)
+	{
+		return;
+	}
+
+	vector<PlatformBuild> objects(units_.size());
+	vector<const PlatformBuild*> inputs;
+
+	for(size_t i = 0; i < units_.size(); ++i)
+	{
+		LinkUnit& unit = *units_[i];
+		PlatformBuild& object = objects[i];
+
+		if(unit.library)
+		{
+			LoadLibrary(unit, context, object);
+		}
+		else if(cache_.LoadPlatform(unit.digest, iCompileKey + opts_.buildOptions,
+			platform_id, context.device_ids, object))
+		{
+			++link.cached;
+		}
+		else
+		{
+			CompileProgram(context, unit.files.Texts()[0],
+				CompileOptions(opts_.buildOptions, unit.scan), object);
+			cache_.StorePlatform(unit.digest, iCompileKey + opts_.buildOptions,
+				object);
+			++link.compiled;
+		}
+
+		if(!object.log.empty())
+		{
+			result.log += unit.path + ":\n" + object.log;
+		}
+
+		if(object.error && !result.error)
+		{
+			result.error = object.error;
+		}
+
+		inputs.push_back(&object);
+	}
+
+	if(!result.error)
+	{
+		string log;
+		swap(log, result.log);
+
+		LinkProgram(context, inputs, linkOptions, result);
+		result.log = log + result.log;
+
+		cache_.StorePlatform(linkDigest, iLinkKey + linkOptions, result);
+	}
+
+	ReleasePlatformContext(context);
+}
+
+}
+
+int RunSeparateCompile(const Options& opts, CompileCache& cache)
+{
+	using namespace std;
+
+	if(opts.infiles.empty())
+	{
+		cerr << "no input file" << endl;
+		return EXIT_FAILURE;
+	}
+
+	Linker linker(opts, cache);
+
+	if(!linker.Load())
+	{
+		return EXIT_FAILURE;
+	}
+
+	vector<cl_platform_id> platform_ids;
+
+	if(cl_int err = GetPlatformIDs(platform_ids))
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(platform_ids.empty())
+	{
+		cerr << "no platform on system" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!opts.all)
+	{
+		platform_ids.resize(1);
+	}
+
+	vector<PlatformLink> links(platform_ids.size());
+	vector<thread> threads;
+
+	for(size_t i = 0; i < platform_ids.size(); ++i)
+	{
+		threads.push_back(thread([&, i]()
+		{
+			ostringstream name;
+			name << "platform " << i;
+			SetTraceThreadName(name.str());
+
+			linker.Link(platform_ids[i], links[i]);
+		}));
+	}
+
+	for(vector<thread>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+	{
+		itr->join();
+	}
+
+	int status = EXIT_SUCCESS;
+	vector<PlatformBuild> results(links.size());
+
+	for(size_t i = 0; i < links.size(); ++i)
+	{
+		PlatformBuild& result = links[i].result;
+
+		if(!result.log.empty())
+		{
+			cout << result.log << endl;
+		}
+
+		if(result.error)
+		{
+			cerr << "error : " << GetErrorMessage(result.error) << endl;
+			status = EXIT_FAILURE;
+		}
+
+		if(opts.verbose)
+		{
+			cout << "platform " << i << ": " << links[i].compiled <<
+				" compiled, " << links[i].cached << " cached" <<
+				(links[i].linkCached ? ", link cached" : "") << endl;
+		}
+
+		swap(results[i], result);
+	}
+
+	if(!opts.all && status)
+	{
+		return status;
+	}
+
+	if(!SaveBinaries(
+		opts.outfile, results, opts.raw, opts.all, opts.compress))
+	{
+		cerr << strerror(errno) << ": " << opts.outfile << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(opts.depfile && status == EXIT_SUCCESS)
+	{
+		vector<string> files;
+		const vector<LinkUnit*>& units = linker.Units();
+
+		for(size_t i = 0; i < units.size(); ++i)
+		{
+			files.insert(files.end(),
+				units[i]->scan.files.begin(), units[i]->scan.files.end());
+		}
+
+		string depfile = opts.depfileOut.empty() ?
+			DefaultDepfile(opts.outfile) : opts.depfileOut;
+
+		if(!WriteDepfile(depfile, opts.outfile, files))
+		{
+			cerr << strerror(errno) << ": " << depfile << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// kernels can not be created from a library
+	if(opts.kernelReport != Options::KERNEL_REPORT_NONE &&
+		!opts.createLibrary && status == EXIT_SUCCESS)
+	{
+		TraceSpan span("kernel report");
+
+		if(!PrintKernelReport(cout, results,
+			opts.kernelReport == Options::KERNEL_REPORT_JSON))
+		{
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return status;
+}
+
+}
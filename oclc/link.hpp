@@ -0,0 +1,37 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_LINK_HPP_
+#define OCLC_LINK_HPP_
+
+#include "cache.hpp"
+#include "options.hpp"
+
+namespace OCLT
+{
+
+// compile every input file on its own with clCompileProgram and link the
+// objects with clLinkProgram, into a library with opts.createLibrary.
+// objects of unchanged files and the linked result are reused from the
+// cache, so only edited files are compiled again. clx inputs are
+// libraries built before, linked in as they are.
+// returns process exit status.
+int RunSeparateCompile(const Options& opts, CompileCache& cache);
+
+}
+
+#endif
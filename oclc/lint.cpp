@@ -0,0 +1,1454 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "lint.hpp"
+#include "file.hpp"
+#include "includes.hpp"
+#include "sources.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace OCLT
+{
+
+namespace
+{
+
+struct Token
+{
+	std::string text;
+	size_t offset;
+};
+
+typedef std::map< std::string, std::vector<std::string> > MacroMap;
+
+struct KernelParam
+{
+	KernelParam() : global(false), pointer(false), isConst(false), restrict(false) {}
+
+	std::string name;
+	std::string type;  // scalar element type, empty when unknown
+	bool global;
+	bool pointer;
+	bool isConst;
+	bool restrict;
+};
+
+// token indices of one kernel definition
+struct KernelDef
+{
+	std::string name;
+	size_t nameToken;
+	size_t attrBegin;
+	size_t bodyBegin;  // after '{'
+	size_t bodyEnd;    // at '}'
+	std::vector<KernelParam> params;
+};
+
+// text offsets of a conditional block which is only compiled when one of
+// the extensions is defined, #ifdef cl_khr_fp64 or #if defined(cl_khr_fp16)
+struct ExtensionGuard
+{
+	size_t begin;
+	size_t end;
+	std::vector<std::string> extensions;
+};
+
+// one source file, comments, literals and preprocessor lines blanked
+struct LintFile
+{
+	std::string path;
+	std::string text;
+	std::vector<size_t> lineStarts;
+	std::vector<Token> tokens;
+	std::vector<ExtensionGuard> guards;
+
+	size_t Line(size_t token) const
+	{
+		return std::upper_bound(lineStarts.begin(), lineStarts.end(),
+			tokens[token].offset) - lineStarts.begin();
+	}
+};
+
+const char* const iTypeNames[] = {
+	"char", "short", "int", "long", "float", "double", "half"};
+const size_t iTypeSizes[] = {1, 2, 4, 8, 4, 8, 2};
+
+// index of the element type of an OpenCL C type name in iTypeNames and
+// its vector width, false for other names
+bool iTypeInfo(const std::string& name, size_t& type, size_t& width)
+{
+	std::string str = name;
+
+	if(str == "unsigned" || str == "signed")
+	{
+		str = "int";
+	}
+
+	if(str.size() > 1 && str[0] == 'u' && str.compare(0, 5, "uchar") &&
+		str.compare(0, 6, "ushort") && str.compare(0, 4, "uint") &&
+		str.compare(0, 5, "ulong"))
+	{
+		return false;
+	}
+
+	if(str[0] == 'u')
+	{
+		str.erase(0, 1);
+	}
+
+	for(type = 0; type < sizeof(iTypeNames) / sizeof(iTypeNames[0]); ++type)
+	{
+		size_t len = strlen(iTypeNames[type]);
+
+		if(str.compare(0, len, iTypeNames[type]))
+		{
+			continue;
+		}
+
+		std::string suffix = str.substr(len);
+		width = suffix.empty() ? 1 : strtoul(suffix.c_str(), NULL, 10);
+
+		return suffix.empty() || width == 2 || width == 3 || width == 4 ||
+			width == 8 || width == 16;
+	}
+
+	return false;
+}
+
+bool iIsIdentifier(const std::string& str)
+{
+	return !str.empty() && (isalpha(static_cast<unsigned char>(str[0])) || str[0] == '_');
+}
+
+bool iIsAssignment(const std::string& str)
+{
+	static const char* const ops[] = {"=", "+=", "-=", "*=", "/=", "%=",
+		"&=", "|=", "^=", "<<=", ">>=", "++", "--"};
+
+	for(size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i)
+	{
+		if(str == ops[i])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// blank comments and string and character literals, keep newlines
+void iBlankComments(std::string& text)
+{
+	for(size_t i = 0; i < text.size(); )
+	{
+		char c = text[i];
+		char next = i + 1 < text.size() ? text[i + 1] : '\0';
+
+		if(c == '/' && next == '/')
+		{
+			while(i < text.size() && text[i] != '\n')
+			{
+				text[i++] = ' ';
+			}
+		}
+		else if(c == '/' && next == '*')
+		{
+			size_t end = text.find("*/", i + 2);
+			end = end == std::string::npos ? text.size() : end + 2;
+
+			for(; i < end; ++i)
+			{
+				if(text[i] != '\n') text[i] = ' ';
+			}
+		}
+		else if(c == '"' || c == '\'')
+		{
+			text[i++] = ' ';
+
+			while(i < text.size() && text[i] != c && text[i] != '\n')
+			{
+				if(text[i] == '\\' && i + 1 < text.size() && text[i + 1] != '\n')
+				{
+					text[i++] = ' ';
+				}
+
+				text[i++] = ' ';
+			}
+
+			if(i < text.size() && text[i] == c)
+			{
+				text[i++] = ' ';
+			}
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void iTokenize(const std::string& text, std::vector<Token>& tokens)
+{
+	static const char* const puncts[] = {"<<=", ">>=", "==", "!=", "<=", ">=",
+		"+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "++", "--", "&&", "||",
+		"<<", ">>", "->"};
+
+	for(size_t i = 0; i < text.size(); )
+	{
+		unsigned char c = text[i];
+		Token token;
+		token.offset = i;
+
+		if(isspace(c))
+		{
+			++i;
+			continue;
+		}
+
+		if(isalpha(c) || c == '_')
+		{
+			while(i < text.size() && (isalnum(static_cast<unsigned char>(text[i])) ||
+				text[i] == '_'))
+			{
+				++i;
+			}
+		}
+		else if(isdigit(c) || (c == '.' && i + 1 < text.size() &&
+			isdigit(static_cast<unsigned char>(text[i + 1]))))
+		{
+			while(i < text.size() && (isalnum(static_cast<unsigned char>(text[i])) ||
+				text[i] == '.' || text[i] == '_'))
+			{
+				char e = text[i++];
+
+				if((e == 'e' || e == 'E') && i < text.size() &&
+					(text[i] == '+' || text[i] == '-'))
+				{
+					++i;
+				}
+			}
+		}
+		else
+		{
+			size_t len = 1;
+
+			for(size_t p = 0; p < sizeof(puncts) / sizeof(puncts[0]); ++p)
+			{
+				if(!text.compare(i, strlen(puncts[p]), puncts[p]))
+				{
+					len = strlen(puncts[p]);
+					break;
+				}
+			}
+
+			i += len;
+		}
+
+		token.text = text.substr(token.offset, i - token.offset);
+		tokens.push_back(token);
+	}
+}
+
+// the extension macros of a condition of defined(cl_...) terms joined by
+// ||, false for other conditions
+bool iExtensionCondition(const std::vector<Token>& tokens, size_t begin,
+	std::vector<std::string>& extensions)
+{
+	std::vector<std::string> names;
+
+	for(size_t t = begin; t < tokens.size(); )
+	{
+		if(tokens[t].text != "defined" || t + 1 >= tokens.size())
+		{
+			return false;
+		}
+
+		bool parens = tokens[t + 1].text == "(";
+		size_t name = t + (parens ? 2 : 1);
+
+		if(name >= tokens.size() || tokens[name].text.compare(0, 3, "cl_") ||
+			(parens && (name + 1 >= tokens.size() || tokens[name + 1].text != ")")))
+		{
+			return false;
+		}
+
+		names.push_back(tokens[name].text);
+		t = name + (parens ? 2 : 1);
+
+		if(t < tokens.size() && (tokens[t].text != "||" || ++t == tokens.size()))
+		{
+			return false;
+		}
+	}
+
+	extensions.swap(names);
+	return !extensions.empty();
+}
+
+// blank preprocessor lines, object-like #define values go to macros and
+// blocks under extension conditions to guards
+void iPreprocess(std::string& text, MacroMap& macros,
+	std::vector<ExtensionGuard>& guards)
+{
+	// the open conditionals, extensions of the current branch and of its
+	// #else
+	struct Branch
+	{
+		ExtensionGuard guard;
+		std::vector<std::string> otherwise;
+	};
+
+	std::vector<Branch> open;
+	bool lineStart = true;
+
+	for(size_t i = 0; i < text.size(); ++i)
+	{
+		if(text[i] == '\n')
+		{
+			lineStart = true;
+			continue;
+		}
+
+		if(isspace(static_cast<unsigned char>(text[i])))
+		{
+			continue;
+		}
+
+		if(!lineStart || text[i] != '#')
+		{
+			lineStart = false;
+			continue;
+		}
+
+		size_t start = i;
+		std::string directive;
+
+		for(; i < text.size() && (text[i] != '\n' || text[i - 1] == '\\'); ++i)
+		{
+			directive += text[i] == '\\' || text[i] == '\n' ? ' ' : text[i];
+
+			if(text[i] != '\n') text[i] = ' ';
+		}
+
+		--i;
+
+		std::vector<Token> tokens;
+		iTokenize(directive, tokens);
+
+		if(tokens.size() >= 3 && tokens[1].text == "define" &&
+			iIsIdentifier(tokens[2].text) &&
+			(tokens.size() == 3 || tokens[3].text != "(" ||
+				tokens[3].offset != tokens[2].offset + tokens[2].text.size()))
+		{
+			std::vector<std::string>& value = macros[tokens[2].text];
+			value.clear();
+
+			for(size_t t = 3; t < tokens.size(); ++t)
+			{
+				value.push_back(tokens[t].text);
+			}
+		}
+
+		const std::string keyword = tokens.size() >= 2 ? tokens[1].text : std::string();
+
+		if(keyword == "if" || keyword == "ifdef" || keyword == "ifndef")
+		{
+			Branch branch;
+			branch.guard.begin = i;
+
+			if(keyword == "if")
+			{
+				iExtensionCondition(tokens, 2, branch.guard.extensions);
+			}
+			else if(tokens.size() == 3 && !tokens[2].text.compare(0, 3, "cl_"))
+			{
+				(keyword == "ifdef" ? branch.guard.extensions : branch.otherwise).push_back(
+					tokens[2].text);
+			}
+
+			open.push_back(branch);
+		}
+		else if(!open.empty() &&
+			(keyword == "elif" || keyword == "else" || keyword == "endif"))
+		{
+			Branch& branch = open.back();
+
+			if(!branch.guard.extensions.empty())
+			{
+				branch.guard.end = start;
+				guards.push_back(branch.guard);
+			}
+
+			if(keyword == "endif")
+			{
+				open.pop_back();
+				continue;
+			}
+
+			branch.guard.begin = i;
+			branch.guard.extensions.clear();
+
+			if(keyword == "elif")
+			{
+				iExtensionCondition(tokens, 2, branch.guard.extensions);
+			}
+			else
+			{
+				branch.guard.extensions.swap(branch.otherwise);
+			}
+
+			branch.otherwise.clear();
+		}
+	}
+
+	// unterminated conditionals run to the end
+	for(size_t b = 0; b < open.size(); ++b)
+	{
+		if(!open[b].guard.extensions.empty())
+		{
+			open[b].guard.end = text.size();
+			guards.push_back(open[b].guard);
+		}
+	}
+}
+
+// -D options of build options
+void iOptionMacros(const std::string& options, MacroMap& macros)
+{
+	std::istringstream str(options);
+	std::string word;
+
+	while(str >> word)
+	{
+		if(word == "-D" && !(str >> word))
+		{
+			break;
+		}
+		else if(!word.compare(0, 2, "-D"))
+		{
+			word.erase(0, 2);
+		}
+		else
+		{
+			continue;
+		}
+
+		size_t eq = word.find('=');
+		std::vector<Token> tokens;
+		iTokenize(eq == std::string::npos ? "1" : word.substr(eq + 1), tokens);
+
+		std::vector<std::string>& value = macros[word.substr(0, eq)];
+		value.clear();
+
+		for(size_t t = 0; t < tokens.size(); ++t)
+		{
+			value.push_back(tokens[t].text);
+		}
+	}
+}
+
+// integer constant expressions of + - * / % << >> and parentheses over
+// numbers and macros
+class iEvaluator
+{
+public:
+	iEvaluator(const MacroMap& macros) : macros_(macros), pos_(0) {}
+
+	bool Evaluate(const std::vector<Token>& tokens, size_t begin, size_t end,
+		long long& value)
+	{
+		tokens_.clear();
+		pos_ = 0;
+
+		for(size_t i = begin; i < end; ++i)
+		{
+			if(!Expand(tokens[i].text, 0))
+			{
+				return false;
+			}
+		}
+
+		return Shift(value) && pos_ == tokens_.size();
+	}
+
+private:
+	bool Expand(const std::string& token, int depth)
+	{
+		MacroMap::const_iterator itr = macros_.find(token);
+
+		if(itr == macros_.end())
+		{
+			tokens_.push_back(token);
+			return true;
+		}
+
+		if(depth > 16)
+		{
+			return false;
+		}
+
+		for(size_t i = 0; i < itr->second.size(); ++i)
+		{
+			if(!Expand(itr->second[i], depth + 1))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool Accept(const char* op)
+	{
+		if(pos_ < tokens_.size() && tokens_[pos_] == op)
+		{
+			++pos_;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool Shift(long long& value)
+	{
+		if(!Sum(value)) return false;
+
+		for(;;)
+		{
+			long long rhs;
+			bool left = Accept("<<");
+
+			if(!left && !Accept(">>")) return true;
+			if(!Sum(rhs) || rhs < 0 || rhs > 62) return false;
+
+			value = left ? value << rhs : value >> rhs;
+		}
+	}
+
+	bool Sum(long long& value)
+	{
+		if(!Product(value)) return false;
+
+		for(;;)
+		{
+			long long rhs;
+			bool plus = Accept("+");
+
+			if(!plus && !Accept("-")) return true;
+			if(!Product(rhs)) return false;
+
+			value = plus ? value + rhs : value - rhs;
+		}
+	}
+
+	bool Product(long long& value)
+	{
+		if(!Factor(value)) return false;
+
+		for(;;)
+		{
+			long long rhs;
+			char op = Accept("*") ? '*' : Accept("/") ? '/' : Accept("%") ? '%' : 0;
+
+			if(!op) return true;
+			if(!Factor(rhs) || (op != '*' && !rhs)) return false;
+
+			value = op == '*' ? value * rhs : op == '/' ? value / rhs : value % rhs;
+		}
+	}
+
+	bool Factor(long long& value)
+	{
+		if(Accept("("))
+		{
+			return Shift(value) && Accept(")");
+		}
+
+		if(Accept("-"))
+		{
+			bool ok = Factor(value);
+			value = -value;
+			return ok;
+		}
+
+		if(pos_ == tokens_.size() ||
+			!isdigit(static_cast<unsigned char>(tokens_[pos_][0])))
+		{
+			return false;
+		}
+
+		char* end;
+		value = strtoll(tokens_[pos_].c_str(), &end, 0);
+
+		while(*end == 'u' || *end == 'U' || *end == 'l' || *end == 'L')
+		{
+			++end;
+		}
+
+		++pos_;
+		return !*end;
+	}
+
+	const MacroMap& macros_;
+	std::vector<std::string> tokens_;
+	size_t pos_;
+};
+
+// index of the bracket closing the one at open, or end
+size_t iMatching(const std::vector<Token>& tokens, size_t open, size_t end)
+{
+	const std::string& left = tokens[open].text;
+	const char* right = left == "(" ? ")" : left == "[" ? "]" : "}";
+	int depth = 0;
+
+	for(size_t i = open; i < end; ++i)
+	{
+		if(tokens[i].text == left)
+		{
+			++depth;
+		}
+		else if(tokens[i].text == right && !--depth)
+		{
+			return i;
+		}
+	}
+
+	return end;
+}
+
+size_t iSkipAttributes(const std::vector<Token>& tokens, size_t i)
+{
+	while(i + 1 < tokens.size() && tokens[i].text == "__attribute__" &&
+		tokens[i + 1].text == "(")
+	{
+		i = iMatching(tokens, i + 1, tokens.size()) + 1;
+	}
+
+	return i;
+}
+
+void iParseParam(const std::vector<Token>& tokens, size_t begin, size_t end,
+	KernelParam& param)
+{
+	for(size_t i = begin; i < end; ++i)
+	{
+		const std::string& text = tokens[i].text;
+		size_t type, width;
+
+		if(text == "__global" || text == "global")
+		{
+			param.global = true;
+		}
+		else if(text == "*")
+		{
+			param.pointer = true;
+		}
+		else if((text == "const" || text == "__const") && !param.pointer)
+		{
+			param.isConst = true;
+		}
+		else if(text == "restrict" || text == "__restrict" || text == "__restrict__")
+		{
+			param.restrict = true;
+		}
+		else if(param.type.empty() && !param.pointer &&
+			iTypeInfo(text, type, width) && width == 1)
+		{
+			param.type = iTypeNames[type];
+		}
+
+		if(iIsIdentifier(text))
+		{
+			param.name = text;
+		}
+	}
+}
+
+void iFindKernels(const LintFile& file, std::vector<KernelDef>& kernels)
+{
+	const std::vector<Token>& tokens = file.tokens;
+	size_t statement = 0;
+
+	for(size_t i = 0; i < tokens.size(); ++i)
+	{
+		const std::string& text = tokens[i].text;
+
+		if(text == ";" || text == "}")
+		{
+			statement = i + 1;
+			continue;
+		}
+
+		if(text != "__kernel" && text != "kernel")
+		{
+			continue;
+		}
+
+		size_t j = iSkipAttributes(tokens, i + 1);
+
+		if(j >= tokens.size() || tokens[j].text != "void")
+		{
+			continue;
+		}
+
+		j = iSkipAttributes(tokens, j + 1);
+
+		if(j + 1 >= tokens.size() || !iIsIdentifier(tokens[j].text) ||
+			tokens[j + 1].text != "(")
+		{
+			continue;
+		}
+
+		KernelDef kernel;
+		kernel.name = tokens[j].text;
+		kernel.nameToken = j;
+		kernel.attrBegin = statement;
+
+		size_t paramsEnd = iMatching(tokens, j + 1, tokens.size());
+		size_t body = iSkipAttributes(tokens, paramsEnd + 1);
+
+		if(body >= tokens.size() || tokens[body].text != "{")
+		{
+			continue;
+		}
+
+		kernel.bodyBegin = body + 1;
+		kernel.bodyEnd = iMatching(tokens, body, tokens.size());
+
+		for(size_t p = j + 2; p < paramsEnd; )
+		{
+			size_t q = p;
+			int depth = 0;
+
+			for(; q < paramsEnd && (depth || tokens[q].text != ","); ++q)
+			{
+				if(tokens[q].text == "(") ++depth;
+				if(tokens[q].text == ")") --depth;
+			}
+
+			KernelParam param;
+			iParseParam(tokens, p, q, param);
+
+			if(!param.name.empty() && param.name != "void")
+			{
+				kernel.params.push_back(param);
+			}
+
+			p = q + 1;
+		}
+
+		kernels.push_back(kernel);
+		i = kernel.bodyEnd;
+		statement = i + 1;
+	}
+}
+
+class iLinter
+{
+public:
+	iLinter(const MacroMap& macros,
+		const std::vector<const DeviceCapabilities*>& devices,
+		std::vector<LintWarning>& warnings)
+		: macros_(macros), devices_(devices), warnings_(warnings)
+	{
+	}
+
+	void Lint(const LintFile& file)
+	{
+		file_ = &file;
+
+		CheckDouble();
+
+		std::vector<KernelDef> kernels;
+		iFindKernels(file, kernels);
+
+		for(size_t i = 0; i < kernels.size(); ++i)
+		{
+			CheckPointers(kernels[i]);
+			CheckWorkGroupSize(kernels[i]);
+			CheckLocalMemory(kernels[i]);
+			CheckVectors(kernels[i]);
+			CheckStrides(kernels[i]);
+		}
+	}
+
+private:
+	void Warn(size_t token, const std::string& message)
+	{
+		LintWarning warning;
+		warning.file = file_->path;
+		warning.line = file_->Line(token);
+		warning.message = message;
+
+		for(size_t i = 0; i < warnings_.size(); ++i)
+		{
+			if(warnings_[i].file == warning.file && warnings_[i].line == warning.line &&
+				warnings_[i].message == message)
+			{
+				return;
+			}
+		}
+
+		warnings_.push_back(warning);
+	}
+
+	const std::string& Text(size_t token) const
+	{
+		return file_->tokens[token].text;
+	}
+
+	static bool HasFp64(const DeviceCapabilities& device)
+	{
+		return device.extensions.find("cl_khr_fp64") != std::string::npos ||
+			device.extensions.find("cl_amd_fp64") != std::string::npos;
+	}
+
+	// false when token is in a block under an extension condition the
+	// device does not define
+	bool IsCompiled(size_t token, const DeviceCapabilities& device) const
+	{
+		size_t offset = file_->tokens[token].offset;
+
+		for(size_t g = 0; g < file_->guards.size(); ++g)
+		{
+			const ExtensionGuard& guard = file_->guards[g];
+
+			if(offset < guard.begin || offset >= guard.end)
+			{
+				continue;
+			}
+
+			bool defined = false;
+
+			for(size_t e = 0; e < guard.extensions.size() && !defined; ++e)
+			{
+				defined = device.extensions.find(guard.extensions[e]) != std::string::npos;
+			}
+
+			if(!defined)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void CheckDouble()
+	{
+		for(size_t d = 0; d < devices_.size(); ++d)
+		{
+			if(HasFp64(*devices_[d]))
+			{
+				continue;
+			}
+
+			for(size_t i = 0; i < file_->tokens.size(); ++i)
+			{
+				size_t type, width;
+
+				if(iTypeInfo(Text(i), type, width) && !strcmp(iTypeNames[type], "double") &&
+					IsCompiled(i, *devices_[d]))
+				{
+					Warn(i, "double used, " + devices_[d]->name +
+						" has no fp64 support (cl_khr_fp64)");
+				}
+			}
+		}
+	}
+
+	// the innermost call around token, empty when there is none
+	std::string EnclosingCall(const KernelDef& kernel, size_t token) const
+	{
+		int depth = 0;
+
+		for(size_t i = token; i-- > kernel.bodyBegin; )
+		{
+			if(Text(i) == ")") ++depth;
+			else if(Text(i) == "(" && depth) --depth;
+			else if(Text(i) == "(") return iIsIdentifier(Text(i - 1)) ? Text(i - 1) : "";
+			else if(Text(i) == ";" || Text(i) == "{") return "";
+		}
+
+		return "";
+	}
+
+	// no use of the pointer param could write through it
+	bool IsReadOnly(const KernelDef& kernel, const std::string& name) const
+	{
+		for(size_t i = kernel.bodyBegin; i < kernel.bodyEnd; ++i)
+		{
+			if(Text(i) != name)
+			{
+				continue;
+			}
+
+			const std::string& prev = Text(i - 1);
+
+			if(Text(i + 1) == "[")
+			{
+				size_t close = iMatching(file_->tokens, i + 1, kernel.bodyEnd);
+
+				if(iIsAssignment(Text(close + 1)) ||
+					prev == "&" || prev == "++" || prev == "--")
+				{
+					return false;
+				}
+			}
+			else if(prev == "*" && !iIsIdentifier(Text(i - 2)) &&
+				Text(i - 2) != ")" && Text(i - 2) != "]" &&
+				!isdigit(static_cast<unsigned char>(Text(i - 2)[0])))
+			{
+				// dereference
+				if(iIsAssignment(Text(i + 1)))
+				{
+					return false;
+				}
+			}
+			else if(EnclosingCall(kernel, i).compare(0, 5, "vload"))
+			{
+				// passed on, assigned or offset
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void CheckPointers(const KernelDef& kernel)
+	{
+		std::vector<std::string> notRestrict;
+		size_t pointers = 0;
+
+		for(size_t i = 0; i < kernel.params.size(); ++i)
+		{
+			const KernelParam& param = kernel.params[i];
+
+			if(!param.global || !param.pointer)
+			{
+				continue;
+			}
+
+			++pointers;
+
+			if(!param.restrict)
+			{
+				notRestrict.push_back(param.name);
+			}
+
+			if(!param.isConst && IsReadOnly(kernel, param.name))
+			{
+				Warn(kernel.nameToken, "global pointer '" + param.name +
+					"' of kernel " + kernel.name + " is only read, declare it const");
+			}
+		}
+
+		if(pointers < 2 || notRestrict.empty())
+		{
+			return;
+		}
+
+		std::string names;
+
+		for(size_t i = 0; i < notRestrict.size(); ++i)
+		{
+			names += (i ? ", '" : "'") + notRestrict[i] + "'";
+		}
+
+		Warn(kernel.nameToken, "global pointer" +
+			std::string(notRestrict.size() > 1 ? "s " : " ") + names +
+			" of kernel " + kernel.name + (notRestrict.size() > 1 ? " are" : " is") +
+			" not restrict, loads can not be reordered past stores");
+	}
+
+	void CheckWorkGroupSize(const KernelDef& kernel)
+	{
+		for(size_t i = kernel.attrBegin; i < kernel.bodyBegin; ++i)
+		{
+			if(Text(i) != "reqd_work_group_size" || Text(i + 1) != "(")
+			{
+				continue;
+			}
+
+			size_t close = iMatching(file_->tokens, i + 1, kernel.bodyBegin);
+			std::vector<long long> sizes;
+			iEvaluator evaluator(macros_);
+
+			for(size_t p = i + 2; p < close; )
+			{
+				size_t q = p;
+
+				while(q < close && Text(q) != ",") ++q;
+
+				long long size;
+
+				if(!evaluator.Evaluate(file_->tokens, p, q, size))
+				{
+					return;
+				}
+
+				sizes.push_back(size);
+				p = q + 1;
+			}
+
+			long long total = 1;
+			std::ostringstream str;
+
+			for(size_t d = 0; d < sizes.size(); ++d)
+			{
+				total *= sizes[d];
+				str << (d ? "," : "") << sizes[d];
+			}
+
+			for(size_t d = 0; d < devices_.size(); ++d)
+			{
+				const DeviceCapabilities& device = *devices_[d];
+				std::ostringstream message;
+
+				if(static_cast<unsigned long long>(total) > device.maxWorkGroupSize)
+				{
+					message << "reqd_work_group_size(" << str.str() << ") of kernel " <<
+						kernel.name << " is " << total << " work-items, " <<
+						device.name << " allows " << device.maxWorkGroupSize;
+					Warn(i, message.str());
+				}
+
+				for(size_t s = 0; s < sizes.size() && s < device.maxWorkItemSizes.size(); ++s)
+				{
+					if(static_cast<unsigned long long>(sizes[s]) <= device.maxWorkItemSizes[s])
+					{
+						continue;
+					}
+
+					message.str("");
+					message << "reqd_work_group_size(" << str.str() << ") of kernel " <<
+						kernel.name << " exceeds CL_DEVICE_MAX_WORK_ITEM_SIZES[" << s <<
+						"] = " << device.maxWorkItemSizes[s] << " of " << device.name;
+					Warn(i, message.str());
+				}
+			}
+		}
+	}
+
+	void CheckLocalMemory(const KernelDef& kernel)
+	{
+		unsigned long long total = 0;
+		size_t largest = kernel.nameToken;
+		unsigned long long largestSize = 0;
+		iEvaluator evaluator(macros_);
+
+		for(size_t i = kernel.bodyBegin; i < kernel.bodyEnd; ++i)
+		{
+			if(Text(i) != "__local" && Text(i) != "local")
+			{
+				continue;
+			}
+
+			size_t j = i + 1;
+
+			while(Text(j) == "const" || Text(j) == "volatile") ++j;
+
+			size_t type, width;
+
+			if(!iTypeInfo(Text(j), type, width) || !iIsIdentifier(Text(j + 1)) ||
+				Text(j + 2) != "[")
+			{
+				continue;
+			}
+
+			unsigned long long size = iTypeSizes[type] * (width == 3 ? 4 : width);
+
+			for(j += 2; Text(j) == "["; )
+			{
+				size_t close = iMatching(file_->tokens, j, kernel.bodyEnd);
+				long long count;
+
+				if(!evaluator.Evaluate(file_->tokens, j + 1, close, count) || count < 0)
+				{
+					size = 0;
+					break;
+				}
+
+				size *= count;
+				j = close + 1;
+			}
+
+			total += size;
+
+			if(size > largestSize)
+			{
+				largest = i;
+				largestSize = size;
+			}
+		}
+
+		for(size_t d = 0; total && d < devices_.size(); ++d)
+		{
+			if(total <= devices_[d]->localMemSize)
+			{
+				continue;
+			}
+
+			std::ostringstream message;
+			message << "__local arrays of kernel " << kernel.name << " take " <<
+				total << " bytes, " << devices_[d]->name << " has " <<
+				devices_[d]->localMemSize << " bytes of local memory";
+			Warn(largest, message.str());
+		}
+	}
+
+	// get_global_id(0) at token
+	bool IsGlobalIdCall(size_t token) const
+	{
+		size_t end;
+		return IsIdCall(token, end) && Text(token) == "get_global_id";
+	}
+
+	// every use of the pointer param is name[gid] with gid the global id of
+	// dimension 0, each work-item takes one scalar and neighbours are
+	// adjacent, what vloadn/vstoren would widen
+	bool IsScalarBound(const KernelDef& kernel, const std::string& name) const
+	{
+		std::set<std::string> ids;
+
+		for(size_t i = kernel.bodyBegin; i + 1 < kernel.bodyEnd; ++i)
+		{
+			if(iIsIdentifier(Text(i)) && Text(i + 1) == "=" && IsGlobalIdCall(i + 2))
+			{
+				ids.insert(Text(i));
+			}
+		}
+
+		size_t uses = 0;
+
+		for(size_t i = kernel.bodyBegin; i < kernel.bodyEnd; ++i)
+		{
+			if(Text(i) != name)
+			{
+				continue;
+			}
+
+			if(Text(i + 1) != "[" || !((ids.count(Text(i + 2)) && Text(i + 3) == "]") ||
+				(IsGlobalIdCall(i + 2) && Text(i + 6) == "]")))
+			{
+				return false;
+			}
+
+			++uses;
+		}
+
+		return uses > 0;
+	}
+
+	void CheckVectors(const KernelDef& kernel)
+	{
+		for(size_t i = kernel.nameToken; i < kernel.bodyEnd; ++i)
+		{
+			size_t type, width;
+
+			if((iTypeInfo(Text(i), type, width) && width > 1) ||
+				!Text(i).compare(0, 5, "vload") || !Text(i).compare(0, 6, "vstore"))
+			{
+				return;
+			}
+		}
+
+		for(size_t d = 0; d < devices_.size(); ++d)
+		{
+			const DeviceCapabilities& device = *devices_[d];
+
+			for(size_t p = 0; p < kernel.params.size(); ++p)
+			{
+				const KernelParam& param = kernel.params[p];
+				size_t type, width;
+
+				if(!param.global || !param.pointer || param.type.empty() ||
+					!iTypeInfo(param.type, type, width) ||
+					type >= device.preferredVectorWidths.size() ||
+					device.preferredVectorWidths[type] < 2 || !IsScalarBound(kernel, param.name))
+				{
+					continue;
+				}
+
+				std::ostringstream message;
+				message << "kernel " << kernel.name << " works on one scalar " <<
+					param.type << " of " << param.name << " per work-item, " << device.name << " prefers " << param.type <<
+					device.preferredVectorWidths[type] <<
+					" (CL_DEVICE_PREFERRED_VECTOR_WIDTH_";
+
+				for(const char* c = iTypeNames[type]; *c; ++c)
+				{
+					message << static_cast<char>(toupper(*c));
+				}
+
+				message << ")";
+				Warn(kernel.nameToken, message.str());
+				break;
+			}
+		}
+	}
+
+	// get_global_id(0) or get_local_id(0) at token, its last token in end
+	bool IsIdCall(size_t token, size_t& end) const
+	{
+		if((Text(token) == "get_global_id" || Text(token) == "get_local_id") &&
+			Text(token + 1) == "(" && Text(token + 2) == "0" && Text(token + 3) == ")")
+		{
+			end = token + 3;
+			return true;
+		}
+
+		return false;
+	}
+
+	void CheckStrides(const KernelDef& kernel)
+	{
+		using namespace std;
+
+		// variables holding the work-item index of dimension 0
+		set<string> ids;
+		set<string> pointers;
+
+		for(size_t i = kernel.bodyBegin; i + 1 < kernel.bodyEnd; ++i)
+		{
+			size_t end;
+
+			if(iIsIdentifier(Text(i)) && Text(i + 1) == "=" && IsIdCall(i + 2, end))
+			{
+				ids.insert(Text(i));
+			}
+		}
+
+		for(size_t p = 0; p < kernel.params.size(); ++p)
+		{
+			if(kernel.params[p].global && kernel.params[p].pointer)
+			{
+				pointers.insert(kernel.params[p].name);
+			}
+		}
+
+		for(size_t i = kernel.bodyBegin; i + 1 < kernel.bodyEnd; ++i)
+		{
+			if(!pointers.count(Text(i)) || Text(i + 1) != "[")
+			{
+				continue;
+			}
+
+			size_t close = iMatching(file_->tokens, i + 1, kernel.bodyEnd);
+			string stride;
+
+			for(size_t j = i + 2; stride.empty() && j < close; ++j)
+			{
+				size_t end = j;
+				bool id = ids.count(Text(j)) || IsIdCall(j, end);
+
+				// id * n, id << n
+				if(id && end + 2 <= close &&
+					(Text(end + 1) == "*" || Text(end + 1) == "<<") &&
+					Text(end + 2) != "1" && Text(end + 2) != "0" && Text(end + 2) != "(")
+				{
+					stride = Text(end + 1) == "<<" ? "1 << " + Text(end + 2) : Text(end + 2);
+				}
+
+				// n * id
+				if(Text(j) == "*" && j > i + 2 && Text(j - 1) != "1" && Text(j - 1) != ")" &&
+					j + 1 < close && (ids.count(Text(j + 1)) || IsIdCall(j + 1, end)))
+				{
+					stride = Text(j - 1);
+				}
+			}
+
+			if(stride.empty())
+			{
+				continue;
+			}
+
+			string index;
+
+			for(size_t j = i + 2; j < close; ++j)
+			{
+				index += (j > i + 2 && (iIsIdentifier(Text(j)) || isdigit(
+					static_cast<unsigned char>(Text(j)[0]))) &&
+					(iIsIdentifier(Text(j - 1)) || isdigit(
+					static_cast<unsigned char>(Text(j - 1)[0]))) ? " " : "") + Text(j);
+			}
+
+			Warn(i, "strided access " + Text(i) + "[" + index + "], neighbouring "
+				"work-items are " + stride + " elements apart and their global "
+				"accesses are not coalesced");
+		}
+	}
+
+	const MacroMap& macros_;
+	const std::vector<const DeviceCapabilities*>& devices_;
+	std::vector<LintWarning>& warnings_;
+	const LintFile* file_;
+};
+
+bool iByLine(const LintWarning& a, const LintWarning& b)
+{
+	return a.line < b.line;
+}
+
+}
+
+void LintSources(const std::vector<std::string>& paths,
+	const std::vector<SourceText>& sources, const std::string& build_options,
+	const std::vector<const DeviceCapabilities*>& devices,
+	std::vector<LintWarning>& warnings)
+{
+	using namespace std;
+
+	vector<LintFile> files(sources.size());
+	MacroMap macros;
+
+	// macros of every file first, headers define sizes used by inputs
+	for(size_t i = 0; i < sources.size(); ++i)
+	{
+		LintFile& file = files[i];
+		file.path = paths[i];
+		file.text.assign(sources[i].data, sources[i].size);
+
+		iBlankComments(file.text);
+		iPreprocess(file.text, macros, file.guards);
+		iTokenize(file.text, file.tokens);
+
+		// sentinels at the end so that lookahead needs no bounds checks
+		Token sentinel;
+		sentinel.offset = file.text.size();
+		file.tokens.insert(file.tokens.end(), 4, sentinel);
+
+		for(size_t offset = 0; offset < file.text.size(); ++offset)
+		{
+			if(file.text[offset] == '\n') file.lineStarts.push_back(offset + 1);
+		}
+
+		file.lineStarts.insert(file.lineStarts.begin(), 0);
+	}
+
+	iOptionMacros(build_options, macros);
+
+	iLinter linter(macros, devices, warnings);
+
+	for(size_t i = 0; i < files.size(); ++i)
+	{
+		size_t first = warnings.size();
+
+		linter.Lint(files[i]);
+
+		stable_sort(warnings.begin() + first, warnings.end(), iByLine);
+	}
+}
+
+int RunLint(const Options& opts)
+{
+	using namespace std;
+
+	SourceFiles inputs;
+
+	for(size_t i = 0; i < opts.infiles.size(); ++i)
+	{
+		if(!inputs.Add(opts.infiles[i]))
+		{
+			int errorNum = errno;
+			cerr << strerror(errorNum) << ": " << opts.infiles[i] << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	IncludeScan scan;
+
+	if(!ScanIncludes(opts.infiles, inputs.Texts(), opts.includeDirs, scan))
+	{
+		int errorNum = errno;
+		cerr << strerror(errorNum) << ": " << scan.files.back() << endl;
+		return EXIT_FAILURE;
+	}
+
+	SourceFiles files;
+
+	for(size_t i = 0; i < scan.files.size(); ++i)
+	{
+		if(!files.Add(scan.files[i]))
+		{
+			int errorNum = errno;
+			cerr << strerror(errorNum) << ": " << scan.files[i] << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// the limits oclq --snapshot saved, queried now when they are missing
+	// or the drivers changed
+	CapabilitySnapshot snapshot;
+	string path = GetDefaultSnapshotPath();
+
+	if(!LoadSnapshot(path, snapshot))
+	{
+		snapshot = CapabilitySnapshot();
+
+		if(QueryCapabilities(snapshot))
+		{
+			cerr << "warning: no OpenCL devices, device limits are not checked" << endl;
+		}
+		else
+		{
+			string::size_type slash = path.rfind('/');
+			bool saved = (slash == string::npos || !slash ||
+				MakeDirectories(path.substr(0, slash))) && SaveSnapshot(path, snapshot);
+
+			if(!saved && opts.verbose)
+			{
+				int errorNum = errno;
+				cerr << "can not write " << path << ": " << strerror(errorNum) << endl;
+			}
+		}
+	}
+
+	vector<const DeviceCapabilities*> devices;
+
+	for(size_t i = 0; i < snapshot.devices.size() && (opts.all || !i); ++i)
+	{
+		devices.push_back(&snapshot.devices[i]);
+	}
+
+	vector<LintWarning> warnings;
+	LintSources(scan.files, files.Texts(), opts.buildOptions, devices, warnings);
+
+	for(size_t i = 0; i < warnings.size(); ++i)
+	{
+		cout << warnings[i].file << ":" << warnings[i].line << ": warning: " <<
+			warnings[i].message << endl;
+	}
+
+	if(opts.verbose)
+	{
+		cerr << warnings.size() << " warnings" << endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+}
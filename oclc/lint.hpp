@@ -0,0 +1,56 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_LINT_HPP_
+#define OCLC_LINT_HPP_
+
+#include "build.hpp"
+#include "capabilities.hpp"
+#include "options.hpp"
+
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+struct LintWarning
+{
+	std::string file;
+	size_t line;
+	std::string message;
+};
+
+// check the sources of one program (paths and their texts, headers
+// included) for performance problems, device limits taken from devices:
+// double without fp64, global pointers without const or restrict,
+// reqd_work_group_size and __local arrays beyond the device, scalar code
+// where the device prefers vectors and strided global access. macros of
+// #define lines and -D in build_options size __local arrays.
+void LintSources(const std::vector<std::string>& paths,
+	const std::vector<SourceText>& sources, const std::string& build_options,
+	const std::vector<const DeviceCapabilities*>& devices,
+	std::vector<LintWarning>& warnings);
+
+// lint opts.infiles and their headers against the first device (every
+// device with opts.all) of the capability snapshot, print warnings as
+// "file:line: warning: message". returns process exit status.
+int RunLint(const Options& opts);
+
+}
+
+#endif
@@ -21,13 +21,31 @@
 	#include <OpenCL/opencl.h>
 #endif
 
+#include "batch.hpp"
+#include "build.hpp"
+#include "cache.hpp"
+#include "clx.hpp"
+#include "clxtool.hpp"
+#include "daemon.hpp"
+#include "device.hpp"
 #include "errors.hpp"
+#include "includes.hpp"
+#include "iobench.hpp"
+#include "kernelreport.hpp"
+#include "link.hpp"
+#include "lint.hpp"
+#include "options.hpp"
+#include "sources.hpp"
+#include "trace.hpp"
+#include "tune.hpp"
+#include "watch.hpp"
 
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -36,18 +54,30 @@
 static const int gVersionMajor = 1;
 static const int gVersionMinor = 0;
 
+// read by FinishTrace() at exit
+static bool gTimeReport = false;
+static std::string gTraceFile;
+
 static void IfErrorThenExit(int error);
-static void GetOpts(
-	int argc, char* argv[],
-	bool& verbose, bool& version, bool& help,
-	std::string& outfile, std::vector<std::string>& infiles);
-static void LoadSource(
-	const std::string& infile, std::vector<char>& source);
+static void FinishTrace();
+static void GetOpts(int argc, char* argv[], OCLT::Options& opts);
+static void LoadSources(
+	const std::vector<std::string>& infiles, OCLT::SourceFiles& files);
 static void BuildProgram(
-	const std::vector< std::vector<char> >& source,
-	std::vector<unsigned char>& binary);
-static void SaveBinary(
-	const std::string& outfile, const std::vector<unsigned char> binary);
+	const OCLT::Options& opts,
+	const std::vector<OCLT::SourceText>& source,
+	const OCLT::IncludeScan& scan,
+	OCLT::CompileCache& cache,
+	OCLT::DeviceBinary& binary);
+static bool BuildProgramAll(
+	const OCLT::Options& opts,
+	const std::vector<OCLT::SourceText>& sources,
+	const OCLT::IncludeScan& scan,
+	OCLT::CompileCache& cache,
+	std::vector<OCLT::PlatformBuild>& results);
+static void PrintCacheStats(OCLT::CompileCache& cache);
+static void SaveBinaries(
+	const OCLT::Options& opts, const std::vector<OCLT::PlatformBuild>& results);
 
 int
 main(int argc, char* argv[])
@@ -55,210 +85,578 @@ main(int argc, char* argv[])
 	using namespace std;
 	using namespace OCLT;
 
-	bool verbose = false;
-	bool version = false;
-	bool help = false;
+	Options opts;
 
-	vector<string> infiles;
-	string outfile;
+	GetOpts(argc, argv, opts);
 
-	GetOpts(argc, argv,
-		verbose, version, help,
-		outfile, infiles);
+	if(opts.timeReport || !opts.traceFile.empty())
+	{
+		// also reports runs which end in exit() on an error
+		gTimeReport = opts.timeReport;
+		gTraceFile = opts.traceFile;
+		EnableTrace();
+		atexit(FinishTrace);
+	}
 
-	if(help)
+	if(opts.help)
 	{
 		cout << "usage: " << argv[0] << " [options] kernel.cl" << endl <<
 			"  -o file      output file name" << endl <<
+			"  -a --all     build for every platform and device" << endl <<
+			"  -b --batch   compile each input file into its own output," << endl <<
+			"               file.cl to file.clx, or into directory -o" << endl <<
+			"  --manifest=file" << endl <<
+			"               batch compile lines \"input [output]\" of file" << endl <<
+			"  -j n         batch compile on n threads (default: cores)," << endl <<
+			"               also bounded by the make jobserver" << endl <<
+			"  --daemon     keep contexts of every platform and serve" << endl <<
+			"               compile requests on --socket" << endl <<
+			"  --remote     let the daemon compile" << endl <<
+			"  --socket=path" << endl <<
+			"               daemon socket (default $OCLC_SOCKET or" << endl <<
+			"               /tmp/oclc-<uid>.sock)" << endl <<
+			"  --bench=n    with --remote, compare latency of n requests to" << endl <<
+			"               the daemon and n runs of oclc without it" << endl <<
+			"  --bench-io=MB time loading a generated MB source and writing" << endl <<
+			"               its binary, --bench=n runs (default 5)" << endl <<
+			"  --bench-compress" << endl <<
+			"               compare size and load time of the binaries of" << endl <<
+			"               the given files with and without --compress" << endl <<
+			"  --bench-startup" << endl <<
+			"               compare the time to a program loaded from its" << endl <<
+			"               binary (written to $TMPDIR and removed after)" << endl <<
+			"               with a build of the input, --bench=n runs" << endl <<
+			"  --raw        write bare device binaries instead of a clx" << endl <<
+			"               container, with -a as file.<platform>.<device>.clx" << endl <<
+			"  --compress   compress binaries in the clx container" << endl <<
+			"  -O --options=string" << endl <<
+			"               options passed to clBuildProgram" << endl <<
+			"  --separate   compile each input file on its own and link" << endl <<
+			"               them, only changed files are compiled again" << endl <<
+			"               with --cache-dir. clx inputs are libraries" << endl <<
+			"  --create-library" << endl <<
+			"               link the inputs into a library" << endl <<
+			"  --link-options=string" << endl <<
+			"               options passed to clLinkProgram" << endl <<
+			"  --tune=NAME=v1,v2,..." << endl <<
+			"               build a variant for each value of macro NAME," << endl <<
+			"               @float (@int, ...) tries preferred vector widths" << endl <<
+			"  --tune-flag=option" << endl <<
+			"               build variants with and without option" << endl <<
+			"  --kernel=name --args=spec --global=x[,y,z] --local=x[,y,z]" << endl <<
+			"               kernel timed for each variant, its arguments" << endl <<
+			"               (buffer:float:1M, local:float:256, int:7) and" << endl <<
+			"               work sizes, which may name tuned macros" << endl <<
+			"  --tune-check choose only variants whose buffers match the" << endl <<
+			"               first variant within --tune-tolerance=x (1e-4)" << endl <<
+			"               the fastest variant of each device is saved," << endl <<
+			"               its options to output.options, --bench=n runs" << endl <<
+			"  -I dir       search dir for included headers" << endl <<
+			"  -MD          write a depfile of the input and its headers" << endl <<
+			"               to output.d (output.d per file in batch mode)" << endl <<
+			"  -MF file     write the depfile to file" << endl <<
+			"  --time-report print time spent in each phase, builds the" << endl <<
+			"               devices of a platform one after another" << endl <<
+			"  --kernel-report[=text|json]" << endl <<
+			"               print work-group size, local and private memory" << endl <<
+			"               and estimated occupancy of each kernel and device" << endl <<
+			"  --lint       check the input and its headers for performance" << endl <<
+			"               problems on the first device (-a: every device)" << endl <<
+			"               instead of building" << endl <<
+			"  --watch      build, then rebuild whenever an input or a header" << endl <<
+			"               it includes is saved (with -b each input on its" << endl <<
+			"               own), keeping the contexts" << endl <<
+			"  --trace=file write phases of every thread to file as" << endl <<
+			"               chrome trace json (chrome://tracing, Perfetto)," << endl <<
+			"               builds the devices of a platform one after" << endl <<
+			"               another so that each gets its own phase" << endl <<
+			"  --cache-dir=dir" << endl <<
+			"               reuse binaries built before from dir" << endl <<
+			"               (default $OCLC_CACHE_DIR)" << endl <<
+			"  --cache-size=MB" << endl <<
+			"               evict least recently used binaries beyond MB" << endl <<
+			"  --cache-stats print cache hit and miss statistics" << endl <<
+			"  --no-cache   do not use the cache" << endl <<
+			"  --list       list entries of the given clx files" << endl <<
+			"  --extract=n  write entry n of the given clx file to -o file" << endl <<
+			"  --verify     check digests of the given clx files" << endl <<
 			"  -v --verbose print detail" << endl <<
 			"  -h --help    print help" << endl <<
 			"  -V --version print version information" << endl;
 		exit(EXIT_SUCCESS);
 	}
 
-	if(infiles.empty())
+	if(opts.clxMode != Options::CLX_NONE)
 	{
-		cerr << "no input file" << endl;
-		exit(EXIT_FAILURE);
+		if(opts.infiles.empty())
+		{
+			cerr << "no input file" << endl;
+			exit(EXIT_FAILURE);
+		}
+
+		switch(opts.clxMode)
+		{
+		case Options::CLX_LIST:
+			return ListContainers(opts.infiles, opts.verbose);
+		case Options::CLX_EXTRACT:
+			return ExtractContainer(
+				opts.infiles[0], opts.extractIndex, opts.outfile);
+		default:
+			return VerifyContainers(opts.infiles);
+		}
 	}
 
-	vector< vector<char> > sources(infiles.size());
-	vector< vector<char> >::iterator srcItr = sources.begin();
+	if(opts.benchIoSize)
+	{
+		return RunIoBench(opts);
+	}
 
-	for(vector<string>::const_iterator itr = infiles.begin();
-		itr != infiles.end(); ++itr, ++srcItr)
+	if(opts.benchCompress)
 	{
-		vector<char> source;
-		LoadSource(*itr, source);
-		srcItr->swap(source);
+		return RunCompressBench(opts);
 	}
 
-	vector<unsigned char> binary;
+	if(opts.lint)
+	{
+		if(opts.infiles.empty())
+		{
+			cerr << "no input file" << endl;
+			exit(EXIT_FAILURE);
+		}
+
+		return RunLint(opts);
+	}
 
-	BuildProgram(sources, binary);
+	if( opts.outfile.empty() && !opts.batch ) opts.outfile = "out.clx";
 
-	if( outfile.empty() ) outfile = "out.clx";
+	if(opts.benchStartup)
+	{
+		return RunStartupBench(opts);
+	}
 
-	SaveBinary(outfile, binary);
+	if(!opts.tuneMacros.empty() || !opts.tuneFlags.empty() ||
+		!opts.tuneKernel.empty())
+	{
+		return RunTune(opts);
+	}
 
-	return 0;
-}
+	if(opts.remote)
+	{
+		if(opts.infiles.empty())
+		{
+			cerr << "no input file" << endl;
+			exit(EXIT_FAILURE);
+		}
 
-static void LoadSource(
-	const std::string& infile, std::vector<char>& source)
-{
-	using namespace std;
+		if(opts.raw && opts.all)
+		{
+			cerr << "--raw with -a is not supported by --remote" << endl;
+			exit(EXIT_FAILURE);
+		}
+
+		return opts.benchCount ?
+			RunClientBench(opts, argc, argv) : RunClient(opts);
+	}
+
+	CompileCache cache(opts.cacheDir, opts.cacheSize);
+
+	if(opts.daemon)
+	{
+		int status = RunDaemon(opts, cache);
+
+		if(opts.cacheStats)
+		{
+			PrintCacheStats(cache);
+		}
+
+		return status;
+	}
+
+	if(!opts.cacheDir.empty() && !cache.IsOpen())
+	{
+		cerr << "warning : can not use cache directory: " <<
+			opts.cacheDir << endl;
+	}
+
+	if(opts.watch)
+	{
+		if(opts.infiles.empty() || !opts.manifest.empty())
+		{
+			cerr << "--watch needs input files" << endl;
+			exit(EXIT_FAILURE);
+		}
+
+		return RunWatch(opts, cache);
+	}
+
+	if(opts.batch)
+	{
+		int status = RunBatch(opts, cache);
+
+		if(opts.cacheStats)
+		{
+			PrintCacheStats(cache);
+		}
+
+		return status;
+	}
+
+	if(opts.separate || opts.createLibrary)
+	{
+#ifdef CL_VERSION_1_2
+		int status = RunSeparateCompile(opts, cache);
+#else
+		cerr << "--separate and --create-library need OpenCL 1.2" << endl;
+		int status = EXIT_FAILURE;
+#endif
+
+		if(opts.cacheStats)
+		{
+			PrintCacheStats(cache);
+		}
+
+		return status;
+	}
+
+	if(opts.infiles.empty())
+	{
+		if(opts.cacheStats)
+		{
+			PrintCacheStats(cache);
+			exit(EXIT_SUCCESS);
+		}
+
+		cerr << "no input file" << endl;
+		exit(EXIT_FAILURE);
+	}
 
-	FILE* file = fopen(infile.c_str(), "rb");
+	SourceFiles files;
+	LoadSources(opts.infiles, files);
 
-	if(!file)
+	const vector<SourceText>& sources = files.Texts();
+
+	IncludeScan scan;
+
+	if(!ScanIncludes(opts.infiles, sources, opts.includeDirs, scan))
 	{
 		int errorNum = errno;
-		cerr << strerror(errorNum) << ": " << infile << endl;
+		cerr << strerror(errorNum) << ": " << scan.files.back() << endl;
 		exit(EXIT_FAILURE);
 	}
 
-	source.clear();
-	
-	while(!feof(file))
+	if(opts.verbose && cache.IsOpen() && !scan.unresolved.empty())
 	{
-		char buf[1024];
+		cout << "not cached, include not resolved: " << scan.unresolved[0] << endl;
+	}
+
+	int status = EXIT_SUCCESS;
 
-		size_t readBytes = fread(buf, 1, 1024, file);
+	vector<PlatformBuild> results;
 
-		if(!readBytes)
+	if(opts.all)
+	{
+		status = BuildProgramAll(opts, sources, scan, cache, results) ?
+			EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	else
+	{
+		results.resize(1);
+		results[0].error = CL_SUCCESS;
+		results[0].binaries.resize(1);
+
+		BuildProgram(opts, sources, scan, cache, results[0].binaries[0]);
+	}
+
+	SaveBinaries(opts, results);
+
+	if(opts.depfile && status == EXIT_SUCCESS)
+	{
+		string depfile = opts.depfileOut.empty() ?
+			DefaultDepfile(opts.outfile) : opts.depfileOut;
+
+		if(!WriteDepfile(depfile, opts.outfile, scan.files))
 		{
-			break;
+			int errorNum = errno;
+			cerr << strerror(errorNum) << ": " << depfile << endl;
+			exit(EXIT_FAILURE);
 		}
+	}
+
+	if(opts.kernelReport != Options::KERNEL_REPORT_NONE && status == EXIT_SUCCESS)
+	{
+		TraceSpan span("kernel report");
+
+		if(!PrintKernelReport(cout, results,
+			opts.kernelReport == Options::KERNEL_REPORT_JSON))
+		{
+			status = EXIT_FAILURE;
+		}
+	}
 
-		size_t preSize= source.size();
-		source.resize(preSize + readBytes);
-		memcpy(&source[preSize], buf, readBytes);
+	if(opts.cacheStats)
+	{
+		PrintCacheStats(cache);
 	}
 
-	fclose(file);
+	return status;
 }
 
-static void BuildProgram(
-	const std::vector< std::vector<char> >& sources,
-	std::vector<unsigned char>& binary)
+static void LoadSources(
+	const std::vector<std::string>& infiles, OCLT::SourceFiles& files)
 {
 	using namespace std;
 
-	vector<const char*> srcPtrs(sources.size());
-	vector<size_t> srcSizes(sources.size());
-
-	for(size_t i = 0; i < sources.size(); ++i)
+	for(vector<string>::const_iterator itr = infiles.begin();
+		itr != infiles.end(); ++itr)
 	{
-		srcPtrs[i] = &sources[i][0];
-		srcSizes[i] = sources[i].size();
+		OCLT::TraceSpan span("load source", *itr);
+
+		if(!files.Add(*itr))
+		{
+			int errorNum = errno;
+			cerr << strerror(errorNum) << ": " << *itr << endl;
+			exit(EXIT_FAILURE);
+		}
 	}
+}
 
-	cl_platform_id platform_id;
-	cl_uint num_platforms;
-	IfErrorThenExit( clGetPlatformIDs(1, &platform_id, &num_platforms) );
+static void BuildProgram(
+	const OCLT::Options& opts,
+	const std::vector<OCLT::SourceText>& sources,
+	const OCLT::IncludeScan& scan,
+	OCLT::CompileCache& cache,
+	OCLT::DeviceBinary& binary)
+{
+	using namespace std;
+	using namespace OCLT;
 
-	if(!num_platforms)
+	vector<cl_platform_id> platform_ids;
+	IfErrorThenExit( GetPlatformIDs(platform_ids) );
+
+	if(platform_ids.empty())
 	{
 		cerr << "no platform on system" << endl;
 		exit(EXIT_FAILURE);
 	}
 
-	cl_uint num_devices = 0;
-	IfErrorThenExit(
-		clGetDeviceIDs(platform_id, CL_DEVICE_TYPE_ALL, 0, NULL, &num_devices) );
+	vector<cl_device_id> device_ids;
+	IfErrorThenExit( GetDeviceIDs(platform_ids[0], device_ids) );
 
-	if(!num_devices)
+	if(device_ids.empty())
 	{
 		cerr << "no device on system" << endl;
 		exit(EXIT_FAILURE);
 	}
 
-	vector<cl_device_id> device_ids(num_devices);
-	IfErrorThenExit(
-		clGetDeviceIDs(platform_id, CL_DEVICE_TYPE_ALL, num_devices, &device_ids[0], NULL) );
+	binary.device_id = device_ids[0];
+
+	if(cache.IsOpen())
+	{
+		string key = CompileCache::MakeKey(CacheDigest(scan), opts.buildOptions,
+			GetDeviceFingerprint(device_ids[0]));
+
+		if(cache.Load(key, binary.binary))
+		{
+			if(opts.verbose)
+			{
+				cout << "cache hit: " << key << endl;
+			}
+
+			return;
+		}
+	}
+
+	PlatformBuild result;
+	OCLT::BuildProgram(platform_ids[0], sources,
+		CompileOptions(opts.buildOptions, scan), result);
+
+	if(!result.log.empty())
+	{
+		cout << result.log << endl;
+	}
 
-	cl_int errcode_ret;
-	cl_context context = clCreateContext(
-		NULL, device_ids.size(), &device_ids[0], NULL, NULL, &errcode_ret);
-	IfErrorThenExit(errcode_ret);
+	IfErrorThenExit(result.error);
 
-	cl_program program = clCreateProgramWithSource(
-			context, sources.size(), &srcPtrs[0], &srcSizes[0], &errcode_ret);
-	IfErrorThenExit(errcode_ret);
+	if(cache.IsOpen())
+	{
+		cache.StorePlatform(CacheDigest(scan), opts.buildOptions, result);
+	}
 
-	if(int err = clBuildProgram(program, 0, NULL, NULL, NULL, NULL) )
+	for(vector<DeviceBinary>::iterator itr = result.binaries.begin();
+		itr != result.binaries.end(); ++itr)
 	{
-		size_t log_size = 0;
-		IfErrorThenExit( clGetProgramBuildInfo(
-			program, device_ids[0], CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size) );
+		if(itr->device_id == device_ids[0])
+		{
+			binary.binary.swap(itr->binary);
+			return;
+		}
+	}
 
-		vector<char> build_log(log_size);
+	binary.device_id = result.binaries[0].device_id;
+	binary.binary.swap(result.binaries[0].binary);
+}
+
+static bool BuildProgramAll(
+	const OCLT::Options& opts,
+	const std::vector<OCLT::SourceText>& sources,
+	const OCLT::IncludeScan& scan,
+	OCLT::CompileCache& cache,
+	std::vector<OCLT::PlatformBuild>& results)
+{
+	using namespace std;
+	using namespace OCLT;
+
+	vector<cl_platform_id> platform_ids;
+	IfErrorThenExit( GetPlatformIDs(platform_ids) );
+
+	if(platform_ids.empty())
+	{
+		cerr << "no platform on system" << endl;
+		exit(EXIT_FAILURE);
+	}
 
-		IfErrorThenExit( clGetProgramBuildInfo(
-			program, device_ids[0], CL_PROGRAM_BUILD_LOG, log_size, &build_log[0], NULL) );
+	// platforms whose binaries are all cached skip context creation and build
+	results.clear();
+	results.resize(platform_ids.size());
+	vector<cl_platform_id> buildPlatformIds;
+	vector<size_t> buildIndices;
 
-		cout << string(&build_log[0], log_size) << endl;
+	for(size_t i = 0; i < platform_ids.size(); ++i)
+	{
+		vector<cl_device_id> device_ids;
 
+		if(cache.IsOpen() && !GetDeviceIDs(platform_ids[i], device_ids) &&
+			cache.LoadPlatform(CacheDigest(scan), opts.buildOptions,
+				platform_ids[i], device_ids, results[i]))
+		{
+			if(opts.verbose)
+			{
+				cout << "cache hit: platform " << i << endl;
+			}
 
-		clReleaseContext(context);
+			continue;
+		}
 
-		IfErrorThenExit( err );
-		return;
+		buildPlatformIds.push_back(platform_ids[i]);
+		buildIndices.push_back(i);
 	}
 
-	cl_uint num_program_devices;
+	vector<PlatformBuild> builds;
+	BuildProgramAllPlatforms(
+		buildPlatformIds, sources, CompileOptions(opts.buildOptions, scan),
+		builds);
 
-	IfErrorThenExit(
-		clGetProgramInfo(
-			program, CL_PROGRAM_NUM_DEVICES, sizeof(num_program_devices),
-			&num_program_devices, NULL) );
+	for(size_t i = 0; i < builds.size(); ++i)
+	{
+		if(cache.IsOpen() && !builds[i].error)
+		{
+			cache.StorePlatform(CacheDigest(scan), opts.buildOptions, builds[i]);
+		}
+
+		swap(results[buildIndices[i]], builds[i]);
+	}
 
-	if(!num_program_devices)
+	bool succeeded = true;
+
+	for(size_t i = 0; i < results.size(); ++i)
 	{
-		cerr << "no device specific program built" << endl;
-		exit(EXIT_FAILURE);
+		const PlatformBuild& result = results[i];
+
+		if(!result.log.empty())
+		{
+			cout << result.log << endl;
+		}
+
+		if(result.error)
+		{
+			map<int, string>::const_iterator errMsgPairItr =
+				ErrorMessageMap.find(result.error);
+
+			cerr << "error : platform " << i << " : " <<
+				(errMsgPairItr != ErrorMessageMap.end() ?
+					errMsgPairItr->second : string("unkown error")) << endl;
+			succeeded = false;
+		}
 	}
 
-	vector<size_t> programSizes(num_program_devices);
-	IfErrorThenExit(
-		clGetProgramInfo(
-			program, CL_PROGRAM_BINARY_SIZES,
-			sizeof(size_t) * num_program_devices, &programSizes[0], NULL) );
+	return succeeded;
+}
 
-	vector< vector<unsigned char> > binaries(num_program_devices);
-	vector<unsigned char*> binaryPtrs(num_program_devices);
+static void PrintCacheStats(OCLT::CompileCache& cache)
+{
+	using namespace std;
+	using namespace OCLT;
 
-	for(size_t i = 0; i < num_program_devices; ++i)
+	if(!cache.IsOpen())
 	{
-		binaries[i].resize(programSizes[i]);
-		binaryPtrs[i] = &binaries[i][0];
+		cout << "cache: disabled" << endl;
+		return;
 	}
 
-	unsigned char* dataPtr = &binary[0];
-	IfErrorThenExit(
-		clGetProgramInfo(program, CL_PROGRAM_BINARIES,
-			sizeof(unsigned char*) * num_program_devices, &binaryPtrs[0], NULL) );
-	binary = binaries[0];
+	CacheStats session = cache.SessionStats();
+	CacheStats total;
+	cache.TotalStats(total);
+
+	cout << "cache: this run " << session.hits << " hits, " <<
+		session.misses << " misses" << endl;
+	cout << "cache: total " << total.hits << " hits, " <<
+		total.misses << " misses, " << total.evictions << " evictions, " <<
+		total.entries << " entries, " << total.bytes << " bytes" << endl;
 }
 
-static void SaveBinary(
-	const std::string& outfile, const std::vector<unsigned char> binary)
+static void SaveBinaries(
+	const OCLT::Options& opts, const std::vector<OCLT::PlatformBuild>& results)
 {
 	using namespace std;
+	using namespace OCLT;
 
-	FILE* file = fopen(outfile.c_str(), "wb");
+	if(opts.verbose)
+	{
+		for(size_t i = 0; i < results.size(); ++i)
+		{
+			if(results[i].error) continue;
 
-	if(!file)
+			for(size_t j = 0; j < results[i].binaries.size(); ++j)
+			{
+				const DeviceBinary& binary = results[i].binaries[j];
+
+				cout << "platform " << i << " device " << j << ": " <<
+					GetDeviceInfoString(binary.device_id, CL_DEVICE_NAME) <<
+					" (" << binary.binary.size() << " bytes)";
+
+				if(opts.raw && opts.all)
+				{
+					cout << " -> " << DeviceOutfile(opts.outfile, i, j);
+				}
+
+				cout << endl;
+			}
+		}
+	}
+
+	if(!OCLT::SaveBinaries(
+		opts.outfile, results, opts.raw, opts.all, opts.compress))
 	{
 		int errorNum = errno;
-		cerr << strerror(errorNum) << ": " << outfile << endl;
+		cerr << strerror(errorNum) << ": " << opts.outfile << endl;
 		exit(EXIT_FAILURE);
 	}
+}
 
-	fwrite(&binary[0], 1, binary.size(), file);
+static void FinishTrace()
+{
+	using namespace std;
 
-	fclose(file);
+	if(gTimeReport)
+	{
+		OCLT::PrintTimeReport(cout);
+	}
+
+	if(!gTraceFile.empty() && !OCLT::WriteChromeTrace(gTraceFile))
+	{
+		int errorNum = errno;
+		cerr << strerror(errorNum) << ": " << gTraceFile << endl;
+	}
 }
 
 static void IfErrorThenExit(int error)
@@ -285,14 +683,69 @@ static void IfErrorThenExit(int error)
 	exit(EXIT_FAILURE);
 }
 
-static void GetOpts(
-	int argc, char* argv[],
-	bool& verbose, bool& version, bool& help,
-	std::string& outfile, std::vector<std::string>& infiles)
+static void GetOpts(int argc, char* argv[], OCLT::Options& opts)
 {
-	verbose = false;
-	version = false;
-	help = false;
+	enum
+	{
+		OPT_CACHE_DIR = 256,
+		OPT_CACHE_SIZE,
+		OPT_CACHE_STATS,
+		OPT_NO_CACHE,
+		OPT_RAW,
+		OPT_LIST,
+		OPT_EXTRACT,
+		OPT_VERIFY,
+		OPT_MANIFEST,
+		OPT_DAEMON,
+		OPT_REMOTE,
+		OPT_SOCKET,
+		OPT_BENCH,
+		OPT_BENCH_IO,
+		OPT_BENCH_COMPRESS,
+		OPT_COMPRESS,
+		OPT_BENCH_STARTUP,
+		OPT_MD,
+		OPT_MF,
+		OPT_TIME_REPORT,
+		OPT_TRACE,
+		OPT_KERNEL_REPORT,
+		OPT_LINT,
+		OPT_WATCH,
+		OPT_SEPARATE,
+		OPT_CREATE_LIBRARY,
+		OPT_LINK_OPTIONS,
+		OPT_TUNE,
+		OPT_TUNE_FLAG,
+		OPT_TUNE_CHECK,
+		OPT_TUNE_TOLERANCE,
+		OPT_KERNEL,
+		OPT_ARGS,
+		OPT_GLOBAL,
+		OPT_LOCAL,
+	};
+
+	opts = OCLT::Options();
+
+	// gcc style -MD and -MF[file] become long options for getopt
+	for(int i = 1; i < argc; ++i)
+	{
+		if(!strcmp(argv[i], "-MD") || !strncmp(argv[i], "-MF", 3))
+		{
+			std::string arg = std::string("-") + argv[i];
+
+			if(arg.size() > 4 && arg[3] == 'F')
+			{
+				arg.insert(4, "=");
+			}
+
+			argv[i] = strdup(arg.c_str());
+		}
+	}
+
+	if(const char* env = getenv("OCLC_CACHE_DIR"))
+	{
+		opts.cacheDir = env;
+	}
 
 	for(;;)
 	{
@@ -300,36 +753,226 @@ static void GetOpts(
 			{"help", 0, 0, 'h'},
 			{"verbose", 0, 0, 'v'},
 			{"version", 0, 0, 'V'},
+			{"all", 0, 0, 'a'},
+			{"options", 1, 0, 'O'},
+			{"cache-dir", 1, 0, OPT_CACHE_DIR},
+			{"cache-size", 1, 0, OPT_CACHE_SIZE},
+			{"cache-stats", 0, 0, OPT_CACHE_STATS},
+			{"no-cache", 0, 0, OPT_NO_CACHE},
+			{"raw", 0, 0, OPT_RAW},
+			{"list", 0, 0, OPT_LIST},
+			{"extract", 1, 0, OPT_EXTRACT},
+			{"verify", 0, 0, OPT_VERIFY},
+			{"batch", 0, 0, 'b'},
+			{"manifest", 1, 0, OPT_MANIFEST},
+			{"daemon", 0, 0, OPT_DAEMON},
+			{"remote", 0, 0, OPT_REMOTE},
+			{"socket", 1, 0, OPT_SOCKET},
+			{"bench", 1, 0, OPT_BENCH},
+			{"bench-io", 1, 0, OPT_BENCH_IO},
+			{"bench-compress", 0, 0, OPT_BENCH_COMPRESS},
+			{"compress", 0, 0, OPT_COMPRESS},
+			{"bench-startup", 0, 0, OPT_BENCH_STARTUP},
+			{"MD", 0, 0, OPT_MD},
+			{"MF", 1, 0, OPT_MF},
+			{"time-report", 0, 0, OPT_TIME_REPORT},
+			{"trace", 1, 0, OPT_TRACE},
+			{"kernel-report", 2, 0, OPT_KERNEL_REPORT},
+			{"lint", 0, 0, OPT_LINT},
+			{"watch", 0, 0, OPT_WATCH},
+			{"separate", 0, 0, OPT_SEPARATE},
+			{"create-library", 0, 0, OPT_CREATE_LIBRARY},
+			{"link-options", 1, 0, OPT_LINK_OPTIONS},
+			{"tune", 1, 0, OPT_TUNE},
+			{"tune-flag", 1, 0, OPT_TUNE_FLAG},
+			{"tune-check", 0, 0, OPT_TUNE_CHECK},
+			{"tune-tolerance", 1, 0, OPT_TUNE_TOLERANCE},
+			{"kernel", 1, 0, OPT_KERNEL},
+			{"args", 1, 0, OPT_ARGS},
+			{"global", 1, 0, OPT_GLOBAL},
+			{"local", 1, 0, OPT_LOCAL},
 			{0,0,0,0}
 		};
 
 		int option_index = 0;
-		int c = getopt_long(argc, argv, "hvVo:", long_options, &option_index);
+		int c = getopt_long(argc, argv, "hvVabo:O:I:j:", long_options, &option_index);
 
 		if(c == -1) break;
 
+		// the argv elements getopt took for them, with a separate value
+		if(c == OPT_REMOTE || c == OPT_SOCKET || c == OPT_BENCH)
+		{
+			opts.remoteArgs.push_back(argv[optind - 1]);
+
+			if(c != OPT_REMOTE && optarg == argv[optind - 1])
+			{
+				opts.remoteArgs.push_back(argv[optind - 2]);
+			}
+		}
+
 		switch(c)
 		{
 		case 'h':
-			help = true;
+			opts.help = true;
 			break;
 		case 'v':
-			verbose = true;
+			opts.verbose = true;
 			break;
 		case 'V':
-			version = true;
+			opts.version = true;
+			break;
+		case 'a':
+			opts.all = true;
 			break;
 		case 'o':
-			outfile = optarg;
+			opts.outfile = optarg;
+			break;
+		case 'b':
+			opts.batch = true;
+			break;
+		case 'j':
+			opts.jobs = strtoul(optarg, NULL, 10);
+			break;
+		case OPT_MANIFEST:
+			opts.batch = true;
+			opts.manifest = optarg;
+			break;
+		case OPT_DAEMON:
+			opts.daemon = true;
+			break;
+		case OPT_REMOTE:
+			opts.remote = true;
+			break;
+		case OPT_SOCKET:
+			opts.socketPath = optarg;
+			break;
+		case OPT_BENCH:
+			opts.benchCount = strtoul(optarg, NULL, 10);
+			break;
+		case 'I':
+			opts.includeDirs.push_back(optarg);
+			break;
+		case OPT_MD:
+			opts.depfile = true;
+			break;
+		case OPT_MF:
+			opts.depfile = true;
+			opts.depfileOut = optarg;
+			break;
+		case OPT_SEPARATE:
+			opts.separate = true;
+			break;
+		case OPT_CREATE_LIBRARY:
+			opts.createLibrary = true;
+			break;
+		case OPT_LINK_OPTIONS:
+			if(!opts.linkOptions.empty()) opts.linkOptions += " ";
+			opts.linkOptions += optarg;
+			break;
+		case OPT_TUNE:
+			opts.tuneMacros.push_back(optarg);
+			break;
+		case OPT_TUNE_FLAG:
+			opts.tuneFlags.push_back(optarg);
+			break;
+		case OPT_TUNE_CHECK:
+			opts.tuneCheck = true;
+			break;
+		case OPT_TUNE_TOLERANCE:
+			opts.tuneTolerance = strtod(optarg, NULL);
+			break;
+		case OPT_KERNEL:
+			opts.tuneKernel = optarg;
+			break;
+		case OPT_ARGS:
+			opts.kernelArgs = optarg;
+			break;
+		case OPT_GLOBAL:
+			opts.globalSize = optarg;
+			break;
+		case OPT_LOCAL:
+			opts.localSize = optarg;
+			break;
+		case OPT_TIME_REPORT:
+			opts.timeReport = true;
+			break;
+		case OPT_TRACE:
+			opts.traceFile = optarg;
+			break;
+		case OPT_KERNEL_REPORT:
+			if(!optarg || !strcmp(optarg, "text"))
+			{
+				opts.kernelReport = OCLT::Options::KERNEL_REPORT_TEXT;
+			}
+			else if(!strcmp(optarg, "json"))
+			{
+				opts.kernelReport = OCLT::Options::KERNEL_REPORT_JSON;
+			}
+			else
+			{
+				std::cerr << "unknown report format: " << optarg << std::endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPT_LINT:
+			opts.lint = true;
+			break;
+		case OPT_WATCH:
+			opts.watch = true;
+			break;
+		case OPT_BENCH_IO:
+			opts.benchIoSize = strtoull(optarg, NULL, 10) << 20;
+			break;
+		case OPT_BENCH_COMPRESS:
+			opts.benchCompress = true;
+			break;
+		case OPT_COMPRESS:
+			opts.compress = true;
+			break;
+		case OPT_BENCH_STARTUP:
+			opts.benchStartup = true;
+			break;
+		case 'O':
+			if(!opts.buildOptions.empty()) opts.buildOptions += " ";
+			opts.buildOptions += optarg;
+			break;
+		case OPT_CACHE_DIR:
+			opts.cacheDir = optarg;
+			break;
+		case OPT_CACHE_SIZE:
+			opts.cacheSize = strtoull(optarg, NULL, 10) << 20;
+			break;
+		case OPT_CACHE_STATS:
+			opts.cacheStats = true;
+			break;
+		case OPT_NO_CACHE:
+			opts.cacheDir.clear();
+			break;
+		case OPT_RAW:
+			opts.raw = true;
+			break;
+		case OPT_LIST:
+			opts.clxMode = OCLT::Options::CLX_LIST;
+			break;
+		case OPT_EXTRACT:
+			opts.clxMode = OCLT::Options::CLX_EXTRACT;
+			opts.extractIndex = strtoul(optarg, NULL, 10);
+			break;
+		case OPT_VERIFY:
+			opts.clxMode = OCLT::Options::CLX_VERIFY;
 			break;
 		default:
 			break;
 		}
 	}
 
+	if(opts.socketPath.empty())
+	{
+		opts.socketPath = OCLT::DefaultSocketPath();
+	}
+
 	while(optind < argc)
 	{
-		infiles.push_back( std::string(argv[optind++]) );
+		opts.infiles.push_back( std::string(argv[optind++]) );
 	}
 }
-
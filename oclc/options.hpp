@@ -1,3 +1,152 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
 #ifndef OCLC_OPTIONS_HPP_
 #define OCLC_OPTIONS_HPP_
+
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// command line options of oclc
+struct Options
+{
+	enum ClxMode
+	{
+		CLX_NONE,
+		CLX_LIST,
+		CLX_EXTRACT,
+		CLX_VERIFY,
+	};
+
+	enum KernelReport
+	{
+		KERNEL_REPORT_NONE,
+		KERNEL_REPORT_TEXT,
+		KERNEL_REPORT_JSON,
+	};
+
+	Options()
+		: verbose(false), version(false), help(false), all(false), raw(false),
+		compress(false), batch(false), jobs(0), daemon(false), remote(false),
+		benchCount(0), benchIoSize(0), benchCompress(false),
+		benchStartup(false), separate(false), createLibrary(false),
+		depfile(false), timeReport(false), kernelReport(KERNEL_REPORT_NONE),
+		lint(false), watch(false),
+		tuneCheck(false),
+		tuneTolerance(1e-4),
+		cacheSize(512ULL << 20), cacheStats(false),
+		clxMode(CLX_NONE), extractIndex(0)
+	{
+	}
+
+	bool verbose;
+	bool version;
+	bool help;
+	bool all;
+
+	// write bare device binaries instead of a clx container
+	bool raw;
+	// compress binaries in the clx container
+	bool compress;
+
+	// compile each input file (and manifest entry) into its own output
+	bool batch;
+	std::string manifest;
+	// worker threads of batch mode, concurrent requests of the daemon,
+	// 0 for hardware concurrency
+	size_t jobs;
+
+	// serve compile requests on socketPath, or send them to it with remote
+	bool daemon;
+	bool remote;
+	std::string socketPath;
+	// number of requests to time with remote, 0 to compile once,
+	// or runs per method with benchIoSize
+	size_t benchCount;
+	// argv elements of --remote, --socket and --bench and their values,
+	// left out of the one-shot runs remote --bench compares with
+	std::vector<const char*> remoteArgs;
+	// bytes of the source generated by the I/O benchmark, 0 to compile
+	unsigned long long benchIoSize;
+	// compare size and load time of compressed and plain containers of
+	// the binaries of infiles
+	bool benchCompress;
+	// compare startup latency of loading outfile with building infiles
+	bool benchStartup;
+
+	std::string outfile;
+	std::vector<std::string> infiles;
+
+	// passed to clBuildProgram, or to clCompileProgram when separate
+	std::string buildOptions;
+
+	// compile each input file with clCompileProgram and link them
+	bool separate;
+	// link into a library instead of an executable, implies separate
+	bool createLibrary;
+	// passed to clLinkProgram
+	std::string linkOptions;
+
+	// header search path, passed to clBuildProgram as -I
+	std::vector<std::string> includeDirs;
+	// write a make style depfile to depfileOut, or next to outfile
+	bool depfile;
+	std::string depfileOut;
+
+	// print time spent in each phase, write phases as a chrome trace
+	bool timeReport;
+	std::string traceFile;
+
+	// print resources and occupancy of each kernel of the built program
+	KernelReport kernelReport;
+
+	// check the inputs for performance problems instead of building
+	bool lint;
+
+	// rebuild whenever an input or one of its headers changes
+	bool watch;
+
+	// autotune: build a variant for each combination of macro values
+	// ("NAME=v1,v2", "@float" for preferred vector widths) and flags,
+	// run tuneKernel of each on kernelArgs (see ParseArgSpecs()) over
+	// globalSize and localSize, which may name macros, and save the
+	// fastest. with tuneCheck, buffers must match the first variant.
+	std::vector<std::string> tuneMacros;
+	std::vector<std::string> tuneFlags;
+	std::string tuneKernel;
+	std::string kernelArgs;
+	std::string globalSize;
+	std::string localSize;
+	bool tuneCheck;
+	double tuneTolerance;
+
+	// empty disables the compile cache
+	std::string cacheDir;
+	unsigned long long cacheSize;
+	bool cacheStats;
+
+	// inspect clx files given as input instead of building
+	ClxMode clxMode;
+	size_t extractIndex;
+};
+
+}
+
 #endif
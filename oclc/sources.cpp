@@ -0,0 +1,96 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "sources.hpp"
+#include "file.hpp"
+
+#include <cerrno>
+
+namespace OCLT
+{
+
+SourceFiles::SourceFiles(bool map)
+	: map_(map)
+{
+}
+
+SourceFiles::~SourceFiles()
+{
+	Clear();
+}
+
+bool SourceFiles::Add(const std::string& path)
+{
+	if(map_)
+	{
+		MappedFile* file = new MappedFile;
+
+		if(file->Open(path))
+		{
+			mapped_.push_back(file);
+			Add(reinterpret_cast<const char*>(file->Data()), file->Size());
+			return true;
+		}
+
+		delete file;
+
+		if(errno != ENODEV)
+		{
+			return false;
+		}
+	}
+
+	// list nodes never move, so the text stays where Texts() points
+	buffers_.push_back(std::vector<char>());
+
+	if(!ReadFile(path, buffers_.back()))
+	{
+		int errorNum = errno;
+		buffers_.pop_back();
+		errno = errorNum;
+		return false;
+	}
+
+	std::vector<char>& buffer = buffers_.back();
+	Add(buffer.empty() ? NULL : &buffer[0], buffer.size());
+
+	return true;
+}
+
+void SourceFiles::Add(const char* data, size_t size)
+{
+	SourceText text;
+	text.data = data;
+	text.size = size;
+
+	texts_.push_back(text);
+}
+
+void SourceFiles::Clear()
+{
+	for(std::vector<MappedFile*>::iterator itr = mapped_.begin();
+		itr != mapped_.end(); ++itr)
+	{
+		delete *itr;
+	}
+
+	mapped_.clear();
+	buffers_.clear();
+	texts_.clear();
+}
+
+}
@@ -0,0 +1,66 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_SOURCES_HPP_
+#define OCLC_SOURCES_HPP_
+
+#include "build.hpp"
+
+#include <list>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+class MappedFile;
+
+// sources of one program. regular files are mapped into memory so that
+// the text reaches clCreateProgramWithSource without being copied, other
+// files (pipes, /dev/stdin) are read into a buffer.
+// a mapped file must not be truncated while it is in use: reading its
+// pages raises SIGBUS. without map every file is read, for files an
+// editor may rewrite in place.
+class SourceFiles
+{
+public:
+	explicit SourceFiles(bool map = true);
+	~SourceFiles();
+
+	// returns false and sets errno on failure
+	bool Add(const std::string& path);
+
+	// text owned by the caller, which must outlive Texts()
+	void Add(const char* data, size_t size);
+
+	void Clear();
+
+	const std::vector<SourceText>& Texts() const { return texts_; }
+
+private:
+	SourceFiles(const SourceFiles&);
+	SourceFiles& operator=(const SourceFiles&);
+
+	bool map_;
+	std::vector<MappedFile*> mapped_;
+	std::list< std::vector<char> > buffers_;
+	std::vector<SourceText> texts_;
+};
+
+}
+
+#endif
@@ -0,0 +1,735 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "tune.hpp"
+#include "build.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+#include "file.hpp"
+#include "includes.hpp"
+#include "kernelargs.hpp"
+#include "sources.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace OCLT
+{
+
+namespace
+{
+
+// variants beyond this are most likely a mistake in the command line
+const size_t iMaxVariants = 4096;
+
+const size_t iDefaultRuns = 10;
+
+// a macro of --tune and the values it takes
+struct TuneMacro
+{
+	std::string name;
+	std::vector<std::string> values;
+};
+
+// one combination of macro values and flags
+struct Variant
+{
+	std::map<std::string, std::string> defines;
+	std::string options;
+};
+
+// a variant run on one device
+struct Timing
+{
+	Timing() : variant(0), error(CL_SUCCESS), time(0), checked(false),
+		same(true), maxError(0) {}
+
+	size_t variant;
+	cl_int error;
+	// median of kernel execution times in milliseconds
+	double time;
+	bool checked;
+	bool same;
+	double maxError;
+};
+
+struct TuneDevice
+{
+	TuneDevice() : platform(0), index(0), device_id(NULL), winner(NULL) {}
+
+	// indices of the context and of the device in it
+	size_t platform;
+	size_t index;
+	cl_device_id device_id;
+	std::vector<Timing> timings;
+	const Timing* winner;
+};
+
+// "NAME=v1,v2,..."
+bool iParseMacro(const std::string& spec, TuneMacro& macro)
+{
+	std::string::size_type equal = spec.find('=');
+
+	if(equal == std::string::npos || !equal || equal + 1 == spec.size())
+	{
+		return false;
+	}
+
+	macro.name = spec.substr(0, equal);
+	macro.values.clear();
+
+	std::istringstream iss(spec.substr(equal + 1));
+	std::string value;
+
+	while(std::getline(iss, value, ','))
+	{
+		if(value.empty())
+		{
+			return false;
+		}
+
+		macro.values.push_back(value);
+	}
+
+	return true;
+}
+
+// replace "@<type>" values by the preferred vector width of type on each
+// device, with half and twice of it, as far as OpenCL has such vectors
+bool iExpandWidths(TuneMacro& macro, const std::vector<TuneDevice>& devices)
+{
+	using namespace std;
+
+	vector<string> values;
+
+	for(vector<string>::const_iterator itr = macro.values.begin();
+		itr != macro.values.end(); ++itr)
+	{
+		if((*itr)[0] != '@')
+		{
+			values.push_back(*itr);
+			continue;
+		}
+
+		for(vector<TuneDevice>::const_iterator dev = devices.begin();
+			dev != devices.end(); ++dev)
+		{
+			cl_uint width = GetPreferredVectorWidth(dev->device_id, itr->substr(1));
+
+			if(!width)
+			{
+				return false;
+			}
+
+			const cl_uint candidates[] = { width, width / 2, width * 2 };
+
+			for(size_t i = 0; i < 3; ++i)
+			{
+				cl_uint w = candidates[i];
+
+				if(w == 1 || w == 2 || w == 4 || w == 8 || w == 16)
+				{
+					ostringstream oss;
+					oss << w;
+					values.push_back(oss.str());
+				}
+			}
+		}
+	}
+
+	macro.values.clear();
+
+	for(vector<string>::const_iterator itr = values.begin();
+		itr != values.end(); ++itr)
+	{
+		if(find(macro.values.begin(), macro.values.end(), *itr) ==
+			macro.values.end())
+		{
+			macro.values.push_back(*itr);
+		}
+	}
+
+	return !macro.values.empty();
+}
+
+// every combination, the first takes the first value of each macro and
+// none of the flags
+void iMakeVariants(const std::vector<TuneMacro>& macros,
+	const std::vector<std::string>& flags, size_t count,
+	std::vector<Variant>& variants)
+{
+	using namespace std;
+
+	variants.resize(count);
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		Variant& variant = variants[i];
+		ostringstream oss;
+		size_t rest = i >> flags.size();
+
+		for(size_t j = 0; j < macros.size(); ++j)
+		{
+			const TuneMacro& macro = macros[j];
+			const string& value = macro.values[rest % macro.values.size()];
+			rest /= macro.values.size();
+
+			variant.defines[macro.name] = value;
+			oss << (oss.tellp() ? " " : "") << "-D " << macro.name << "=" << value;
+		}
+
+		for(size_t j = 0; j < flags.size(); ++j)
+		{
+			if(i & (size_t(1) << j))
+			{
+				oss << (oss.tellp() ? " " : "") << flags[j];
+			}
+		}
+
+		variant.options = oss.str();
+	}
+}
+
+// work sizes of spec with macro names replaced by their values
+bool iWorkSizes(const std::string& spec, const Variant& variant,
+	std::vector<size_t>& sizes)
+{
+	using namespace std;
+
+	istringstream iss(spec);
+	string field;
+	string resolved;
+
+	while(getline(iss, field, ','))
+	{
+		map<string, string>::const_iterator itr = variant.defines.find(field);
+
+		resolved += (resolved.empty() ? "" : ",") +
+			(itr != variant.defines.end() ? itr->second : field);
+	}
+
+	return ParseWorkSizes(resolved, sizes);
+}
+
+cl_int iCreateKernel(const PlatformContext& context, const DeviceBinary& binary,
+	const std::string& options, const std::string& name,
+	cl_program& program, cl_kernel& kernel)
+{
+	const unsigned char* data = binary.binary.empty() ? NULL : &binary.binary[0];
+	size_t size = binary.binary.size();
+	cl_int status;
+	cl_int errcode_ret;
+
+	kernel = NULL;
+	program = clCreateProgramWithBinary(context.context, 1, &binary.device_id,
+		&size, &data, &status, &errcode_ret);
+
+	if(errcode_ret)
+	{
+		program = NULL;
+		return errcode_ret;
+	}
+
+	if(cl_int err = clBuildProgram(
+		program, 1, &binary.device_id, options.c_str(), NULL, NULL))
+	{
+		return err;
+	}
+
+	kernel = clCreateKernel(program, name.c_str(), &errcode_ret);
+
+	if(errcode_ret)
+	{
+		kernel = NULL;
+	}
+
+	return errcode_ret;
+}
+
+// a warm-up run whose buffers are read into contents, then runs whose
+// execution times are added to times
+cl_int iTimeKernel(cl_command_queue queue, cl_kernel kernel, KernelArgs& args,
+	const std::vector<size_t>& global, const std::vector<size_t>& local,
+	size_t runs, std::vector< std::vector<unsigned char> >* contents,
+	std::vector<double>& times)
+{
+	if(cl_int err = args.Set(kernel))
+	{
+		return err;
+	}
+
+	std::vector<double> warmup;
+
+	for(size_t i = 0; i <= runs; ++i)
+	{
+		if(cl_int err = args.Reset(queue))
+		{
+			return err;
+		}
+
+		if(cl_int err = TimeKernel(queue, kernel, global, local, 1,
+			i ? times : warmup))
+		{
+			return err;
+		}
+
+		if(!i && contents)
+		{
+			if(cl_int err = args.Read(queue, *contents))
+			{
+				return err;
+			}
+		}
+	}
+
+	return CL_SUCCESS;
+}
+
+double iMedian(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+bool iFaster(const Timing& a, const Timing& b)
+{
+	if(!a.error != !b.error)
+	{
+		return !a.error;
+	}
+
+	return a.time < b.time;
+}
+
+}
+
+int RunTune(const Options& opts)
+{
+	using namespace std;
+
+	vector<TuneMacro> macros(opts.tuneMacros.size());
+	vector<ArgSpec> argSpecs;
+	string error;
+
+	for(size_t i = 0; i < macros.size(); ++i)
+	{
+		if(!iParseMacro(opts.tuneMacros[i], macros[i]))
+		{
+			cerr << "bad --tune: " << opts.tuneMacros[i] << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(opts.tuneKernel.empty() || opts.globalSize.empty())
+	{
+		cerr << "--tune needs --kernel and --global" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!ParseArgSpecs(opts.kernelArgs, argSpecs, error))
+	{
+		cerr << error << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(opts.infiles.empty())
+	{
+		cerr << "no input file" << endl;
+		return EXIT_FAILURE;
+	}
+
+	SourceFiles files;
+
+	for(vector<string>::const_iterator itr = opts.infiles.begin();
+		itr != opts.infiles.end(); ++itr)
+	{
+		if(!files.Add(*itr))
+		{
+			cerr << strerror(errno) << ": " << *itr << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	IncludeScan scan;
+
+	if(!ScanIncludes(opts.infiles, files.Texts(), opts.includeDirs, scan))
+	{
+		cerr << strerror(errno) << ": " << scan.files.back() << endl;
+		return EXIT_FAILURE;
+	}
+
+	// one context per platform holding the tuned devices
+	vector<cl_platform_id> platform_ids;
+	vector<PlatformContext> contexts;
+	vector<TuneDevice> devices;
+
+	if(cl_int err = GetPlatformIDs(platform_ids))
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return EXIT_FAILURE;
+	}
+
+	for(size_t i = 0; i < platform_ids.size(); ++i)
+	{
+		if(!opts.all && !devices.empty()) break;
+
+		PlatformContext context;
+		context.platform_id = platform_ids[i];
+
+		if(cl_int err = GetDeviceIDs(platform_ids[i], context.device_ids))
+		{
+			cerr << "error : " << GetErrorMessage(err) << endl;
+			continue;
+		}
+
+		if(context.device_ids.empty()) continue;
+		if(!opts.all) context.device_ids.resize(1);
+
+		cl_int errcode_ret;
+		context.context = clCreateContext(NULL, context.device_ids.size(),
+			&context.device_ids[0], NULL, NULL, &errcode_ret);
+
+		if(errcode_ret)
+		{
+			cerr << "error : " << GetErrorMessage(errcode_ret) << endl;
+			continue;
+		}
+
+		for(size_t j = 0; j < context.device_ids.size(); ++j)
+		{
+			TuneDevice device;
+			device.platform = contexts.size();
+			device.index = j;
+			device.device_id = context.device_ids[j];
+			devices.push_back(device);
+		}
+
+		contexts.push_back(context);
+	}
+
+	if(devices.empty())
+	{
+		cerr << "no device found" << endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t count = opts.tuneFlags.size() < 16 ?
+		size_t(1) << opts.tuneFlags.size() : iMaxVariants + 1;
+
+	for(size_t i = 0; i < macros.size() && count <= iMaxVariants; ++i)
+	{
+		if(!iExpandWidths(macros[i], devices))
+		{
+			cerr << "bad --tune: " << opts.tuneMacros[i] << endl;
+			count = 0;
+			break;
+		}
+
+		count *= macros[i].values.size();
+	}
+
+	if(count > iMaxVariants)
+	{
+		cerr << "too many variants, at most " << iMaxVariants << endl;
+		count = 0;
+	}
+
+	if(!count)
+	{
+		for(vector<PlatformContext>::iterator itr = contexts.begin();
+			itr != contexts.end(); ++itr)
+		{
+			ReleasePlatformContext(*itr);
+		}
+
+		return EXIT_FAILURE;
+	}
+
+	vector<Variant> variants;
+	iMakeVariants(macros, opts.tuneFlags, count, variants);
+
+	// build every variant for every platform
+	vector< vector<PlatformBuild> > builds(contexts.size(),
+		vector<PlatformBuild>(variants.size()));
+	string baseOptions = CompileOptions(opts.buildOptions, scan);
+	size_t tasks = contexts.size() * variants.size();
+	size_t workers = opts.jobs ? opts.jobs : thread::hardware_concurrency();
+	atomic<size_t> next(0);
+	vector<thread> threads;
+
+	for(size_t i = 0; i < min(max(workers, size_t(1)), tasks); ++i)
+	{
+		threads.push_back(thread([&, i]()
+		{
+			ostringstream name;
+			name << "tune worker " << i;
+			SetTraceThreadName(name.str());
+
+			for(size_t task; (task = next++) < tasks; )
+			{
+				size_t p = task % contexts.size();
+				size_t v = task / contexts.size();
+
+				BuildProgram(contexts[p], files.Texts(),
+					baseOptions + " " + variants[v].options, builds[p][v]);
+			}
+		}));
+	}
+
+	for(vector<thread>::iterator itr = threads.begin();
+		itr != threads.end(); ++itr)
+	{
+		itr->join();
+	}
+
+	// run variants one at a time, so that they do not disturb each other
+	size_t runs = opts.benchCount ? opts.benchCount : iDefaultRuns;
+
+	for(vector<TuneDevice>::iterator dev = devices.begin();
+		dev != devices.end(); ++dev)
+	{
+		const PlatformContext& context = contexts[dev->platform];
+		cl_int errcode_ret;
+		cl_command_queue queue = clCreateCommandQueue(context.context,
+			dev->device_id, CL_QUEUE_PROFILING_ENABLE, &errcode_ret);
+
+		KernelArgs args;
+
+		if(!errcode_ret)
+		{
+			errcode_ret = args.Create(context.context, argSpecs);
+		}
+
+		vector< vector<unsigned char> > reference;
+		bool checking = opts.tuneCheck;
+
+		dev->timings.resize(variants.size());
+
+		for(size_t v = 0; v < variants.size(); ++v)
+		{
+			TraceSpan span("tune run", variants[v].options);
+
+			Timing& timing = dev->timings[v];
+			const PlatformBuild& build = builds[dev->platform][v];
+			const DeviceBinary* binary = NULL;
+
+			timing.variant = v;
+
+			for(size_t j = 0; j < build.binaries.size(); ++j)
+			{
+				if(build.binaries[j].device_id == dev->device_id)
+				{
+					binary = &build.binaries[j];
+				}
+			}
+
+			vector<size_t> global;
+			vector<size_t> local;
+
+			if(errcode_ret || build.error)
+			{
+				timing.error = errcode_ret ? errcode_ret : build.error;
+			}
+			else if(!binary)
+			{
+				timing.error = CL_INVALID_BINARY;
+			}
+			else if(!iWorkSizes(opts.globalSize, variants[v], global) ||
+				(!opts.localSize.empty() &&
+					(!iWorkSizes(opts.localSize, variants[v], local) ||
+					local.size() != global.size())))
+			{
+				timing.error = CL_INVALID_WORK_DIMENSION;
+			}
+
+			cl_program program = NULL;
+			cl_kernel kernel = NULL;
+
+			if(!timing.error)
+			{
+				timing.error = iCreateKernel(context, *binary,
+					baseOptions + " " + variants[v].options, opts.tuneKernel,
+					program, kernel);
+			}
+
+			vector< vector<unsigned char> > contents;
+			vector<double> times;
+
+			if(!timing.error)
+			{
+				timing.error = iTimeKernel(queue, kernel, args, global, local,
+					runs, checking ? &contents : NULL, times);
+			}
+
+			if(kernel) clReleaseKernel(kernel);
+			if(program) clReleaseProgram(program);
+
+			if(!timing.error)
+			{
+				timing.time = iMedian(times);
+			}
+
+			if(!checking)
+			{
+				continue;
+			}
+
+			if(!v)
+			{
+				if(timing.error)
+				{
+					cerr << "warning : reference variant failed, " <<
+						"results are not checked" << endl;
+					checking = false;
+				}
+
+				reference.swap(contents);
+			}
+			else if(!timing.error)
+			{
+				timing.checked = true;
+				timing.same = args.Compare(reference, contents,
+					opts.tuneTolerance, timing.maxError);
+			}
+		}
+
+		args.Release();
+
+		if(queue) clReleaseCommandQueue(queue);
+	}
+
+	for(vector<PlatformContext>::iterator itr = contexts.begin();
+		itr != contexts.end(); ++itr)
+	{
+		ReleasePlatformContext(*itr);
+	}
+
+	// report, fastest first, and pick the fastest variant which passed
+	vector<PlatformBuild> results(contexts.size());
+	ostringstream optionsFile;
+
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		results[i].platform_id = contexts[i].platform_id;
+		results[i].error = CL_SUCCESS;
+	}
+
+	for(vector<TuneDevice>::iterator dev = devices.begin();
+		dev != devices.end(); ++dev)
+	{
+		stable_sort(dev->timings.begin(), dev->timings.end(), iFaster);
+
+		for(vector<Timing>::const_iterator itr = dev->timings.begin();
+			itr != dev->timings.end() && !dev->winner; ++itr)
+		{
+			if(!itr->error && itr->same)
+			{
+				dev->winner = &*itr;
+			}
+		}
+
+		cout << "platform " << dev->platform << " device " << dev->index << ": " <<
+			GetDeviceInfoString(dev->device_id, CL_DEVICE_NAME) << endl;
+
+		for(vector<Timing>::const_iterator itr = dev->timings.begin();
+			itr != dev->timings.end(); ++itr)
+		{
+			const Variant& variant = variants[itr->variant];
+
+			cout << (&*itr == dev->winner ? "* " : "  ");
+
+			if(itr->error)
+			{
+				cout << "error : " << GetErrorMessage(itr->error);
+			}
+			else
+			{
+				cout << fixed << setprecision(4) << setw(10) << itr->time << " ms";
+
+				if(itr->checked)
+				{
+					cout << (itr->same ? "  ok" : "  mismatch");
+				}
+
+				if(itr->checked && itr->maxError)
+				{
+					cout << " (max error " << scientific << setprecision(1) <<
+						itr->maxError << ")";
+				}
+			}
+
+			cout << "  " << (variant.options.empty() ? "(none)" : variant.options);
+			cout << (itr->variant ? "" : "  [reference]") << endl;
+		}
+
+		if(!dev->winner)
+		{
+			continue;
+		}
+
+		const PlatformBuild& build = builds[dev->platform][dev->winner->variant];
+
+		for(size_t j = 0; j < build.binaries.size(); ++j)
+		{
+			if(build.binaries[j].device_id == dev->device_id)
+			{
+				results[dev->platform].binaries.push_back(build.binaries[j]);
+			}
+		}
+
+		string fingerprint = GetDeviceFingerprint(dev->device_id);
+
+		for(string::size_type pos; (pos = fingerprint.find('\n')) != string::npos; )
+		{
+			fingerprint.replace(pos, 1, " / ");
+		}
+
+		optionsFile << fingerprint << ": " << opts.buildOptions <<
+			(opts.buildOptions.empty() ? "" : " ") <<
+			variants[dev->winner->variant].options << endl;
+	}
+
+	const string optionsText = optionsFile.str();
+
+	if(optionsText.empty())
+	{
+		cerr << "no variant succeeded" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!SaveBinaries(
+		opts.outfile, results, opts.raw, opts.all, opts.compress) ||
+		!WriteFileAtomic(opts.outfile + ".options",
+			optionsText.data(), optionsText.size()))
+	{
+		cerr << strerror(errno) << ": " << opts.outfile << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+}
@@ -0,0 +1,37 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_TUNE_HPP_
+#define OCLC_TUNE_HPP_
+
+#include "options.hpp"
+
+namespace OCLT
+{
+
+// build a variant of the sources for every combination of opts.tuneMacros
+// values and opts.tuneFlags, compiled in parallel, and time
+// opts.tuneKernel of each with profiling events on synthetic arguments.
+// the fastest variant of every device is written to opts.outfile and its
+// options to opts.outfile + ".options". with opts.tuneCheck, variants
+// whose buffers differ from those of the first variant are not chosen.
+// returns process exit status.
+int RunTune(const Options& opts);
+
+}
+
+#endif
@@ -0,0 +1,481 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "watch.hpp"
+#include "batch.hpp"
+#include "build.hpp"
+#include "errors.hpp"
+#include "includes.hpp"
+#include "session.hpp"
+#include "sources.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <set>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+// quiet time which ends a burst of saves
+const int iDebounceMs = 150;
+
+const uint32_t iWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE;
+
+struct WatchedProgram
+{
+	WatchedProgram() : dirty(true) {}
+
+	std::vector<std::string> infiles;
+	std::string outfile;
+	// inputs and headers, see iCanonical()
+	std::set<std::string> files;
+	// canonical text of the last successful build
+	std::string digest;
+	bool dirty;
+};
+
+// path with its directory resolved, so that a file which an editor
+// replaces by renaming another one over it keeps its name
+std::string iCanonical(const std::string& path)
+{
+	using namespace std;
+
+	string::size_type slash = path.find_last_of('/');
+	string directory = slash == string::npos ? "." : slash ? path.substr(0, slash) : "/";
+	char resolved[PATH_MAX];
+
+	if(!realpath(directory.c_str(), resolved))
+	{
+		return path;
+	}
+
+	return string(resolved) + (strcmp(resolved, "/") ? "/" : "") +
+		path.substr(slash == string::npos ? 0 : slash + 1);
+}
+
+std::string iNow()
+{
+	time_t now = time(NULL);
+	char text[16];
+
+	strftime(text, sizeof(text), "%H:%M:%S", localtime(&now));
+
+	return text;
+}
+
+class Watcher
+{
+public:
+	Watcher(const Options& opts, CompileCache& cache)
+		: opts_(opts), cache_(cache), fd_(-1)
+	{
+	}
+
+	~Watcher()
+	{
+		if(fd_ >= 0)
+		{
+			close(fd_);
+		}
+	}
+
+	bool Prepare();
+	int Run();
+
+private:
+	void Build(WatchedProgram& program);
+	void Watch(const std::string& file);
+	// block until a burst of events ends, mark the programs it touched
+	bool WaitForChanges();
+
+	const Options& opts_;
+	CompileCache& cache_;
+	BuildSession session_;
+	std::vector<cl_platform_id> platform_ids_;
+	std::vector<WatchedProgram> programs_;
+	int fd_;
+	std::map<int, std::string> directories_;
+	std::set<std::string> watched_;
+};
+
+bool Watcher::Prepare()
+{
+	using namespace std;
+
+	if(opts_.batch)
+	{
+		map<string, string> writers;
+
+		for(size_t i = 0; i < opts_.infiles.size(); ++i)
+		{
+			WatchedProgram program;
+			program.infiles.push_back(opts_.infiles[i]);
+			program.outfile = BatchOutfile(opts_, opts_.infiles[i]);
+			programs_.push_back(program);
+
+			pair<map<string, string>::iterator, bool> inserted =
+				writers.insert(make_pair(program.outfile, opts_.infiles[i]));
+
+			if(!inserted.second)
+			{
+				cerr << inserted.first->second << " and " << opts_.infiles[i] <<
+					" are both built into " << program.outfile << endl;
+				return false;
+			}
+		}
+	}
+	else
+	{
+		WatchedProgram program;
+		program.infiles = opts_.infiles;
+		program.outfile = opts_.outfile;
+		programs_.push_back(program);
+	}
+
+	if(cl_int err = session_.GetPlatformIDs(platform_ids_))
+	{
+		cerr << "error : " << GetErrorMessage(err) << endl;
+		return false;
+	}
+
+	if(platform_ids_.empty())
+	{
+		cerr << "no platform on system" << endl;
+		return false;
+	}
+
+	if(!opts_.all)
+	{
+		platform_ids_.resize(1);
+	}
+
+	fd_ = inotify_init1(IN_CLOEXEC);
+
+	if(fd_ < 0)
+	{
+		cerr << strerror(errno) << ": inotify" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+void Watcher::Watch(const std::string& file)
+{
+	using namespace std;
+
+	string::size_type slash = file.find_last_of('/');
+	string directory = slash ? file.substr(0, slash) : "/";
+
+	if(slash == string::npos || !watched_.insert(directory).second)
+	{
+		return;
+	}
+
+	int wd = inotify_add_watch(fd_, directory.c_str(), iWatchMask);
+
+	if(wd < 0)
+	{
+		cerr << "warning : " << strerror(errno) << ": " << directory << endl;
+		watched_.erase(directory);
+		return;
+	}
+
+	directories_[wd] = directory;
+}
+
+void Watcher::Build(WatchedProgram& program)
+{
+	using namespace std;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	program.dirty = false;
+
+	// watched even when they can not be read, a later save brings them
+	for(size_t i = 0; i < program.infiles.size(); ++i)
+	{
+		program.files.insert(iCanonical(program.infiles[i]));
+		Watch(iCanonical(program.infiles[i]));
+	}
+
+	// read, not mapped: an editor may truncate a file while it is scanned
+	SourceFiles files(false);
+
+	for(size_t i = 0; i < program.infiles.size(); ++i)
+	{
+		if(!files.Add(program.infiles[i]))
+		{
+			cerr << iNow() << " " << strerror(errno) << ": " <<
+				program.infiles[i] << endl;
+			program.digest.clear();
+			return;
+		}
+	}
+
+	const vector<SourceText>& sources = files.Texts();
+	IncludeScan scan;
+	bool scanned = ScanIncludes(
+		program.infiles, sources, opts_.includeDirs, scan, false);
+
+	program.files.clear();
+
+	for(size_t i = 0; i < scan.files.size(); ++i)
+	{
+		program.files.insert(iCanonical(scan.files[i]));
+		Watch(iCanonical(scan.files[i]));
+	}
+
+	if(!scanned)
+	{
+		cerr << iNow() << " " << strerror(errno) << ": " << scan.files.back() << endl;
+		program.digest.clear();
+		return;
+	}
+
+	// empty when an include was not resolved, the compiler may then find
+	// a header which did change
+	string digest = CacheDigest(scan);
+
+	if(!digest.empty() && digest == program.digest)
+	{
+		if(opts_.verbose)
+		{
+			cout << iNow() << " " << program.outfile <<
+				": only comments or whitespace changed, not built" << endl;
+		}
+
+		return;
+	}
+
+	string buildOptions = CompileOptions(opts_.buildOptions, scan);
+	vector<PlatformBuild> results(platform_ids_.size());
+	bool failed = false;
+	bool cached = true;
+
+	for(size_t i = 0; i < platform_ids_.size(); ++i)
+	{
+		const PlatformContext* context = NULL;
+		cl_int err = session_.GetContext(platform_ids_[i], context);
+
+		results[i].platform_id = platform_ids_[i];
+		results[i].error = err;
+
+		if(!err && cache_.IsOpen() && cache_.LoadPlatform(digest,
+			opts_.buildOptions, platform_ids_[i], context->device_ids, results[i]))
+		{
+			continue;
+		}
+
+		cached = false;
+
+		if(!err)
+		{
+			session_.Build(platform_ids_[i], sources, buildOptions, results[i]);
+
+			if(!results[i].error)
+			{
+				cache_.StorePlatform(digest, opts_.buildOptions, results[i]);
+			}
+		}
+
+		if(!results[i].log.empty())
+		{
+			cout << results[i].log << endl;
+		}
+
+		if(results[i].error)
+		{
+			cerr << "error : " << GetErrorMessage(results[i].error) << endl;
+			failed = true;
+		}
+	}
+
+	// the first device only, as a build without -a
+	if(!opts_.all && results[0].binaries.size() > 1)
+	{
+		results[0].binaries.resize(1);
+	}
+
+	if(!failed && !SaveBinaries(
+		program.outfile, results, opts_.raw, opts_.all, opts_.compress))
+	{
+		cerr << strerror(errno) << ": " << program.outfile << endl;
+		failed = true;
+	}
+
+	if(!failed && opts_.depfile && !opts_.batch)
+	{
+		string depfile = opts_.depfileOut.empty() ?
+			DefaultDepfile(program.outfile) : opts_.depfileOut;
+
+		if(!WriteDepfile(depfile, program.outfile, scan.files))
+		{
+			cerr << strerror(errno) << ": " << depfile << endl;
+		}
+	}
+
+	double ms = chrono::duration<double, milli>(
+		chrono::steady_clock::now() - start).count();
+	char line[128];
+
+	snprintf(line, sizeof(line), "%s %s: %s in %.1f ms%s", iNow().c_str(),
+		program.outfile.c_str(), failed ? "failed" : "built", ms,
+		cached && !failed ? " (cached)" : "");
+	(failed ? cerr : cout) << line << endl;
+
+	program.digest = failed ? string() : digest;
+}
+
+bool Watcher::WaitForChanges()
+{
+	using namespace std;
+
+	// aligned for the events read into it
+	union
+	{
+		struct inotify_event event;
+		char bytes[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+	} buffer;
+
+	bool changed = false;
+
+	for(;;)
+	{
+		struct pollfd poll_fd = {fd_, POLLIN, 0};
+		int ready = poll(&poll_fd, 1, changed ? iDebounceMs : -1);
+
+		if(ready < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(ready <= 0)
+		{
+			return !ready;
+		}
+
+		ssize_t size = read(fd_, buffer.bytes, sizeof(buffer.bytes));
+
+		if(size < 0)
+		{
+			if(errno == EINTR || errno == EAGAIN)
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		for(ssize_t offset = 0; offset < size; )
+		{
+			const struct inotify_event* event =
+				reinterpret_cast<const struct inotify_event*>(buffer.bytes + offset);
+
+			offset += sizeof(struct inotify_event) + event->len;
+
+			// events were lost, anything may have changed
+			if(event->mask & IN_Q_OVERFLOW)
+			{
+				for(size_t i = 0; i < programs_.size(); ++i)
+				{
+					programs_[i].dirty = changed = true;
+				}
+
+				continue;
+			}
+
+			map<int, string>::const_iterator directory = directories_.find(event->wd);
+
+			if(!event->len || directory == directories_.end())
+			{
+				continue;
+			}
+
+			string path = directory->second +
+				(directory->second == "/" ? "" : "/") + event->name;
+
+			for(size_t i = 0; i < programs_.size(); ++i)
+			{
+				if(programs_[i].files.count(path))
+				{
+					programs_[i].dirty = changed = true;
+				}
+			}
+		}
+	}
+}
+
+int Watcher::Run()
+{
+	using namespace std;
+
+	for(size_t i = 0; i < programs_.size(); ++i)
+	{
+		Build(programs_[i]);
+	}
+
+	cout << iNow() << " watching " << watched_.size() << " directories for " <<
+		programs_.size() << " programs" << endl;
+
+	for(;;)
+	{
+		if(!WaitForChanges())
+		{
+			cerr << strerror(errno) << ": inotify" << endl;
+			return EXIT_FAILURE;
+		}
+
+		for(size_t i = 0; i < programs_.size(); ++i)
+		{
+			if(programs_[i].dirty)
+			{
+				Build(programs_[i]);
+			}
+		}
+	}
+}
+
+}
+
+int RunWatch(const Options& opts, CompileCache& cache)
+{
+	Watcher watcher(opts, cache);
+
+	if(!watcher.Prepare())
+	{
+		return EXIT_FAILURE;
+	}
+
+	return watcher.Run();
+}
+
+}
@@ -0,0 +1,40 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLC_WATCH_HPP_
+#define OCLC_WATCH_HPP_
+
+#include "cache.hpp"
+#include "options.hpp"
+
+namespace OCLT
+{
+
+// build the inputs, as one program into opts.outfile or with opts.batch
+// each into its own output, and rebuild a program whenever one of its
+// inputs or the headers they include is saved. the directories of those
+// files are watched with inotify, a burst of saves is waited out before
+// building, and programs whose canonical text did not change (see
+// CanonicalSource()) are not built again. contexts are created once by a
+// BuildSession and kept, each rebuild prints its build log and time.
+// returns process exit status when watching fails, runs until killed
+// otherwise.
+int RunWatch(const Options& opts, CompileCache& cache);
+
+}
+
+#endif
@@ -0,0 +1,442 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "bandwidth.hpp"
+#include "device.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace OCLT
+{
+
+const char* const TransferMethodNames[TRANSFER_METHODS] = {
+	"write", "read", "map-wr", "map-rd", "host-wr", "host-rd",
+	"uhost-wr", "uhost-rd", "copy" };
+
+namespace
+{
+
+const size_t iMinBytes = 4096;
+const unsigned iWarmup = 2;
+
+// a method is only advised over the ones listed before it when it is
+// this much faster, so that noise does not split size classes
+const double iAdviceMargin = 1.1;
+
+// host pointer offset of the unaligned CL_MEM_USE_HOST_PTR buffers,
+// still aligned for float
+const size_t iUnalignedOffset = sizeof(cl_float);
+
+const TransferMethod iToDevice[] = {
+	TRANSFER_WRITE, TRANSFER_MAP_WRITE,
+	TRANSFER_HOST_WRITE, TRANSFER_UNALIGNED_WRITE };
+
+const TransferMethod iToHost[] = {
+	TRANSFER_READ, TRANSFER_MAP_READ,
+	TRANSFER_HOST_READ, TRANSFER_UNALIGNED_READ };
+
+std::string iSize(size_t bytes)
+{
+	std::ostringstream str;
+
+	if(bytes >= (1 << 20) && !(bytes & ((1 << 20) - 1)))
+	{
+		str << (bytes >> 20) << "M";
+	}
+	else if(bytes >= (1 << 10) && !(bytes & ((1 << 10) - 1)))
+	{
+		str << (bytes >> 10) << "K";
+	}
+	else
+	{
+		str << bytes;
+	}
+
+	return str.str();
+}
+
+std::string iDescription(TransferMethod method, size_t alignment)
+{
+	std::ostringstream str;
+
+	switch(method)
+	{
+	case TRANSFER_WRITE:
+		return "clEnqueueWriteBuffer";
+	case TRANSFER_READ:
+		return "clEnqueueReadBuffer";
+	case TRANSFER_MAP_WRITE:
+	case TRANSFER_MAP_READ:
+		return "map a CL_MEM_ALLOC_HOST_PTR buffer";
+	case TRANSFER_HOST_WRITE:
+	case TRANSFER_HOST_READ:
+		str << "map a CL_MEM_USE_HOST_PTR buffer on " <<
+			alignment << " byte aligned memory";
+		return str.str();
+	case TRANSFER_UNALIGNED_WRITE:
+	case TRANSFER_UNALIGNED_READ:
+		return "map a CL_MEM_USE_HOST_PTR buffer on unaligned memory";
+	default:
+		return "clEnqueueCopyBuffer";
+	}
+}
+
+cl_int iCreateBuffer(cl_context context, TransferMethod method,
+	size_t bytes, unsigned char* host, cl_mem& buffer)
+{
+	cl_mem_flags flags = CL_MEM_READ_WRITE;
+	void* host_ptr = NULL;
+
+	switch(method)
+	{
+	case TRANSFER_MAP_WRITE:
+	case TRANSFER_MAP_READ:
+		flags |= CL_MEM_ALLOC_HOST_PTR;
+		break;
+	case TRANSFER_HOST_WRITE:
+	case TRANSFER_HOST_READ:
+		flags |= CL_MEM_USE_HOST_PTR;
+		host_ptr = host;
+		break;
+	case TRANSFER_UNALIGNED_WRITE:
+	case TRANSFER_UNALIGNED_READ:
+		flags |= CL_MEM_USE_HOST_PTR;
+		host_ptr = host + iUnalignedOffset;
+		break;
+	default:
+		break;
+	}
+
+	cl_int err = CL_SUCCESS;
+	buffer = clCreateBuffer(context, flags, bytes, host_ptr, &err);
+
+	return err;
+}
+
+cl_int iMapCopy(cl_command_queue queue, cl_mem buffer, bool to_device,
+	size_t bytes, unsigned char* data)
+{
+	cl_int err = CL_SUCCESS;
+
+	// the whole buffer is overwritten, so its old contents need not be
+	// copied into the mapping
+#ifdef CL_VERSION_1_2
+	cl_map_flags write = CL_MAP_WRITE_INVALIDATE_REGION;
+#else
+	cl_map_flags write = CL_MAP_WRITE;
+#endif
+
+	void* mapped = clEnqueueMapBuffer(queue, buffer, CL_TRUE,
+		to_device ? write : CL_MAP_READ, 0, bytes, 0, NULL, NULL, &err);
+
+	if(err)
+	{
+		return err;
+	}
+
+	if(to_device)
+	{
+		memcpy(mapped, data, bytes);
+	}
+	else
+	{
+		memcpy(data, mapped, bytes);
+	}
+
+	err = clEnqueueUnmapMemObject(queue, buffer, mapped, 0, NULL, NULL);
+
+	return err ? err : clFinish(queue);
+}
+
+// one transfer of bytes between data and buffer, or buffer and other
+cl_int iTransfer(cl_command_queue queue, TransferMethod method,
+	cl_mem buffer, cl_mem other, size_t bytes, unsigned char* data)
+{
+	cl_int err;
+
+	switch(method)
+	{
+	case TRANSFER_WRITE:
+		return clEnqueueWriteBuffer(
+			queue, buffer, CL_TRUE, 0, bytes, data, 0, NULL, NULL);
+	case TRANSFER_READ:
+		return clEnqueueReadBuffer(
+			queue, buffer, CL_TRUE, 0, bytes, data, 0, NULL, NULL);
+	case TRANSFER_MAP_WRITE:
+	case TRANSFER_HOST_WRITE:
+	case TRANSFER_UNALIGNED_WRITE:
+		return iMapCopy(queue, buffer, true, bytes, data);
+	case TRANSFER_MAP_READ:
+	case TRANSFER_HOST_READ:
+	case TRANSFER_UNALIGNED_READ:
+		return iMapCopy(queue, buffer, false, bytes, data);
+	default:
+		err = clEnqueueCopyBuffer(
+			queue, buffer, other, 0, 0, bytes, 0, NULL, NULL);
+		return err ? err : clFinish(queue);
+	}
+}
+
+// median GB/s of runs transfers, 0 on failure
+double iMeasure(cl_context context, cl_command_queue queue,
+	TransferMethod method, size_t bytes, unsigned runs,
+	unsigned char* host, unsigned char* data)
+{
+	using namespace std;
+
+	cl_mem buffer = NULL;
+	cl_mem other = NULL;
+
+	if(iCreateBuffer(context, method, bytes, host, buffer))
+	{
+		return 0;
+	}
+
+	if(method == TRANSFER_COPY &&
+		iCreateBuffer(context, method, bytes, host, other))
+	{
+		clReleaseMemObject(buffer);
+		return 0;
+	}
+
+	vector<double> seconds;
+
+	for(unsigned i = 0; i < iWarmup + runs; ++i)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		if(iTransfer(queue, method, buffer, other, bytes, data))
+		{
+			seconds.clear();
+			break;
+		}
+
+		if(i >= iWarmup)
+		{
+			seconds.push_back(chrono::duration<double>(
+				chrono::steady_clock::now() - start).count());
+		}
+	}
+
+	if(other)
+	{
+		clReleaseMemObject(other);
+	}
+
+	clReleaseMemObject(buffer);
+
+	if(seconds.empty())
+	{
+		return 0;
+	}
+
+	sort(seconds.begin(), seconds.end());
+
+	double median = seconds[seconds.size() / 2];
+
+	return median > 0 ? bytes / median / 1e9 : 0;
+}
+
+void iMeasureSizes(cl_context context, cl_command_queue queue,
+	size_t max_bytes, unsigned runs, unsigned char* host,
+	unsigned char* data, BandwidthReport& report)
+{
+	for(size_t bytes = iMinBytes; bytes <= max_bytes; bytes *= 4)
+	{
+		BandwidthResult result;
+		result.bytes = bytes;
+
+		for(int i = 0; i < TRANSFER_METHODS; ++i)
+		{
+			result.gbps[i] = iMeasure(context, queue,
+				static_cast<TransferMethod>(i), bytes, runs, host, data);
+		}
+
+		report.results.push_back(result);
+	}
+}
+
+}
+
+cl_int MeasureBandwidth(cl_device_id device, size_t max_bytes,
+	unsigned runs, BandwidthReport& report)
+{
+	using namespace std;
+
+	report.device = GetDeviceInfoString(device, CL_DEVICE_NAME);
+	report.unifiedMemory =
+		GetDeviceInfoValue<cl_bool>(device, CL_DEVICE_HOST_UNIFIED_MEMORY) != CL_FALSE;
+	report.alignment = max<size_t>(sysconf(_SC_PAGESIZE),
+		GetDeviceInfoValue<cl_uint>(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN) / 8);
+	report.results.clear();
+
+	max_bytes = min<cl_ulong>(max_bytes,
+		GetDeviceInfoValue<cl_ulong>(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE));
+
+	cl_int err = CL_SUCCESS;
+
+	cl_context context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+
+	if(err)
+	{
+		return err;
+	}
+
+	cl_command_queue queue = clCreateCommandQueue(context, device, 0, &err);
+
+	if(err)
+	{
+		clReleaseContext(context);
+		return err;
+	}
+
+	void* host = NULL;
+	vector<unsigned char> data(max(max_bytes, iMinBytes));
+
+	for(size_t i = 0; i < data.size(); ++i)
+	{
+		data[i] = static_cast<unsigned char>(i * 7);
+	}
+
+	if(posix_memalign(&host, report.alignment, data.size() + iUnalignedOffset))
+	{
+		err = CL_OUT_OF_HOST_MEMORY;
+	}
+	else
+	{
+		iMeasureSizes(context, queue, max_bytes, runs,
+			static_cast<unsigned char*>(host), &data[0], report);
+		free(host);
+	}
+
+	clReleaseCommandQueue(queue);
+	clReleaseContext(context);
+
+	return err;
+}
+
+void AdviseTransfers(const BandwidthReport& report, bool to_device,
+	std::vector<TransferAdvice>& advice)
+{
+	const TransferMethod* methods = to_device ? iToDevice : iToHost;
+
+	advice.clear();
+
+	for(size_t i = 0; i < report.results.size(); ++i)
+	{
+		const BandwidthResult& result = report.results[i];
+		TransferMethod best = methods[0];
+
+		for(size_t j = 1; j < sizeof(iToDevice) / sizeof(iToDevice[0]); ++j)
+		{
+			if(result.gbps[methods[j]] > result.gbps[best] * iAdviceMargin)
+			{
+				best = methods[j];
+			}
+		}
+
+		if(!result.gbps[best])
+		{
+			continue;
+		}
+
+		if(!advice.empty() && advice.back().method == best &&
+			advice.back().maxBytes * 4 == result.bytes)
+		{
+			advice.back().maxBytes = result.bytes;
+			continue;
+		}
+
+		TransferAdvice range = { result.bytes, result.bytes, best };
+		advice.push_back(range);
+	}
+}
+
+void PrintBandwidth(std::ostream& out, const BandwidthReport& report)
+{
+	using namespace std;
+
+	char line[128];
+
+	out << "-- bandwidth " << report.device << " (unified memory: " <<
+		(report.unifiedMemory ? "yes" : "no") << ", GB/s, median)" << endl;
+
+	snprintf(line, sizeof(line), "%6s", "size");
+	out << line;
+
+	for(int i = 0; i < TRANSFER_METHODS; ++i)
+	{
+		snprintf(line, sizeof(line), " %9s", TransferMethodNames[i]);
+		out << line;
+	}
+
+	out << endl;
+
+	for(size_t i = 0; i < report.results.size(); ++i)
+	{
+		const BandwidthResult& result = report.results[i];
+
+		snprintf(line, sizeof(line), "%6s", iSize(result.bytes).c_str());
+		out << line;
+
+		for(int j = 0; j < TRANSFER_METHODS; ++j)
+		{
+			if(result.gbps[j])
+			{
+				snprintf(line, sizeof(line), " %9.3f", result.gbps[j]);
+			}
+			else
+			{
+				snprintf(line, sizeof(line), " %9s", "-");
+			}
+
+			out << line;
+		}
+
+		out << endl;
+	}
+
+	for(int direction = 0; direction < 2; ++direction)
+	{
+		vector<TransferAdvice> advice;
+		AdviseTransfers(report, direction == 0, advice);
+
+		for(size_t i = 0; i < advice.size(); ++i)
+		{
+			string range = iSize(advice[i].minBytes);
+
+			if(advice[i].maxBytes != advice[i].minBytes)
+			{
+				range += " - " + iSize(advice[i].maxBytes);
+			}
+
+			snprintf(line, sizeof(line), "%-15s %-12s ",
+				direction == 0 ? "host to device" : "device to host",
+				range.c_str());
+			out << line << iDescription(advice[i].method, report.alignment) << endl;
+		}
+	}
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLQ_BANDWIDTH_HPP_
+#define OCLQ_BANDWIDTH_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+enum TransferMethod
+{
+	TRANSFER_WRITE,            // clEnqueueWriteBuffer
+	TRANSFER_READ,             // clEnqueueReadBuffer
+	TRANSFER_MAP_WRITE,        // CL_MEM_ALLOC_HOST_PTR, map, copy in, unmap
+	TRANSFER_MAP_READ,         // CL_MEM_ALLOC_HOST_PTR, map, copy out, unmap
+	TRANSFER_HOST_WRITE,       // CL_MEM_USE_HOST_PTR on aligned memory
+	TRANSFER_HOST_READ,
+	TRANSFER_UNALIGNED_WRITE,  // CL_MEM_USE_HOST_PTR on unaligned memory
+	TRANSFER_UNALIGNED_READ,
+	TRANSFER_COPY,             // clEnqueueCopyBuffer between device buffers
+	TRANSFER_METHODS,
+};
+
+// short names used as column headers
+extern const char* const TransferMethodNames[TRANSFER_METHODS];
+
+struct BandwidthResult
+{
+	size_t bytes;
+	double gbps[TRANSFER_METHODS];  // median, 0 when the method failed
+};
+
+struct BandwidthReport
+{
+	std::string device;
+	bool unifiedMemory;  // CL_DEVICE_HOST_UNIFIED_MEMORY
+	size_t alignment;    // of the aligned host memory, bytes
+	std::vector<BandwidthResult> results;
+};
+
+// the fastest method for buffers from minBytes to maxBytes
+struct TransferAdvice
+{
+	size_t minBytes;
+	size_t maxBytes;
+	TransferMethod method;
+};
+
+// time every transfer method for buffer sizes from 4KB to max_bytes
+// (stepping by 4x, bounded by CL_DEVICE_MAX_MEM_ALLOC_SIZE) on a context
+// of its own. transfers are timed on the host from enqueue to completion,
+// mapped transfers include copying the data in or out of the mapping.
+// a method which fails is recorded as 0 GB/s.
+cl_int MeasureBandwidth(cl_device_id device, size_t max_bytes,
+	unsigned runs, BandwidthReport& report);
+
+// consecutive sizes on which the same method of one direction (host to
+// device or device to host) is fastest, as size classes. copying with
+// clEnqueueWrite/ReadBuffer is preferred unless mapping is clearly faster
+void AdviseTransfers(const BandwidthReport& report, bool to_device,
+	std::vector<TransferAdvice>& advice);
+
+// the table of a report followed by the advice of both directions
+void PrintBandwidth(std::ostream& out, const BandwidthReport& report);
+
+}
+
+#endif
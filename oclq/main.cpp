@@ -15,8 +15,14 @@
  *    See the License for the specific language governing permissions and
  *    limitations under the License.
  */
+#include "bandwidth.hpp"
+#include "capabilities.hpp"
 #include "errors.hpp"
+#include "file.hpp"
 #include "names.hpp"
+#include "options.hpp"
+#include "partitions.hpp"
+#include "printer.hpp"
 
 #if !APPLE
 	#include <CL/cl.h>
@@ -24,6 +30,10 @@
 	#include <OpenCL/opencl.h>
 #endif
 
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -32,6 +42,12 @@
 static const int gVersionMajor = 1;
 static const int gVersionMinor = 0;
 
+static const size_t gBandwidthMaxBytes = 64 << 20;
+// the smallest size MeasureBandwidth() times
+static const size_t gBandwidthMinBytes = 4 << 10;
+static const unsigned gBandwidthRuns = 10;
+static const unsigned gPartitionRuns = 5;
+
 static void IfErrorThenExit(int error);
 
 static std::string GetPlatformInfo(cl_platform_id id, cl_platform_info info);
@@ -44,11 +60,15 @@ template<typename T>
 static T GetDeviceInfo(cl_device_id device_id, cl_device_info info);
 static std::string GetDeviceInfo(cl_device_id device_id, cl_device_info info);
 
-static void PrintPlatform(cl_platform_id platform_id, bool verbose);
-static void PrintDevice(cl_platform_id platform_id, cl_device_id device_id, bool verbose);
+static void PrintPlatform(
+	OCLT::InfoPrinter& out, cl_platform_id platform_id, bool verbose);
+static void PrintDevice(OCLT::InfoPrinter& out,
+	cl_platform_id platform_id, cl_device_id device_id, bool verbose);
+static void PrintBandwidth(cl_device_id device_id, size_t max_bytes);
+static void PrintPartitions(cl_device_id device_id);
+static int WriteSnapshot(const std::string& path);
 
-static void GetOpts(
-	int argc, char* argv[], bool& verbose, bool& version, bool& help);
+static void GetOpts(int argc, char* argv[], OCLT::Options& opts);
 
 int
 main(int argc, char* argv[])
@@ -56,27 +76,53 @@ main(int argc, char* argv[])
 	using namespace std;
 	using namespace OCLT;
 
-	bool verbose = false;
-	bool version = false;
-	bool help = false;
+	Options opts;
 
-	GetOpts(argc, argv, verbose, version, help);
+	GetOpts(argc, argv, opts);
 
-	if(help)
+	if(opts.help)
 	{
 		cout << "usage: " << argv[0] << " [options]" << endl <<
+			"  -b --bandwidth[=max]" << endl <<
+			"               measure host-device transfer bandwidth of every" << endl <<
+			"               device for sizes up to max (default 64M) and" << endl <<
+			"               recommend a buffer strategy per size" << endl <<
+			"  -f --format=text|json" << endl <<
+			"               print as text (default) or as json with every" << endl <<
+			"               value, typed" << endl <<
+			"  -P --partitions" << endl <<
+			"               split every device into sub-devices by affinity" << endl <<
+			"               domain, equally and by counts and compare the" << endl <<
+			"               aggregate bandwidth and compute throughput" << endl <<
+			"  -s --snapshot[=file]" << endl <<
+			"               write the capabilities of every device to file" << endl <<
+			"               (default $OCLT_SNAPSHOT or" << endl <<
+			"               ~/.cache/oclt/capabilities) for liboclt users" << endl <<
 			"  -v --verbose print detail" << endl <<
 			"  -h --help    print help" << endl <<
 			"  -V --version print version information" << endl;
 		exit(EXIT_SUCCESS);
 	}
 
-	if(version)
+	if(opts.version)
 	{
 		cout << "oclq version " << gVersionMajor << "." << gVersionMinor << endl;
 		exit(EXIT_SUCCESS);
 	}
 
+	if(opts.snapshot)
+	{
+		return WriteSnapshot(opts.snapshotPath.empty() ?
+			GetDefaultSnapshotPath() : opts.snapshotPath);
+	}
+
+	TextPrinter text(cout);
+	JsonPrinter json(cout);
+	InfoPrinter& out = opts.format == Options::FORMAT_JSON ?
+		static_cast<InfoPrinter&>(json) : text;
+	bool verbose = opts.verbose || opts.format == Options::FORMAT_JSON;
+	bool measuring = opts.bandwidth || opts.partitions;
+
 	cl_uint num_platforms;
 
 	IfErrorThenExit( clGetPlatformIDs(0, NULL, &num_platforms) );
@@ -93,7 +139,11 @@ main(int argc, char* argv[])
 
 	for(cl_uint i = 0; i < num_platforms; ++i)
 	{
-		PrintPlatform(platforms[i], verbose);
+		if(!measuring)
+		{
+			out.BeginPlatform();
+			PrintPlatform(out, platforms[i], verbose);
+		}
 
 		cl_uint device_num = 0;
 
@@ -102,6 +152,11 @@ main(int argc, char* argv[])
 
 		if(!device_num)
 		{
+			if(!measuring)
+			{
+				out.EndPlatform();
+			}
+
 			continue;
 		}
 
@@ -112,7 +167,25 @@ main(int argc, char* argv[])
 
 		for(size_t j = 0; j < device_num; ++j)
 		{
-			PrintDevice(platforms[i], devices[j], verbose);
+			if(opts.bandwidth)
+			{
+				PrintBandwidth(devices[j], opts.bandwidth);
+			}
+			else if(opts.partitions)
+			{
+				PrintPartitions(devices[j]);
+			}
+			else
+			{
+				out.BeginDevice();
+				PrintDevice(out, platforms[i], devices[j], verbose);
+				out.EndDevice();
+			}
+		}
+
+		if(!measuring)
+		{
+			out.EndPlatform();
 		}
 
 		delete[] devices;
@@ -120,221 +193,272 @@ main(int argc, char* argv[])
 
 	delete[] platforms;
 
+	if(!measuring)
+	{
+		out.Finish();
+	}
+
 	return 0;
 }
 
-static void PrintPlatform(cl_platform_id platform_id, bool verbose)
+static void PrintPlatform(
+	OCLT::InfoPrinter& out, cl_platform_id platform_id, bool verbose)
 {
-	using namespace std;
+	out.Id("ID", platform_id);
 
-	cout << "---- platform" << endl;
-	cout << "ID: " << platform_id << endl;
+	out.String("CL_PLATFORM_PROFILE",
+		GetPlatformInfo(platform_id, CL_PLATFORM_PROFILE));
 
-	cout << "CL_PLATFORM_PROFILE: " <<
-		GetPlatformInfo(platform_id, CL_PLATFORM_PROFILE) << endl;
+	out.String("CL_PLATFORM_VERSION",
+		GetPlatformInfo(platform_id, CL_PLATFORM_VERSION));
 
-	cout << "CL_PLATFORM_VERSION: " <<
-		GetPlatformInfo(platform_id, CL_PLATFORM_VERSION) << endl;
+	out.String("CL_PLATFORM_NAME",
+		GetPlatformInfo(platform_id, CL_PLATFORM_NAME));
 
-	cout << "CL_PLATFORM_NAME: " <<
-		GetPlatformInfo(platform_id, CL_PLATFORM_NAME) << endl;
+	out.String("CL_PLATFORM_VENDOR",
+		GetPlatformInfo(platform_id, CL_PLATFORM_VENDOR));
 
-	cout << "CL_PLATFORM_VENDOR: " <<
-		GetPlatformInfo(platform_id, CL_PLATFORM_VENDOR) << endl;
 
-
-	cout << "CL_PLATFORM_EXTENSIONS: " <<
-		GetPlatformInfo(platform_id, CL_PLATFORM_EXTENSIONS) << endl;
+	out.String("CL_PLATFORM_EXTENSIONS",
+		GetPlatformInfo(platform_id, CL_PLATFORM_EXTENSIONS));
 }
 
-static void PrintDevice(cl_platform_id platform_id, cl_device_id device_id, bool verbose)
+static void PrintDevice(OCLT::InfoPrinter& out,
+	cl_platform_id platform_id, cl_device_id device_id, bool verbose)
 {
 	using namespace std;
 
-	cout << "-- device" << endl;
-
-	cout << "ID: " << device_id << endl;
-	cout << "CL_DEVICE_TYPE: " << GetDeviceType(device_id) << endl;
-	cout << "CL_DEVICE_VENDOR_ID: " <<
-		"0x" << hex << GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_VENDOR_ID) << dec << endl;
-	cout << "CL_DEVICE_MAX_COMPUTE_UNITS: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_COMPUTE_UNITS) << endl;
+	out.Id("ID", device_id);
+	out.String("CL_DEVICE_TYPE", GetDeviceType(device_id));
+	out.Hex("CL_DEVICE_VENDOR_ID",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_VENDOR_ID));
+	out.Number("CL_DEVICE_MAX_COMPUTE_UNITS",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_COMPUTE_UNITS));
 	
-	cout << "CL_DEVICE_PLATFORM: " << "0x" << hex <<
-		GetDeviceInfo<cl_platform_id>(device_id, CL_DEVICE_PLATFORM) << dec << endl;
+	out.Id("CL_DEVICE_PLATFORM",
+		GetDeviceInfo<cl_platform_id>(device_id, CL_DEVICE_PLATFORM));
 
-	cout << "CL_DEVICE_NAME: " <<
-		GetDeviceInfo(device_id, CL_DEVICE_NAME) << endl;
+	out.String("CL_DEVICE_NAME",
+		GetDeviceInfo(device_id, CL_DEVICE_NAME));
 
-	cout << "CL_DEVICE_VENDOR: " <<
-		GetDeviceInfo(device_id, CL_DEVICE_VENDOR) << endl;
+	out.String("CL_DEVICE_VENDOR",
+		GetDeviceInfo(device_id, CL_DEVICE_VENDOR));
 
-	cout << "CL_DEVICE_VERSION: " <<
-		GetDeviceInfo(device_id, CL_DEVICE_VERSION) << endl;
+	out.String("CL_DEVICE_VERSION",
+		GetDeviceInfo(device_id, CL_DEVICE_VERSION));
 
-	cout << "CL_DEVICE_PROFILE: " <<
-		GetDeviceInfo(device_id, CL_DEVICE_PROFILE) << endl;
+	out.String("CL_DEVICE_PROFILE",
+		GetDeviceInfo(device_id, CL_DEVICE_PROFILE));
 
-	cout << "CL_DEVICE_OPENCL_C_VERSION: " <<
-		GetDeviceInfo(device_id, CL_DEVICE_OPENCL_C_VERSION) << endl;
+	out.String("CL_DEVICE_OPENCL_C_VERSION",
+		GetDeviceInfo(device_id, CL_DEVICE_OPENCL_C_VERSION));
 
-	cout << "CL_DRIVER_VERSION: " <<
-		GetDeviceInfo(device_id, CL_DRIVER_VERSION) << endl;
+	out.String("CL_DRIVER_VERSION",
+		GetDeviceInfo(device_id, CL_DRIVER_VERSION));
 
-	cout << "CL_DEVICE_EXTENSIONS: " <<
-		GetDeviceInfo(device_id, CL_DEVICE_EXTENSIONS) << endl;
+	out.String("CL_DEVICE_EXTENSIONS",
+		GetDeviceInfo(device_id, CL_DEVICE_EXTENSIONS));
 
 	if(!verbose) return;
 
-	cl_uint max_work_item_dimensions = 0;
-	cout << "CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS: " <<
-		( max_work_item_dimensions =
-			GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS) ) <<
-			endl;
-
-	std::vector<size_t> work_item_sizes =
-		GetDeviceMaxWorkItemSizes(device_id, max_work_item_dimensions);
-
-	cout << "CL_DEVICE_MAX_WORK_ITEM_SIZES:";
-
-	for(vector<size_t>::const_iterator itr = work_item_sizes.begin();
-		itr != work_item_sizes.end(); ++itr) cout << " " << (*itr);
-
-	cout << endl;
-
-	cout << "CL_DEVICE_MAX_WORK_GROUP_SIZE: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE) << endl;
-
-	cout << "CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR) << endl;
-	cout << "CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT) << endl;
-	cout << "CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT) << endl;
-	cout << "CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG) << endl;
-	cout << "CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT) << endl;
-	cout << "CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE) << endl;
-	cout << "CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF) << endl;
-
-	cout << "CL_DEVICE_NATIVE_VECTOR_WIDTH_CHAR: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_CHAR) << endl;
-	cout << "CL_DEVICE_NATIVE_VECTOR_WIDTH_SHORT: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_SHORT) << endl;
-	cout << "CL_DEVICE_NATIVE_VECTOR_WIDTH_INT: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_INT) << endl;
-	cout << "CL_DEVICE_NATIVE_VECTOR_WIDTH_LONG: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_LONG) << endl;
-	cout << "CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT) << endl;
-	cout << "CL_DEVICE_NATIVE_VECTOR_WIDTH_DOUBLE: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_DOUBLE) << endl;
-	cout << "CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF) << endl;
-
-	cout << "CL_DEVICE_MAX_CLOCK_FREQUENCY: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_CLOCK_FREQUENCY) << endl;
-	cout << "CL_DEVICE_ADDRESS_BITS: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_ADDRESS_BITS) << endl;
-	cout << "CL_DEVICE_MAX_MEM_ALLOC_SIZE: " <<
-		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE) << endl;
-	cout << "CL_DEVICE_IMAGE_SUPPORT: " <<
-		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_IMAGE_SUPPORT) << endl;
-	cout << "CL_DEVICE_MAX_READ_IMAGE_ARGS: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_READ_IMAGE_ARGS) << endl;
-	cout << "CL_DEVICE_IMAGE2D_MAX_WIDTH: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE2D_MAX_WIDTH) << endl;
-	cout << "CL_DEVICE_IMAGE2D_MAX_HEIGHT: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE2D_MAX_HEIGHT) << endl;
-	cout << "CL_DEVICE_IMAGE3D_MAX_WIDTH: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE3D_MAX_WIDTH) << endl;
-	cout << "CL_DEVICE_IMAGE3D_MAX_HEIGHT: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE3D_MAX_HEIGHT) << endl;
-	cout << "CL_DEVICE_IMAGE3D_MAX_DEPTH: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE3D_MAX_DEPTH) << endl;
-	cout << "CL_DEVICE_MAX_SAMPLERS: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_SAMPLERS) << endl;
-	cout << "CL_DEVICE_MAX_PARAMETER_SIZE: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_MAX_PARAMETER_SIZE) << endl;
-	cout << "CL_DEVICE_MEM_BASE_ADDR_ALIGN: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MEM_BASE_ADDR_ALIGN) << endl;
-	cout << "CL_DEVICE_MIN_DATA_TYPE_ALIGN_SIZE: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MIN_DATA_TYPE_ALIGN_SIZE) << endl;
+	cl_uint max_work_item_dimensions =
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS);
+	out.Number("CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS", max_work_item_dimensions);
+
+	out.Numbers("CL_DEVICE_MAX_WORK_ITEM_SIZES",
+		GetDeviceMaxWorkItemSizes(device_id, max_work_item_dimensions));
+
+	out.Number("CL_DEVICE_MAX_WORK_GROUP_SIZE",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE));
+
+	out.Number("CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR));
+	out.Number("CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT));
+	out.Number("CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT));
+	out.Number("CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG));
+	out.Number("CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT));
+	out.Number("CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE));
+	out.Number("CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF));
+
+	out.Number("CL_DEVICE_NATIVE_VECTOR_WIDTH_CHAR",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_CHAR));
+	out.Number("CL_DEVICE_NATIVE_VECTOR_WIDTH_SHORT",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_SHORT));
+	out.Number("CL_DEVICE_NATIVE_VECTOR_WIDTH_INT",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_INT));
+	out.Number("CL_DEVICE_NATIVE_VECTOR_WIDTH_LONG",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_LONG));
+	out.Number("CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT));
+	out.Number("CL_DEVICE_NATIVE_VECTOR_WIDTH_DOUBLE",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_DOUBLE));
+	out.Number("CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF));
+
+	out.Number("CL_DEVICE_MAX_CLOCK_FREQUENCY",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_CLOCK_FREQUENCY));
+	out.Number("CL_DEVICE_ADDRESS_BITS",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_ADDRESS_BITS));
+	out.Number("CL_DEVICE_MAX_MEM_ALLOC_SIZE",
+		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE));
+	out.Bool("CL_DEVICE_IMAGE_SUPPORT",
+		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_IMAGE_SUPPORT));
+	out.Number("CL_DEVICE_MAX_READ_IMAGE_ARGS",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_READ_IMAGE_ARGS));
+	out.Number("CL_DEVICE_IMAGE2D_MAX_WIDTH",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE2D_MAX_WIDTH));
+	out.Number("CL_DEVICE_IMAGE2D_MAX_HEIGHT",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE2D_MAX_HEIGHT));
+	out.Number("CL_DEVICE_IMAGE3D_MAX_WIDTH",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE3D_MAX_WIDTH));
+	out.Number("CL_DEVICE_IMAGE3D_MAX_HEIGHT",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE3D_MAX_HEIGHT));
+	out.Number("CL_DEVICE_IMAGE3D_MAX_DEPTH",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_IMAGE3D_MAX_DEPTH));
+	out.Number("CL_DEVICE_MAX_SAMPLERS",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_SAMPLERS));
+	out.Number("CL_DEVICE_MAX_PARAMETER_SIZE",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_MAX_PARAMETER_SIZE));
+	out.Number("CL_DEVICE_MEM_BASE_ADDR_ALIGN",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MEM_BASE_ADDR_ALIGN));
+	out.Number("CL_DEVICE_MIN_DATA_TYPE_ALIGN_SIZE",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MIN_DATA_TYPE_ALIGN_SIZE));
 
 	cl_device_fp_config fp_config = GetDeviceInfo<cl_device_fp_config>(
 		device_id, CL_DEVICE_SINGLE_FP_CONFIG);
 
-	cout << "CL_DEVICE_SINGLE_FP_CONFIG:" <<
-		(fp_config & CL_FP_DENORM ? "CL_DEVICE_ CL_FP_DENORM" : "") <<
-		(fp_config & CL_FP_INF_NAN ? "CL_DEVICE_ CL_FP_INF_NAN" : "") <<
-		(fp_config & CL_FP_ROUND_TO_NEAREST? "CL_DEVICE_ CL_FP_ROUND_TO_NEAREST" : "") <<
-		(fp_config & CL_FP_ROUND_TO_ZERO? "CL_DEVICE_ CL_FP_ROUND_TO_ZERO" : "") <<
-		(fp_config & CL_FP_ROUND_TO_INF? "CL_DEVICE_ CL_FP_ROUND_TO_INF" : "") <<
-		(fp_config & CL_FP_FMA ? "CL_DEVICE_ CL_FP_FMA" : "") <<
-		(fp_config & CL_FP_SOFT_FLOAT ? "CL_DEVICE_ CL_FP_SOFT_FLOAT" : "") << endl;
+	vector<string> fp_flags;
+	if(fp_config & CL_FP_DENORM) fp_flags.push_back("CL_FP_DENORM");
+	if(fp_config & CL_FP_INF_NAN) fp_flags.push_back("CL_FP_INF_NAN");
+	if(fp_config & CL_FP_ROUND_TO_NEAREST) fp_flags.push_back("CL_FP_ROUND_TO_NEAREST");
+	if(fp_config & CL_FP_ROUND_TO_ZERO) fp_flags.push_back("CL_FP_ROUND_TO_ZERO");
+	if(fp_config & CL_FP_ROUND_TO_INF) fp_flags.push_back("CL_FP_ROUND_TO_INF");
+	if(fp_config & CL_FP_FMA) fp_flags.push_back("CL_FP_FMA");
+	if(fp_config & CL_FP_SOFT_FLOAT) fp_flags.push_back("CL_FP_SOFT_FLOAT");
+
+	out.Flags("CL_DEVICE_SINGLE_FP_CONFIG", fp_flags);
 	
 	cl_device_mem_cache_type mem_cache_type = GetDeviceInfo<cl_device_mem_cache_type>(
 		device_id, CL_DEVICE_GLOBAL_MEM_CACHE_TYPE);
 	
-	cout << "CL_DEVICE_GLOBAL_MEM_CACHE_TYPE: " <<
-		(mem_cache_type == CL_NONE ? "CL_DEVICE_CL_NONE" :
-			mem_cache_type == CL_READ_ONLY_CACHE ? "CL_DEVICE_CL_READ_ONLY_CACHE" :
-			mem_cache_type == CL_READ_WRITE_CACHE ? "CL_DEVICE_CL_READ_WRITE_CACHE" : "unknown") << endl;
-
-	cout << "CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE) << endl;
-	cout << "CL_DEVICE_GLOBAL_MEM_CACHE_SIZE: " <<
-		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_CACHE_SIZE) << endl;
-	cout << "CL_DEVICE_GLOBAL_MEM_SIZE: " <<
-		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_SIZE) << endl;
-
-	cout << "CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE: " <<
-		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE) << endl;
-	cout << "CL_DEVICE_MAX_CONSTANT_ARGS: " <<
-		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_CONSTANT_ARGS) << endl;
+	out.Enum("CL_DEVICE_GLOBAL_MEM_CACHE_TYPE",
+		mem_cache_type == CL_NONE ? "CL_NONE" :
+			mem_cache_type == CL_READ_ONLY_CACHE ? "CL_READ_ONLY_CACHE" :
+			mem_cache_type == CL_READ_WRITE_CACHE ? "CL_READ_WRITE_CACHE" : "unknown");
+
+	out.Number("CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE));
+	out.Number("CL_DEVICE_GLOBAL_MEM_CACHE_SIZE",
+		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_CACHE_SIZE));
+	out.Number("CL_DEVICE_GLOBAL_MEM_SIZE",
+		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_SIZE));
+
+	out.Number("CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE",
+		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE));
+	out.Number("CL_DEVICE_MAX_CONSTANT_ARGS",
+		GetDeviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_CONSTANT_ARGS));
 
 	cl_device_local_mem_type local_mem_type = GetDeviceInfo<cl_device_local_mem_type>(
 		device_id, CL_DEVICE_LOCAL_MEM_TYPE);
 	
-	cout << "CL_DEVICE_LOCAL_MEM_TYPE: " <<
-		(local_mem_type == CL_LOCAL ? "CL_DEVICE_CL_LOCAL" :
-			local_mem_type == CL_GLOBAL? "CL_DEVICE_CL_GLOBAL" : "unknown") << endl;
-
-	cout << "CL_DEVICE_LOCAL_MEM_SIZE: " <<
-		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_LOCAL_MEM_SIZE) << endl;
-
-	cout << "CL_DEVICE_ERROR_CORRECTION_SUPPORT: " <<
-		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_ERROR_CORRECTION_SUPPORT) << endl;
-	cout << "CL_DEVICE_HOST_UNIFIED_MEMORY: " <<
-		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_HOST_UNIFIED_MEMORY) << endl;
-	cout << "CL_DEVICE_PROFILING_TIMER_RESOLUTION: " <<
-		GetDeviceInfo<size_t>(device_id, CL_DEVICE_PROFILING_TIMER_RESOLUTION) << endl;
-	cout << "CL_DEVICE_ENDIAN_LITTLE: " <<
-		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_ENDIAN_LITTLE) << endl;
-	cout << "CL_DEVICE_AVAILABLE: " <<
-		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_AVAILABLE) << endl;
-	cout << "CL_DEVICE_COMPILER_AVAILABLE: " <<
-		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_COMPILER_AVAILABLE) << endl;
+	out.Enum("CL_DEVICE_LOCAL_MEM_TYPE",
+		local_mem_type == CL_LOCAL ? "CL_LOCAL" :
+			local_mem_type == CL_GLOBAL? "CL_GLOBAL" : "unknown");
+
+	out.Number("CL_DEVICE_LOCAL_MEM_SIZE",
+		GetDeviceInfo<cl_ulong>(device_id, CL_DEVICE_LOCAL_MEM_SIZE));
+
+	out.Bool("CL_DEVICE_ERROR_CORRECTION_SUPPORT",
+		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_ERROR_CORRECTION_SUPPORT));
+	out.Bool("CL_DEVICE_HOST_UNIFIED_MEMORY",
+		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_HOST_UNIFIED_MEMORY));
+	out.Number("CL_DEVICE_PROFILING_TIMER_RESOLUTION",
+		GetDeviceInfo<size_t>(device_id, CL_DEVICE_PROFILING_TIMER_RESOLUTION));
+	out.Bool("CL_DEVICE_ENDIAN_LITTLE",
+		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_ENDIAN_LITTLE));
+	out.Bool("CL_DEVICE_AVAILABLE",
+		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_AVAILABLE));
+	out.Bool("CL_DEVICE_COMPILER_AVAILABLE",
+		GetDeviceInfo<cl_bool>(device_id, CL_DEVICE_COMPILER_AVAILABLE));
 
 	cl_device_exec_capabilities exec_capabilities =
 		GetDeviceInfo<cl_device_exec_capabilities>(
 			device_id, CL_DEVICE_EXECUTION_CAPABILITIES);
+
+	vector<string> exec_flags;
+	if(exec_capabilities & CL_EXEC_KERNEL) exec_flags.push_back("CL_EXEC_KERNEL");
+	if(exec_capabilities & CL_EXEC_NATIVE_KERNEL) exec_flags.push_back("CL_EXEC_NATIVE_KERNEL");
 	
-	cout << "CL_DEVICE_EXECUTION_CAPABILITIES:" <<
-		(exec_capabilities & CL_EXEC_KERNEL ? "CL_DEVICE_ CL_EXEC_KERNEL" : "") <<
-		(exec_capabilities & CL_EXEC_NATIVE_KERNEL ? "CL_DEVICE_ CL_EXEC_NATIVE_KERNEL" : "") << endl;
+	out.Flags("CL_DEVICE_EXECUTION_CAPABILITIES", exec_flags);
 	
 	cl_command_queue_properties queue_properties =
 		GetDeviceInfo<cl_command_queue_properties>(device_id, CL_DEVICE_QUEUE_PROPERTIES);
 
-	cout << "CL_DEVICE_QUEUE_PROPERTIES:" <<
-		(queue_properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE ?
-			"CL_DEVICE_ CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE" : "") <<
-		(queue_properties & CL_QUEUE_PROFILING_ENABLE ?
-			"CL_DEVICE_ CL_QUEUE_PROFILING_ENABLE" : "") << endl;
+	vector<string> queue_flags;
+	if(queue_properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)
+		queue_flags.push_back("CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE");
+	if(queue_properties & CL_QUEUE_PROFILING_ENABLE)
+		queue_flags.push_back("CL_QUEUE_PROFILING_ENABLE");
+
+	out.Flags("CL_DEVICE_QUEUE_PROPERTIES", queue_flags);
+}
+
+static void PrintBandwidth(cl_device_id device_id, size_t max_bytes)
+{
+	OCLT::BandwidthReport report;
+
+	IfErrorThenExit( OCLT::MeasureBandwidth(
+		device_id, max_bytes, gBandwidthRuns, report) );
+
+	OCLT::PrintBandwidth(std::cout, report);
+}
+
+static void PrintPartitions(cl_device_id device_id)
+{
+#ifdef CL_VERSION_1_2
+	OCLT::PartitionReport report;
+
+	IfErrorThenExit( OCLT::ExplorePartitions(
+		device_id, gPartitionRuns, report) );
+
+	OCLT::PrintPartitions(std::cout, report);
+#else
+	// rejected by GetOpts
+	(void)device_id;
+#endif
+}
+
+static int WriteSnapshot(const std::string& path)
+{
+	OCLT::CapabilitySnapshot snapshot;
+
+	IfErrorThenExit( OCLT::QueryCapabilities(snapshot) );
+
+	std::string::size_type slash = path.rfind('/');
+
+	if(slash != std::string::npos && slash &&
+		!OCLT::MakeDirectories(path.substr(0, slash)))
+	{
+		std::cerr << "can not create directory of " << path << ": " <<
+			strerror(errno) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!OCLT::SaveSnapshot(path, snapshot))
+	{
+		std::cerr << "can not write " << path << ": " << strerror(errno) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << path << ": " << snapshot.devices.size() << " devices" << std::endl;
+
+	return EXIT_SUCCESS;
 }
 
 static std::string GetPlatformInfo(
@@ -452,12 +576,9 @@ static void IfErrorThenExit(int error)
 	exit(EXIT_FAILURE);
 }
 
-static void GetOpts(
-	int argc, char* argv[], bool& verbose, bool& version, bool& help)
+static void GetOpts(int argc, char* argv[], OCLT::Options& opts)
 {
-	verbose = false;
-	version = false;
-	help = false;
+	opts = OCLT::Options();
 
 	for(;;)
 	{
@@ -465,29 +586,93 @@ static void GetOpts(
 			{"help", 0, 0, 'h'},
 			{"verbose", 0, 0, 'v'},
 			{"version", 0, 0, 'V'},
+			{"bandwidth", 2, 0, 'b'},
+			{"format", 1, 0, 'f'},
+			{"partitions", 0, 0, 'P'},
+			{"snapshot", 2, 0, 's'},
 			{0,0,0,0}
 		};
 
 		int option_index = 0;
-		int c = getopt_long(argc, argv, "hvV", long_options, &option_index);
+		int c = getopt_long(argc, argv, "hvVb::f:Ps::", long_options, &option_index);
 
 		if(c == -1) break;
 
 		switch(c)
 		{
 		case 'h':
-			help = true;
+			opts.help = true;
 			break;
 		case 'v':
-			verbose = true;
+			opts.verbose = true;
 			break;
 		case 'V':
-			version = true;
+			opts.version = true;
+			break;
+		case 'b':
+			opts.bandwidth = gBandwidthMaxBytes;
+
+			if(optarg)
+			{
+				char* end = optarg;
+
+				if(isdigit(static_cast<unsigned char>(*optarg)))
+				{
+					opts.bandwidth = strtoul(optarg, &end, 10);
+				}
+
+				if(*end == 'K' || *end == 'k')
+				{
+					opts.bandwidth <<= 10;
+					++end;
+				}
+				else if(*end == 'M' || *end == 'm')
+				{
+					opts.bandwidth <<= 20;
+					++end;
+				}
+				else if(*end == 'G' || *end == 'g')
+				{
+					opts.bandwidth <<= 30;
+					++end;
+				}
+
+				if(end == optarg || *end || opts.bandwidth < gBandwidthMinBytes)
+				{
+					std::cerr << "invalid bandwidth size: " << optarg <<
+						" (4K or more, with an optional K, M or G suffix)" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+			break;
+		case 'f':
+			if(std::string(optarg) == "json")
+			{
+				opts.format = OCLT::Options::FORMAT_JSON;
+			}
+			else if(std::string(optarg) == "text")
+			{
+				opts.format = OCLT::Options::FORMAT_TEXT;
+			}
+			else
+			{
+				std::cerr << "unknown format: " << optarg << std::endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'P':
+#ifndef CL_VERSION_1_2
+			std::cerr << "--partitions needs OpenCL 1.2" << std::endl;
+			exit(EXIT_FAILURE);
+#endif
+			opts.partitions = true;
+			break;
+		case 's':
+			opts.snapshot = true;
+			opts.snapshotPath = optarg ? optarg : "";
 			break;
 		default:
 			break;
 		}
 	}
 }
-
-
@@ -0,0 +1,54 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLQ_OPTIONS_HPP_
+#define OCLQ_OPTIONS_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace OCLT
+{
+
+// command line options of oclq
+struct Options
+{
+	enum Format
+	{
+		FORMAT_TEXT,
+		FORMAT_JSON,
+	};
+
+	bool verbose;
+	bool version;
+	bool help;
+	Format format;
+	size_t bandwidth;          // largest transfer, 0 when not measuring
+	bool partitions;
+	bool snapshot;
+	std::string snapshotPath;  // empty for GetDefaultSnapshotPath()
+
+	Options()
+		: verbose(false), version(false), help(false), format(FORMAT_TEXT),
+		bandwidth(0), partitions(false), snapshot(false)
+	{
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,609 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "partitions.hpp"
+#include "device.hpp"
+#include "errors.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#ifdef CL_VERSION_1_2
+
+namespace OCLT
+{
+
+namespace
+{
+
+const char* const iProbeSource =
+	"__kernel void fill(__global float* a, __global float* b, __global float* c)\n"
+	"{\n"
+	"	size_t i = get_global_id(0);\n"
+	"	a[i] = 0.0f;\n"
+	"	b[i] = (float)(i & 255);\n"
+	"	c[i] = 1.0f;\n"
+	"}\n"
+	"__kernel void triad(__global float* restrict a,\n"
+	"	__global const float* restrict b, __global const float* restrict c, float s)\n"
+	"{\n"
+	"	size_t i = get_global_id(0);\n"
+	"	a[i] = b[i] + s * c[i];\n"
+	"}\n"
+	"__kernel void chain(__global float* out, float s)\n"
+	"{\n"
+	"	float x = (float)get_global_id(0);\n"
+	"	float y = s;\n"
+	"	for(int i = 0; i < 256; ++i)\n"
+	"	{\n"
+	"		x = mad(x, y, 0.5f);\n"
+	"		y = mad(y, x, 0.25f);\n"
+	"	}\n"
+	"	out[get_global_id(0)] = x + y;\n"
+	"}\n";
+
+// floating point operations of one chain work-item, bytes of one triad
+// element
+const double iChainFlops = 256 * 2 * 2;
+const double iTriadBytes = 3 * sizeof(cl_float);
+
+// work of every split together, divided among its sub-devices in
+// multiples of iGroup
+const size_t iStreamElements = 16 << 20;
+const size_t iChainItems = 1 << 20;
+const size_t iGroup = 64;
+const unsigned iWarmup = 1;
+
+const struct
+{
+	cl_device_affinity_domain domain;
+	const char* name;
+} iDomains[] = {
+	{CL_DEVICE_AFFINITY_DOMAIN_NUMA, "numa"},
+	{CL_DEVICE_AFFINITY_DOMAIN_L4_CACHE, "l4-cache"},
+	{CL_DEVICE_AFFINITY_DOMAIN_L3_CACHE, "l3-cache"},
+	{CL_DEVICE_AFFINITY_DOMAIN_L2_CACHE, "l2-cache"},
+	{CL_DEVICE_AFFINITY_DOMAIN_L1_CACHE, "l1-cache"},
+	{CL_DEVICE_AFFINITY_DOMAIN_NEXT_PARTITIONABLE, "next-partitionable"},
+};
+
+struct Scheme
+{
+	Scheme() : units(0) {}
+
+	std::string name;
+	std::vector<cl_device_partition_property> properties;
+	// compute units of each sub-device of an equal split, 0 for others
+	cl_uint units;
+};
+
+struct SubDevice
+{
+	SubDevice()
+		: queue(NULL), triad(NULL), chain(NULL), a(NULL), b(NULL), c(NULL),
+		out(NULL), elements(0), items(0)
+	{
+	}
+
+	cl_command_queue queue;
+	cl_kernel triad;
+	cl_kernel chain;
+	cl_mem a, b, c, out;
+	size_t elements;
+	size_t items;
+};
+
+const char* iPropertyName(cl_device_partition_property property)
+{
+	switch(property)
+	{
+	case CL_DEVICE_PARTITION_EQUALLY:
+		return "equally";
+	case CL_DEVICE_PARTITION_BY_COUNTS:
+		return "by-counts";
+	case CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN:
+		return "by-affinity-domain";
+	default:
+		return "unknown";
+	}
+}
+
+size_t iShare(size_t total, size_t parts, size_t limit)
+{
+	size_t share = std::min(total / parts, limit);
+	return std::max(iGroup, share / iGroup * iGroup);
+}
+
+void iListSchemes(const PartitionReport& report, std::vector<Scheme>& schemes)
+{
+	const std::vector<cl_device_partition_property>& properties = report.properties;
+	char name[64];
+
+	for(size_t i = 0; i < properties.size(); ++i)
+	{
+		if(properties[i] == CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN)
+		{
+			for(size_t d = 0; d < sizeof(iDomains) / sizeof(iDomains[0]); ++d)
+			{
+				if(!(report.affinityDomains & iDomains[d].domain))
+				{
+					continue;
+				}
+
+				Scheme scheme;
+				scheme.name = std::string("affinity ") + iDomains[d].name;
+				scheme.properties.push_back(CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN);
+				scheme.properties.push_back(iDomains[d].domain);
+				scheme.properties.push_back(0);
+				schemes.push_back(scheme);
+			}
+		}
+		else if(properties[i] == CL_DEVICE_PARTITION_EQUALLY)
+		{
+			for(cl_uint parts = 2; parts <= report.maxSubDevices &&
+				parts <= report.computeUnits; parts *= 2)
+			{
+				// named by the count the driver makes, see ExplorePartitions()
+				Scheme scheme;
+				scheme.units = report.computeUnits / parts;
+				snprintf(name, sizeof(name), "equally by %u", scheme.units);
+				scheme.name = name;
+				scheme.properties.push_back(CL_DEVICE_PARTITION_EQUALLY);
+				scheme.properties.push_back(scheme.units);
+				scheme.properties.push_back(0);
+				schemes.push_back(scheme);
+			}
+		}
+		else if(properties[i] == CL_DEVICE_PARTITION_BY_COUNTS &&
+			report.computeUnits >= 4 && report.maxSubDevices >= 2)
+		{
+			cl_uint large = report.computeUnits * 3 / 4;
+
+			Scheme scheme;
+			snprintf(name, sizeof(name), "counts %u + %u",
+				large, report.computeUnits - large);
+			scheme.name = name;
+			scheme.properties.push_back(CL_DEVICE_PARTITION_BY_COUNTS);
+			scheme.properties.push_back(large);
+			scheme.properties.push_back(report.computeUnits - large);
+			scheme.properties.push_back(CL_DEVICE_PARTITION_BY_COUNTS_LIST_END);
+			scheme.properties.push_back(0);
+			schemes.push_back(scheme);
+		}
+	}
+}
+
+cl_int iSetUp(cl_context context, cl_program program, cl_device_id device,
+	size_t parts, SubDevice& sub)
+{
+	cl_int err = CL_SUCCESS;
+	cl_ulong max_alloc = GetDeviceInfoValue<cl_ulong>(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE);
+	cl_ulong global_mem = GetDeviceInfoValue<cl_ulong>(device, CL_DEVICE_GLOBAL_MEM_SIZE);
+
+	// three arrays within an eighth of the memory of the whole device
+	sub.elements = iShare(iStreamElements, parts, std::min<cl_ulong>(
+		max_alloc, global_mem / 8 / 3 / parts) / sizeof(cl_float));
+	sub.items = iShare(iChainItems, parts, max_alloc / sizeof(cl_float));
+
+	sub.queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+
+	if(!err) sub.triad = clCreateKernel(program, "triad", &err);
+	if(!err) sub.chain = clCreateKernel(program, "chain", &err);
+
+	size_t bytes = sub.elements * sizeof(cl_float);
+
+	if(!err) sub.a = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &err);
+	if(!err) sub.b = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &err);
+	if(!err) sub.c = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &err);
+	if(!err) sub.out = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+		sub.items * sizeof(cl_float), NULL, &err);
+
+	if(err)
+	{
+		return err;
+	}
+
+	// written first by the sub-device which uses them
+	cl_kernel fill = clCreateKernel(program, "fill", &err);
+
+	if(!err) err = clSetKernelArg(fill, 0, sizeof(cl_mem), &sub.a);
+	if(!err) err = clSetKernelArg(fill, 1, sizeof(cl_mem), &sub.b);
+	if(!err) err = clSetKernelArg(fill, 2, sizeof(cl_mem), &sub.c);
+	if(!err) err = clEnqueueNDRangeKernel(
+		sub.queue, fill, 1, NULL, &sub.elements, NULL, 0, NULL, NULL);
+	if(!err) err = clFinish(sub.queue);
+
+	if(fill)
+	{
+		clReleaseKernel(fill);
+	}
+
+	cl_float s = 3.0f;
+
+	if(!err) err = clSetKernelArg(sub.triad, 0, sizeof(cl_mem), &sub.a);
+	if(!err) err = clSetKernelArg(sub.triad, 1, sizeof(cl_mem), &sub.b);
+	if(!err) err = clSetKernelArg(sub.triad, 2, sizeof(cl_mem), &sub.c);
+	if(!err) err = clSetKernelArg(sub.triad, 3, sizeof(s), &s);
+	if(!err) err = clSetKernelArg(sub.chain, 0, sizeof(cl_mem), &sub.out);
+	if(!err) err = clSetKernelArg(sub.chain, 1, sizeof(s), &s);
+
+	return err;
+}
+
+void iRelease(SubDevice& sub)
+{
+	cl_mem mems[] = {sub.a, sub.b, sub.c, sub.out};
+
+	for(size_t i = 0; i < sizeof(mems) / sizeof(mems[0]); ++i)
+	{
+		if(mems[i]) clReleaseMemObject(mems[i]);
+	}
+
+	if(sub.triad) clReleaseKernel(sub.triad);
+	if(sub.chain) clReleaseKernel(sub.chain);
+	if(sub.queue) clReleaseCommandQueue(sub.queue);
+}
+
+double iMedian(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values.empty() ? 0 : values[values.size() / 2];
+}
+
+// run triad or chain on every sub-device at once, median wall time of the
+// runs in seconds and of each sub-device from profiling events
+cl_int iRun(std::vector<SubDevice>& subs, bool triad, unsigned runs,
+	double& seconds, std::vector<double>& subSeconds)
+{
+	using namespace std;
+
+	vector<double> wall;
+	vector< vector<double> > each(subs.size());
+	vector<cl_event> events(subs.size(), NULL);
+
+	for(unsigned r = 0; r < iWarmup + runs; ++r)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		cl_int err = CL_SUCCESS;
+
+		for(size_t s = 0; !err && s < subs.size(); ++s)
+		{
+			size_t* global = triad ? &subs[s].elements : &subs[s].items;
+
+			err = clEnqueueNDRangeKernel(subs[s].queue,
+				triad ? subs[s].triad : subs[s].chain, 1, NULL, global, NULL,
+				0, NULL, &events[s]);
+
+			if(!err) err = clFlush(subs[s].queue);
+		}
+
+		for(size_t s = 0; s < subs.size(); ++s)
+		{
+			cl_int finished = clFinish(subs[s].queue);
+			err = err ? err : finished;
+		}
+
+		double elapsed = chrono::duration<double>(
+			chrono::steady_clock::now() - start).count();
+
+		for(size_t s = 0; s < subs.size(); ++s)
+		{
+			cl_ulong begin = 0;
+			cl_ulong end = 0;
+
+			if(!events[s])
+			{
+				continue;
+			}
+
+			if(!err) err = clGetEventProfilingInfo(events[s],
+				CL_PROFILING_COMMAND_START, sizeof(begin), &begin, NULL);
+			if(!err) err = clGetEventProfilingInfo(events[s],
+				CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+
+			clReleaseEvent(events[s]);
+			events[s] = NULL;
+
+			if(r >= iWarmup)
+			{
+				each[s].push_back((end - begin) * 1e-9);
+			}
+		}
+
+		if(err)
+		{
+			return err;
+		}
+
+		if(r >= iWarmup)
+		{
+			wall.push_back(elapsed);
+		}
+	}
+
+	seconds = iMedian(wall);
+	subSeconds.clear();
+
+	for(size_t s = 0; s < subs.size(); ++s)
+	{
+		subSeconds.push_back(iMedian(each[s]));
+	}
+
+	return CL_SUCCESS;
+}
+
+// probe devices, all of them at once, into result
+cl_int iProbe(const std::vector<cl_device_id>& devices, unsigned runs,
+	PartitionResult& result)
+{
+	using namespace std;
+
+	cl_int err = CL_SUCCESS;
+	cl_context context = clCreateContext(
+		NULL, devices.size(), &devices[0], NULL, NULL, &err);
+
+	if(err)
+	{
+		return err;
+	}
+
+	const char* source = iProbeSource;
+	cl_program program = clCreateProgramWithSource(
+		context, 1, &source, NULL, &err);
+
+	if(!err)
+	{
+		err = clBuildProgram(program, devices.size(), &devices[0], "", NULL, NULL);
+	}
+
+	vector<SubDevice> subs(devices.size());
+
+	for(size_t i = 0; !err && i < devices.size(); ++i)
+	{
+		err = iSetUp(context, program, devices[i], devices.size(), subs[i]);
+	}
+
+	double seconds = 0;
+	vector<double> subSeconds;
+
+	if(!err)
+	{
+		err = iRun(subs, true, runs, seconds, subSeconds);
+	}
+
+	double bytes = 0;
+
+	for(size_t i = 0; !err && i < subs.size(); ++i)
+	{
+		bytes += subs[i].elements * iTriadBytes;
+		result.subGbps.push_back(subSeconds[i] > 0 ?
+			subs[i].elements * iTriadBytes / subSeconds[i] / 1e9 : 0);
+	}
+
+	result.gbps = seconds > 0 ? bytes / seconds / 1e9 : 0;
+
+	if(!err)
+	{
+		err = iRun(subs, false, runs, seconds, subSeconds);
+	}
+
+	double flops = 0;
+
+	for(size_t i = 0; !err && i < subs.size(); ++i)
+	{
+		flops += subs[i].items * iChainFlops;
+	}
+
+	result.gflops = !err && seconds > 0 ? flops / seconds / 1e9 : 0;
+
+	for(size_t i = 0; i < subs.size(); ++i)
+	{
+		iRelease(subs[i]);
+	}
+
+	if(program)
+	{
+		clReleaseProgram(program);
+	}
+
+	clReleaseContext(context);
+
+	return err;
+}
+
+}
+
+cl_int ExplorePartitions(cl_device_id device, unsigned runs,
+	PartitionReport& report)
+{
+	using namespace std;
+
+	report.device = GetDeviceInfoString(device, CL_DEVICE_NAME);
+	report.computeUnits = GetDeviceInfoValue<cl_uint>(device, CL_DEVICE_MAX_COMPUTE_UNITS);
+	report.maxSubDevices =
+		GetDeviceInfoValue<cl_uint>(device, CL_DEVICE_PARTITION_MAX_SUB_DEVICES);
+	report.affinityDomains = GetDeviceInfoValue<cl_device_affinity_domain>(
+		device, CL_DEVICE_PARTITION_AFFINITY_DOMAIN);
+	report.properties.clear();
+	report.results.clear();
+
+	size_t size = 0;
+
+	if(!clGetDeviceInfo(device, CL_DEVICE_PARTITION_PROPERTIES, 0, NULL, &size) &&
+		size >= sizeof(cl_device_partition_property))
+	{
+		vector<cl_device_partition_property> properties(
+			size / sizeof(cl_device_partition_property));
+
+		if(cl_int err = clGetDeviceInfo(device, CL_DEVICE_PARTITION_PROPERTIES,
+			size, &properties[0], NULL))
+		{
+			return err;
+		}
+
+		for(size_t i = 0; i < properties.size() && properties[i]; ++i)
+		{
+			report.properties.push_back(properties[i]);
+		}
+	}
+
+	PartitionResult whole;
+	whole.scheme = "whole device";
+	whole.subDevices = 1;
+	whole.error = iProbe(vector<cl_device_id>(1, device), runs, whole);
+	report.results.push_back(whole);
+
+	vector<Scheme> schemes;
+	iListSchemes(report, schemes);
+
+	for(size_t i = 0; i < schemes.size(); ++i)
+	{
+		PartitionResult result;
+		result.scheme = schemes[i].name;
+		result.subDevices = 0;
+		result.gbps = result.gflops = 0;
+
+		const cl_device_partition_property* properties = &schemes[i].properties[0];
+
+		result.error = clCreateSubDevices(
+			device, properties, 0, NULL, &result.subDevices);
+
+		// units which do not fill a sub-device are left out, and drivers
+		// may cap the count
+		if(!result.error && schemes[i].units)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "equally %u x %u",
+				result.subDevices, schemes[i].units);
+			result.scheme = name;
+		}
+
+		vector<cl_device_id> subs(result.subDevices);
+
+		if(!result.error && result.subDevices)
+		{
+			result.error = clCreateSubDevices(
+				device, properties, subs.size(), &subs[0], NULL);
+
+			if(!result.error)
+			{
+				result.error = iProbe(subs, runs, result);
+			}
+
+			for(size_t s = 0; s < subs.size(); ++s)
+			{
+				if(subs[s]) clReleaseDevice(subs[s]);
+			}
+		}
+
+		report.results.push_back(result);
+	}
+
+	return CL_SUCCESS;
+}
+
+void PrintPartitions(std::ostream& out, const PartitionReport& report)
+{
+	using namespace std;
+
+	char line[256];
+
+	out << "-- partitions " << report.device << " (" << report.computeUnits <<
+		" compute units, up to " << report.maxSubDevices << " sub-devices)" << endl;
+
+	out << "properties:";
+
+	for(size_t i = 0; i < report.properties.size(); ++i)
+	{
+		out << " " << iPropertyName(report.properties[i]);
+	}
+
+	out << (report.properties.empty() ? " none" : "") << endl << "affinity domains:";
+
+	for(size_t d = 0; d < sizeof(iDomains) / sizeof(iDomains[0]); ++d)
+	{
+		if(report.affinityDomains & iDomains[d].domain)
+		{
+			out << " " << iDomains[d].name;
+		}
+	}
+
+	out << (report.affinityDomains ? "" : " none") << endl;
+
+	snprintf(line, sizeof(line), "%-28s %4s %9s %9s  %s",
+		"scheme", "subs", "GB/s", "GFLOP/s", "GB/s of each sub-device");
+	out << line << endl;
+
+	const PartitionResult* bestBandwidth = NULL;
+	const PartitionResult* bestCompute = NULL;
+
+	for(size_t i = 0; i < report.results.size(); ++i)
+	{
+		const PartitionResult& result = report.results[i];
+
+		if(result.error)
+		{
+			snprintf(line, sizeof(line), "%-28s %4u  error : %s",
+				result.scheme.c_str(), result.subDevices,
+				GetErrorMessage(result.error).c_str());
+			out << line << endl;
+			continue;
+		}
+
+		snprintf(line, sizeof(line), "%-28s %4u %9.3f %9.3f ",
+			result.scheme.c_str(), result.subDevices, result.gbps, result.gflops);
+		out << line;
+
+		for(size_t s = 0; s < result.subGbps.size(); ++s)
+		{
+			snprintf(line, sizeof(line), " %.3f", result.subGbps[s]);
+			out << line;
+		}
+
+		out << endl;
+
+		if(!bestBandwidth || result.gbps > bestBandwidth->gbps)
+		{
+			bestBandwidth = &result;
+		}
+
+		if(!bestCompute || result.gflops > bestCompute->gflops)
+		{
+			bestCompute = &result;
+		}
+	}
+
+	const PartitionResult& whole = report.results.front();
+
+	if(!bestBandwidth || whole.error || !whole.gbps || !whole.gflops)
+	{
+		return;
+	}
+
+	snprintf(line, sizeof(line), "best bandwidth: %s (%.2fx the whole device)",
+		bestBandwidth->scheme.c_str(), bestBandwidth->gbps / whole.gbps);
+	out << line << endl;
+
+	snprintf(line, sizeof(line), "best compute:   %s (%.2fx the whole device)",
+		bestCompute->scheme.c_str(), bestCompute->gflops / whole.gflops);
+	out << line << endl;
+}
+
+}
+
+#endif
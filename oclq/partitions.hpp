@@ -0,0 +1,76 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLQ_PARTITIONS_HPP_
+#define OCLQ_PARTITIONS_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// sub-devices need OpenCL 1.2
+#ifdef CL_VERSION_1_2
+
+namespace OCLT
+{
+
+// one way of splitting a device, measured with every sub-device running
+// the probes at once
+struct PartitionResult
+{
+	std::string scheme;
+	cl_int error;        // of clCreateSubDevices or the probes
+	cl_uint subDevices;
+	double gbps;         // aggregate triad bandwidth, median
+	double gflops;       // aggregate mad throughput, median
+	std::vector<double> subGbps;  // of each sub-device in the same runs
+};
+
+struct PartitionReport
+{
+	std::string device;
+	cl_uint computeUnits;
+	cl_uint maxSubDevices;  // CL_DEVICE_PARTITION_MAX_SUB_DEVICES
+	std::vector<cl_device_partition_property> properties;
+	cl_device_affinity_domain affinityDomains;
+	std::vector<PartitionResult> results;  // the whole device first
+};
+
+// query the partitioning support of device and split it by every
+// affinity domain it names, equally into 2, 4, ... sub-devices and by
+// counts into 3/4 and 1/4 of its compute units, as far as supported.
+// each split gets one context, and on each sub-device a queue and buffers
+// first written by that sub-device, so that they are local to its NUMA
+// node on drivers which place memory on first touch. a triad kernel
+// probes bandwidth, a chain of mads compute throughput, the same total
+// work for every split. splits which fail are recorded with their error.
+cl_int ExplorePartitions(cl_device_id device, unsigned runs,
+	PartitionReport& report);
+
+void PrintPartitions(std::ostream& out, const PartitionReport& report);
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "printer.hpp"
+#include "json.hpp"
+
+#include <sstream>
+
+namespace OCLT
+{
+
+TextPrinter::TextPrinter(std::ostream& out)
+	: out_(out)
+{
+}
+
+void TextPrinter::BeginPlatform()
+{
+	out_ << "---- platform" << std::endl;
+}
+
+void TextPrinter::EndPlatform()
+{
+}
+
+void TextPrinter::BeginDevice()
+{
+	out_ << "-- device" << std::endl;
+}
+
+void TextPrinter::EndDevice()
+{
+}
+
+void TextPrinter::Finish()
+{
+}
+
+void TextPrinter::Id(const char* name, const void* id)
+{
+	out_ << name << ": " << id << std::endl;
+}
+
+void TextPrinter::String(const char* name, const std::string& value)
+{
+	out_ << name << ": " << value << std::endl;
+}
+
+void TextPrinter::Number(const char* name, cl_ulong value)
+{
+	out_ << name << ": " << value << std::endl;
+}
+
+void TextPrinter::Hex(const char* name, cl_ulong value)
+{
+	out_ << name << ": 0x" << std::hex << value << std::dec << std::endl;
+}
+
+void TextPrinter::Bool(const char* name, bool value)
+{
+	out_ << name << ": " << (value ? 1 : 0) << std::endl;
+}
+
+void TextPrinter::Numbers(const char* name, const std::vector<size_t>& values)
+{
+	out_ << name << ":";
+
+	for(size_t i = 0; i < values.size(); ++i)
+	{
+		out_ << " " << values[i];
+	}
+
+	out_ << std::endl;
+}
+
+void TextPrinter::Enum(const char* name, const std::string& value)
+{
+	out_ << name << ": " << (value == "unknown" ? "" : "CL_DEVICE_") <<
+		value << std::endl;
+}
+
+void TextPrinter::Flags(const char* name, const std::vector<std::string>& flags)
+{
+	out_ << name << ":";
+
+	for(size_t i = 0; i < flags.size(); ++i)
+	{
+		out_ << "CL_DEVICE_ " << flags[i];
+	}
+
+	out_ << std::endl;
+}
+
+JsonPrinter::JsonPrinter(std::ostream& out)
+	: out_(out), depth_(0), first_(true), devices_(false)
+{
+	Open(NULL, '{');
+	Open("platforms", '[');
+}
+
+void JsonPrinter::BeginPlatform()
+{
+	Open(NULL, '{');
+	devices_ = false;
+}
+
+void JsonPrinter::EndPlatform()
+{
+	if(devices_)
+	{
+		Close(']');
+		devices_ = false;
+	}
+
+	Close('}');
+}
+
+void JsonPrinter::BeginDevice()
+{
+	if(!devices_)
+	{
+		Open("devices", '[');
+		devices_ = true;
+	}
+
+	Open(NULL, '{');
+}
+
+void JsonPrinter::EndDevice()
+{
+	Close('}');
+}
+
+void JsonPrinter::Finish()
+{
+	Close(']');
+	Close('}');
+
+	out_ << json_ << std::endl;
+	json_.clear();
+}
+
+void JsonPrinter::Id(const char* name, const void* id)
+{
+	std::ostringstream str;
+	str << id;
+
+	String(name, str.str());
+}
+
+void JsonPrinter::String(const char* name, const std::string& value)
+{
+	Key(name);
+	AppendJsonString(json_, value);
+}
+
+void JsonPrinter::Number(const char* name, cl_ulong value)
+{
+	std::ostringstream str;
+	str << value;
+
+	Key(name);
+	json_ += str.str();
+}
+
+void JsonPrinter::Hex(const char* name, cl_ulong value)
+{
+	Number(name, value);
+}
+
+void JsonPrinter::Bool(const char* name, bool value)
+{
+	Key(name);
+	json_ += value ? "true" : "false";
+}
+
+void JsonPrinter::Numbers(const char* name, const std::vector<size_t>& values)
+{
+	std::ostringstream str;
+
+	for(size_t i = 0; i < values.size(); ++i)
+	{
+		str << (i ? ", " : "") << values[i];
+	}
+
+	Key(name);
+	json_ += "[" + str.str() + "]";
+}
+
+void JsonPrinter::Enum(const char* name, const std::string& value)
+{
+	String(name, value);
+}
+
+void JsonPrinter::Flags(const char* name, const std::vector<std::string>& flags)
+{
+	Key(name);
+	json_ += "[";
+
+	for(size_t i = 0; i < flags.size(); ++i)
+	{
+		json_ += i ? ", " : "";
+		AppendJsonString(json_, flags[i]);
+	}
+
+	json_ += "]";
+}
+
+void JsonPrinter::Key(const char* name)
+{
+	if(depth_)
+	{
+		json_ += first_ ? "\n" : ",\n";
+		json_.append(depth_, '\t');
+	}
+
+	first_ = false;
+
+	if(name)
+	{
+		AppendJsonString(json_, name);
+		json_ += ": ";
+	}
+}
+
+void JsonPrinter::Open(const char* name, char bracket)
+{
+	Key(name);
+	json_ += bracket;
+
+	++depth_;
+	first_ = true;
+}
+
+void JsonPrinter::Close(char bracket)
+{
+	--depth_;
+
+	if(!first_)
+	{
+		json_ += "\n";
+		json_.append(depth_, '\t');
+	}
+
+	json_ += bracket;
+	first_ = false;
+}
+
+}
@@ -0,0 +1,125 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLQ_PRINTER_HPP_
+#define OCLQ_PRINTER_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+// receives platform and device information as typed values, values
+// belong to the platform or device begun last
+class InfoPrinter
+{
+public:
+	virtual ~InfoPrinter() {}
+
+	virtual void BeginPlatform() = 0;
+	virtual void EndPlatform() = 0;
+	virtual void BeginDevice() = 0;
+	virtual void EndDevice() = 0;
+
+	// after the last platform
+	virtual void Finish() = 0;
+
+	virtual void Id(const char* name, const void* id) = 0;
+	virtual void String(const char* name, const std::string& value) = 0;
+	virtual void Number(const char* name, cl_ulong value) = 0;
+	virtual void Hex(const char* name, cl_ulong value) = 0;
+	virtual void Bool(const char* name, bool value) = 0;
+	virtual void Numbers(const char* name, const std::vector<size_t>& values) = 0;
+
+	// value is the name of an enumerator, or "unknown"
+	virtual void Enum(const char* name, const std::string& value) = 0;
+
+	// names of the bits set in a bitfield
+	virtual void Flags(const char* name, const std::vector<std::string>& flags) = 0;
+};
+
+// the "NAME: value" lines oclq has always printed
+class TextPrinter : public InfoPrinter
+{
+public:
+	explicit TextPrinter(std::ostream& out);
+
+	void BeginPlatform();
+	void EndPlatform();
+	void BeginDevice();
+	void EndDevice();
+	void Finish();
+
+	void Id(const char* name, const void* id);
+	void String(const char* name, const std::string& value);
+	void Number(const char* name, cl_ulong value);
+	void Hex(const char* name, cl_ulong value);
+	void Bool(const char* name, bool value);
+	void Numbers(const char* name, const std::vector<size_t>& values);
+	void Enum(const char* name, const std::string& value);
+	void Flags(const char* name, const std::vector<std::string>& flags);
+
+private:
+	std::ostream& out_;
+};
+
+// {"platforms": [{..., "devices": [{...}]}]} with numbers, booleans,
+// arrays and bitfields as arrays of names
+class JsonPrinter : public InfoPrinter
+{
+public:
+	explicit JsonPrinter(std::ostream& out);
+
+	void BeginPlatform();
+	void EndPlatform();
+	void BeginDevice();
+	void EndDevice();
+	void Finish();
+
+	void Id(const char* name, const void* id);
+	void String(const char* name, const std::string& value);
+	void Number(const char* name, cl_ulong value);
+	void Hex(const char* name, cl_ulong value);
+	void Bool(const char* name, bool value);
+	void Numbers(const char* name, const std::vector<size_t>& values);
+	void Enum(const char* name, const std::string& value);
+	void Flags(const char* name, const std::vector<std::string>& flags);
+
+private:
+	// separator, indent and "name": of the next member or element
+	void Key(const char* name);
+	void Open(const char* name, char bracket);
+	void Close(char bracket);
+
+	std::ostream& out_;
+	std::string json_;
+	int depth_;
+	bool first_;
+	bool devices_;  // the devices array of the platform is open
+};
+
+}
+
+#endif
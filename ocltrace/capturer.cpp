@@ -0,0 +1,263 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "capturer.hpp"
+#include "capture.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace OCLT
+{
+
+namespace
+{
+
+std::atomic<bool> gCapturing(false);
+std::string gCaptureKernel;
+std::string gCapturePath;
+size_t gCaptureLaunch = 1;
+
+// guards the state below, taken by the capture calls only
+std::mutex gCaptureMutex;
+size_t gLaunches = 0;
+std::set<cl_mem> gBuffers;
+std::map< cl_kernel, std::map<cl_uint, CaptureArg> > gArgs;
+
+// arguments which cannot be captured, with the reason
+std::map< cl_kernel, std::map<cl_uint, std::string> > gRefused;
+
+// whether the argument is declared __global or __constant, that is a
+// memory object. without kernel argument info a value of the size of a
+// handle is asked for its memory object type instead
+bool iIsMemoryArgument(cl_kernel kernel, cl_uint index, size_t size, const void* value)
+{
+#ifdef CL_VERSION_1_2
+	cl_kernel_arg_address_qualifier address = 0;
+
+	if(!clGetKernelArgInfo(kernel, index, CL_KERNEL_ARG_ADDRESS_QUALIFIER,
+		sizeof(address), &address, NULL))
+	{
+		return address == CL_KERNEL_ARG_ADDRESS_GLOBAL ||
+			address == CL_KERNEL_ARG_ADDRESS_CONSTANT;
+	}
+#endif
+
+	cl_mem_object_type type;
+
+	return size == sizeof(cl_mem) && !clGetMemObjectInfo(
+		*static_cast<const cl_mem*>(value), CL_MEM_TYPE, sizeof(type), &type, NULL);
+}
+
+// why a memory object argument cannot be captured
+std::string iRefusal(cl_mem mem)
+{
+	cl_mem_object_type type = 0;
+
+	if(clGetMemObjectInfo(mem, CL_MEM_TYPE, sizeof(type), &type, NULL))
+	{
+		return "not a memory object";
+	}
+
+	if(type == CL_MEM_OBJECT_BUFFER)
+	{
+		return "a buffer not created by clCreateBuffer or clCreateSubBuffer";
+	}
+
+#ifdef CL_VERSION_2_0
+	if(type == CL_MEM_OBJECT_PIPE)
+	{
+		return "a pipe";
+	}
+#endif
+
+	return "an image";
+}
+
+}
+
+void StartCapture()
+{
+	const char* env = getenv("OCLTRACE_CAPTURE");
+
+	if(!env || !*env)
+	{
+		return;
+	}
+
+	gCaptureKernel = env;
+
+	size_t colon = gCaptureKernel.find(':');
+
+	if(colon != std::string::npos)
+	{
+		gCaptureLaunch = strtoul(gCaptureKernel.c_str() + colon + 1, NULL, 10);
+		gCaptureKernel.erase(colon);
+	}
+
+	const char* path = getenv("OCLTRACE_CAPTURE_FILE");
+	gCapturePath = path ? path : gCaptureKernel + ".oclcap";
+
+	gCapturing = gCaptureLaunch > 0;
+}
+
+bool IsCapturing()
+{
+	return gCapturing.load(std::memory_order_relaxed);
+}
+
+void CaptureBuffer(cl_mem mem)
+{
+	std::lock_guard<std::mutex> lock(gCaptureMutex);
+	gBuffers.insert(mem);
+}
+
+void ForgetBuffer(cl_mem mem)
+{
+	std::lock_guard<std::mutex> lock(gCaptureMutex);
+	gBuffers.erase(mem);
+}
+
+void ForgetKernel(cl_kernel kernel)
+{
+	std::lock_guard<std::mutex> lock(gCaptureMutex);
+	gArgs.erase(kernel);
+	gRefused.erase(kernel);
+}
+
+void CaptureArgument(cl_kernel kernel, cl_uint index, size_t size, const void* value)
+{
+	bool memory = value && iIsMemoryArgument(kernel, index, size, value);
+
+	std::lock_guard<std::mutex> lock(gCaptureMutex);
+
+	CaptureArg& arg = gArgs[kernel][index];
+	arg = CaptureArg();
+	arg.size = size;
+
+	gRefused[kernel].erase(index);
+
+	if(!value)
+	{
+		arg.kind = CaptureArg::EMPTY;
+	}
+	else if(memory)
+	{
+		cl_mem mem = size == sizeof(cl_mem) ? *static_cast<const cl_mem*>(value) : NULL;
+
+		if(mem && gBuffers.count(mem))
+		{
+			arg.kind = CaptureArg::BUFFER;
+			arg.mem = mem;
+		}
+		else if(!mem)
+		{
+			arg.kind = CaptureArg::EMPTY;
+		}
+		else
+		{
+			gRefused[kernel][index] = iRefusal(mem);
+		}
+	}
+	else
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(value);
+		arg.kind = CaptureArg::VALUE;
+		arg.value.assign(bytes, bytes + size);
+	}
+}
+
+void CaptureKernel(cl_command_queue queue,
+	cl_kernel kernel, cl_uint work_dim, const size_t* global_work_offset,
+	const size_t* global_work_size, const size_t* local_work_size,
+	cl_uint num_events, const cl_event* events)
+{
+	using namespace std;
+
+	char name[256] = {};
+
+	if(!IsCapturing() || clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME,
+		sizeof(name) - 1, name, NULL) || gCaptureKernel != name)
+	{
+		return;
+	}
+
+	vector<CaptureArg> args;
+
+	{
+		lock_guard<mutex> lock(gCaptureMutex);
+
+		if(!gCapturing || ++gLaunches != gCaptureLaunch)
+		{
+			return;
+		}
+
+		gCapturing = false;
+
+		const map<cl_uint, string>& refused = gRefused[kernel];
+
+		if(!refused.empty())
+		{
+			fprintf(stderr, "ocltrace: capture of %s refused: argument %u is %s\n",
+				name, refused.begin()->first, refused.begin()->second.c_str());
+
+			gArgs.clear();
+			gBuffers.clear();
+			gRefused.clear();
+			return;
+		}
+
+		const map<cl_uint, CaptureArg>& set = gArgs[kernel];
+
+		for(map<cl_uint, CaptureArg>::const_iterator itr = set.begin();
+			itr != set.end(); ++itr)
+		{
+			if(itr->first != args.size())
+			{
+				break;
+			}
+
+			args.push_back(itr->second);
+		}
+
+		gArgs.clear();
+		gBuffers.clear();
+		gRefused.clear();
+	}
+
+	string error;
+
+	if(CaptureLaunch(gCapturePath, queue, kernel, work_dim, global_work_offset,
+		global_work_size, local_work_size, num_events, events, args, error))
+	{
+		fprintf(stderr, "ocltrace: captured launch %zu of %s to %s\n",
+			gCaptureLaunch, name, gCapturePath.c_str());
+	}
+	else
+	{
+		fprintf(stderr, "ocltrace: capture of %s failed: %s\n", name, error.c_str());
+	}
+}
+
+}
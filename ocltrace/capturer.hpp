@@ -0,0 +1,62 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLTRACE_CAPTURER_HPP_
+#define OCLTRACE_CAPTURER_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <cstddef>
+
+namespace OCLT
+{
+
+// capture of one launch, $OCLTRACE_CAPTURE=kernel[:n] selects the n-th
+// (first) launch of kernel, written to $OCLTRACE_CAPTURE_FILE or
+// <kernel>.oclcap (see capture.hpp). arguments and buffers are only
+// tracked while a capture is pending.
+void StartCapture();
+
+bool IsCapturing();
+
+// a buffer created by the program
+void CaptureBuffer(cl_mem mem);
+
+// a buffer about to be released for the last time
+void ForgetBuffer(cl_mem mem);
+
+// a kernel about to be released for the last time, its handle may be
+// reused by the next kernel created
+void ForgetKernel(cl_kernel kernel);
+
+// an argument set with clSetKernelArg. images, pipes and buffers not
+// seen created cannot be captured, the launch is then refused
+void CaptureArgument(cl_kernel kernel, cl_uint index, size_t size, const void* value);
+
+// before kernel is enqueued, write the launch when it is the one selected
+void CaptureKernel(cl_command_queue queue,
+	cl_kernel kernel, cl_uint work_dim, const size_t* global_work_offset,
+	const size_t* global_work_size, const size_t* local_work_size,
+	cl_uint num_events, const cl_event* events);
+
+}
+
+#endif
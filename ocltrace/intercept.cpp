@@ -0,0 +1,599 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "capturer.hpp"
+#include "recorder.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+// the OpenCL entry points below replace those of libOpenCL when the
+// library is preloaded, each records the call and forwards it to the
+// next definition of the function, found with dlsym(RTLD_NEXT)
+
+#define iREAL(name) \
+	static decltype(&name) real_##name = \
+		reinterpret_cast<decltype(&name)>(OCLT::iNextSymbol(#name))
+
+namespace OCLT
+{
+
+namespace
+{
+
+// queues which may still have commands in flight, finished at exit so
+// that their completion callbacks have run before the trace is written
+std::mutex gQueuesMutex;
+std::set<cl_command_queue> gQueues;
+
+void* iNextSymbol(const char* name)
+{
+	void* symbol = dlsym(RTLD_NEXT, name);
+
+	if(!symbol)
+	{
+		fprintf(stderr, "ocltrace: %s not found\n", name);
+		abort();
+	}
+
+	return symbol;
+}
+
+void iSetKernelName(TraceCall* call, cl_kernel kernel)
+{
+	if(clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME,
+		sizeof(call->detail), call->detail, NULL))
+	{
+		size_t size = 0;
+		clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, NULL, &size);
+
+		std::vector<char> name(size + 1, '\0');
+		clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, size, &name[0], NULL);
+
+		SetCallDetail(call, &name[0]);
+	}
+}
+
+void iTrackQueue(cl_command_queue queue)
+{
+	std::lock_guard<std::mutex> lock(gQueuesMutex);
+	gQueues.insert(queue);
+}
+
+void iForgetQueue(cl_command_queue queue)
+{
+	std::lock_guard<std::mutex> lock(gQueuesMutex);
+	gQueues.erase(queue);
+}
+
+void iFinishQueues()
+{
+	iREAL(clFinish);
+
+	std::lock_guard<std::mutex> lock(gQueuesMutex);
+
+	for(std::set<cl_command_queue>::const_iterator itr = gQueues.begin();
+		itr != gQueues.end(); ++itr)
+	{
+		real_clFinish(*itr);
+	}
+}
+
+void iAtExit()
+{
+	iFinishQueues();
+
+	std::string path;
+
+	if(const char* env = getenv("OCLTRACE_FILE"))
+	{
+		path = env;
+	}
+	else
+	{
+		std::ostringstream str;
+		str << "ocltrace." << getpid() << ".json";
+		path = str.str();
+	}
+
+	const char* top = getenv("OCLTRACE_TOP");
+
+	WriteTrace(path, top ? strtoul(top, NULL, 10) : 10);
+}
+
+__attribute__((constructor)) void iStart()
+{
+	// atexit handlers run before libOpenCL is unloaded
+	atexit(iAtExit);
+
+	StartCapture();
+}
+
+}
+
+}
+
+using OCLT::BeginCall;
+using OCLT::EndCall;
+using OCLT::EndEnqueue;
+using OCLT::SetCallDetail;
+using OCLT::TraceCall;
+
+CL_API_ENTRY cl_command_queue CL_API_CALL clCreateCommandQueue(
+	cl_context context, cl_device_id device,
+	cl_command_queue_properties properties, cl_int* errcode_ret)
+{
+	iREAL(clCreateCommandQueue);
+
+	TraceCall* call = BeginCall("clCreateCommandQueue");
+
+	// device timestamps need profiling
+	cl_command_queue queue = real_clCreateCommandQueue(
+		context, device, properties | CL_QUEUE_PROFILING_ENABLE, errcode_ret);
+
+	if(queue)
+	{
+		OCLT::iTrackQueue(queue);
+	}
+
+	EndCall(call);
+
+	return queue;
+}
+
+#ifdef CL_VERSION_2_0
+CL_API_ENTRY cl_command_queue CL_API_CALL clCreateCommandQueueWithProperties(
+	cl_context context, cl_device_id device,
+	const cl_queue_properties* properties, cl_int* errcode_ret)
+{
+	iREAL(clCreateCommandQueueWithProperties);
+
+	TraceCall* call = BeginCall("clCreateCommandQueueWithProperties");
+
+	std::vector<cl_queue_properties> profiling;
+	bool found = false;
+
+	for(size_t i = 0; properties && properties[i]; i += 2)
+	{
+		profiling.push_back(properties[i]);
+		profiling.push_back(properties[i + 1]);
+
+		if(properties[i] == CL_QUEUE_PROPERTIES)
+		{
+			profiling.back() |= CL_QUEUE_PROFILING_ENABLE;
+			found = true;
+		}
+	}
+
+	if(!found)
+	{
+		profiling.push_back(CL_QUEUE_PROPERTIES);
+		profiling.push_back(CL_QUEUE_PROFILING_ENABLE);
+	}
+
+	profiling.push_back(0);
+
+	cl_command_queue queue = real_clCreateCommandQueueWithProperties(
+		context, device, &profiling[0], errcode_ret);
+
+	if(queue)
+	{
+		OCLT::iTrackQueue(queue);
+	}
+
+	EndCall(call);
+
+	return queue;
+}
+#endif
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseCommandQueue(cl_command_queue queue)
+{
+	iREAL(clReleaseCommandQueue);
+	iREAL(clFinish);
+
+	cl_uint references = 0;
+
+	// before the last reference goes, finish the queue so that the
+	// callbacks of its commands run while the trace can take them
+	if(!clGetCommandQueueInfo(queue, CL_QUEUE_REFERENCE_COUNT,
+		sizeof(references), &references, NULL) && references == 1)
+	{
+		real_clFinish(queue);
+		OCLT::iForgetQueue(queue);
+	}
+
+	return real_clReleaseCommandQueue(queue);
+}
+
+CL_API_ENTRY cl_mem CL_API_CALL clCreateBuffer(cl_context context,
+	cl_mem_flags flags, size_t size, void* host_ptr, cl_int* errcode_ret)
+{
+	iREAL(clCreateBuffer);
+
+	cl_mem mem = real_clCreateBuffer(context, flags, size, host_ptr, errcode_ret);
+
+	if(mem && OCLT::IsCapturing())
+	{
+		OCLT::CaptureBuffer(mem);
+	}
+
+	return mem;
+}
+
+#ifdef CL_VERSION_1_1
+CL_API_ENTRY cl_mem CL_API_CALL clCreateSubBuffer(cl_mem buffer,
+	cl_mem_flags flags, cl_buffer_create_type buffer_create_type,
+	const void* buffer_create_info, cl_int* errcode_ret)
+{
+	iREAL(clCreateSubBuffer);
+
+	cl_mem mem = real_clCreateSubBuffer(
+		buffer, flags, buffer_create_type, buffer_create_info, errcode_ret);
+
+	if(mem && OCLT::IsCapturing())
+	{
+		OCLT::CaptureBuffer(mem);
+	}
+
+	return mem;
+}
+#endif
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseMemObject(cl_mem mem)
+{
+	iREAL(clReleaseMemObject);
+
+	cl_uint references = 0;
+
+	if(OCLT::IsCapturing() && !clGetMemObjectInfo(mem, CL_MEM_REFERENCE_COUNT,
+		sizeof(references), &references, NULL) && references == 1)
+	{
+		OCLT::ForgetBuffer(mem);
+	}
+
+	return real_clReleaseMemObject(mem);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseKernel(cl_kernel kernel)
+{
+	iREAL(clReleaseKernel);
+
+	cl_uint references = 0;
+
+	if(OCLT::IsCapturing() && !clGetKernelInfo(kernel, CL_KERNEL_REFERENCE_COUNT,
+		sizeof(references), &references, NULL) && references == 1)
+	{
+		OCLT::ForgetKernel(kernel);
+	}
+
+	return real_clReleaseKernel(kernel);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clSetKernelArg(cl_kernel kernel,
+	cl_uint arg_index, size_t arg_size, const void* arg_value)
+{
+	iREAL(clSetKernelArg);
+
+	cl_int err = real_clSetKernelArg(kernel, arg_index, arg_size, arg_value);
+
+	if(!err && OCLT::IsCapturing())
+	{
+		OCLT::CaptureArgument(kernel, arg_index, arg_size, arg_value);
+	}
+
+	return err;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueNDRangeKernel(
+	cl_command_queue queue, cl_kernel kernel, cl_uint work_dim,
+	const size_t* global_work_offset, const size_t* global_work_size,
+	const size_t* local_work_size, cl_uint num_events_in_wait_list,
+	const cl_event* event_wait_list, cl_event* event)
+{
+	iREAL(clEnqueueNDRangeKernel);
+
+	if(OCLT::IsCapturing())
+	{
+		OCLT::CaptureKernel(queue, kernel, work_dim, global_work_offset,
+			global_work_size, local_work_size, num_events_in_wait_list,
+			event_wait_list);
+	}
+
+	TraceCall* call = BeginCall("clEnqueueNDRangeKernel", queue);
+	OCLT::iSetKernelName(call, kernel);
+
+	cl_event own = NULL;
+	cl_int err = real_clEnqueueNDRangeKernel(queue, kernel, work_dim,
+		global_work_offset, global_work_size, local_work_size,
+		num_events_in_wait_list, event_wait_list, event ? event : &own);
+
+	EndEnqueue(call, err, event ? *event : own, !event);
+
+	return err;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueReadBuffer(
+	cl_command_queue queue, cl_mem buffer, cl_bool blocking_read,
+	size_t offset, size_t size, void* ptr, cl_uint num_events_in_wait_list,
+	const cl_event* event_wait_list, cl_event* event)
+{
+	iREAL(clEnqueueReadBuffer);
+
+	TraceCall* call = BeginCall("clEnqueueReadBuffer", queue);
+	call->bytes = size;
+
+	cl_event own = NULL;
+	cl_int err = real_clEnqueueReadBuffer(queue, buffer, blocking_read,
+		offset, size, ptr, num_events_in_wait_list, event_wait_list,
+		event ? event : &own);
+
+	EndEnqueue(call, err, event ? *event : own, !event);
+
+	return err;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueWriteBuffer(
+	cl_command_queue queue, cl_mem buffer, cl_bool blocking_write,
+	size_t offset, size_t size, const void* ptr, cl_uint num_events_in_wait_list,
+	const cl_event* event_wait_list, cl_event* event)
+{
+	iREAL(clEnqueueWriteBuffer);
+
+	TraceCall* call = BeginCall("clEnqueueWriteBuffer", queue);
+	call->bytes = size;
+
+	cl_event own = NULL;
+	cl_int err = real_clEnqueueWriteBuffer(queue, buffer, blocking_write,
+		offset, size, ptr, num_events_in_wait_list, event_wait_list,
+		event ? event : &own);
+
+	EndEnqueue(call, err, event ? *event : own, !event);
+
+	return err;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueCopyBuffer(
+	cl_command_queue queue, cl_mem src_buffer, cl_mem dst_buffer,
+	size_t src_offset, size_t dst_offset, size_t size,
+	cl_uint num_events_in_wait_list, const cl_event* event_wait_list,
+	cl_event* event)
+{
+	iREAL(clEnqueueCopyBuffer);
+
+	TraceCall* call = BeginCall("clEnqueueCopyBuffer", queue);
+	call->bytes = size;
+
+	cl_event own = NULL;
+	cl_int err = real_clEnqueueCopyBuffer(queue, src_buffer, dst_buffer,
+		src_offset, dst_offset, size, num_events_in_wait_list, event_wait_list,
+		event ? event : &own);
+
+	EndEnqueue(call, err, event ? *event : own, !event);
+
+	return err;
+}
+
+#ifdef CL_VERSION_1_2
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueFillBuffer(
+	cl_command_queue queue, cl_mem buffer, const void* pattern,
+	size_t pattern_size, size_t offset, size_t size,
+	cl_uint num_events_in_wait_list, const cl_event* event_wait_list,
+	cl_event* event)
+{
+	iREAL(clEnqueueFillBuffer);
+
+	TraceCall* call = BeginCall("clEnqueueFillBuffer", queue);
+	call->bytes = size;
+
+	cl_event own = NULL;
+	cl_int err = real_clEnqueueFillBuffer(queue, buffer, pattern,
+		pattern_size, offset, size, num_events_in_wait_list, event_wait_list,
+		event ? event : &own);
+
+	EndEnqueue(call, err, event ? *event : own, !event);
+
+	return err;
+}
+#endif
+
+CL_API_ENTRY void* CL_API_CALL clEnqueueMapBuffer(
+	cl_command_queue queue, cl_mem buffer, cl_bool blocking_map,
+	cl_map_flags map_flags, size_t offset, size_t size,
+	cl_uint num_events_in_wait_list, const cl_event* event_wait_list,
+	cl_event* event, cl_int* errcode_ret)
+{
+	iREAL(clEnqueueMapBuffer);
+
+	TraceCall* call = BeginCall("clEnqueueMapBuffer", queue);
+	call->bytes = size;
+
+	cl_event own = NULL;
+	cl_int err = CL_SUCCESS;
+	void* mapped = real_clEnqueueMapBuffer(queue, buffer, blocking_map,
+		map_flags, offset, size, num_events_in_wait_list, event_wait_list,
+		event ? event : &own, &err);
+
+	EndEnqueue(call, err, event ? *event : own, !event);
+
+	if(errcode_ret)
+	{
+		*errcode_ret = err;
+	}
+
+	return mapped;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueUnmapMemObject(
+	cl_command_queue queue, cl_mem memobj, void* mapped_ptr,
+	cl_uint num_events_in_wait_list, const cl_event* event_wait_list,
+	cl_event* event)
+{
+	iREAL(clEnqueueUnmapMemObject);
+
+	TraceCall* call = BeginCall("clEnqueueUnmapMemObject", queue);
+
+	cl_event own = NULL;
+	cl_int err = real_clEnqueueUnmapMemObject(queue, memobj, mapped_ptr,
+		num_events_in_wait_list, event_wait_list, event ? event : &own);
+
+	EndEnqueue(call, err, event ? *event : own, !event);
+
+	return err;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clFlush(cl_command_queue queue)
+{
+	iREAL(clFlush);
+
+	TraceCall* call = BeginCall("clFlush", queue);
+	cl_int err = real_clFlush(queue);
+	EndCall(call);
+
+	return err;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clFinish(cl_command_queue queue)
+{
+	iREAL(clFinish);
+
+	TraceCall* call = BeginCall("clFinish", queue);
+	cl_int err = real_clFinish(queue);
+	EndCall(call);
+
+	return err;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clWaitForEvents(
+	cl_uint num_events, const cl_event* event_list)
+{
+	iREAL(clWaitForEvents);
+
+	TraceCall* call = BeginCall("clWaitForEvents");
+	cl_int err = real_clWaitForEvents(num_events, event_list);
+	EndCall(call);
+
+	return err;
+}
+
+CL_API_ENTRY cl_program CL_API_CALL clCreateProgramWithSource(
+	cl_context context, cl_uint count, const char** strings,
+	const size_t* lengths, cl_int* errcode_ret)
+{
+	iREAL(clCreateProgramWithSource);
+
+	TraceCall* call = BeginCall("clCreateProgramWithSource");
+
+	for(cl_uint i = 0; strings && i < count; ++i)
+	{
+		call->bytes += lengths && lengths[i] ? lengths[i] : strlen(strings[i]);
+	}
+
+	cl_program program = real_clCreateProgramWithSource(
+		context, count, strings, lengths, errcode_ret);
+	EndCall(call);
+
+	return program;
+}
+
+CL_API_ENTRY cl_program CL_API_CALL clCreateProgramWithBinary(
+	cl_context context, cl_uint num_devices, const cl_device_id* device_list,
+	const size_t* lengths, const unsigned char** binaries,
+	cl_int* binary_status, cl_int* errcode_ret)
+{
+	iREAL(clCreateProgramWithBinary);
+
+	TraceCall* call = BeginCall("clCreateProgramWithBinary");
+
+	for(cl_uint i = 0; lengths && i < num_devices; ++i)
+	{
+		call->bytes += lengths[i];
+	}
+
+	cl_program program = real_clCreateProgramWithBinary(context, num_devices,
+		device_list, lengths, binaries, binary_status, errcode_ret);
+	EndCall(call);
+
+	return program;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clBuildProgram(
+	cl_program program, cl_uint num_devices, const cl_device_id* device_list,
+	const char* options, void (CL_CALLBACK* pfn_notify)(cl_program, void*),
+	void* user_data)
+{
+	iREAL(clBuildProgram);
+
+	TraceCall* call = BeginCall("clBuildProgram");
+	SetCallDetail(call, options);
+
+	cl_int err = real_clBuildProgram(
+		program, num_devices, device_list, options, pfn_notify, user_data);
+	EndCall(call);
+
+	return err;
+}
+
+#ifdef CL_VERSION_1_2
+CL_API_ENTRY cl_int CL_API_CALL clCompileProgram(
+	cl_program program, cl_uint num_devices, const cl_device_id* device_list,
+	const char* options, cl_uint num_input_headers,
+	const cl_program* input_headers, const char** header_include_names,
+	void (CL_CALLBACK* pfn_notify)(cl_program, void*), void* user_data)
+{
+	iREAL(clCompileProgram);
+
+	TraceCall* call = BeginCall("clCompileProgram");
+	SetCallDetail(call, options);
+
+	cl_int err = real_clCompileProgram(program, num_devices, device_list,
+		options, num_input_headers, input_headers, header_include_names,
+		pfn_notify, user_data);
+	EndCall(call);
+
+	return err;
+}
+
+CL_API_ENTRY cl_program CL_API_CALL clLinkProgram(
+	cl_context context, cl_uint num_devices, const cl_device_id* device_list,
+	const char* options, cl_uint num_input_programs,
+	const cl_program* input_programs,
+	void (CL_CALLBACK* pfn_notify)(cl_program, void*), void* user_data,
+	cl_int* errcode_ret)
+{
+	iREAL(clLinkProgram);
+
+	TraceCall* call = BeginCall("clLinkProgram");
+	SetCallDetail(call, options);
+
+	cl_program program = real_clLinkProgram(context, num_devices, device_list,
+		options, num_input_programs, input_programs, pfn_notify, user_data,
+		errcode_ret);
+	EndCall(call);
+
+	return program;
+}
+#endif
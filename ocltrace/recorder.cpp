@@ -0,0 +1,438 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include "recorder.hpp"
+#include "file.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <unistd.h>
+
+namespace OCLT
+{
+
+namespace
+{
+
+const size_t iChunkSize = 1024;
+
+struct CallChunk
+{
+	CallChunk() : used(0), next(NULL) {}
+
+	TraceCall calls[iChunkSize];
+	std::atomic<size_t> used;  // published calls
+	std::atomic<CallChunk*> next;
+};
+
+// calls of one thread, appended by that thread only. calls are published
+// once every call begun on the thread has ended, so that a call made
+// inside another one (by a driver) does not publish the outer one early.
+struct ThreadCalls
+{
+	int thread;
+	CallChunk* head;
+	CallChunk* tail;
+	CallChunk* unpublished;  // first chunk with calls not yet published
+	size_t reserved;         // calls begun in tail
+	int open;                // calls begun and not ended
+	ThreadCalls* next;
+};
+
+struct KernelTotal
+{
+	KernelTotal() : calls(0), total(0), longest(0) {}
+
+	std::string name;
+	size_t calls;
+	cl_ulong total;
+	cl_ulong longest;
+};
+
+// never freed, threads may still record while the trace is written
+std::atomic<ThreadCalls*> gThreads(NULL);
+std::atomic<int> gNextThread(0);
+
+ThreadCalls* iThreadCalls()
+{
+	static thread_local ThreadCalls* calls = NULL;
+
+	if(!calls)
+	{
+		calls = new ThreadCalls;
+		calls->thread = gNextThread++;
+		calls->head = calls->tail = calls->unpublished = new CallChunk;
+		calls->reserved = 0;
+		calls->open = 0;
+		calls->next = gThreads.load();
+
+		while(!gThreads.compare_exchange_weak(calls->next, calls))
+		{
+		}
+	}
+
+	return calls;
+}
+
+void iPublish()
+{
+	ThreadCalls* thread = iThreadCalls();
+
+	if(--thread->open)
+	{
+		return;
+	}
+
+	for(CallChunk* chunk = thread->unpublished; chunk != thread->tail;
+		chunk = chunk->next.load())
+	{
+		chunk->used.store(iChunkSize, std::memory_order_release);
+	}
+
+	thread->tail->used.store(thread->reserved, std::memory_order_release);
+	thread->unpublished = thread->tail;
+}
+
+void CL_CALLBACK iOnComplete(cl_event event, cl_int status, void* data)
+{
+	TraceCall* call = static_cast<TraceCall*>(data);
+
+	bool ok = status == CL_COMPLETE &&
+		!clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED,
+			sizeof(cl_ulong), &call->queued, NULL) &&
+		!clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT,
+			sizeof(cl_ulong), &call->submit, NULL) &&
+		!clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+			sizeof(cl_ulong), &call->start, NULL) &&
+		!clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+			sizeof(cl_ulong), &call->end, NULL);
+
+	if(call->event)
+	{
+		clReleaseEvent(call->event);
+	}
+
+	call->state.store(ok ? TRACE_COMPLETE : TRACE_FAILED, std::memory_order_release);
+}
+
+// every published call of every thread
+void iCollect(std::vector<const TraceCall*>& calls, std::vector<int>& threads)
+{
+	for(ThreadCalls* thread = gThreads.load(); thread; thread = thread->next)
+	{
+		for(CallChunk* chunk = thread->head; chunk; chunk = chunk->next.load())
+		{
+			size_t used = chunk->used.load(std::memory_order_acquire);
+
+			for(size_t i = 0; i < used; ++i)
+			{
+				calls.push_back(&chunk->calls[i]);
+				threads.push_back(thread->thread);
+			}
+		}
+	}
+}
+
+bool iIsComplete(const TraceCall* call)
+{
+	return call->state.load(std::memory_order_acquire) == TRACE_COMPLETE &&
+		call->end >= call->start && call->start >= call->queued;
+}
+
+bool iWriteJson(const std::string& path,
+	const std::vector<const TraceCall*>& calls, const std::vector<int>& threads)
+{
+	using namespace std;
+
+	long long origin = 0;
+
+	for(size_t i = 0; i < calls.size(); ++i)
+	{
+		if(!i || calls[i]->hostStart < origin)
+		{
+			origin = calls[i]->hostStart;
+		}
+	}
+
+	const int hostPid = 1;
+	const int devicePid = 2;
+
+	string json = "{\"traceEvents\":[\n";
+	char buf[256];
+
+	snprintf(buf, sizeof(buf),
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"host\"}},\n"
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"device\"}}",
+		hostPid, devicePid);
+	json += buf;
+
+	map<cl_command_queue, int> queues;
+
+	for(size_t i = 0; i < calls.size(); ++i)
+	{
+		const TraceCall* call = calls[i];
+
+		json += ",\n{\"name\":";
+		AppendJsonString(json, call->function);
+
+		snprintf(buf, sizeof(buf),
+			",\"cat\":\"host\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+			"\"pid\":%d,\"tid\":%d,\"args\":{",
+			(call->hostStart - origin) / 1e3, (call->hostEnd - call->hostStart) / 1e3,
+			hostPid, threads[i]);
+		json += buf;
+
+		snprintf(buf, sizeof(buf), "\"bytes\":%zu", call->bytes);
+		json += buf;
+
+		if(call->detail[0])
+		{
+			json += ",\"detail\":";
+			AppendJsonString(json, call->detail);
+		}
+
+		json += "}}";
+
+		if(!iIsComplete(call))
+		{
+			continue;
+		}
+
+		if(queues.find(call->queue) == queues.end())
+		{
+			int index = queues.size();
+			queues[call->queue] = index;
+
+			snprintf(buf, sizeof(buf),
+				",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+				"\"args\":{\"name\":\"queue %d\"}}", devicePid, index, index);
+			json += buf;
+		}
+
+		// device clocks are not the host clock, the command is placed
+		// relative to its enqueue
+		json += ",\n{\"name\":";
+		AppendJsonString(json, call->detail[0] ? call->detail : call->function);
+
+		snprintf(buf, sizeof(buf),
+			",\"cat\":\"device\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+			"\"pid\":%d,\"tid\":%d,\"args\":{\"queued_to_submit_us\":%.3f,"
+			"\"submit_to_start_us\":%.3f}}",
+			(call->hostStart - origin + (call->start - call->queued)) / 1e3,
+			(call->end - call->start) / 1e3, devicePid, queues[call->queue],
+			(call->submit - call->queued) / 1e3, (call->start - call->submit) / 1e3);
+		json += buf;
+	}
+
+	for(size_t i = 0; i < threads.size(); ++i)
+	{
+		if(find(threads.begin(), threads.begin() + i, threads[i]) !=
+			threads.begin() + i)
+		{
+			continue;
+		}
+
+		snprintf(buf, sizeof(buf),
+			",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+			"\"args\":{\"name\":\"thread %d\"}}", hostPid, threads[i], threads[i]);
+		json += buf;
+	}
+
+	json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return WriteFileAtomic(path, json.data(), json.size());
+}
+
+bool iByTotal(const KernelTotal& a, const KernelTotal& b)
+{
+	return a.total > b.total;
+}
+
+void iPrintSummary(const std::vector<const TraceCall*>& calls, size_t top)
+{
+	using namespace std;
+
+	map<string, KernelTotal> totals;
+	cl_ulong device = 0;
+	size_t pending = 0;
+
+	for(size_t i = 0; i < calls.size(); ++i)
+	{
+		const TraceCall* call = calls[i];
+
+		if(call->state.load(memory_order_acquire) == TRACE_PENDING)
+		{
+			++pending;
+		}
+
+		if(!iIsComplete(call) || strcmp(call->function, "clEnqueueNDRangeKernel"))
+		{
+			continue;
+		}
+
+		KernelTotal& total = totals[call->detail];
+		cl_ulong time = call->end - call->start;
+
+		total.name = call->detail;
+		++total.calls;
+		total.total += time;
+		total.longest = max(total.longest, time);
+		device += time;
+	}
+
+	vector<KernelTotal> kernels;
+
+	for(map<string, KernelTotal>::const_iterator itr = totals.begin();
+		itr != totals.end(); ++itr)
+	{
+		kernels.push_back(itr->second);
+	}
+
+	sort(kernels.begin(), kernels.end(), iByTotal);
+
+	fprintf(stderr, "ocltrace: %zu calls, %zu kernels, %.3f ms kernel time",
+		calls.size(), kernels.size(), device / 1e6);
+
+	if(pending)
+	{
+		fprintf(stderr, ", %zu commands did not complete", pending);
+	}
+
+	fprintf(stderr, "\n");
+
+	if(kernels.empty())
+	{
+		return;
+	}
+
+	fprintf(stderr, "%-32s %8s %12s %12s %12s %6s\n",
+		"kernel", "calls", "total ms", "mean us", "max us", "%");
+
+	for(size_t i = 0; i < kernels.size() && i < top; ++i)
+	{
+		const KernelTotal& total = kernels[i];
+
+		fprintf(stderr, "%-32s %8zu %12.3f %12.3f %12.3f %6.1f\n",
+			total.name.c_str(), total.calls, total.total / 1e6,
+			total.total / 1e3 / total.calls, total.longest / 1e3,
+			device ? 100.0 * total.total / device : 0.0);
+	}
+}
+
+}
+
+long long TraceNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceCall* BeginCall(const char* function, cl_command_queue queue)
+{
+	ThreadCalls* thread = iThreadCalls();
+
+	if(thread->reserved == iChunkSize)
+	{
+		CallChunk* chunk = new CallChunk;
+		thread->tail->next.store(chunk);
+		thread->tail = chunk;
+		thread->reserved = 0;
+	}
+
+	TraceCall* call = &thread->tail->calls[thread->reserved++];
+	++thread->open;
+
+	call->function = function;
+	call->detail[0] = '\0';
+	call->queue = queue;
+	call->bytes = 0;
+	call->queued = call->submit = call->start = call->end = 0;
+	call->event = NULL;
+	call->state.store(TRACE_HOST, std::memory_order_relaxed);
+	call->hostStart = TraceNow();
+
+	return call;
+}
+
+void SetCallDetail(TraceCall* call, const char* str)
+{
+	strncpy(call->detail, str ? str : "", sizeof(call->detail) - 1);
+	call->detail[sizeof(call->detail) - 1] = '\0';
+}
+
+void EndCall(TraceCall* call)
+{
+	call->hostEnd = TraceNow();
+
+	iPublish();
+}
+
+void EndEnqueue(TraceCall* call, cl_int err, cl_event event, bool own_event)
+{
+	call->hostEnd = TraceNow();
+
+	if(!err && event)
+	{
+		call->event = own_event ? event : NULL;
+		call->state.store(TRACE_PENDING, std::memory_order_relaxed);
+
+		if(clSetEventCallback(event, CL_COMPLETE, iOnComplete, call))
+		{
+			call->state.store(TRACE_FAILED, std::memory_order_relaxed);
+
+			if(own_event)
+			{
+				clReleaseEvent(event);
+			}
+		}
+	}
+
+	iPublish();
+}
+
+void WriteTrace(const std::string& path, size_t top)
+{
+	std::vector<const TraceCall*> calls;
+	std::vector<int> threads;
+
+	iCollect(calls, threads);
+
+	// children of the traced program which never call OpenCL
+	if(calls.empty())
+	{
+		return;
+	}
+
+	if(!path.empty() && !iWriteJson(path, calls, threads))
+	{
+		fprintf(stderr, "ocltrace: can not write %s\n", path.c_str());
+	}
+	else if(!path.empty())
+	{
+		fprintf(stderr, "ocltrace: wrote %s\n", path.c_str());
+	}
+
+	iPrintSummary(calls, top);
+}
+
+}
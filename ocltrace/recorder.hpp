@@ -0,0 +1,85 @@
+/*
+ * OpenCL tools
+ *
+ * Copyright (C) 2011 Yusuke Suzuki 
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef OCLTRACE_RECORDER_HPP_
+#define OCLTRACE_RECORDER_HPP_
+
+#if !APPLE
+	#include <CL/cl.h>
+#else
+	#include <OpenCL/opencl.h>
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace OCLT
+{
+
+enum TraceCallState
+{
+	TRACE_HOST,      // no device work, or the command was not enqueued
+	TRACE_PENDING,   // waiting for the event of the command
+	TRACE_COMPLETE,  // device timestamps are set
+	TRACE_FAILED,    // the command ended in an error
+};
+
+// one intercepted call. host times are steady clock nanoseconds, device
+// times are profiling counters of the device, set by the completion
+// callback of the command before state becomes TRACE_COMPLETE.
+struct TraceCall
+{
+	const char* function;
+	char detail[64];  // kernel name or build options
+	cl_command_queue queue;
+	size_t bytes;
+	long long hostStart;
+	long long hostEnd;
+	cl_ulong queued;
+	cl_ulong submit;
+	cl_ulong start;
+	cl_ulong end;
+	cl_event event;  // released by the callback, NULL when it is the caller's
+	std::atomic<int> state;
+};
+
+long long TraceNow();
+
+// a record in the buffer of the calling thread, started now. buffers
+// only grow and records never move, appending takes no lock.
+TraceCall* BeginCall(const char* function, cl_command_queue queue = NULL);
+
+// detail of call from str, truncated
+void SetCallDetail(TraceCall* call, const char* str);
+
+// end call now and make it visible to WriteTrace()
+void EndCall(TraceCall* call);
+
+// end an enqueue which returned err. on success the device timestamps
+// of event are collected when the command completes, an event created
+// for the trace (own_event) is released then.
+void EndEnqueue(TraceCall* call, cl_int err, cl_event event, bool own_event);
+
+// write the calls of every thread as chrome://tracing / Perfetto JSON to
+// path (unless empty) and print the top kernels by device time to stderr.
+// nothing is done when no call was recorded.
+void WriteTrace(const std::string& path, size_t top);
+
+}
+
+#endif